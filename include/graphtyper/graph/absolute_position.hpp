@@ -6,6 +6,8 @@
 
 #include <boost/serialization/access.hpp>
 
+#include <graphtyper/constants.hpp>
+
 
 namespace gyper
 {
@@ -15,8 +17,8 @@ class Contig;
 class AbsolutePosition
 {
 public:
-  std::vector<uint32_t> offsets;
-  std::unordered_map<std::string, uint32_t> chromosome_to_offset;
+  std::vector<TAbsPos> offsets;
+  std::unordered_map<std::string, TAbsPos> chromosome_to_offset;
 
   AbsolutePosition() = default;
   AbsolutePosition(std::vector<Contig> const & contigs);
@@ -26,10 +28,10 @@ public:
 
   ///* const methods */
   bool is_contig_available(std::string const & chromosome) const;
-  uint32_t get_absolute_position(std::string const & chromosome, uint32_t contig_position) const;
+  TAbsPos get_absolute_position(std::string const & chromosome, uint32_t contig_position) const;
 
   std::pair<std::string, uint32_t>
-  get_contig_position(uint32_t absolute_position,
+  get_contig_position(TAbsPos absolute_position,
                       std::vector<Contig> const & contigs) const;
 
 
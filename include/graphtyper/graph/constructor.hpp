@@ -19,6 +19,12 @@ void construct_graph(std::string const & reference_filename,
                      bool use_absolute_positions = true,
                      bool check_index = true);
 
+// Constructs a graph with the variant sites of a previous step, as if they had been written to and read from a VCF
+void construct_graph(std::string const & reference_filename,
+                     std::vector<Variant> const & variants,
+                     std::string const & region,
+                     bool use_absolute_positions = true);
+
 std::vector<Variant>
 get_variants_using_tabix(std::string const & vcf, GenomicRegion const & genomic_region);
 
@@ -8,6 +8,8 @@
 
 #include <boost/serialization/access.hpp>
 
+#include <graphtyper/constants.hpp>
+
 
 namespace gyper
 {
@@ -34,11 +36,11 @@ public:
   void clear();
   void pad(long N_bases); // pad region by N_bases
   void pad_end(long N_bases); // pad end of region by N_bases
-  uint32_t get_absolute_begin_position() const;
-  uint32_t get_absolute_end_position() const;
-  uint32_t get_absolute_position(std::string const & chromosome, uint32_t contig_position) const;
-  uint32_t get_absolute_position(uint32_t contig_position) const;
-  std::pair<std::string, uint32_t> get_contig_position(uint32_t absolute_position, Graph const & graph) const;
+  TAbsPos get_absolute_begin_position() const;
+  TAbsPos get_absolute_end_position() const;
+  TAbsPos get_absolute_position(std::string const & chromosome, uint32_t contig_position) const;
+  TAbsPos get_absolute_position(uint32_t contig_position) const;
+  std::pair<std::string, uint32_t> get_contig_position(TAbsPos absolute_position, Graph const & graph) const;
   std::string to_string() const;
 
   void check_if_var_records_match_reference_genome(std::vector<VarRecord> const & var_records,
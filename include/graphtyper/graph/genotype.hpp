@@ -3,6 +3,9 @@
 #include <cstdint>
 
 #include <boost/serialization/access.hpp>
+#include <boost/serialization/version.hpp>
+
+#include <graphtyper/constants.hpp>
 
 
 namespace gyper
@@ -13,12 +16,12 @@ class Genotype
   friend class boost::serialization::access;
 
 public:
-  uint32_t id;
+  TAbsPos id; // Order of the first variant node
   uint16_t num;
   uint32_t first_variant_node;
 
   Genotype();
-  Genotype(uint32_t i, uint16_t n, uint32_t fvn);
+  Genotype(TAbsPos i, uint16_t n, uint32_t fvn);
 
 private:
   template <class Archive>
@@ -26,3 +29,6 @@ private:
 };
 
 } // namespace gyper
+
+// Archives of the two position widths are not compatible
+BOOST_CLASS_VERSION(gyper::Genotype, gyper::ABS_POS_ARCHIVE_VERSION)
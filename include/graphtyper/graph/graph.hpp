@@ -13,6 +13,7 @@
 #include <graphtyper/graph/haplotype.hpp>
 #include <graphtyper/graph/location.hpp>
 #include <graphtyper/graph/node.hpp>
+#include <graphtyper/graph/packed_sequence.hpp>
 #include <graphtyper/graph/sv.hpp>
 #include <graphtyper/index/kmer_label.hpp>
 #include <graphtyper/typer/path.hpp>
@@ -50,7 +51,7 @@ public:
   bool use_absolute_positions{true};
   bool is_sv_graph{false};
   GenomicRegion genomic_region;
-  std::vector<char> reference;
+  PackedSequence reference;
   //uint32_t reference_offset{0};
   AbsolutePosition absolute_pos;
   std::vector<RefNode> ref_nodes;
@@ -79,17 +80,18 @@ public:
    * GRAPH ACCESS *
    ****************/
   std::vector<char> get_all_ref() const;
-  std::vector<char> get_ref(uint32_t from, uint32_t to) const;
-  std::vector<char> get_generated_reference_genome(uint32_t & from, uint32_t & to) const;
-  std::vector<char> get_reference_ref(uint32_t & from, uint32_t & to) const;
+  std::vector<char> get_ref(TAbsPos from, TAbsPos to) const;
+  std::vector<char> get_generated_reference_genome(TAbsPos & from, TAbsPos & to) const;
+  PackedSequenceView get_generated_reference_view(TAbsPos & from, TAbsPos & to) const; // Same range, no copy
+  std::vector<char> get_reference_ref(TAbsPos & from, TAbsPos & to) const;
   std::vector<char> get_first_var() const;
-  std::vector<char> walk_random_path(uint32_t from, uint32_t to) const;
+  std::vector<char> walk_random_path(TAbsPos from, TAbsPos to) const;
 
   /*********************
    * GRAPH INFORMATION *
    *********************/
   std::size_t size() const;
-  uint32_t get_variant_order(long variant_id) const;
+  TAbsPos get_variant_order(long variant_id) const;
   uint16_t get_variant_num(uint32_t v) const;
   std::vector<Haplotype> get_all_haplotypes(uint32_t variant_distance = MAX_READ_LENGTH) const;
 
@@ -116,8 +118,8 @@ public:
   reference_distance_between_locations(std::vector<Location> const & ll1,
                                        std::vector<Location> const & ll2) const;
 
-  std::vector<Location> get_locations_of_a_position(uint32_t pos, Path const & path) const;
-  std::vector<Location> get_locations_of_an_actual_position(uint32_t pos,
+  std::vector<Location> get_locations_of_a_position(TAbsPos pos, Path const & path) const;
+  std::vector<Location> get_locations_of_an_actual_position(TAbsPos pos,
                                                             Path const & path,
                                                             bool const is_special = false) const;
 
@@ -140,15 +142,15 @@ public:
   /*********************
    * SPECIAL POSITIONS *
    *********************/
-  void add_special_pos(uint32_t reach, uint32_t ref_reach);
-  bool is_special_pos(uint32_t pos) const;
-  uint32_t get_special_pos(uint32_t pos, uint32_t ref_reach) const;
-  uint32_t get_ref_reach_pos(uint32_t pos) const;
-  uint32_t get_actual_pos(uint32_t pos) const;
+  void add_special_pos(TAbsPos reach, TAbsPos ref_reach);
+  bool is_special_pos(TAbsPos pos) const;
+  TAbsPos get_special_pos(TAbsPos pos, TAbsPos ref_reach) const;
+  TAbsPos get_ref_reach_pos(TAbsPos pos) const;
+  TAbsPos get_actual_pos(TAbsPos pos) const;
 
-  std::unordered_map<uint32_t, std::vector<uint32_t> > ref_reach_to_special_pos;
-  std::vector<uint32_t> ref_reach_poses;
-  std::vector<uint32_t> actual_poses;
+  std::unordered_map<TAbsPos, std::vector<TAbsPos> > ref_reach_to_special_pos;
+  std::vector<TAbsPos> ref_reach_poses;
+  std::vector<TAbsPos> actual_poses;
 
   /**
    * ERROR CHECKING
@@ -162,7 +164,7 @@ public:
   /**
    * Other
    */
-  std::vector<uint32_t> get_var_orders(uint32_t const start, uint32_t const end) const;
+  std::vector<TAbsPos> get_var_orders(TAbsPos const start, TAbsPos const end) const;
   void print() const;
 
 private:
@@ -172,7 +174,7 @@ private:
   /**********************
    * GRAPH MODIFICATION *
    **********************/
-  void add_reference(unsigned end_pos,
+  void add_reference(TAbsPos end_pos,
                      unsigned const & num_var,
                      std::vector<char> const & reference_sequence
                      );
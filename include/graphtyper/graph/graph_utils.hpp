@@ -75,9 +75,12 @@ count_mismatches_backward(std::vector<char> const & read,
 
 
 void inline
-add_node_dna_to_sequence(std::vector<char> & seq, gyper::Label const & label, uint32_t const from, uint32_t const to)
+add_node_dna_to_sequence(std::vector<char> & seq,
+                         gyper::Label const & label,
+                         gyper::TAbsPos const from,
+                         gyper::TAbsPos const to)
 {
-  uint32_t const dna_end = label.order + label.dna.size();
+  gyper::TAbsPos const dna_end = label.order + label.dna.size();
 
   if (to <= from or dna_end <= from or label.order >= to)
     return;
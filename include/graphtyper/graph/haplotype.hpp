@@ -104,7 +104,7 @@ public:
   std::vector<uint16_t> get_haplotype_calls() const;
   uint32_t get_genotype_num() const;
   bool has_too_many_genotypes() const;
-  std::vector<uint32_t> get_genotype_ids() const;
+  std::vector<TAbsPos> get_genotype_ids() const;
 
   /** Update likelihood and stats */
   void explain_to_score(std::size_t pn_index,
@@ -32,7 +32,7 @@ make_variant_of_gapped_strings(std::string & gapped_ref,
                                long & ref_to_seq_offset);
 
 std::vector<VariantCandidate>
-find_variants_in_alignment(uint32_t pos,
+find_variants_in_alignment(TAbsPos pos,
                            std::vector<char> const & ref,
                            std::vector<char> const & seq,
                            std::vector<char> const & qual);
@@ -4,8 +4,10 @@
 #include <vector>
 
 #include <boost/serialization/access.hpp>
+#include <boost/serialization/version.hpp>
 
 #include <graphtyper/constants.hpp>
+#include <graphtyper/graph/packed_sequence.hpp>
 
 
 namespace gyper
@@ -22,23 +24,28 @@ class Label
   friend class gyper::VarNode;
 
 public:
-  uint32_t order{0};
-  std::vector<char> dna{};
+  TAbsPos order{0};
+  PackedSequence dna{};
   uint16_t variant_num{0};
 
   Label() noexcept;
   Label(Label const & l) noexcept;
   Label(Label && l) noexcept;
-  Label(uint32_t const & order, std::vector<char> && dna, uint16_t const & variant_num) noexcept;
+  Label(TAbsPos const & order, std::vector<char> && dna, uint16_t const & variant_num) noexcept;
 
   /**
    * CLASS INFORMATION
    */
-  uint32_t reach() const;
+  TAbsPos reach() const;
 
 private:
   template <typename Archive>
   void serialize(Archive & ar, const unsigned int);
 };
 
+// Version 0 had an unpacked sequence and 32-bit positions. Archives of the two position widths are not compatible.
+unsigned constexpr LABEL_ARCHIVE_VERSION = 1 + ABS_POS_ARCHIVE_VERSION;
+
 } // namespace gyper
+
+BOOST_CLASS_VERSION(gyper::Label, gyper::LABEL_ARCHIVE_VERSION)
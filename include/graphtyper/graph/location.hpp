@@ -2,6 +2,8 @@
 
 #include <cstdint>
 
+#include <graphtyper/constants.hpp>
+
 namespace gyper
 {
 
@@ -10,7 +12,7 @@ class Location
 public:
   char node_type;
   uint32_t node_index;
-  uint32_t node_order;
+  TAbsPos node_order;
   uint32_t offset;
 
   bool inline
@@ -34,7 +36,7 @@ public:
     , offset(0)
   {}
 
-  Location(char && _node_type, uint32_t _node_index, uint32_t _node_order, uint32_t _offset)
+  Location(char && _node_type, uint32_t _node_index, TAbsPos _node_order, uint32_t _offset)
     : node_type(std::move(_node_type))
     , node_index(_node_index)
     , node_order(_node_order)
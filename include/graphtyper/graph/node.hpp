@@ -22,7 +22,7 @@ public:
   RefNode(Label && l, std::vector<TNodeIndex> && c) noexcept;
   RefNode(RefNode const & rn) noexcept;
 
-  void change_label_order(uint32_t change);
+  void change_label_order(TAbsPos change);
 
   std::size_t out_degree() const;
   Label const & get_label() const;
@@ -47,7 +47,7 @@ public:
   VarNode(Label && l, TNodeIndex && ori) noexcept;
   VarNode(VarNode const & vn) noexcept;
 
-  void change_label_order(uint32_t change);
+  void change_label_order(TAbsPos change);
 
   std::size_t out_degree() const;
   Label const & get_label() const;
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <boost/serialization/access.hpp>
+#include <boost/serialization/split_member.hpp>
+
+
+namespace gyper
+{
+
+class PackedSequenceView;
+
+
+/**
+ * \brief A DNA sequence packed with two bits per base.
+ * \details A, C, G and T are stored in 64-bit words, 32 bases per word with the first base in the lowest bits. Any
+ * other character (typically N, or the characters of symbolic alleles) is stored as a run of equal characters on top of
+ * the packed bases, which take a value of zero (A) in the words. The words and runs share a single allocation, and
+ * sequences of up to 32 bases without other characters are stored in the object itself, so a SNP allele takes 16 bytes
+ * and a long sequence about a quarter of the memory of a std::vector<char>.
+ */
+class PackedSequence
+{
+  friend class boost::serialization::access;
+  friend class PackedSequenceView;
+
+public:
+  /** \brief Random access iterator which decodes a base on each access */
+  class const_iterator
+  {
+public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = char;
+    using difference_type = std::ptrdiff_t;
+    using pointer = char const *;
+    using reference = char;
+
+    const_iterator() = default;
+    const_iterator(PackedSequence const * _seq, std::size_t const _i) : seq(_seq), i(_i) {}
+
+    char operator*() const {return (*seq)[i];}
+    char operator[](difference_type const n) const {return (*seq)[i + n];}
+
+    const_iterator & operator++() {++i; return *this;}
+    const_iterator & operator--() {--i; return *this;}
+    const_iterator operator++(int) {const_iterator it(*this); ++i; return it;}
+    const_iterator operator--(int) {const_iterator it(*this); --i; return it;}
+    const_iterator & operator+=(difference_type const n) {i += n; return *this;}
+    const_iterator & operator-=(difference_type const n) {i -= n; return *this;}
+    const_iterator operator+(difference_type const n) const {return const_iterator(seq, i + n);}
+    const_iterator operator-(difference_type const n) const {return const_iterator(seq, i - n);}
+    difference_type operator-(const_iterator const & it) const {return static_cast<difference_type>(i - it.i);}
+
+    bool operator==(const_iterator const & it) const {return i == it.i;}
+    bool operator!=(const_iterator const & it) const {return i != it.i;}
+    bool operator<(const_iterator const & it) const {return i < it.i;}
+    bool operator>(const_iterator const & it) const {return i > it.i;}
+    bool operator<=(const_iterator const & it) const {return i <= it.i;}
+    bool operator>=(const_iterator const & it) const {return i >= it.i;}
+
+private:
+    PackedSequence const * seq{nullptr};
+    std::size_t i{0};
+  };
+
+  PackedSequence() noexcept = default;
+  explicit PackedSequence(std::vector<char> const & seq);
+  PackedSequence(PackedSequence const & other);
+  PackedSequence(PackedSequence && other) noexcept;
+  PackedSequence & operator=(PackedSequence const & other);
+  PackedSequence & operator=(PackedSequence && other) noexcept;
+  ~PackedSequence();
+
+  void assign(std::vector<char> const & seq);
+  void clear();
+
+  /***************
+   * INFORMATION *
+   ***************/
+  std::size_t size() const;
+  bool empty() const;
+  char operator[](std::size_t i) const;
+  char front() const;
+  char back() const;
+
+  const_iterator begin() const {return const_iterator(this, 0);}
+  const_iterator end() const {return const_iterator(this, seq_size);}
+  const_iterator cbegin() const {return begin();}
+  const_iterator cend() const {return end();}
+
+  std::vector<char> get_sequence(std::size_t begin, std::size_t end) const; /** \brief Unpacks [begin, end) */
+  std::vector<char> to_vector() const; /** \brief Unpacks the whole sequence */
+  std::string to_string() const; /** \brief Unpacks the whole sequence */
+  PackedSequenceView get_view(std::size_t begin, std::size_t end) const;
+
+  bool has_other_bases(std::size_t begin, std::size_t end) const; /** \brief True if [begin, end) has non-ACGT */
+
+private:
+  uint32_t seq_size{0};
+  uint32_t n_other_runs{0}; // Runs of non-ACGT characters
+
+  // The words of short sequences without other characters, otherwise an allocation with the words, followed by the
+  // runs ((end << 32) | begin, sorted by position) and then the character of each run
+  union Storage
+  {
+    uint64_t word;
+    uint64_t * data;
+  };
+
+  Storage storage{0};
+
+  bool is_allocated() const;
+  std::size_t get_num_words() const;
+  std::size_t get_num_allocated_words() const;
+  uint64_t const * get_words() const;
+  uint64_t const * get_other_runs() const;
+  char const * get_other_chars() const;
+
+  void allocate();
+  char get_packed_base(std::size_t i) const; // Ignores the other characters
+  std::size_t first_other_run_ending_after(std::size_t i) const;
+
+  template <typename Archive>
+  void save(Archive & ar, unsigned int version) const;
+
+  template <typename Archive>
+  void load(Archive & ar, unsigned int version);
+
+  BOOST_SERIALIZATION_SPLIT_MEMBER()
+};
+
+
+/**
+ * \brief A range of a PackedSequence, which is decoded on access instead of copied.
+ * \details The view is only valid while the sequence it refers to is not changed. Ranges with only A, C, G and T are
+ * decoded directly from the words.
+ */
+class PackedSequenceView
+{
+public:
+  PackedSequenceView() = default;
+  PackedSequenceView(PackedSequence const * seq, std::size_t begin, std::size_t end);
+
+  std::size_t size() const;
+  bool empty() const;
+  char operator[](std::size_t i) const;
+  std::vector<char> to_vector() const;
+
+private:
+  PackedSequence const * seq{nullptr};
+  std::size_t begin{0};
+  std::size_t end{0};
+  bool has_other_bases{false};
+};
+
+} // namespace gyper
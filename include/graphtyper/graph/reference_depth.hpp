@@ -13,13 +13,33 @@ class GenotypePaths;
 class VariantCandidate;
 
 
+/**
+ * \brief Read depth of one sample along the reference.
+ * \details Reads are first stored as start and end events, which are folded into run-length encoded depths when there
+ * are many of them (and by ReferenceDepth::finalize before any queries). Bases without reads take no space.
+ */
+class DepthTrack
+{
+public:
+  std::vector<uint32_t> run_ends{}; // Exclusive end index of each run, the depth is zero after the last run
+  std::vector<uint16_t> run_depths{}; // Depth of each run
+  std::vector<uint32_t> events{}; // Events not yet in the runs. Read starts are 'index * 2 + 1', read ends 'index * 2'
+
+  void add(long begin_index, long end_index); /** \brief Increases the depth in [begin_index, end_index) by one */
+  void compact(); /** \brief Folds the events into the runs */
+
+  uint16_t get_max_depth(long begin_index, long end_index) const;
+};
+
+
 class ReferenceDepth
 {
 public:
   ReferenceDepth();
 
-  uint32_t reference_offset = 0;
-  std::vector<std::vector<uint16_t> > depths{};
+  TAbsPos reference_offset = 0;
+  long reference_size = 0;
+  std::vector<DepthTrack> depths{};
 
   /***************
    * INFORMATION *
@@ -33,7 +53,7 @@ public:
    * \param sample_index the index of the PN to check for.
    */
   uint16_t get_read_depth(VariantCandidate const & var, long sample_index) const;
-  uint16_t get_read_depth(uint32_t abs_pos, long sample_index) const;
+  uint16_t get_read_depth(TAbsPos abs_pos, long sample_index) const;
   uint64_t get_total_read_depth_of_samples(VariantCandidate const & var,
                                            std::vector<uint32_t> const & sample_indexes
                                            ) const;
@@ -44,6 +64,7 @@ public:
   void set_depth_sizes(long sample_count, long reference_size = graph.reference.size());
   void add_depth(long start_pos, long end_pos, long sample_index);
   void add_genotype_paths(GenotypePaths const & geno, long sample_index);
+  void finalize(); /** \brief Must be called after all depth has been added and before the read depth is retrieved */
 };
 
 } // namespace gyper
@@ -5,6 +5,8 @@
 
 #include <htslib/kseq.h>
 
+#include <graphtyper/constants.hpp>
+
 std::ostream & operator<<(std::ostream & os, std::vector<char> const & dt);
 std::string to_string(std::vector<char> const & dt);
 
@@ -14,14 +16,14 @@ namespace gyper
 class VarRecord
 {
 public:
-  uint32_t pos;
+  TAbsPos pos;
   std::vector<char> ref;
   std::vector<std::vector<char> > alts;
   bool is_sv = false;
 
   VarRecord();
-  VarRecord(uint32_t const pos);
-  VarRecord(uint32_t const pos, std::vector<char> && ref, std::vector<std::vector<char> > && alts);
+  VarRecord(TAbsPos const pos);
+  VarRecord(TAbsPos const pos, std::vector<char> && ref, std::vector<std::vector<char> > && alts);
 
   std::string to_string() const;
 
@@ -1,6 +1,7 @@
 #pragma once
 #include <cstdint>
 
+#include <graphtyper/constants.hpp>
 #include <graphtyper/utilities/type_conversions.hpp> // to_uint64()
 
 
@@ -16,17 +17,17 @@ class IndexEntry
 {
 public:
   uint64_t dna = 0u;                      /** \brief A string of DNA bases represented as a 64 bit integer. */
-  uint32_t start_index = 0u;              /** \brief The index where the variant starts on the reference genome. */
+  TAbsPos start_index = 0u;               /** \brief The index where the variant starts on the reference genome. */
   std::vector<uint32_t> variant_id;
   uint32_t total_var_num = 1u;
   uint32_t total_var_count = 0u;
   uint8_t valid = 0u;
 
-  IndexEntry(uint32_t const s)
+  IndexEntry(TAbsPos const s)
     : start_index(s)
   {}
 
-  IndexEntry(uint32_t const s, uint32_t const i, bool const is_reference, unsigned const var_num)
+  IndexEntry(TAbsPos const s, uint32_t const i, bool const is_reference, unsigned const var_num)
     : start_index(s), variant_id(1, i), total_var_num(var_num), total_var_count(static_cast<uint32_t>(!is_reference))
   {}
 
@@ -5,6 +5,7 @@
 
 #include <boost/archive/binary_oarchive.hpp>
 #include <boost/archive/binary_iarchive.hpp>
+#include <boost/serialization/version.hpp>
 
 #include <graphtyper/constants.hpp>
 
@@ -20,21 +21,21 @@ private:
   friend class boost::serialization::access;
 
 public:
-  uint32_t start_index{0}; /** \brief The index where the variant starts on the reference genome. */
-  uint32_t end_index{0};   /** \brief The index where the variant ends on the reference genome. */
+  TAbsPos start_index{0}; /** \brief The index where the variant starts on the reference genome. */
+  TAbsPos end_index{0};   /** \brief The index where the variant ends on the reference genome. */
   uint32_t variant_id{INVALID_ID};  /** \brief The variant id, i.e. the index of the variant on the graph. */
 
 
   KmerLabel() noexcept = default;
 
-  KmerLabel(uint32_t const s, uint32_t const e) noexcept
+  KmerLabel(TAbsPos const s, TAbsPos const e) noexcept
     : start_index(s)
     , end_index(e)
     , variant_id(INVALID_ID)
   {}
 
   // Used when add a KmerLabel to the index.
-  KmerLabel(uint32_t const s, uint32_t const e, uint32_t const i) noexcept
+  KmerLabel(TAbsPos const s, TAbsPos const e, uint32_t const i) noexcept
     : start_index(s)
     , end_index(e)
     , variant_id(i)
@@ -48,8 +49,12 @@ public:
 private:
   template <class Archive>
   void
-  serialize(Archive & ar, const unsigned int)
+  serialize(Archive & ar, const unsigned int version)
   {
+    // Newer versions are rejected by Boost, older ones are rejected here
+    if (version != ABS_POS_ARCHIVE_VERSION)
+      throw boost::archive::archive_exception(boost::archive::archive_exception::unsupported_class_version);
+
     ar & start_index;
     ar & end_index;
     ar & variant_id;
@@ -62,3 +67,6 @@ private:
 using TKmerLabels = std::vector<std::vector<KmerLabel> >;
 
 } // namespace gyper
+
+// Archives of the two position widths are not compatible
+BOOST_CLASS_VERSION(gyper::KmerLabel, gyper::ABS_POS_ARCHIVE_VERSION)
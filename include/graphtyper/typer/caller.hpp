@@ -1,8 +1,15 @@
 #pragma once
 
 #include <string> // std::string
+#include <unordered_map> // std::unordered_map
 #include <vector> // std::vector
 
+#include <htslib/sam.h>
+
+#include <graphtyper/graph/genomic_region.hpp>
+#include <graphtyper/graph/reference_depth.hpp>
+#include <graphtyper/typer/variant_map.hpp>
+
 
 namespace gyper
 {
@@ -25,6 +32,32 @@ call(std::vector<std::string> const & hts_path,
      bool const is_writing_hap);
 
 
+/**
+ * \brief Discovers variants from the cigar of aligned reads and accumulates their reference depth.
+ * \details Used on reads which are read anyway. Add the alignment file of the reads with add_file before adding
+ * them, then save the variant map of the samples in all the files. The graph of the region must be loaded.
+ */
+class CigarDiscovery
+{
+public:
+  CigarDiscovery(GenomicRegion const & region, long minimum_variant_support, double minimum_variant_support_ratio);
+
+  void add_file(std::string const & hts_path); /** \brief Adds the samples of an alignment file */
+  void add_read(bam1_t const * record); /** \brief Adds a read of the most recently added file */
+  void save(std::string const & variant_map_path);
+
+  std::vector<std::string> samples;
+
+private:
+  GenomicRegion const region;
+  std::string const ref_str;
+  std::unordered_map<std::string, int> rg2sample_i; // Read group to sample index of the current file
+  long file_sample_index{0}; // Sample index of the current file when it has no read groups
+  ReferenceDepth reference_depth;
+  VariantMap varmap;
+};
+
+
 // returns the written variant maps
 std::vector<std::string>
 discover_directly_from_bam(std::string const & graph_path,
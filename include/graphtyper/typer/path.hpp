@@ -18,11 +18,11 @@ class Path
 public:
   /** \brief The start position of this path. Can be a special position and is used for connecting
    * two paths. */
-  uint32_t start = 0;
+  TAbsPos start = 0;
 
   /** \brief The end position of this path. Can be a special position and is used for connecting
    * two paths. */
-  uint32_t end = 0;
+  TAbsPos end = 0;
 
   /** \brief 0-based start index of the part of the read which aligned. */
   uint16_t read_start_index = 0;
@@ -32,7 +32,7 @@ public:
    * The reported value is included.
    */
   uint16_t read_end_index = 0;
-  std::vector<uint32_t> var_order;
+  std::vector<TAbsPos> var_order;
   std::vector<std::bitset<MAX_NUMBER_OF_HAPLOTYPES> > nums;
   uint16_t mismatches;
 
@@ -58,12 +58,12 @@ public:
   /********************
    * PATH INFORMATION *
    ********************/
-  uint32_t start_pos() const;
-  uint32_t end_pos() const;
-  uint32_t start_correct_pos() const;
-  uint32_t end_correct_pos() const;
-  uint32_t start_ref_reach_pos() const;
-  uint32_t end_ref_reach_pos() const;
+  TAbsPos start_pos() const;
+  TAbsPos end_pos() const;
+  TAbsPos start_correct_pos() const;
+  TAbsPos end_correct_pos() const;
+  TAbsPos start_ref_reach_pos() const;
+  TAbsPos end_ref_reach_pos() const;
   uint32_t size() const;
   uint32_t get_read_end_index(uint32_t read_length) const;
   bool is_reference() const;
@@ -18,7 +18,7 @@ public:
 class Segment
 {
 public:
-  uint32_t id;
+  TAbsPos id; // Absolute position of the segment
   std::size_t ref_size;
   std::vector<std::string> allele_names;
   std::vector<SegmentCall> segment_calls;
@@ -27,7 +27,7 @@ public:
   int32_t extra_id = -1;
 
   Segment();
-  Segment(uint32_t _id, std::size_t ref_size, std::vector<std::string> const & _alts);
+  Segment(TAbsPos _id, std::size_t ref_size, std::vector<std::string> const & _alts);
   void clear();
   void insert_score(std::vector<uint32_t> const & score);
   void insert_scores(std::vector<std::vector<uint32_t> > const & scores);
@@ -1,10 +1,12 @@
 #pragma once
 
 #include <cstdint> // intX_t, uintX_t
-#include <map> // std::map
 #include <string> // std::string
+#include <utility> // std::pair
 #include <vector> // std::vector
 
+#include <boost/serialization/access.hpp>
+
 #include <graphtyper/graph/read_strand.hpp>
 
 namespace gyper
@@ -32,18 +34,51 @@ public:
    */
   void add_mapq(uint8_t const new_mapq);
 
+};
+
+
+/**
+ * The INFO statistics GraphTyper produces itself (CR, MQsquared and SB*). They are kept as numbers so VCF merging can
+ * sum them without formatting and parsing strings. Other INFO fields are kept in Variant::infos.
+ */
+class InfoStats
+{
+  friend class boost::serialization::access;
+
+public:
+  bool has_clipped_reads{false};
+  bool has_mapq_squared{false};
+  bool has_strand_bias{false};
+
+  uint32_t clipped_reads{0u}; // CR
+  uint64_t mapq_squared{0u}; // MQsquared
+
+  // Strand bias per allele
+  std::vector<uint32_t> sbf{}; // SBF
+  std::vector<uint32_t> sbr{}; // SBR
+  std::vector<uint32_t> sbf1{}; // SBF1
+  std::vector<uint32_t> sbf2{}; // SBF2
+  std::vector<uint32_t> sbr1{}; // SBR1
+  std::vector<uint32_t> sbr2{}; // SBR2
+
+  InfoStats() = default;
+  explicit InfoStats(VarStats const & stat);
+
   /**
-   * CLASS INFORMATION
+   * MODIFIERS
    */
-  std::string get_forward_strand_bias() const;
-  std::string get_reverse_strand_bias() const;
+  void merge_with(InfoStats const & other); // Sums the statistics of another record of the same site
+  void set_all(); // Marks every statistic as set, even the ones that are zero or empty
 
-  // Read pair specfici biases
-  std::string get_r1_forward_strand_bias() const;
-  std::string get_r2_forward_strand_bias() const;
-  std::string get_r1_reverse_strand_bias() const;
-  std::string get_r2_reverse_strand_bias() const;
+  /**
+   * CLASS INFORMATION
+   */
+  bool empty() const;
+  std::vector<std::pair<char const *, std::string> > get_infos() const; // INFO key and values, ordered by key
 
+private:
+  template <class Archive>
+  void serialize(Archive & ar, unsigned int version);
 
 };
 
@@ -53,9 +88,8 @@ std::string join_strand_bias(std::vector<uint32_t> const & r1bias, std::vector<u
 
 std::vector<std::string> split_bias_to_strings(std::string const & bias);
 std::vector<uint32_t> split_bias_to_numbers(std::string const & bias);
-std::vector<uint32_t> get_strand_bias(std::map<std::string, std::string> const & infos, std::string const & bias);
-long get_accumulated_strand_bias(std::map<std::string, std::string> const & infos, std::string const & bias);
-long get_accumulated_alt_strand_bias(std::map<std::string, std::string> const & infos, std::string const & bias);
+long get_accumulated_strand_bias(std::vector<uint32_t> const & strand_bias);
+long get_accumulated_alt_strand_bias(std::vector<uint32_t> const & strand_bias);
 std::vector<uint16_t> get_list_of_uncalled_alleles(std::string const & ac);
 
 } // namespace gyper
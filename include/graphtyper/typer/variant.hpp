@@ -5,10 +5,12 @@
 #include <vector> // std::vector
 
 #include <boost/serialization/access.hpp>
+#include <boost/serialization/version.hpp>
 
 #include <graphtyper/graph/genotype.hpp> // gyper::Genotype
 #include <graphtyper/graph/haplotype.hpp> // gyper::Haplotype
 #include <graphtyper/typer/sample_call.hpp> // gyper::SampleCall
+#include <graphtyper/typer/var_stats.hpp> // gyper::InfoStats
 #include <graphtyper/utilities/options.hpp>
 
 namespace gyper
@@ -21,10 +23,11 @@ class Variant
   friend class boost::serialization::access;
 
 public:
-  uint32_t abs_pos;
+  TAbsPos abs_pos;
   std::vector<std::vector<char> > seqs;
   std::vector<SampleCall> calls;
   std::map<std::string, std::string> infos;
+  InfoStats stats; // CR, MQsquared and SB* INFO fields
   std::string suffix_id;
   bool is_info_generated{false};
 
@@ -92,6 +95,9 @@ std::vector<Variant> break_down_variant(Variant && variant,
                                         bool const is_no_variant_overlapping,
                                         bool const is_all_biallelic);
 
+// True if break_down_variant depends on the reach of the variants before, i.e. when the variant is broken down by skyr
+bool is_break_down_using_reach(Variant const & var, bool const is_no_variant_overlapping);
+
 std::vector<Variant> break_down_skyr(Variant && var, long const reach);
 std::vector<Variant> extract_sequences_from_aligned_variant(Variant const && variant, std::size_t const THRESHOLD);
 std::vector<Variant> simplify_complex_haplotype(Variant && variant, std::size_t const THRESHOLD);
@@ -99,3 +105,6 @@ std::vector<Variant> break_multi_snps(Variant const && var);
 void find_variant_sequences(gyper::Variant & new_var, gyper::Variant const & old_var);
 
 } // namespace gyper
+
+// Archives of the two position widths are not compatible
+BOOST_CLASS_VERSION(gyper::Variant, gyper::ABS_POS_ARCHIVE_VERSION)
@@ -7,6 +7,7 @@
 
 #include <boost/archive/binary_oarchive.hpp>
 #include <boost/archive/binary_iarchive.hpp>
+#include <boost/serialization/version.hpp>
 
 
 namespace gyper
@@ -22,8 +23,8 @@ class VariantCandidate
   friend class boost::serialization::access;
 
 public:
-  uint32_t abs_pos = 0;
-  uint32_t original_pos = 0u;
+  TAbsPos abs_pos = 0;
+  uint32_t original_pos = 0u; // Contig position of the read the variant was found in
   std::vector<std::vector<char> > seqs;
   uint16_t flags = 0;
 
@@ -55,8 +56,12 @@ public:
 private:
   template <class Archive>
   void
-  serialize(Archive & ar, const unsigned int)
+  serialize(Archive & ar, const unsigned int version)
   {
+    // Newer versions are rejected by Boost, older ones are rejected here
+    if (version != ABS_POS_ARCHIVE_VERSION)
+      throw boost::archive::archive_exception(boost::archive::archive_exception::unsupported_class_version);
+
     ar & abs_pos;
     ar & original_pos;
     ar & flags;
@@ -73,3 +78,6 @@ struct VariantCandidateHash
 };
 
 } // namespace gyper
+
+// Archives of the two position widths are not compatible
+BOOST_CLASS_VERSION(gyper::VariantCandidate, gyper::ABS_POS_ARCHIVE_VERSION)
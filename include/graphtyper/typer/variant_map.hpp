@@ -1,9 +1,10 @@
 #pragma once
 
-#include <map> // std::map
+#include <cstdint> // uint32_t
 #include <string> // std::string
-#include <vector> // std::vector
 #include <unordered_map>
+#include <utility> // std::pair
+#include <vector> // std::vector
 
 #include <graphtyper/typer/variant_candidate.hpp>
 #include <graphtyper/typer/variant_support.hpp>
@@ -18,8 +19,44 @@ namespace gyper
 class ReferenceDepth;
 class Vcf;
 
-using VarMap = std::unordered_map<VariantCandidate, VariantSupport, VariantCandidateHash>;
-using PoolVarMap = std::map<VariantCandidate, std::vector<VariantSupport> >;
+/**
+ * \brief Stores each distinct allele sequence once and refers to it by an ID.
+ */
+class AlleleArena
+{
+public:
+  uint32_t insert(std::vector<char> const & seq); /** \brief Returns the ID of the sequence, adding it if it is new */
+  uint32_t insert(std::vector<char> const & seq, std::size_t hash); /** \brief Same, with a given sequence hash */
+  std::vector<char> get(uint32_t id) const;
+  void clear();
+
+private:
+  std::vector<char> sequences; // All sequences back to back
+  std::vector<uint32_t> ends; // End offset of each sequence in 'sequences'
+  std::unordered_multimap<std::size_t, uint32_t> ids; // Hash of a sequence -> its ID
+};
+
+
+// Compact key of a variant candidate in a per-sample varmap, its alleles are in the arena of the VariantMap
+struct VarMapKey
+{
+  TAbsPos abs_pos{0};
+  uint32_t ref_id{0};
+  uint32_t alt_id{0};
+
+  bool operator==(VarMapKey const & b) const;
+};
+
+struct VarMapKeyHash
+{
+  std::size_t operator()(VarMapKey const & key) const;
+};
+
+using VarMap = std::unordered_map<VarMapKey, VariantSupport, VarMapKeyHash>;
+
+// Variants with their supports in each sample, sorted by variant (and each variant only once). A sorted vector is
+// much cheaper to build, serialize and merge than a tree.
+using PoolVarMap = std::vector<std::pair<VariantCandidate, std::vector<VariantSupport> > >;
 
 class VariantMap
 {
@@ -32,10 +69,12 @@ public:
   void create_varmap_for_all(ReferenceDepth const & reference_depth);
   void filter_varmap_for_all();
   void clear();
+  VariantCandidate get_variant_candidate(VarMapKey const & key) const;
 
   /**
    * \brief Opens input file and creates one variant map with all variant maps in input file
    * \param path Input file path with many variant maps
+   * \details The variant maps are loaded in parallel and merged pairwise, in parallel, until one is left.
    */
   void load_many_variant_maps(std::string const & path);
   void load_many_variant_maps(std::vector<std::string> const & paths);
@@ -55,6 +94,7 @@ public:
   long minimum_variant_support{5};
   double minimum_variant_support_ratio{0.25};
   std::vector<VarMap> varmaps; /** \brief List of varmaps, one for each sample */
+  AlleleArena alleles; /** \brief Allele sequences of the variants in varmaps */
 
   template <class Archive>
   void inline
@@ -1,7 +1,7 @@
 #pragma once
 
+#include <array> // std::array
 #include <cstdint> // uint32_t
-#include <set> // std::set<T>
 
 #include <boost/archive/binary_oarchive.hpp>
 #include <boost/archive/binary_iarchive.hpp>
@@ -24,7 +24,8 @@ public:
   uint16_t clipped{0u};
   uint16_t var_size{0u};
   uint16_t growth{0u};
-  std::set<uint32_t> unique_positions;
+  std::array<uint32_t, 3> unique_positions{{0u, 0u, 0u}}; // The filters only need to know of up to three positions
+  uint8_t num_unique_positions{0u};
   bool is_indel{false};
   bool is_any_mapq_good{false};
 
@@ -34,6 +35,7 @@ public:
 
   VariantSupport() = default;
 
+  void add_unique_position(uint32_t pos);
   void set_depth(uint16_t _depth);
   long get_score() const;
   double get_corrected_support() const;
@@ -7,13 +7,15 @@
 
 #include <boost/serialization/access.hpp>
 
+#include <htslib/vcf.h> // htsFile, bcf_hdr_t, bcf1_t
+
 #include <graphtyper/constants.hpp>
 #include <graphtyper/graph/genotype.hpp>
 #include <graphtyper/graph/haplotype.hpp>
 #include <graphtyper/typer/segment.hpp>
 #include <graphtyper/typer/variant.hpp>
+#include <graphtyper/utilities/bgzf_reader.hpp>
 #include <graphtyper/utilities/bgzf_stream.hpp>
-#include <graphtyper/utilities/gzstream.hpp>
 
 
 namespace gyper
@@ -27,7 +29,9 @@ enum VCF_FILE_MODE
   READ_BGZF_MODE,
   WRITE_UNCOMPRESSED_MODE,
   WRITE_BGZF_MODE,
-  READ_MODE, // Selects whether to use uncompressed or bgzf based on file extension
+  READ_BCF_MODE,
+  WRITE_BCF_MODE,
+  READ_MODE, // Selects whether to use uncompressed, bgzf or BCF based on file extension
   WRITE_MODE
 };
 
@@ -41,6 +45,7 @@ public:
   explicit Vcf(VCF_FILE_MODE _filemode, std::string const & filename);
   Vcf(Vcf const &) = delete;
   Vcf(Vcf &&) = delete;
+  ~Vcf();
 
   void open(VCF_FILE_MODE _filemode, std::string const & _filename);
   void set_filemode(VCF_FILE_MODE _filemode);
@@ -49,26 +54,48 @@ public:
    * CLASS MODIFERS *
    ******************/
   /** I/O member functions */
-  igzstream bgzf_in;
+  BGZF_reader bgzf_in;
   BGZF_stream bgzf_stream;
 
+  /** BCF I/O member variables, used when the filename ends with .bcf */
+  htsFile * bcf_fp{nullptr};
+  bcf_hdr_t * bcf_hdr{nullptr};
+  bcf1_t * bcf_record{nullptr};
+  std::vector<int32_t> bcf_values; // Reused when writing INFO and FORMAT values
+  int32_t * bcf_read_values{nullptr}; // Reused by htslib when reading FORMAT values
+  int bcf_read_values_size{0};
+  kstring_t bcf_str{0, 0, nullptr}; // Reused when formatting INFO values
+
+  bool is_indexing{false}; // True if a TBI/CSI index is built when the file is closed
+
+  bool is_bcf() const;
+  bool is_open_for_reading() const;
   void open_vcf_file_for_reading();
   void read_samples();
+  // Call once after read_samples to read only these samples, in the order of the file. An empty subset reads all.
+  void set_sample_subset(std::vector<std::string> const & subset);
+
+  // With SITES_ONLY, the calls of the record are not decoded unless decode_calls() is called before the next record
   bool read_record(bool SITES_ONLY = false);
+  void decode_calls(); // Decodes the calls of the last record read, if they have not been decoded
   void read(bool SITES_ONLY = false); /** \brief Reads the VCF file. */
-  void open_for_writing(long const n_threads = 1);
+  void open_for_writing(long const n_threads = 1, bool const is_indexing = false);
   void write_header();
 
   void write_record(Variant const & var,
                     std::string const & suffix = "",
                     const bool FILTER_ZERO_QUAL = false);
 
-  void write_tbi_index() const;
+  void write_tbi_index() const; // Indexes a closed file, not needed if it was opened for writing with indexing
   void write_segments();
   void write(std::string const & region = ".", long const n_threads = 1); /** \brief Writes the VCF file. */
 
-  void write_records(uint32_t region_begin,
-                     uint32_t region_end,
+  // Returns the sites which would be written, without calls. Used to pass the sites to the next graph construction
+  // without a round-trip through a VCF file.
+  std::vector<Variant> get_sites() const;
+
+  void write_records(TAbsPos region_begin,
+                     TAbsPos region_end,
                      bool FILTER_ZERO_QUAL,
                      std::vector<Variant> const & vars);
 
@@ -93,6 +120,21 @@ public:
   std::vector<Segment> segments;
 
 private:
+  std::vector<char> sample_mask; // Sample columns of the file which are read, all of them if empty
+  bool has_undecoded_calls{false};
+  char const * undecoded_calls_begin{nullptr}; // FORMAT and sample columns of the last text record
+  char const * undecoded_calls_end{nullptr};
+
+  std::string get_header() const;
+  bool is_skipped(Variant const & var, std::pair<std::string, uint32_t> const & contig_pos) const; // Too large to write
+  void decode_text_calls(Variant & new_var);
+  void decode_bcf_calls(Variant & new_var);
+  bool read_bcf_record(bool SITES_ONLY);
+  void write_bcf_record(Variant const & var,
+                        std::pair<std::string, uint32_t> const & contig_pos,
+                        std::string const & id,
+                        uint64_t const variant_qual);
+
   template <class Archive>
   void serialize(Archive & ar, unsigned int version);
 };
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <string> // std::string
+#include <vector> // std::vector
+
+#include <graphtyper/typer/variant.hpp> // gyper::Variant
+
+
+namespace gyper
+{
+
+class Vcf;
+
+/**
+ * Columnar format of the internal VCF batch files (filename_N) written by save_vcf.
+ *
+ * A batch starts with a fixed size header with the size of absolute positions, the number of sample names and
+ * variants, and the byte offset of each section. The sections are:
+ *  - sample names
+ *  - sites: position, sequences, INFO, INFO statistics and the layout of the calls of each variant
+ *  - PL of all calls, one byte per value
+ *  - AD of all calls, as variable length integers
+ *  - depths of all calls (ref/alt total depth, ambiguous depth and alt proper pair depth)
+ *
+ * Integers are stored as LEB128 variable length integers, so most AD values take a single byte. The sections are
+ * decoded side by side one variant at a time from a memory mapped file (or from a file read in one go if mmap is not
+ * available).
+ */
+void write_vcf_batch(std::string const & batch_filename,
+                     std::vector<std::string> const & sample_names,
+                     std::vector<Variant>::const_iterator begin,
+                     std::vector<Variant>::const_iterator end);
+
+// Reads a batch file and appends its variants to vcf. Sample names are only set if 'is_reading_sample_names' is true.
+// Returns false if the batch file does not exist.
+bool read_vcf_batch(std::string const & batch_filename, Vcf & vcf, bool const is_reading_sample_names);
+
+} // namespace gyper
@@ -37,7 +37,7 @@ public:
   std::vector<HaplotypeCall> get_haplotype_calls() const;
 
 private:
-  std::unordered_map<uint32_t, std::pair<uint32_t, uint32_t> > id2hap; // first = haplotype, second = local genotype id
+  std::unordered_map<TAbsPos, std::pair<uint32_t, uint32_t> > id2hap; // first = haplotype, second = local genotype id
 
 public:
   std::vector<std::string> pns;
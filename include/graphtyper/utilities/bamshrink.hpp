@@ -1,5 +1,9 @@
 #pragma once
 
+#include <string>
+#include <vector>
+
+
 namespace bamshrink
 {
 
@@ -32,6 +36,8 @@ int main(Options & opts);
 namespace gyper
 {
 
+class GenomicRegion;
+
 void
 bamshrink(std::string const chrom,
           int begin,
@@ -43,6 +49,21 @@ bamshrink(std::string const chrom,
           std::string const ref_fn);
 
 
+// Like bamshrink, but also discovers variants from the cigar of the copied reads within 'discovery_region' and writes
+// their variant map to 'variant_map_path'. The graph of the discovery region must be loaded.
+void
+bamshrink_and_discover(std::string const chrom,
+                       int begin,
+                       int end,
+                       std::string const path_in,
+                       std::string const sam_index_in,
+                       std::string const path_out,
+                       double const avg_cov_by_readlen,
+                       std::string const ref_fn,
+                       GenomicRegion const * discovery_region,
+                       std::string const variant_map_path);
+
+
 void
 bamshrink_multi(std::string const interval_fn,
                 std::string const path_in,
@@ -50,4 +71,14 @@ bamshrink_multi(std::string const interval_fn,
                 double const avg_cov_by_readlen,
                 std::string const ref_fn);
 
+
+// Reads the input file once and writes the reads of each region to its own output file
+void
+bamshrink_regions(std::vector<GenomicRegion> const & regions,
+                  std::string const & path_in,
+                  std::string const & sam_index_in,
+                  std::vector<std::string> const & paths_out,
+                  double const avg_cov_by_readlen,
+                  std::string const & ref_fn);
+
 } // namespace gyper
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <cstdio> // std::exit
+#include <cstring> // std::memchr, std::memmove
+#include <iostream> // std::cerr
+#include <string> // std::string
+#include <vector> // std::vector
+
+#define INCLUDE_SEQAN_STREAM_IOSTREAM_BGZF_H_
+#include "bgzf.h" // part of htslib
+
+
+namespace gyper
+{
+
+// Reads lines of a BGZF (or gzip) compressed file through a large buffer. The lines are returned as character ranges
+// inside the buffer, so no memory is allocated per line. A range is valid until the next call to read_line.
+class BGZF_reader
+{
+private:
+  BGZF * fp = nullptr;
+  std::vector<char> buffer;
+  std::size_t begin{0}; // Start of unread data in the buffer
+  std::size_t end{0}; // End of data in the buffer
+  bool is_eof{false};
+
+public:
+  BGZF_reader() = default;
+  ~BGZF_reader(); // custom
+  BGZF_reader(BGZF_reader const &) = delete;
+  BGZF_reader(BGZF_reader &&) = delete;
+  BGZF_reader & operator=(BGZF_reader const &) = delete;
+  BGZF_reader & operator=(BGZF_reader &&) = delete;
+
+  void open(std::string const & filename);
+  bool is_open() const;
+  explicit operator bool() const;
+  bool read_line(char const *& line_begin, char const *& line_end); // Returns false when there are no more lines
+  void close();
+
+  std::size_t BUFFER_SIZE{262144ul}; // Initial size of the buffer, it grows if a line is longer
+};
+
+
+inline
+void
+BGZF_reader::open(std::string const & filename)
+{
+  if (fp)
+    close();
+
+  fp = bgzf_open(filename.c_str(), "r");
+  buffer.resize(BUFFER_SIZE);
+  begin = 0;
+  end = 0;
+  is_eof = false;
+}
+
+
+inline bool
+BGZF_reader::is_open() const
+{
+  return fp;
+}
+
+
+inline
+BGZF_reader::operator bool() const
+{
+  return fp;
+}
+
+
+inline bool
+BGZF_reader::read_line(char const *& line_begin, char const *& line_end)
+{
+  if (!fp)
+    return false;
+
+  while (true)
+  {
+    char const * data = buffer.data();
+    char const * newline = static_cast<char const *>(std::memchr(data + begin, '\n', end - begin));
+
+    if (newline)
+    {
+      line_begin = data + begin;
+      line_end = newline;
+      begin = newline - data + 1;
+      return true;
+    }
+
+    if (is_eof)
+    {
+      // The last line may lack a newline
+      if (begin == end)
+        return false;
+
+      line_begin = data + begin;
+      line_end = data + end;
+      begin = end;
+      return true;
+    }
+
+    // Move the incomplete line to the front of the buffer and fill the rest
+    if (begin > 0)
+    {
+      std::memmove(buffer.data(), buffer.data() + begin, end - begin);
+      end -= begin;
+      begin = 0;
+    }
+
+    if (end == buffer.size())
+      buffer.resize(buffer.size() * 2);
+
+    ssize_t const n = bgzf_read(fp, buffer.data() + end, buffer.size() - end);
+
+    if (n < 0)
+    {
+      std::cerr << "ERROR: Reading from BGZF file failed." << std::endl;
+      std::exit(1);
+    }
+
+    is_eof = n == 0;
+    end += n;
+  }
+}
+
+
+inline
+void
+BGZF_reader::close()
+{
+  if (fp)
+  {
+    bgzf_close(fp);
+    fp = nullptr;
+  }
+
+  buffer = std::vector<char>();
+  begin = 0;
+  end = 0;
+  is_eof = false;
+}
+
+
+inline
+BGZF_reader::~BGZF_reader()
+{
+  close();
+}
+
+
+} // namespace gyper
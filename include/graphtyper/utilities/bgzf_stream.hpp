@@ -1,11 +1,14 @@
 #pragma once
 
+#include <cassert> // assert
+#include <cstdint> // uint8_t, uint64_t
 #include <cstdio> // std::exit
 #include <cstring>
 #include <iostream> // std::cout
 #include <memory>
-#include <sstream> // std::stringstream
+#include <sstream> // std::ostringstream
 #include <string> // std::string
+#include <vector> // std::vector
 
 #define INCLUDE_SEQAN_STREAM_IOSTREAM_BGZF_H_
 #include "bgzf.h" // part of htslib
@@ -15,14 +18,20 @@ namespace gyper
 {
 
 
+// Writes text to a BGZF file (or uncompressed to stdout). The text is appended to a reusable buffer with specialised
+// formatting of integers and PL lists, and the buffer is handed to htslib in chunks of whole BGZF blocks, which are
+// compressed by the BGZF thread pool.
 class BGZF_stream
 {
 private:
   BGZF * fp = nullptr;
+  std::string buffer; // Text which has not been written yet
+  std::ostringstream ss_other; // Used to format types which have no specialised formatting
 
-public:
-  std::ostringstream ss;
+  void append_uint(uint64_t val);
+  void append_int(int64_t val);
 
+public:
   BGZF_stream() = default;
   ~BGZF_stream(); // custom
   BGZF_stream(BGZF_stream const &) = delete;
@@ -30,34 +39,300 @@ public:
   BGZF_stream & operator=(BGZF_stream const &) = delete;
   BGZF_stream & operator=(BGZF_stream &&) = delete;
 
+  BGZF_stream & operator<<(char const c);
+  BGZF_stream & operator<<(char const * str);
+  BGZF_stream & operator<<(std::string const & str);
+  BGZF_stream & operator<<(unsigned short const val);
+  BGZF_stream & operator<<(unsigned int const val);
+  BGZF_stream & operator<<(unsigned long const val);
+  BGZF_stream & operator<<(unsigned long long const val);
+  BGZF_stream & operator<<(short const val);
+  BGZF_stream & operator<<(int const val);
+  BGZF_stream & operator<<(long const val);
+  BGZF_stream & operator<<(long long const val);
+
   template <class T>
   BGZF_stream & operator<<(T const & x);
+
+  void write(char const * str, std::size_t const size);
+  void write_phred(std::vector<uint8_t> const & phred); // Writes a comma separated PL list
+
+  // Appends the rest of the BGZF file 'in', from its current position. The remaining data of the current block of 'in'
+  // is recompressed, the blocks after it are copied without decompressing them.
+  void append_bgzf_blocks(BGZF * in);
+
   void check_cache();
   void flush();
   void open(std::string const & filename, std::string const & filemode, long const n_threads);
   bool is_open() const;
   void close(); // Close BGZF file
 
-  long MAX_CACHE_SIZE{1000000ll};
+  long MAX_CACHE_SIZE{16l * 0xff00l}; // Multiple of the maximum BGZF block data size
 };
 
 
+inline
+void
+BGZF_stream::append_uint(uint64_t val)
+{
+  char digits[20];
+  char * it = digits + sizeof(digits);
+
+  do
+  {
+    *--it = static_cast<char>('0' + val % 10);
+    val /= 10;
+  } while (val > 0);
+
+  buffer.append(it, digits + sizeof(digits) - it);
+}
+
+
+inline
+void
+BGZF_stream::append_int(int64_t val)
+{
+  if (val < 0)
+  {
+    buffer.push_back('-');
+    append_uint(static_cast<uint64_t>(-(val + 1)) + 1u); // Avoids overflow of the smallest value
+  }
+  else
+  {
+    append_uint(static_cast<uint64_t>(val));
+  }
+}
+
+
+inline
+BGZF_stream &
+BGZF_stream::operator<<(char const c)
+{
+  buffer.push_back(c);
+  return *this;
+}
+
+
+inline
+BGZF_stream &
+BGZF_stream::operator<<(char const * str)
+{
+  buffer.append(str);
+  return *this;
+}
+
+
+inline
+BGZF_stream &
+BGZF_stream::operator<<(std::string const & str)
+{
+  buffer.append(str);
+  return *this;
+}
+
+
+inline
+BGZF_stream &
+BGZF_stream::operator<<(unsigned short const val)
+{
+  append_uint(val);
+  return *this;
+}
+
+
+inline
+BGZF_stream &
+BGZF_stream::operator<<(unsigned int const val)
+{
+  append_uint(val);
+  return *this;
+}
+
+
+inline
+BGZF_stream &
+BGZF_stream::operator<<(unsigned long const val)
+{
+  append_uint(val);
+  return *this;
+}
+
+
+inline
+BGZF_stream &
+BGZF_stream::operator<<(unsigned long long const val)
+{
+  append_uint(val);
+  return *this;
+}
+
+
+inline
+BGZF_stream &
+BGZF_stream::operator<<(short const val)
+{
+  append_int(val);
+  return *this;
+}
+
+
+inline
+BGZF_stream &
+BGZF_stream::operator<<(int const val)
+{
+  append_int(val);
+  return *this;
+}
+
+
+inline
+BGZF_stream &
+BGZF_stream::operator<<(long const val)
+{
+  append_int(val);
+  return *this;
+}
+
+
+inline
+BGZF_stream &
+BGZF_stream::operator<<(long long const val)
+{
+  append_int(val);
+  return *this;
+}
+
+
 template <class T>
 inline
 BGZF_stream &
 BGZF_stream::operator<<(T const & x)
 {
-  // Add to stringstream
-  ss << x;
+  ss_other.str("");
+  ss_other << x;
+  buffer.append(ss_other.str());
   return *this;
 }
 
 
+inline
+void
+BGZF_stream::write(char const * str, std::size_t const size)
+{
+  buffer.append(str, size);
+}
+
+
+inline
+void
+BGZF_stream::write_phred(std::vector<uint8_t> const & phred)
+{
+  if (phred.size() == 0)
+    return;
+
+  // At most three digits and a comma per PL value
+  std::size_t const old_size = buffer.size();
+  buffer.resize(old_size + 4 * phred.size());
+  char * out = &buffer[old_size];
+
+  for (std::size_t p = 0; p < phred.size(); ++p)
+  {
+    uint8_t const val = phred[p];
+
+    if (p > 0)
+      *out++ = ',';
+
+    if (val >= 100)
+    {
+      *out++ = static_cast<char>('0' + val / 100);
+      *out++ = static_cast<char>('0' + (val / 10) % 10);
+    }
+    else if (val >= 10)
+    {
+      *out++ = static_cast<char>('0' + val / 10);
+    }
+
+    *out++ = static_cast<char>('0' + val % 10);
+  }
+
+  buffer.resize(out - buffer.data());
+}
+
+
+inline
+void
+BGZF_stream::append_bgzf_blocks(BGZF * in)
+{
+  assert(fp);
+
+  // The empty block which marks the end of a BGZF file
+  static char const BGZF_EOF[28] = {'\037', '\213', '\010', '\004', 0, 0, 0, 0, 0, '\377', '\006', 0, '\102', '\103',
+                                    '\002', 0, '\033', 0, '\003', 0, 0, 0, 0, 0, 0, 0, 0, 0};
+
+  if (in->block_offset < in->block_length)
+  {
+    write(static_cast<char const *>(in->uncompressed_block) + in->block_offset,
+          in->block_length - in->block_offset);
+  }
+
+  // The copied blocks must start at a block boundary of the output
+  flush();
+
+  if (bgzf_flush(fp) < 0)
+  {
+    std::cerr << "ERROR: Writing to BGZF file failed." << std::endl;
+    std::exit(1);
+  }
+
+  // The last bytes read are held back, so the EOF block of 'in' is not copied
+  std::vector<char> data(sizeof(BGZF_EOF) + 0x10000);
+  std::size_t n_held{0};
+
+  while (true)
+  {
+    ssize_t const n = bgzf_raw_read(in, data.data() + n_held, data.size() - n_held);
+
+    if (n < 0)
+    {
+      std::cerr << "ERROR: Reading from BGZF file failed." << std::endl;
+      std::exit(1);
+    }
+
+    if (n == 0)
+      break;
+
+    n_held += n;
+
+    if (n_held > sizeof(BGZF_EOF))
+    {
+      std::size_t const n_write = n_held - sizeof(BGZF_EOF);
+
+      if (bgzf_raw_write(fp, data.data(), n_write) < 0)
+      {
+        std::cerr << "ERROR: Writing to BGZF file failed." << std::endl;
+        std::exit(1);
+      }
+
+      std::memmove(data.data(), data.data() + n_write, sizeof(BGZF_EOF));
+      n_held = sizeof(BGZF_EOF);
+    }
+  }
+
+  if (n_held > 0 &&
+      !(n_held == sizeof(BGZF_EOF) && std::memcmp(data.data(), BGZF_EOF, sizeof(BGZF_EOF)) == 0) &&
+      bgzf_raw_write(fp, data.data(), n_held) < 0)
+  {
+    std::cerr << "ERROR: Writing to BGZF file failed." << std::endl;
+    std::exit(1);
+  }
+}
+
+
 inline
 void
 BGZF_stream::check_cache()
 {
-  if (static_cast<long>(ss.tellp()) > this->MAX_CACHE_SIZE)
+  if (static_cast<long>(buffer.size()) > this->MAX_CACHE_SIZE)
     flush();
 }
 
@@ -66,15 +341,14 @@ inline
 void
 BGZF_stream::flush()
 {
-  // Write stringstream to BGZF file
+  // Write buffer to BGZF file
   if (!fp)
   {
-    std::cout << ss.str(); // Write uncompressed to stdout
+    std::cout.write(buffer.data(), buffer.size()); // Write uncompressed to stdout
   }
-  else
+  else if (buffer.size() > 0)
   {
-    std::string str = ss.str();
-    int ret = bgzf_write(fp, str.data(), str.size());
+    ssize_t ret = bgzf_write(fp, buffer.data(), buffer.size());
 
     if (ret < 0)
     {
@@ -83,8 +357,8 @@ BGZF_stream::flush()
     }
   }
 
-  // Clear stringstream
-  ss.str("");
+  // Clear buffer but keep its capacity
+  buffer.clear();
 }
 
 
@@ -95,6 +369,8 @@ BGZF_stream::open(std::string const & filename, std::string const & filemode, lo
   if (fp)
     close();
 
+  buffer.reserve(MAX_CACHE_SIZE + 0xff00l);
+
   if (filename.size() > 0 && filename != "-")
   {
     fp = bgzf_open(filename.c_str(), filemode.c_str());
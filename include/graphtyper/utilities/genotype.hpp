@@ -15,13 +15,26 @@ struct Options;
 namespace gyper
 {
 
+// If 'discovery_region' is set, variants are also discovered from the cigar of the shrinked reads and the variant
+// maps are written to <tmp>/it1. Their paths are stored in 'variant_map_paths'.
 std::vector<std::string>
 run_bamshrink(std::vector<std::string> const & sams,
               std::vector<std::string> const & sams_index,
               std::string const & ref_fn,
               GenomicRegion const & region,
               std::vector<double> const & avg_cov_by_readlen,
-              std::string const & tmp);
+              std::string const & tmp,
+              GenomicRegion const * discovery_region = nullptr,
+              std::vector<std::string> * variant_map_paths = nullptr);
+
+// bamshrink variant which reads each input once for all regions and returns the shrinked files of each region
+std::vector<std::vector<std::string> >
+run_bamshrink_regions(std::vector<std::string> const & sams,
+                      std::vector<std::string> const & sams_index,
+                      std::string const & ref_fn,
+                      std::vector<GenomicRegion> const & regions,
+                      std::vector<double> const & avg_cov_by_readlen,
+                      std::string const & tmp);
 
 // bamshrink variant for multiple regions
 std::vector<std::string>
@@ -41,7 +54,8 @@ genotype(std::string ref_path,
          GenomicRegion const & region,
          std::string const & output_path,
          std::vector<double> const & avg_cov_by_readlen,
-         bool const is_copy_reference);
+         bool const is_copy_reference,
+         std::vector<std::string> const & shrinked_sams_in);
 
 
 void
@@ -5,6 +5,7 @@
 #include <unordered_map> // std::unordered_map
 
 #include <htslib/sam.h>
+#include <htslib/thread_pool.h>
 
 #include <graphtyper/utilities/hts_record.hpp>
 #include <graphtyper/utilities/hts_utils.hpp>
@@ -38,7 +39,7 @@ private:
 public:
   HtsReader(HtsStore & _store);
 
-  void open(std::string const & path, std::string const & region);
+  void open(std::string const & path, std::string const & region, std::string const & reference = "");
   void close();
   int set_reference(std::string const & reference_path);
   void set_sample_index_offset(int new_sample_index_offset);
@@ -52,4 +53,14 @@ public:
   long get_num_rg() const;
 };
 
+
+// Makes a CRAM file use reference sequences shared with all other CRAMs that were opened with the same reference
+// FASTA and have the same @SQ lines. Each contig is then loaded once per process instead of once per file.
+// Does nothing for non-CRAM files. Returns a negative value on failure.
+int set_shared_cram_reference(htsFile * fp, bam_hdr_t const * hdr, std::string const & reference_path);
+
+// Returns a thread pool shared by all htslib file handles in the process, used for BGZF/CRAM (de)compression.
+// The pool is created on first use and is sized by Options::threads. Returns nullptr when running single threaded.
+htsThreadPool * get_hts_thread_pool();
+
 } // namespace hts
@@ -18,8 +18,9 @@ private:
 public:
   HtsWriter() = default;
 
-  // opens a hts file at path in a format
-  void open(std::string const & path);
+  // opens a hts file at path in a format. The mode is passed to hts_open, "wbu" writes uncompressed BAM without the
+  // shared thread pool
+  void open(std::string const & path, std::string const & mode = "wb");
 
   // closes the hts file
   void close();
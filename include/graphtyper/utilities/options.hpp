@@ -32,6 +32,7 @@ public:
   bool normal_and_no_variant_overlapping{false};
   bool is_all_biallelic{false};
   bool is_only_cigar_discovery{false};
+  bool is_cigar_discovery_in_bamshrink{false};
   bool is_discovery_only_for_paired_reads{false};
   bool is_sam_merging_allowed{false};
   long ploidy{2};
@@ -62,6 +63,7 @@ public:
   int bamshrink_min_readlen_low_mapq{94};
   int bamshrink_min_unpair_readlen{94};
   long bamshrink_as_filter_threshold{40};
+  long bamshrink_regions_per_pass{1}; // Number of regions shrinked with a single pass over each input file
   bool force_use_input_ref_for_cram_reading{false};
 
   /************************
@@ -85,6 +87,7 @@ public:
   long soft_cap_of_variants_in_100_bp_window{22};
   bool get_sample_names_from_filename{false};
   bool output_all_variants{false};
+  bool output_bcf{false}; // Write the final records of 'genotype' as BCF
   bool is_one_genotype_per_haplotype{false};
   std::string variant_suffix_id{};
   std::string primer_bedpe{};
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <functional> // std::function
+
+
+namespace gyper
+{
+
+// Number of consecutive ranges [0, size) is split into for parallel_for_ranges. A few ranges per thread so threads
+// which finish early can take more work, or a single range if there is only one thread.
+long
+get_num_parallel_ranges(long size);
+
+// Beginning of range r when [0, size) is split into n_ranges consecutive ranges. Range r ends where r + 1 begins.
+long
+get_parallel_range_begin(long size, long n_ranges, long r);
+
+// Calls func(i) for each i in [0, size), in parallel over all threads. The last call runs on the current thread.
+void
+parallel_for_each_index(long size, std::function<void(long)> const & func);
+
+// Calls func(begin, end) for consecutive ranges which together cover [0, size), in parallel over all threads
+void
+parallel_for_ranges(long size, std::function<void(long, long)> const & func);
+
+} // namespace gyper
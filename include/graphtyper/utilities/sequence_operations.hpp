@@ -4,13 +4,15 @@
 #include <cstdint>
 #include <vector>
 
+#include <graphtyper/constants.hpp>
+
 
 namespace gyper
 {
 
 
 void inline
-remove_common_prefix(uint32_t & pos,
+remove_common_prefix(TAbsPos & pos,
                      std::vector<char> & ref,
                      std::vector<std::vector<char> > & alts,
                      bool keep_one_match = false)
@@ -39,7 +41,7 @@ remove_common_prefix(uint32_t & pos,
 
 
 void inline
-remove_common_prefix(uint32_t & pos, std::vector<std::vector<char> > & seqs, bool keep_one_match = false)
+remove_common_prefix(TAbsPos & pos, std::vector<std::vector<char> > & seqs, bool keep_one_match = false)
 {
   if (seqs.size() <= 1 || seqs[0].size() <= 1)
     return;
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+namespace gyper
+{
+
+/** \brief Counters of the work done while genotyping, which are updated from all threads */
+struct StageCounters
+{
+  uint64_t reads_aligned{0}; // Reads with at least one graph alignment
+  uint64_t seeds{0}; // k-mer hits in the graph index
+  uint64_t dfs_expansions{0}; // Graph walks started while extending seeds
+  uint64_t haplotype_blocks{0}; // Haplotype blocks of the genotyped graph, not summed in the total of a region
+};
+
+
+/** \brief Graph walks started by the calling thread which have not been added to the report of its read yet */
+extern thread_local uint64_t thread_dfs_expansions;
+
+
+/** \brief Resources used by one stage of genotyping a region */
+struct StageUsage
+{
+  std::string name{};
+  double wall_seconds{0.0};
+  double cpu_seconds{0.0}; // User and system time of all threads
+  long peak_rss_kb{0}; // Peak resident set size during the stage, or of the process so far if it cannot be reset
+  long num_regions{1}; // Regions the stage was run for at once, its time and counters are split evenly between them
+  StageCounters counters{};
+};
+
+
+/**
+ * \brief Timings, peak memory and counters of the stages of genotyping a region.
+ * \details Stages are added by StageTimer on the thread which runs genotype(), while the counters may be updated from
+ * any thread. The report is written as JSON next to the output VCF of the region. Stages which are run once for
+ * several regions before they are genotyped, such as batched bamshrink, are set as shared stages and each region's
+ * share of them is included in its report.
+ */
+class StageReport
+{
+public:
+  std::string region{};
+  std::vector<StageUsage> stages{};
+  std::vector<StageUsage> shared_stages{}; // Share of each region in stages run before it, kept until replaced
+  std::chrono::steady_clock::time_point wall_start{}; // When the region was started
+  double cpu_start{0.0};
+
+  std::atomic<uint64_t> reads_aligned{0};
+  std::atomic<uint64_t> seeds{0};
+  std::atomic<uint64_t> dfs_expansions{0}; // Added once per read from thread_dfs_expansions
+  std::atomic<uint64_t> haplotype_blocks{0}; // Set (not added) by each writer of the graph being genotyped
+
+  void clear(std::string const & new_region);
+  StageCounters get_counters() const;
+  void add_thread_counters(); // Adds and resets the counters of the calling thread
+
+  void add_stage(StageUsage && usage);
+  void set_shared_stages(std::vector<StageUsage> && usages);
+  void write_json(std::string const & path) const;
+};
+
+extern StageReport stage_report;
+
+
+/**
+ * \brief Measures a stage of genotyping from its construction until stop() is called or it goes out of scope.
+ * \details If num_shared_regions is set, the stage is run once for that many regions before they are genotyped and it
+ * is not added to the report of the current region. Use get_usage() to get the share of each region for
+ * StageReport::set_shared_stages().
+ */
+class StageTimer
+{
+public:
+  explicit StageTimer(std::string const & name, long num_shared_regions = 0);
+  ~StageTimer();
+  StageTimer(StageTimer const &) = delete;
+  StageTimer & operator=(StageTimer const &) = delete;
+
+  void stop();
+  StageUsage const & get_usage() const; // Each region's share of the stage, after it was stopped
+
+private:
+  std::string name;
+  long num_shared_regions{0};
+  StageUsage usage{};
+  std::chrono::steady_clock::time_point wall_start;
+  double cpu_start{0.0};
+  StageCounters counters_start{};
+  bool is_stopped{false};
+};
+
+} // namespace gyper
@@ -18,6 +18,16 @@ create_temp_dir(GenomicRegion const & region);
 void
 remove_file_tree(std::string const & path);
 
+// Copies a file next to the destination and renames the copy, so a partially written file never appears there. The
+// permissions and modification time of the file are kept.
+void
+copy_file(std::string const & from, std::string const & to);
+
+// Renames a file, or copies it next to the destination and renames the copy if the file is on another file system.
+// Either way, a partially written file never appears at the destination.
+void
+move_file(std::string const & from, std::string const & to);
+
 bool
 is_file(std::string const & filename);
 
@@ -47,11 +47,11 @@ AbsolutePosition::is_contig_available(std::string const & contig) const
 }
 
 
-uint32_t
+TAbsPos
 AbsolutePosition::get_absolute_position(std::string const & chromosome,
                                         uint32_t const contig_position) const
 {
-  uint32_t abs_pos;
+  TAbsPos abs_pos;
 
   try
   {
@@ -75,7 +75,7 @@ AbsolutePosition::get_absolute_position(std::string const & chromosome,
 
 
 std::pair<std::string, uint32_t>
-AbsolutePosition::get_contig_position(uint32_t const absolute_position,
+AbsolutePosition::get_contig_position(TAbsPos const absolute_position,
                                       std::vector<Contig> const & contigs) const
 {
   auto offset_it = std::lower_bound(offsets.begin(), offsets.end(), absolute_position);
@@ -83,7 +83,7 @@ AbsolutePosition::get_contig_position(uint32_t const absolute_position,
   assert(i > 0);
   assert(i <= static_cast<long>(contigs.size()));
   return std::make_pair<std::string, uint32_t>(std::string(contigs[i - 1].name),
-                                               absolute_position - offsets[i - 1]);
+                                               static_cast<uint32_t>(absolute_position - offsets[i - 1]));
 }
 
 
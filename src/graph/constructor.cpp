@@ -1,3 +1,4 @@
+#include <algorithm> // std::all_of, std::sort, std::unique
 #include <cassert> // assert
 #include <sstream> // std::ostringstream
 #include <string> // std::string
@@ -14,6 +15,7 @@
 #include <graphtyper/graph/var_record.hpp>
 #include <graphtyper/typer/variant.hpp>
 #include <graphtyper/utilities/options.hpp>
+#include <graphtyper/utilities/parallel.hpp> // gyper::parallel_for_each_index
 #include <graphtyper/utilities/gzstream.hpp>
 
 #include <seqan/basic.h>
@@ -191,6 +193,24 @@ open_tabix(seqan::Tabix & tabix_file,
 }
 
 
+// Removes the FORMAT and sample columns of a VCF line, so only the site is parsed
+void
+remove_sample_columns(std::string & line)
+{
+  std::size_t tab = 0;
+
+  for (int c = 0; c < 8; ++c)
+  {
+    tab = line.find('\t', c == 0 ? 0 : tab + 1);
+
+    if (tab == std::string::npos)
+      return; // The line has no sample columns
+  }
+
+  line.resize(tab);
+}
+
+
 void
 open_reference_genome(seqan::FaiIndex & fasta_index, std::string const & fasta_filename)
 {
@@ -224,10 +244,12 @@ open_reference_genome(seqan::FaiIndex & fasta_index, std::string const & fasta_f
     for (gyper::Contig const & contig : gyper::graph.contigs)
       sum += contig.length;
 
-    if (sum > 0x00000000FFFFFFFFull)
+    if (sum >= static_cast<uint64_t>(gyper::SPECIAL_START))
     {
-      BOOST_LOG_TRIVIAL(error) << "[" << __HERE__ << "] Graphtyper only supports references "
-                               << "with a total length less than 4,294,967,295 (2^32 - 1)\n";
+      BOOST_LOG_TRIVIAL(error) << "[" << __HERE__ << "] The total length of the reference is " << sum
+                               << " but this build of Graphtyper only supports references shorter than "
+                               << static_cast<uint64_t>(gyper::SPECIAL_START)
+                               << ". Build Graphtyper with GT_USE_64BIT_POSITIONS=ON to support longer references.";
       std::exit(112);
     }
   }
@@ -1137,10 +1159,30 @@ split_multi_allelic(seqan::VcfRecord && vcf_record)
 }
 
 
+// Reads a single reference base, from the reference sequence of the region if it covers the position
+char
+read_reference_base(long const pos,
+                    std::vector<char> const & reference_sequence,
+                    seqan::FaiIndex const & fasta_index,
+                    GenomicRegion const & genomic_region)
+{
+  long const offset = pos - static_cast<long>(genomic_region.begin);
+
+  if (offset >= 0 && offset < static_cast<long>(reference_sequence.size()))
+    return reference_sequence[offset];
+
+  std::vector<char> ref_base;
+  read_reference_seq(ref_base, fasta_index, get_chrom_idx(fasta_index, genomic_region.chr), pos, 1);
+  assert(ref_base.size() == 1);
+  return ref_base[0];
+}
+
+
 bool
 transform_sv_records(seqan::VcfRecord & vcf_record,
                      seqan::FaiIndex const & fasta_index,
-                     GenomicRegion const & genomic_region)
+                     GenomicRegion const & genomic_region,
+                     std::vector<char> const & reference_sequence)
 {
   if (seqan::length(vcf_record.alt) == 0)
   {
@@ -1177,14 +1219,13 @@ transform_sv_records(seqan::VcfRecord & vcf_record,
 
     if (static_cast<char>(vcf_record.ref[0]) != static_cast<char>(vcf_record.alt[0]))
     {
-      unsigned const chrom_idx = get_chrom_idx(fasta_index, genomic_region.chr);
       --vcf_record.beginPos;
 
-      std::vector<char> ref_before;
-      read_reference_seq(ref_before, fasta_index, chrom_idx, vcf_record.beginPos, 1);
-      assert(ref_before.size() == 1);
-
-      std::string ref_before_str(ref_before.begin(), ref_before.end());
+      std::string const ref_before_str(1,
+                                       read_reference_base(vcf_record.beginPos,
+                                                           reference_sequence,
+                                                           fasta_index,
+                                                           genomic_region));
       vcf_record.ref = ref_before_str.c_str();
       seqan::CharString new_alt(vcf_record.ref);
       seqan::append(new_alt, vcf_record.alt);
@@ -1225,16 +1266,15 @@ transform_sv_records(seqan::VcfRecord & vcf_record,
     // Check if first base does not match
     if (static_cast<char>(vcf_record.ref[0]) != static_cast<char>(vcf_record.alt[0]))
     {
-      unsigned const chrom_idx = get_chrom_idx(fasta_index, genomic_region.chr);
-      std::vector<char> ref_before;
       --vcf_record.beginPos;
-
-      read_reference_seq(ref_before, fasta_index, chrom_idx, vcf_record.beginPos, 1);
-      assert(ref_before.size() == 1);
+      char const ref_before = read_reference_base(vcf_record.beginPos,
+                                                  reference_sequence,
+                                                  fasta_index,
+                                                  genomic_region);
 
       {
         seqan::CharString new_ref;
-        appendValue(new_ref, ref_before[0]);
+        appendValue(new_ref, ref_before);
         append(new_ref, vcf_record.ref);
         vcf_record.ref = new_ref;
       }
@@ -1285,7 +1325,7 @@ add_var_record(std::vector<VarRecord> & var_records,
     return;
   }
 
-  VarRecord var(static_cast<uint32_t>(vcf_record.beginPos));
+  VarRecord var(static_cast<TAbsPos>(vcf_record.beginPos));
 
   var.is_sv = false;
   auto const & v_alt = vcf_record.alt;
@@ -1325,7 +1365,7 @@ add_var_record(std::vector<VarRecord> & var_records,
     }
 
     SV sv;
-    sv.begin = var.pos + 1;
+    sv.begin = static_cast<int32_t>(var.pos + 1);
     sv.chrom = genomic_region.chr;
 
     if (seqan::length(vcf_record.id) > 0)
@@ -1589,27 +1629,78 @@ add_var_record(std::vector<VarRecord> & var_records,
 }
 
 
+// Parses VCF lines into variant records of the region, keeping the order of the lines. Records of SV graphs are
+// parsed on this thread since SVs are numbered in the order they are added to the graph, other records are parsed on
+// all threads.
 void
-construct_graph(std::string const & reference_filename,
-                std::string const & vcf_filename,
-                std::string const & region,
-                bool const is_sv_graph,
-                bool const use_absolute_positions,
-                bool const check_index)
+add_vcf_lines(std::vector<VarRecord> & var_records,
+              std::vector<std::string> & lines,
+              seqan::FaiIndex const & fasta_index,
+              GenomicRegion const & genomic_region,
+              std::vector<char> const & reference_sequence,
+              bool const is_sv_graph)
 {
-  graph = Graph(use_absolute_positions);
-  graph.is_sv_graph = is_sv_graph;
+  auto add_line =
+    [&](std::vector<VarRecord> & records, std::string & line)
+    {
+      // Only the sites are needed, so the sample columns are removed before the records are parsed
+      remove_sample_columns(line);
+      seqan::VcfRecord vcf_record;
+      _insertDataToVcfRecord(vcf_record, line.c_str(), 0);
 
-  BOOST_LOG_TRIVIAL(debug) << __HERE__ << " Constructing graph for region " << region;
-  GenomicRegion genomic_region(region);
-  BOOST_LOG_TRIVIAL(debug) << __HERE__ << " Reading FASTA file located at " << reference_filename;
+      if (vcf_record.beginPos < static_cast<long>(genomic_region.begin) ||
+          static_cast<long>(vcf_record.beginPos + seqan::length(vcf_record.ref)) >
+          static_cast<long>(genomic_region.end))
+      {
+        return;
+      }
 
-  // Load the reference genome
-  seqan::FaiIndex fasta_index;
+      std::vector<seqan::VcfRecord> split_records = split_multi_allelic(std::move(vcf_record));
+
+      for (auto & rec : split_records)
+      {
+        if (!is_sv_graph || transform_sv_records(rec, fasta_index, genomic_region, reference_sequence))
+          add_var_record(records, rec, fasta_index, genomic_region, is_sv_graph);
+      }
+    };
+
+  long const NUM_LINES = lines.size();
+
+  if (is_sv_graph)
+  {
+    for (auto & line : lines)
+      add_line(var_records, line);
+
+    return;
+  }
+
+  // The records of each range are kept apart so they can be added in the order of the lines
+  long const NUM_RANGES = get_num_parallel_ranges(NUM_LINES);
+  std::vector<std::vector<VarRecord> > range_records(NUM_RANGES);
+
+  parallel_for_each_index(NUM_RANGES, [&](long const r)
+    {
+      long const end = get_parallel_range_begin(NUM_LINES, NUM_RANGES, r + 1);
+
+      for (long i = get_parallel_range_begin(NUM_LINES, NUM_RANGES, r); i < end; ++i)
+        add_line(range_records[r], lines[i]);
+    });
+
+  for (auto & records : range_records)
+    std::move(records.begin(), records.end(), std::back_inserter(var_records));
+}
+
+
+// Opens the reference genome and reads the reference sequence of the region
+std::vector<char>
+read_region_reference(seqan::FaiIndex & fasta_index,
+                      std::string const & reference_filename,
+                      GenomicRegion const & genomic_region)
+{
+  BOOST_LOG_TRIVIAL(debug) << __HERE__ << " Reading FASTA file located at " << reference_filename;
   open_reference_genome(fasta_index, reference_filename);
   absolute_pos.calculate_offsets(graph.contigs);
 
-  // Read the reference sequence
   std::vector<char> reference_sequence;
   read_reference_genome(reference_sequence, fasta_index, genomic_region);
 
@@ -1632,6 +1723,94 @@ construct_graph(std::string const & reference_filename,
     std::exit(1);
   }
 
+  return reference_sequence;
+}
+
+
+// Removes duplicate alternative alleles and extends the records which start with the same bases as the reference
+void
+prepare_var_records(std::vector<VarRecord> & var_records,
+                    GenomicRegion & genomic_region,
+                    std::vector<char> const & reference_sequence)
+{
+  // Remove duplicate alternative alleles
+  for (auto & var_record : var_records)
+  {
+    std::sort(var_record.alts.begin(), var_record.alts.end());
+    var_record.alts.erase(std::unique(var_record.alts.begin(), var_record.alts.end()),
+                          var_record.alts.end());
+  }
+
+#ifndef NDEBUG
+  genomic_region.check_if_var_records_match_reference_genome(var_records, reference_sequence);
+#endif // NDEBUG
+
+  for (auto & var_record : var_records)
+  {
+    genomic_region.add_reference_to_record_if_they_have_a_matching_prefix(var_record,
+                                                                          reference_sequence
+                                                                          );
+  }
+
+#ifndef NDEBUG
+  genomic_region.check_if_var_records_match_reference_genome(var_records, reference_sequence);
+#endif // NDEBUG
+}
+
+
+void
+add_region_to_graph(std::vector<char> && reference_sequence,
+                    std::vector<VarRecord> && var_records,
+                    GenomicRegion && genomic_region)
+{
+  // Sort var_records by position in increasing order
+  std::sort(var_records.begin(),
+            var_records.end(),
+            [](VarRecord const & a, VarRecord const & b){
+      return a.pos < b.pos;
+    }
+            );
+
+  graph.add_genomic_region(std::move(reference_sequence),
+                           std::move(var_records),
+                           std::move(genomic_region)
+                           );
+
+#ifndef NDEBUG
+  if (!graph.check())
+  {
+    BOOST_LOG_TRIVIAL(error) << "[" << __HERE__ << "] Problem creating graph. Printing graph:";
+    gyper::graph.print();
+    std::exit(1);
+  }
+#endif // NDEBUG
+
+  // Create all specials positions
+  BOOST_LOG_TRIVIAL(debug) << "[" << __HERE__ << "] Creating special positions for the graph.";
+  graph.create_special_positions();
+
+  BOOST_LOG_TRIVIAL(debug) << "[" << __HERE__ << "] Graph was successfully constructed.";
+}
+
+
+void
+construct_graph(std::string const & reference_filename,
+                std::string const & vcf_filename,
+                std::string const & region,
+                bool const is_sv_graph,
+                bool const use_absolute_positions,
+                bool const check_index)
+{
+  graph = Graph(use_absolute_positions);
+  graph.is_sv_graph = is_sv_graph;
+
+  BOOST_LOG_TRIVIAL(debug) << __HERE__ << " Constructing graph for region " << region;
+  GenomicRegion genomic_region(region);
+
+  // Load the reference genome
+  seqan::FaiIndex fasta_index;
+  std::vector<char> reference_sequence = read_region_reference(fasta_index, reference_filename, genomic_region);
+
   // Read variant records
   std::vector<VarRecord> var_records;
 
@@ -1640,50 +1819,35 @@ construct_graph(std::string const & reference_filename,
     BOOST_LOG_TRIVIAL(debug) << "[" << __HERE__ << "] Reading VCF file located at " <<
       vcf_filename;
 
+    // Lines are read in batches, which are parsed while the raw lines of only one batch are kept in memory
+    std::size_t constexpr BATCH_SIZE{65536};
+    std::vector<std::string> lines;
+    std::string line;
+
+    auto add_line_to_batch =
+      [&]()
+      {
+        lines.push_back(std::move(line));
+        line.clear();
+
+        if (lines.size() == BATCH_SIZE)
+        {
+          add_vcf_lines(var_records, lines, fasta_index, genomic_region, reference_sequence, is_sv_graph);
+          lines.clear();
+        }
+      };
+
     if (check_index)
     {
       // Load region using the tabix index
       seqan::Tabix tabix_file;
       open_tabix(tabix_file, vcf_filename, genomic_region);
 
-      // Load VCF record in loaded region
-      seqan::VcfRecord vcf_record;
-
-      // Read records
-      bool is_read_record = seqan::readRegion(vcf_record, tabix_file);
-
-      while (is_read_record)
-      {
-        if (vcf_record.beginPos >= static_cast<long>(genomic_region.begin) &&
-            static_cast<long>(vcf_record.beginPos + seqan::length(vcf_record.ref)) <=
-            static_cast<long>(genomic_region.end))
-        {
-          std::vector<seqan::VcfRecord> records = split_multi_allelic(std::move(vcf_record));
-
-          for (auto & rec : records)
-          {
-            if (is_sv_graph)
-            {
-              bool const is_ok = transform_sv_records(rec, fasta_index, genomic_region);
-
-              if (is_ok)
-              {
-                add_var_record(var_records, rec, fasta_index, genomic_region, is_sv_graph);
-              }
-            }
-            else
-            {
-              add_var_record(var_records, rec, fasta_index, genomic_region, is_sv_graph);
-            }
-          }
-        }
-
-        is_read_record = seqan::readRegion(vcf_record, tabix_file);
-      }
+      while (seqan::readRawRecord(line, tabix_file))
+        add_line_to_batch();
     }
     else
     {
-      // test
       igzstream igz(vcf_filename.c_str()); // input vcf.gz file
 
       if (!igz.rdbuf()->is_open())
@@ -1692,96 +1856,91 @@ construct_graph(std::string const & reference_filename,
         std::exit(1);
       }
 
-      std::string line;
-
       while (std::getline(igz, line))
       {
         // Skip header
         if (line.size() > 0 && line[0] == '#')
           continue;
 
-        seqan::VcfRecord vcf_record;
-        _insertDataToVcfRecord(vcf_record, line.c_str(), 0);
-
-        if (vcf_record.beginPos >= static_cast<long>(genomic_region.begin) &&
-            static_cast<long>(vcf_record.beginPos + seqan::length(vcf_record.ref)) <=
-            static_cast<long>(genomic_region.end))
-        {
-          std::vector<seqan::VcfRecord> records = split_multi_allelic(std::move(vcf_record));
-
-          for (auto & rec : records)
-          {
-            if (is_sv_graph)
-            {
-              bool const is_ok = transform_sv_records(rec, fasta_index, genomic_region);
-
-              if (is_ok)
-              {
-                add_var_record(var_records, rec, fasta_index, genomic_region, is_sv_graph);
-              }
-            }
-            else
-            {
-              add_var_record(var_records, rec, fasta_index, genomic_region, is_sv_graph);
-            }
-          }
-        }
+        add_line_to_batch();
       }
     }
 
-    // Remove duplicate alternative alleles
-    for (auto & var_record : var_records)
-    {
-      std::sort(var_record.alts.begin(), var_record.alts.end());
-      var_record.alts.erase(std::unique(var_record.alts.begin(), var_record.alts.end()),
-                            var_record.alts.end());
-    }
+    add_vcf_lines(var_records, lines, fasta_index, genomic_region, reference_sequence, is_sv_graph);
+    prepare_var_records(var_records, genomic_region, reference_sequence);
+  }
 
-#ifndef NDEBUG
-    genomic_region.check_if_var_records_match_reference_genome(var_records, reference_sequence);
-#endif // NDEBUG
+  seqan::clear(fasta_index); // Close reference genome FASTA
 
-    for (auto & var_record : var_records)
-    {
-      genomic_region.add_reference_to_record_if_they_have_a_matching_prefix(var_record,
-                                                                            reference_sequence
-                                                                            );
-    }
+  add_region_to_graph(std::move(reference_sequence), std::move(var_records), std::move(genomic_region));
+}
 
-#ifndef NDEBUG
-    genomic_region.check_if_var_records_match_reference_genome(var_records, reference_sequence);
-#endif // NDEBUG
-  }
 
+void
+construct_graph(std::string const & reference_filename,
+                std::vector<Variant> const & variants,
+                std::string const & region,
+                bool const use_absolute_positions)
+{
+  graph = Graph(use_absolute_positions);
+  graph.is_sv_graph = false;
+
+  BOOST_LOG_TRIVIAL(debug) << __HERE__ << " Constructing graph for region " << region << " with "
+                           << variants.size() << " variants";
+  GenomicRegion genomic_region(region);
+
+  // Load the reference genome
+  seqan::FaiIndex fasta_index;
+  std::vector<char> reference_sequence = read_region_reference(fasta_index, reference_filename, genomic_region);
   seqan::clear(fasta_index); // Close reference genome FASTA
 
-  // Sort var_records by position in increasing order
-  std::sort(var_records.begin(),
-            var_records.end(),
-            [](VarRecord const & a, VarRecord const & b){
-      return a.pos < b.pos;
+  // Add one record per alternative allele of the variants in the region, like when they are read from a VCF
+  std::vector<VarRecord> var_records;
+
+  for (auto const & var : variants)
+  {
+    assert(var.seqs.size() >= 2);
+    auto const contig_pos = absolute_pos.get_contig_position(var.abs_pos, graph.contigs);
+    long const pos = static_cast<long>(contig_pos.second) - 1; // 0-based
+    std::vector<char> const & ref = var.seqs[0];
+
+    if (contig_pos.first != genomic_region.chr ||
+        pos < static_cast<long>(genomic_region.begin) ||
+        pos + static_cast<long>(ref.size()) > static_cast<long>(genomic_region.end) ||
+        ref.size() == 0)
+    {
+      continue;
     }
-            );
 
-  graph.add_genomic_region(std::move(reference_sequence),
-                           std::move(var_records),
-                           std::move(genomic_region)
-                           );
+    for (long a = 1; a < static_cast<long>(var.seqs.size()); ++a)
+    {
+      std::vector<char> const & alt = var.seqs[a];
 
-#ifndef NDEBUG
-  if (!graph.check())
-  {
-    BOOST_LOG_TRIVIAL(error) << "[" << __HERE__ << "] Problem creating graph. Printing graph:";
-    gyper::graph.print();
-    std::exit(1);
+      // Skip alleles with non-ACGT
+      bool const is_acgt = alt.size() > 0 && std::all_of(alt.begin(), alt.end(), [](char const c){
+          return c == 'A' || c == 'C' || c == 'G' || c == 'T';
+        });
+
+      if (is_acgt)
+      {
+        var_records.push_back(VarRecord(static_cast<TAbsPos>(pos),
+                                        std::vector<char>(ref),
+                                        std::vector<std::vector<char> >(1, alt)));
+      }
+    }
   }
-#endif // NDEBUG
 
-  // Create all specials positions
-  BOOST_LOG_TRIVIAL(debug) << "[" << __HERE__ << "] Creating special positions for the graph.";
-  graph.create_special_positions();
+  // Remove duplicated records, a VCF written from the variants would not have them
+  std::sort(var_records.begin(), var_records.end(), [](VarRecord const & a, VarRecord const & b){
+      return a.pos < b.pos || (a.pos == b.pos && (a.ref < b.ref || (a.ref == b.ref && a.alts < b.alts)));
+    });
 
-  BOOST_LOG_TRIVIAL(debug) << "[" << __HERE__ << "] Graph was successfully constructed.";
+  var_records.erase(std::unique(var_records.begin(), var_records.end(), [](VarRecord const & a, VarRecord const & b){
+      return a.pos == b.pos && a.ref == b.ref && a.alts == b.alts;
+    }), var_records.end());
+
+  prepare_var_records(var_records, genomic_region, reference_sequence);
+  add_region_to_graph(std::move(reference_sequence), std::move(var_records), std::move(genomic_region));
 }
 
 
@@ -1796,6 +1955,7 @@ get_variants_using_tabix(std::string const & vcf, GenomicRegion const & genomic_
 
   while (seqan::readRawRecord(line, tabix))
   {
+    remove_sample_columns(line); // Only the first columns are used
     std::vector<std::size_t> const tabs = get_all_pos(line, '\t');
 
     std::string const chrom = get_string_at_tab_index(line, tabs, 0);
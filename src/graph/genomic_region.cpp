@@ -176,28 +176,28 @@ GenomicRegion::to_string() const
 }
 
 
-uint32_t
+TAbsPos
 GenomicRegion::get_absolute_begin_position() const
 {
   return absolute_pos.get_absolute_position(chr, begin + 1);
 }
 
 
-uint32_t
+TAbsPos
 GenomicRegion::get_absolute_end_position() const
 {
   return absolute_pos.get_absolute_position(chr, end + 1);
 }
 
 
-uint32_t
+TAbsPos
 GenomicRegion::get_absolute_position(std::string const & chromosome, uint32_t contig_position) const
 {
   return absolute_pos.get_absolute_position(chromosome, contig_position);
 }
 
 
-uint32_t
+TAbsPos
 GenomicRegion::get_absolute_position(uint32_t contig_position) const
 {
   return absolute_pos.get_absolute_position(chr, contig_position);
@@ -205,7 +205,7 @@ GenomicRegion::get_absolute_position(uint32_t contig_position) const
 
 
 std::pair<std::string, uint32_t>
-GenomicRegion::get_contig_position(uint32_t absolute_position, Graph const & graph) const
+GenomicRegion::get_contig_position(TAbsPos absolute_position, Graph const & graph) const
 {
   return absolute_pos.get_contig_position(absolute_position, graph.contigs);
 }
@@ -217,7 +217,7 @@ GenomicRegion::check_if_var_records_match_reference_genome(std::vector<VarRecord
 {
   for (auto const & record : var_records)
   {
-    uint32_t const pos = record.pos;
+    TAbsPos const pos = record.pos;
 
     if (pos >= GenomicRegion::begin + reference.size() || GenomicRegion::begin > pos)
       continue;
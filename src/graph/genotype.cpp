@@ -19,7 +19,7 @@ Genotype::Genotype()
 {}
 
 
-Genotype::Genotype(uint32_t const i, uint16_t const n, uint32_t const fvn)
+Genotype::Genotype(TAbsPos const i, uint16_t const n, uint32_t const fvn)
   : id(i)
   , num(n)
   , first_variant_node(fvn)
@@ -28,8 +28,12 @@ Genotype::Genotype(uint32_t const i, uint16_t const n, uint32_t const fvn)
 
 template <typename Archive>
 void
-Genotype::serialize(Archive & ar, const unsigned int /*version*/)
+Genotype::serialize(Archive & ar, const unsigned int version)
 {
+  // Newer versions are rejected by Boost, older ones are rejected here
+  if (version != ABS_POS_ARCHIVE_VERSION)
+    throw boost::archive::archive_exception(boost::archive::archive_exception::unsupported_class_version);
+
   ar & id;
   ar & num;
   ar & first_variant_node;
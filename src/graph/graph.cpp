@@ -2,6 +2,7 @@
 #include <cassert>
 #include <cmath>
 #include <iostream>
+#include <limits> // std::numeric_limits
 #include <unordered_set> // std::unordered_set
 
 #include <seqan/basic.h>
@@ -24,6 +25,7 @@
 #include <graphtyper/typer/variant.hpp>
 #include <graphtyper/utilities/type_conversions.hpp>
 #include <graphtyper/utilities/options.hpp>
+#include <graphtyper/utilities/stage_report.hpp>
 
 
 namespace gyper
@@ -325,7 +327,7 @@ Graph::add_genomic_region(std::vector<char> && reference_sequence,
   // If we chose to use absolute positions we need to change all labels
   if (use_absolute_positions)
   {
-    uint32_t const offset = genomic_region.get_absolute_position(1);
+    TAbsPos const offset = genomic_region.get_absolute_position(1);
     unsigned r = 0;
     assert(r < ref_nodes.size());
 
@@ -344,8 +346,8 @@ Graph::add_genomic_region(std::vector<char> && reference_sequence,
     ref_nodes[r].change_label_order(offset);
   }
 
-  // Keep the reference_sequence
-  reference = std::move(reference_sequence);
+  // Keep the reference_sequence, packed
+  reference.assign(reference_sequence);
 
   // Set offset
 //  reference_offset = genomic_region.begin;
@@ -360,7 +362,7 @@ Graph::get_variant_num(uint32_t v) const
 }
 
 
-uint32_t
+TAbsPos
 Graph::get_variant_order(long variant_id) const
 {
   assert(variant_id < static_cast<long>(var_nodes.size()));
@@ -381,16 +383,16 @@ Graph::get_all_ref() const
   while (ref_nodes[r].out_degree() != 0)
   {
     // insert reference
-    add_node_dna_to_sequence(ref, ref_nodes[r].get_label(), 0, 0xFFFFFFFFULL);
+    add_node_dna_to_sequence(ref, ref_nodes[r].get_label(), 0, std::numeric_limits<TAbsPos>::max());
 
     // insert the variant node which contains the reference sequence
-    add_node_dna_to_sequence(ref, var_nodes[v].get_label(), 0, 0xFFFFFFFFULL);
+    add_node_dna_to_sequence(ref, var_nodes[v].get_label(), 0, std::numeric_limits<TAbsPos>::max());
 
     v += ref_nodes[r].out_degree();
     ++r;
   }
 
-  add_node_dna_to_sequence(ref, ref_nodes[r].get_label(), 0, 0xFFFFFFFFULL);
+  add_node_dna_to_sequence(ref, ref_nodes[r].get_label(), 0, std::numeric_limits<TAbsPos>::max());
   return ref;
 }
 
@@ -398,7 +400,7 @@ Graph::get_all_ref() const
 void
 Graph::generate_reference_genome()
 {
-  reference = get_all_ref();
+  reference.assign(get_all_ref());
 //  reference_offset = genomic_region.begin;
 }
 
@@ -416,61 +418,53 @@ Graph::create_special_positions()
 
     std::vector<TNodeIndex> const out_vars = ref_nodes[r].get_vars();
     assert(out_vars.size() >= 2);
-    uint32_t const ref_label_reach = var_nodes[out_vars[0]].get_label().reach();
-    uint32_t max_var_reach = var_nodes[out_vars[1]].get_label().reach();
+    TAbsPos const ref_label_reach = var_nodes[out_vars[0]].get_label().reach();
+    TAbsPos max_var_reach = var_nodes[out_vars[1]].get_label().reach();
 
     // Get the maximum variant reach
     for (auto it = out_vars.begin() + 2; it != out_vars.end(); ++it)
       max_var_reach = std::max(max_var_reach, var_nodes[*it].get_label().reach());
 
     // Create special position for each position further than the reference
-    for (uint32_t reach = ref_label_reach + 1; reach <= max_var_reach; ++reach)
+    for (TAbsPos reach = ref_label_reach + 1; reach <= max_var_reach; ++reach)
       add_special_pos(reach, ref_label_reach);
   }
 }
 
 
 std::vector<char>
-Graph::get_generated_reference_genome(uint32_t & from, uint32_t & to) const
+Graph::get_generated_reference_genome(TAbsPos & from, TAbsPos & to) const
+{
+  return get_generated_reference_view(from, to).to_vector();
+}
+
+
+PackedSequenceView
+Graph::get_generated_reference_view(TAbsPos & from, TAbsPos & to) const
 {
   // TODO: Handle multiregions
   // std::string const & chrom = genomic_regions[0].chr;
-  uint32_t const abs_first_from = genomic_region.get_absolute_position(genomic_region.begin + 1);
+  TAbsPos const abs_first_from = genomic_region.get_absolute_position(genomic_region.begin + 1);
   // uint32_t const abs_to = genomic_region.get_contig_position(to).second;
   from = std::max(abs_first_from, from);
-  to = std::min(static_cast<uint32_t>(abs_first_from + reference.size()), to);
+  to = std::min(static_cast<TAbsPos>(abs_first_from + reference.size()), to);
 
   if (to < from)
-  {
-    //BOOST_LOG_TRIVIAL(warning) << "[graphtyper::graph] Read end is before the reference genome "
-    //                           << "starts.";
-    //BOOST_LOG_TRIVIAL(debug) << "reference_offset="
-    //                         << reference_offset
-    //                         << ", to="
-    //                         << to
-    //                         << ", from="
-    //                         << from
-    //                         << ", abs_first_from="
-    //                         << abs_first_from;
+    return PackedSequenceView();
 
-    return std::vector<char>(0);
-  }
-
-  return std::vector<char>(reference.begin() + from - abs_first_from,
-                           reference.begin() + to - abs_first_from
-                           );
+  return reference.get_view(from - abs_first_from, to - abs_first_from);
 }
 
 
 std::vector<char>
-Graph::get_ref(uint32_t from, uint32_t to) const
+Graph::get_ref(TAbsPos from, TAbsPos to) const
 {
   return get_reference_ref(from, to);
 }
 
 
 std::vector<char>
-Graph::get_reference_ref(uint32_t & from, uint32_t & to) const
+Graph::get_reference_ref(TAbsPos & from, TAbsPos & to) const
 {
   if (ref_nodes.size() == 0 or ref_nodes.front().get_label().order > to)
   {
@@ -504,7 +498,7 @@ Graph::get_reference_ref(uint32_t & from, uint32_t & to) const
 
 
 std::vector<char>
-Graph::walk_random_path(uint32_t from, uint32_t to) const
+Graph::walk_random_path(TAbsPos from, TAbsPos to) const
 {
   if (ref_nodes.size() == 0 or ref_nodes.front().get_label().order > to)
   {
@@ -606,14 +600,14 @@ Graph::add_variants(VarRecord && record)
 
 
 void
-Graph::add_reference(unsigned end_pos, unsigned const & num_var, std::vector<char> const & reference_sequence)
+Graph::add_reference(TAbsPos end_pos, unsigned const & num_var, std::vector<char> const & reference_sequence)
 {
   if (end_pos > reference_sequence.size() + genomic_region.begin)
   {
     end_pos = reference_sequence.size() + genomic_region.begin;
   }
 
-  unsigned start_pos = genomic_region.begin;
+  TAbsPos start_pos = genomic_region.begin;
 
   if (var_nodes.size() > 0)
   {
@@ -926,7 +920,7 @@ Graph::get_10log10_num_paths(TNodeIndex const v, uint32_t const MAX_DISTANCE)
   assert(var_nodes[v].get_label().reach() >= var_nodes[v].get_label().order);
 
   // Get the center of the variant, this position will be used to determine if the other variants are too far away or not.
-  uint32_t const CENTER = var_nodes[v].get_label().order +
+  TAbsPos const CENTER = var_nodes[v].get_label().order +
                           (var_nodes[v].get_label().reach() - var_nodes[v].get_label().order) / 2;
   uint32_t r = var_nodes[v].get_out_ref_index() - 1;
   double num_paths = 0.0;
@@ -961,7 +955,7 @@ Graph::get_10log10_num_paths(TNodeIndex const v, uint32_t const MAX_DISTANCE)
 
 
 std::vector<Location>
-Graph::get_locations_of_an_actual_position(uint32_t pos, Path const & path, bool const is_special) const
+Graph::get_locations_of_an_actual_position(TAbsPos pos, Path const & path, bool const is_special) const
 {
   assert(ref_nodes.size() != 0);
   std::vector<Location> locs(0);
@@ -988,7 +982,7 @@ Graph::get_locations_of_an_actual_position(uint32_t pos, Path const & path, bool
         locs.push_back(Location('R' /*type*/,
                                 static_cast<uint32_t>(rr) /*node_id*/,
                                 ref_nodes[rr].get_label().order /*node_order*/,
-                                pos - ref_nodes[rr].get_label().order /*offset*/
+                                static_cast<uint32_t>(pos - ref_nodes[rr].get_label().order) /*offset*/
                                 )
                        );
         break; // There is no way there are also variants at this location if the position is not special
@@ -1026,7 +1020,7 @@ Graph::get_locations_of_an_actual_position(uint32_t pos, Path const & path, bool
               {'V' /*type*/,
                v /*node_id*/,
                var_nodes[v].get_label().order /*node_order*/,
-               pos - var_nodes[v].get_label().order  /*offset*/
+               static_cast<uint32_t>(pos - var_nodes[v].get_label().order)  /*offset*/
               }
               );
           }
@@ -1146,7 +1140,7 @@ Graph::reference_distance_between_locations(std::vector<Location> const & ll1,
 
   auto get_ref_pos_lambda = [&](Location const & l)
                             {
-                              uint32_t pos;
+                              TAbsPos pos;
 
                               if (l.node_type == 'R')
                               {
@@ -1165,11 +1159,11 @@ Graph::reference_distance_between_locations(std::vector<Location> const & ll1,
 
   for (auto const & l1 : ll1)
   {
-    uint32_t const ref_pos1 = get_ref_pos_lambda(l1);
+    TAbsPos const ref_pos1 = get_ref_pos_lambda(l1);
 
     for (auto const & l2 : ll2)
     {
-      uint32_t const ref_pos2 = get_ref_pos_lambda(l2);
+      TAbsPos const ref_pos2 = get_ref_pos_lambda(l2);
       distance_map.insert(static_cast<int64_t>(ref_pos2) - static_cast<int64_t>(ref_pos1));
     }
   }
@@ -1179,7 +1173,7 @@ Graph::reference_distance_between_locations(std::vector<Location> const & ll1,
 
 
 std::vector<Location>
-Graph::get_locations_of_a_position(uint32_t pos, Path const & path) const
+Graph::get_locations_of_a_position(TAbsPos pos, Path const & path) const
 {
   bool const IS_SPECIAL = is_special_pos(pos);
 
@@ -1212,7 +1206,7 @@ Graph::get_labels_forward(Location const & s,
 
   std::vector<std::vector<char> > var_and_refs(1);
   std::vector<std::vector<uint32_t> > var_ids(1);
-  std::vector<uint32_t> end_pos(1, 0u);
+  std::vector<TAbsPos> end_pos(1, 0u);
   std::vector<TNodeIndex> vars;
 
   if (s.node_type == 'V')
@@ -1229,9 +1223,9 @@ Graph::get_labels_forward(Location const & s,
     {
       // variant is enough
       end_pos[0] =
-        static_cast<uint32_t>(var.get_label().reach() - (var_and_refs[0].size() - read.size()));
+        static_cast<TAbsPos>(var.get_label().reach() - (var_and_refs[0].size() - read.size()));
 
-      uint32_t const ref_reach =
+      TAbsPos const ref_reach =
         var_nodes[ref_nodes[var.get_out_ref_index() - 1].get_vars()[0]].get_label().reach();
 
       if (end_pos[0] > ref_reach)
@@ -1249,7 +1243,7 @@ Graph::get_labels_forward(Location const & s,
                              );
 
       end_pos[0] =
-        static_cast<uint32_t>(ref.get_label().reach() - (var_and_refs[0].size() - read.size()));
+        static_cast<TAbsPos>(ref.get_label().reach() - (var_and_refs[0].size() - read.size()));
     }
   }
   else
@@ -1264,7 +1258,7 @@ Graph::get_labels_forward(Location const & s,
                                         );
 
     end_pos[0] =
-      static_cast<uint32_t>(ref.get_label().reach() - (var_and_refs[0].size() - read.size()));
+      static_cast<TAbsPos>(ref.get_label().reach() - (var_and_refs[0].size() - read.size()));
   }
 
   // We are starting on a variant node
@@ -1320,7 +1314,7 @@ Graph::get_labels_forward(Location const & s,
               end_pos.push_back(var.get_label().reach() - (new_seq.size() - read.size()));
 
               // Check if the end position is further than the reference reach
-              uint32_t const ref_reach =
+              TAbsPos const ref_reach =
                 var_nodes[ref_nodes[var.get_out_ref_index() - 1].get_vars()[0]].get_label().reach();
 
               if (end_pos.back() > ref_reach)
@@ -1360,7 +1354,7 @@ Graph::get_labels_forward(Location const & s,
             end_pos[j] = var.get_label().reach() - (var_and_refs[j].size() - read.size());
 
             // Check if the end position is further than the reference reach
-            uint32_t const ref_reach =
+            TAbsPos const ref_reach =
               var_nodes[ref_nodes[var.get_out_ref_index() - 1].get_vars()[0]].get_label().reach();
             if (end_pos[j] > ref_reach)
               end_pos[j] = get_special_pos(end_pos[j], ref_reach);
@@ -1400,7 +1394,7 @@ Graph::get_labels_forward(Location const & s,
   }
 
   std::vector<std::vector<uint32_t> > best_var_ids;
-  std::vector<uint32_t> best_end_pos;
+  std::vector<TAbsPos> best_end_pos;
 
   // Iterate all possible sequences
   for (unsigned j = 0; j < var_and_refs.size(); ++j)
@@ -1438,12 +1432,12 @@ Graph::get_labels_forward(Location const & s,
   {
     for (unsigned j = 0; j < best_var_ids.size(); ++j)
     {
-      uint32_t start_pos = s.node_order + s.offset;
+      TAbsPos start_pos = s.node_order + s.offset;
 
       // Check if we need to use a special positions for the end position
       if (s.node_type == 'V')
       {
-        uint32_t const ref_reach =
+        TAbsPos const ref_reach =
           var_nodes[ref_nodes[var_nodes[s.node_index].get_out_ref_index() - 1].get_vars()[0]].get_label().reach();
         if (start_pos > ref_reach)
           start_pos = get_special_pos(start_pos, ref_reach);
@@ -1483,7 +1477,7 @@ Graph::get_labels_backward(Location const & e,
 
   std::vector<std::vector<char> > var_and_refs(1);
   std::vector<std::vector<uint32_t> > var_ids(1);
-  std::vector<uint32_t> start_pos(1, 0u);
+  std::vector<TAbsPos> start_pos(1, 0u);
   std::vector<TNodeIndex> vars;
 
   if (e.node_type == 'V')
@@ -1499,7 +1493,7 @@ Graph::get_labels_backward(Location const & e,
       start_pos[0] = var.get_label().order + (var_and_refs[0].size() - read.size());
 
       // Check if we need to use a special positions
-      uint32_t const ref_reach = var_nodes[ref_nodes[var.get_out_ref_index() - 1].get_vars()[0]].get_label().reach();
+      TAbsPos const ref_reach = var_nodes[ref_nodes[var.get_out_ref_index() - 1].get_vars()[0]].get_label().reach();
       if (start_pos[0] > ref_reach)
         start_pos[0] = get_special_pos(start_pos[0], ref_reach);
     }
@@ -1587,7 +1581,7 @@ Graph::get_labels_backward(Location const & e,
                 start_pos.push_back(var.get_label().order + (new_seq.size() - read.size()));
 
                 // Check if we need to use a special positions
-                uint32_t const ref_reach =
+                TAbsPos const ref_reach =
                   var_nodes[ref_nodes[var.get_out_ref_index() - 1].get_vars()[0]].get_label().reach();
                 if (start_pos.back() > ref_reach)
                   start_pos.back() = get_special_pos(start_pos.back(), ref_reach);
@@ -1626,7 +1620,7 @@ Graph::get_labels_backward(Location const & e,
             start_pos[j] = var.get_label().order + (var_and_refs[j].size() - read.size());
 
             // Check if we need to use a special positions
-            uint32_t const ref_reach =
+            TAbsPos const ref_reach =
               var_nodes[ref_nodes[var.get_out_ref_index() - 1].get_vars()[0]].get_label().reach();
             if (start_pos[j] > ref_reach)
               start_pos[j] = get_special_pos(start_pos[j], ref_reach);
@@ -1676,7 +1670,7 @@ Graph::get_labels_backward(Location const & e,
   }
 
   std::vector<std::vector<uint32_t> > best_var_ids;
-  std::vector<uint32_t> best_start_pos;
+  std::vector<TAbsPos> best_start_pos;
 
   // Iterate all possible sequences
   for (unsigned j = 0; j < var_and_refs.size(); ++j)
@@ -1708,12 +1702,12 @@ Graph::get_labels_backward(Location const & e,
 
   for (unsigned j = 0; j < best_var_ids.size(); ++j)
   {
-    uint32_t end_pos = e.node_order + e.offset;
+    TAbsPos end_pos = e.node_order + e.offset;
 
     // Check if we need to use a special positions for the end position
     if (e.node_type == 'V')
     {
-      uint32_t const ref_reach =
+      TAbsPos const ref_reach =
         var_nodes[ref_nodes[var_nodes[e.node_index].get_out_ref_index() - 1].get_vars()[0]].get_label().reach();
       if (end_pos > ref_reach)
         end_pos = get_special_pos(end_pos, ref_reach);
@@ -1776,6 +1770,8 @@ Graph::iterative_dfs(std::vector<Location> const & start_locations,
   // Check if node type of start location is unavailable ('U'). In this case we need to walk the graph backwards
   if (start_locations.size() == 1 and start_locations[0].is_unavailable())
   {
+    thread_dfs_expansions += end_locations.size();
+
     for (auto const & e : end_locations)
     {
       uint32_t mismatches = max_mismatches;
@@ -1785,6 +1781,8 @@ Graph::iterative_dfs(std::vector<Location> const & start_locations,
   }
   else
   {
+    thread_dfs_expansions += start_locations.size();
+
     for (auto const & s : start_locations)
     {
       uint32_t mismatches = max_mismatches;
@@ -1801,7 +1799,7 @@ Graph::iterative_dfs(std::vector<Location> const & start_locations,
  * SPECIAL POS
  */
 void
-Graph::add_special_pos(uint32_t const actual_pos, uint32_t const ref_reach)
+Graph::add_special_pos(TAbsPos const actual_pos, TAbsPos const ref_reach)
 {
   ref_reach_poses.push_back(ref_reach);
   actual_poses.push_back(actual_pos);
@@ -1813,13 +1811,13 @@ Graph::add_special_pos(uint32_t const actual_pos, uint32_t const ref_reach)
   }
   else
   {
-    ref_reach_to_special_pos[ref_reach] = std::vector<uint32_t>(1, SPECIAL_START + ref_reach_poses.size() - 1);
+    ref_reach_to_special_pos[ref_reach] = std::vector<TAbsPos>(1, SPECIAL_START + ref_reach_poses.size() - 1);
   }
 }
 
 
-uint32_t
-Graph::get_special_pos(uint32_t const pos, uint32_t const ref_reach) const
+TAbsPos
+Graph::get_special_pos(TAbsPos const pos, TAbsPos const ref_reach) const
 {
   assert(pos > ref_reach);
   assert(std::distance(ref_reach_to_special_pos.begin(), ref_reach_to_special_pos.end()) > 0);
@@ -1830,14 +1828,14 @@ Graph::get_special_pos(uint32_t const pos, uint32_t const ref_reach) const
 
 
 bool
-Graph::is_special_pos(uint32_t const pos) const
+Graph::is_special_pos(TAbsPos const pos) const
 {
   return pos >= SPECIAL_START && (pos - SPECIAL_START) < ref_reach_poses.size();
 }
 
 
-uint32_t
-Graph::get_ref_reach_pos(uint32_t const pos) const
+TAbsPos
+Graph::get_ref_reach_pos(TAbsPos const pos) const
 {
   if (is_special_pos(pos))
     return ref_reach_poses.at(pos - SPECIAL_START);
@@ -1846,8 +1844,8 @@ Graph::get_ref_reach_pos(uint32_t const pos) const
 }
 
 
-uint32_t
-Graph::get_actual_pos(uint32_t const pos) const
+TAbsPos
+Graph::get_actual_pos(TAbsPos const pos) const
 {
   if (is_special_pos(pos))
     return actual_poses.at(pos - SPECIAL_START);
@@ -1981,7 +1979,7 @@ Graph::check_increasing_order() const
   }
 
   // Reference nodes
-  uint32_t old_order = ref_nodes[0].get_label().order;
+  TAbsPos old_order = ref_nodes[0].get_label().order;
 
   for (long r = 1; r < static_cast<long>(ref_nodes.size()); ++r)
   {
@@ -2097,7 +2095,7 @@ Graph::is_homopolymer(Genotype const & gt) const
   // Check if we can find N identical bases
   long constexpr N = 10;
   long same_base = 0;
-  std::vector<char> const & seq1 = var.get_label().dna;
+  PackedSequence const & seq1 = var.get_label().dna;
   char prev_base = seq1.size() > 0 ? seq1[0] : 'N';
 
   // Check reference allele
@@ -2120,7 +2118,7 @@ Graph::is_homopolymer(Genotype const & gt) const
     long r = var.get_out_ref_index();
     assert(r < static_cast<long>(ref_nodes.size()));
     auto const & ref = ref_nodes[r];
-    std::vector<char> const & seq2 = ref.get_label().dna;
+    PackedSequence const & seq2 = ref.get_label().dna;
     long const LEN = std::min(50l - static_cast<long>(seq1.size()), static_cast<long>(seq2.size()));
 
     for (long s = 0; s < LEN; ++s)
@@ -2142,10 +2140,10 @@ Graph::is_homopolymer(Genotype const & gt) const
 }
 
 
-std::vector<uint32_t>
-Graph::get_var_orders(uint32_t const start, uint32_t const end) const
+std::vector<TAbsPos>
+Graph::get_var_orders(TAbsPos const start, TAbsPos const end) const
 {
-  std::vector<uint32_t> var_orders;
+  std::vector<TAbsPos> var_orders;
   unsigned r = 0;
   unsigned v = 0;
 
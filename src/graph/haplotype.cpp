@@ -651,10 +651,10 @@ Haplotype::update_max_log_score()
 */
 
 
-std::vector<uint32_t>
+std::vector<TAbsPos>
 Haplotype::get_genotype_ids() const
 {
-  std::vector<uint32_t> gt_ids;
+  std::vector<TAbsPos> gt_ids;
 
   for (unsigned i = 0; i < gts.size(); ++i)
     gt_ids.push_back(gts[i].id);
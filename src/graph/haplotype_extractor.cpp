@@ -222,7 +222,7 @@ make_variant_of_gapped_strings(std::string & gapped_ref,
 
 
 std::vector<VariantCandidate>
-find_variants_in_alignment(uint32_t const pos,
+find_variants_in_alignment(TAbsPos const pos,
                            std::vector<char> const & ref,
                            std::vector<char> const & seq,
                            std::vector<char> const & qual
@@ -296,7 +296,7 @@ find_variants_in_alignment(uint32_t const pos,
     }
 
     // Check if high or low quality
-    long const r = std::max(0l, new_var.abs_pos - ref_to_seq_offset - 50l);
+    long const r = std::max(0l, static_cast<long>(new_var.abs_pos) - ref_to_seq_offset - 50l);
     long const r_end = r + new_var.seqs[1].size();
     ref_to_seq_offset += new_var.seqs[0].size() - new_var.seqs[1].size();
 
@@ -11,7 +11,7 @@ namespace gyper
 
 Label::Label() noexcept
   : order(INVALID_ID)
-  , dna(0)
+  , dna()
   , variant_num(INVALID_NUM)
 {}
 
@@ -24,20 +24,20 @@ Label::Label(Label const & l) noexcept
 
 
 Label::Label(Label && l) noexcept
-  : order(std::forward<uint32_t>(l.order))
-  , dna(std::forward<std::vector<char> >(l.dna))
+  : order(std::forward<TAbsPos>(l.order))
+  , dna(std::forward<PackedSequence>(l.dna))
   , variant_num(std::forward<uint16_t>(l.variant_num))
 {}
 
 
-Label::Label(uint32_t const & _order, std::vector<char> && _dna, uint16_t const & _variant_num) noexcept
+Label::Label(TAbsPos const & _order, std::vector<char> && _dna, uint16_t const & _variant_num) noexcept
   : order(_order)
-  , dna(std::move(_dna))
+  , dna(_dna)
   , variant_num(_variant_num)
 {}
 
 
-uint32_t
+TAbsPos
 Label::reach() const
 {
   return order + dna.size() - 1;
@@ -46,10 +46,27 @@ Label::reach() const
 
 template <typename Archive>
 void
-Label::serialize(Archive & ar, const unsigned int)
+Label::serialize(Archive & ar, const unsigned int version)
 {
   ar & order;
-  ar & dna;
+
+  if (version == LABEL_ARCHIVE_VERSION)
+  {
+    ar & dna;
+  }
+  else if (version == 0 && ABS_POS_ARCHIVE_VERSION == 0)
+  {
+    // Only loaded, since the current version is always saved
+    std::vector<char> unpacked_dna;
+    ar & unpacked_dna;
+    dna.assign(unpacked_dna);
+  }
+  else
+  {
+    // Newer versions are rejected by Boost, others are rejected here
+    throw boost::archive::archive_exception(boost::archive::archive_exception::unsupported_class_version);
+  }
+
   ar & variant_num;
 }
 
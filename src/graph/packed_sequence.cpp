@@ -0,0 +1,448 @@
+#include <algorithm> // std::upper_bound, std::fill, std::min, std::max, std::copy
+#include <cassert> // assert
+#include <cstdlib> // std::exit
+#include <iterator> // std::distance
+#include <limits> // std::numeric_limits
+#include <string> // std::string
+#include <utility> // std::pair
+#include <vector> // std::vector
+
+#include <boost/archive/binary_iarchive.hpp>
+#include <boost/archive/binary_oarchive.hpp>
+#include <boost/log/trivial.hpp>
+#include <boost/serialization/binary_object.hpp>
+
+#include <graphtyper/constants.hpp>
+#include <graphtyper/graph/packed_sequence.hpp>
+
+
+namespace
+{
+
+char constexpr PACKED_BASES[4] = {'A', 'C', 'G', 'T'};
+
+} // anon namespace
+
+
+namespace gyper
+{
+
+PackedSequence::PackedSequence(std::vector<char> const & seq)
+{
+  assign(seq);
+}
+
+
+PackedSequence::PackedSequence(PackedSequence const & other)
+  : seq_size(other.seq_size)
+  , n_other_runs(other.n_other_runs)
+  , storage(other.storage)
+{
+  if (is_allocated())
+  {
+    allocate();
+    std::copy(other.storage.data, other.storage.data + get_num_allocated_words(), storage.data);
+  }
+}
+
+
+PackedSequence::PackedSequence(PackedSequence && other) noexcept
+  : seq_size(other.seq_size)
+  , n_other_runs(other.n_other_runs)
+  , storage(other.storage)
+{
+  other.seq_size = 0;
+  other.n_other_runs = 0;
+  other.storage.word = 0;
+}
+
+
+PackedSequence &
+PackedSequence::operator=(PackedSequence const & other)
+{
+  if (this != &other)
+  {
+    PackedSequence copy(other);
+    *this = std::move(copy);
+  }
+
+  return *this;
+}
+
+
+PackedSequence &
+PackedSequence::operator=(PackedSequence && other) noexcept
+{
+  if (this != &other)
+  {
+    clear();
+    seq_size = other.seq_size;
+    n_other_runs = other.n_other_runs;
+    storage = other.storage;
+    other.seq_size = 0;
+    other.n_other_runs = 0;
+    other.storage.word = 0;
+  }
+
+  return *this;
+}
+
+
+PackedSequence::~PackedSequence()
+{
+  clear();
+}
+
+
+void
+PackedSequence::assign(std::vector<char> const & seq)
+{
+  clear();
+
+  if (seq.size() > std::numeric_limits<uint32_t>::max())
+  {
+    BOOST_LOG_TRIVIAL(error) << __HERE__ << " Sequences longer than " << std::numeric_limits<uint32_t>::max()
+                             << " bases cannot be packed.";
+    std::exit(1);
+  }
+
+  // Find the runs of other characters first, since they are stored in the same allocation as the words
+  std::vector<std::pair<uint64_t, char> > other_runs;
+
+  for (std::size_t i = 0; i < seq.size(); ++i)
+  {
+    char const c = seq[i];
+
+    if (c == 'A' || c == 'C' || c == 'G' || c == 'T')
+      continue;
+
+    // Extend the previous run if it is of the same character and ends here
+    if (other_runs.size() > 0 && (other_runs.back().first >> 32) == i && other_runs.back().second == c)
+      other_runs.back().first += uint64_t(1) << 32;
+    else
+      other_runs.push_back({(static_cast<uint64_t>(i + 1) << 32) | i, c});
+  }
+
+  seq_size = static_cast<uint32_t>(seq.size());
+  n_other_runs = static_cast<uint32_t>(other_runs.size());
+  allocate();
+
+  uint64_t * words = is_allocated() ? storage.data : &storage.word;
+
+  for (std::size_t i = 0; i < seq.size(); ++i)
+  {
+    uint64_t code{0};
+
+    switch (seq[i])
+    {
+    case 'C': code = 1; break;
+
+    case 'G': code = 2; break;
+
+    case 'T': code = 3; break;
+
+    default: break; // A and other characters
+    }
+
+    words[i >> 5] |= code << ((i & 31) * 2);
+  }
+
+  if (n_other_runs > 0)
+  {
+    uint64_t * runs = storage.data + get_num_words();
+    char * chars = reinterpret_cast<char *>(runs + n_other_runs);
+
+    for (std::size_t r = 0; r < other_runs.size(); ++r)
+    {
+      runs[r] = other_runs[r].first;
+      chars[r] = other_runs[r].second;
+    }
+  }
+}
+
+
+void
+PackedSequence::clear()
+{
+  if (is_allocated())
+    delete [] storage.data;
+
+  seq_size = 0;
+  n_other_runs = 0;
+  storage.word = 0;
+}
+
+
+std::size_t
+PackedSequence::size() const
+{
+  return seq_size;
+}
+
+
+bool
+PackedSequence::empty() const
+{
+  return seq_size == 0;
+}
+
+
+char
+PackedSequence::operator[](std::size_t const i) const
+{
+  assert(i < seq_size);
+
+  if (n_other_runs > 0)
+  {
+    std::size_t const r = first_other_run_ending_after(i);
+
+    if (r < n_other_runs && (get_other_runs()[r] & 0xFFFFFFFFull) <= i)
+      return get_other_chars()[r];
+  }
+
+  return get_packed_base(i);
+}
+
+
+char
+PackedSequence::front() const
+{
+  return (*this)[0];
+}
+
+
+char
+PackedSequence::back() const
+{
+  return (*this)[seq_size - 1];
+}
+
+
+std::vector<char>
+PackedSequence::get_sequence(std::size_t const begin, std::size_t end) const
+{
+  end = std::min(end, static_cast<std::size_t>(seq_size));
+
+  if (begin >= end)
+    return std::vector<char>(0);
+
+  std::vector<char> seq;
+  seq.reserve(end - begin);
+
+  for (std::size_t i = begin; i < end; ++i)
+    seq.push_back(get_packed_base(i));
+
+  // Put back the characters which are not packed
+  uint64_t const * runs = get_other_runs();
+  char const * chars = get_other_chars();
+
+  for (std::size_t r = first_other_run_ending_after(begin); r < n_other_runs && (runs[r] & 0xFFFFFFFFull) < end; ++r)
+  {
+    std::size_t const run_begin = std::max(static_cast<std::size_t>(runs[r] & 0xFFFFFFFFull), begin);
+    std::size_t const run_end = std::min(static_cast<std::size_t>(runs[r] >> 32), end);
+    std::fill(seq.begin() + (run_begin - begin), seq.begin() + (run_end - begin), chars[r]);
+  }
+
+  return seq;
+}
+
+
+std::vector<char>
+PackedSequence::to_vector() const
+{
+  return get_sequence(0, seq_size);
+}
+
+
+std::string
+PackedSequence::to_string() const
+{
+  std::vector<char> const seq = to_vector();
+  return std::string(seq.begin(), seq.end());
+}
+
+
+PackedSequenceView
+PackedSequence::get_view(std::size_t const begin, std::size_t const end) const
+{
+  return PackedSequenceView(this, begin, std::max(begin, std::min(end, static_cast<std::size_t>(seq_size))));
+}
+
+
+bool
+PackedSequence::has_other_bases(std::size_t const begin, std::size_t const end) const
+{
+  if (begin >= end || n_other_runs == 0)
+    return false;
+
+  std::size_t const r = first_other_run_ending_after(begin);
+  return r < n_other_runs && (get_other_runs()[r] & 0xFFFFFFFFull) < end;
+}
+
+
+bool
+PackedSequence::is_allocated() const
+{
+  return seq_size > 32 || n_other_runs > 0;
+}
+
+
+std::size_t
+PackedSequence::get_num_words() const
+{
+  return (static_cast<std::size_t>(seq_size) + 31) / 32;
+}
+
+
+std::size_t
+PackedSequence::get_num_allocated_words() const
+{
+  // Words, runs and then the characters of the runs, eight per word
+  return get_num_words() + n_other_runs + (n_other_runs + 7) / 8;
+}
+
+
+uint64_t const *
+PackedSequence::get_words() const
+{
+  return is_allocated() ? storage.data : &storage.word;
+}
+
+
+uint64_t const *
+PackedSequence::get_other_runs() const
+{
+  return is_allocated() ? storage.data + get_num_words() : nullptr;
+}
+
+
+char const *
+PackedSequence::get_other_chars() const
+{
+  return reinterpret_cast<char const *>(get_other_runs() + n_other_runs);
+}
+
+
+// Allocates zeroed storage for the current size and number of runs
+void
+PackedSequence::allocate()
+{
+  if (is_allocated())
+    storage.data = new uint64_t[get_num_allocated_words()]();
+  else
+    storage.word = 0;
+}
+
+
+char
+PackedSequence::get_packed_base(std::size_t const i) const
+{
+  return PACKED_BASES[(get_words()[i >> 5] >> ((i & 31) * 2)) & 3];
+}
+
+
+std::size_t
+PackedSequence::first_other_run_ending_after(std::size_t const i) const
+{
+  // Runs do not overlap, so they are sorted by their end in the upper bits
+  uint64_t const * runs = get_other_runs();
+  uint64_t const key = (static_cast<uint64_t>(i) << 32) | 0xFFFFFFFFull;
+  return std::distance(runs, std::upper_bound(runs, runs + n_other_runs, key));
+}
+
+
+template <typename Archive>
+void
+PackedSequence::save(Archive & ar, unsigned int const /*version*/) const
+{
+  ar & seq_size;
+  ar & n_other_runs;
+
+  if (is_allocated())
+  {
+    boost::serialization::binary_object data =
+      boost::serialization::make_binary_object(storage.data, get_num_allocated_words() * sizeof(uint64_t));
+    ar & data;
+  }
+  else
+  {
+    ar & storage.word;
+  }
+}
+
+
+template <typename Archive>
+void
+PackedSequence::load(Archive & ar, unsigned int const /*version*/)
+{
+  clear();
+  ar & seq_size;
+  ar & n_other_runs;
+  allocate();
+
+  if (is_allocated())
+  {
+    boost::serialization::binary_object data =
+      boost::serialization::make_binary_object(storage.data, get_num_allocated_words() * sizeof(uint64_t));
+    ar & data;
+  }
+  else
+  {
+    ar & storage.word;
+  }
+}
+
+
+PackedSequenceView::PackedSequenceView(PackedSequence const * _seq, std::size_t const _begin, std::size_t const _end)
+  : seq(_seq)
+  , begin(_begin)
+  , end(_end)
+  , has_other_bases(_seq && _seq->has_other_bases(_begin, _end))
+{
+  assert(begin <= end);
+}
+
+
+std::size_t
+PackedSequenceView::size() const
+{
+  return end - begin;
+}
+
+
+bool
+PackedSequenceView::empty() const
+{
+  return begin == end;
+}
+
+
+char
+PackedSequenceView::operator[](std::size_t const i) const
+{
+  assert(seq);
+  assert(begin + i < end);
+  return has_other_bases ? (*seq)[begin + i] : seq->get_packed_base(begin + i);
+}
+
+
+std::vector<char>
+PackedSequenceView::to_vector() const
+{
+  if (!seq)
+    return std::vector<char>(0);
+
+  return seq->get_sequence(begin, end);
+}
+
+
+/***************************
+ * EXPLICIT INSTANTIATIONS *
+ ***************************/
+
+template void PackedSequence::save<boost::archive::binary_oarchive>(boost::archive::binary_oarchive &,
+                                                                    unsigned int) const;
+template void PackedSequence::load<boost::archive::binary_iarchive>(boost::archive::binary_iarchive &,
+                                                                    unsigned int);
+
+} // namespace gyper
@@ -43,7 +43,7 @@ RefNode::get_vars() const
 
 
 void
-RefNode::change_label_order(uint32_t change)
+RefNode::change_label_order(TAbsPos change)
 {
   // Make sure we do not overflow
   assert(change + label.order >= change);
@@ -1,6 +1,8 @@
-#include <algorithm> // std::sort
+#include <algorithm> // std::sort, std::upper_bound
+#include <cassert> // assert
 #include <string> // std::string
 #include <sstream> // std::stringstream
+#include <utility> // std::pair
 #include <vector> // std::vector
 
 #include <graphtyper/graph/graph.hpp>
@@ -12,6 +14,114 @@
 namespace gyper
 {
 
+void
+DepthTrack::add(long const begin_index, long const end_index)
+{
+  if (begin_index >= end_index)
+    return;
+
+  events.push_back(static_cast<uint32_t>(begin_index * 2 + 1));
+  events.push_back(static_cast<uint32_t>(end_index * 2));
+
+  // Fold the events into the runs once there are more events than runs, so compacting is amortized over the reads
+  if (events.size() >= std::max(static_cast<std::size_t>(4096), 2 * run_ends.size()))
+    compact();
+}
+
+
+void
+DepthTrack::compact()
+{
+  if (events.size() == 0)
+    return;
+
+  std::sort(events.begin(), events.end());
+  std::vector<uint32_t> new_run_ends;
+  std::vector<uint16_t> new_run_depths;
+  long const NUM_RUNS = run_ends.size();
+  long run_i{0};
+  std::size_t e{0};
+  long pos{0};
+  long delta{0}; // Depth change from the events before 'pos'
+
+  while (run_i < NUM_RUNS || e < events.size())
+  {
+    // Find the next position where the depth may change
+    long const next_run_end = run_i < NUM_RUNS ? static_cast<long>(run_ends[run_i]) : -1;
+    long const next_event = e < events.size() ? static_cast<long>(events[e] >> 1) : -1;
+    long next;
+
+    if (next_run_end == -1)
+      next = next_event;
+    else if (next_event == -1)
+      next = next_run_end;
+    else
+      next = std::min(next_run_end, next_event);
+
+    if (next > pos)
+    {
+      long const old_depth = run_i < NUM_RUNS ? run_depths[run_i] : 0;
+      uint16_t const depth = static_cast<uint16_t>(std::min(0xFFFFl, std::max(0l, old_depth + delta)));
+
+      if (new_run_depths.size() > 0 && new_run_depths.back() == depth)
+      {
+        new_run_ends.back() = static_cast<uint32_t>(next); // Extend the previous run
+      }
+      else
+      {
+        new_run_ends.push_back(static_cast<uint32_t>(next));
+        new_run_depths.push_back(depth);
+      }
+
+      pos = next;
+    }
+
+    if (next == next_run_end)
+      ++run_i;
+
+    for (; e < events.size() && static_cast<long>(events[e] >> 1) == next; ++e)
+      delta += (events[e] & 1) ? 1 : -1;
+  }
+
+  assert(delta == 0);
+
+  // Drop a trailing run of zero depth
+  if (new_run_depths.size() > 0 && new_run_depths.back() == 0)
+  {
+    new_run_ends.pop_back();
+    new_run_depths.pop_back();
+  }
+
+  run_ends = std::move(new_run_ends);
+  run_depths = std::move(new_run_depths);
+  events = std::vector<uint32_t>();
+}
+
+
+uint16_t
+DepthTrack::get_max_depth(long const begin_index, long const end_index) const
+{
+  assert(events.size() == 0); // ReferenceDepth::finalize must be called before read depth is retrieved
+  uint16_t max_depth{0};
+
+  if (begin_index >= end_index)
+    return max_depth;
+
+  // First run which ends after begin_index
+  long r = std::upper_bound(run_ends.begin(), run_ends.end(), static_cast<uint32_t>(begin_index)) - run_ends.begin();
+
+  for (; r < static_cast<long>(run_ends.size()); ++r)
+  {
+    max_depth = std::max(max_depth, run_depths[r]);
+
+    if (static_cast<long>(run_ends[r]) >= end_index)
+      break;
+  }
+
+  return max_depth;
+}
+
+
 /***********************
  * Global reference
  */
@@ -25,11 +135,10 @@ ReferenceDepth::ReferenceDepth()
 
 
 void
-ReferenceDepth::set_depth_sizes(long const sample_count, long const reference_size)
+ReferenceDepth::set_depth_sizes(long const sample_count, long const _reference_size)
 {
-  std::vector<uint16_t> depth;
-  depth.resize(reference_size);
-  depths.resize(sample_count, depth);
+  reference_size = _reference_size;
+  depths.resize(sample_count);
 }
 
 
@@ -38,49 +147,30 @@ ReferenceDepth::get_read_depth(VariantCandidate const & var, long const sample_i
 {
   assert(depths.size() > 0);
   assert(sample_index < static_cast<long>(depths.size()));
-  auto const & depth = depths[sample_index];
-  assert(depth.size() > 0);
   assert(var.seqs.size() > 0);
-  uint32_t start_pos = var.abs_pos;
-  uint32_t end_pos = static_cast<uint32_t>(start_pos + var.seqs[0].size() - 1);
+  TAbsPos start_pos = var.abs_pos;
+  TAbsPos end_pos = static_cast<TAbsPos>(start_pos + var.seqs[0].size() - 1);
 
   // We want to avoid getting the coverage at the first pos if possible, since the first positions very often match in more than one path
   if (var.seqs[0].size() > 1)
     ++start_pos;
 
   long const start_index = start_pos_to_index(start_pos);
-  long const end_index = end_pos_to_index(end_pos, depth.size());
-
-  if (start_index < static_cast<long>(depth.size()))
-  {
-    auto max_depth_it = std::max_element(depth.cbegin() + start_index, depth.cbegin() + end_index);
-    assert(max_depth_it != depth.begin() + end_index);
-    return *max_depth_it;
-  }
-  else
-  {
-    return 0;
-  }
+  long const end_index = end_pos_to_index(end_pos, reference_size);
+  return depths[sample_index].get_max_depth(start_index, end_index);
 }
 
 
 uint16_t
-ReferenceDepth::get_read_depth(uint32_t abs_pos, long const sample_index) const
+ReferenceDepth::get_read_depth(TAbsPos abs_pos, long const sample_index) const
 {
   assert(sample_index < static_cast<long>(depths.size()));
-  auto const & depth = depths[sample_index];
 
-  if (depth.size() == 0)
-  {
-    // Happens if there are absolutely no reads in the region
+  if (reference_size == 0)
     return 0;
-  }
-  else
-  {
-    //std::cerr << "abs_pos = " << abs_pos << " " << start_pos_to_index(abs_pos) << "\n";
-    long const index = std::min(start_pos_to_index(abs_pos), static_cast<long>(depth.size() - 1l));
-    return depth[index];
-  }
+
+  long const index = std::min(start_pos_to_index(abs_pos), reference_size - 1l);
+  return depths[sample_index].get_max_depth(index, index + 1);
 }
 
 
@@ -90,33 +180,22 @@ ReferenceDepth::get_total_read_depth_of_samples(VariantCandidate const & var,
                                                 ) const
 {
   assert(var.seqs.size() > 0);
-  uint32_t start_pos = var.abs_pos;
-  uint32_t end_pos = start_pos + var.seqs[0].size() - 1;
+  TAbsPos start_pos = var.abs_pos;
+  TAbsPos end_pos = start_pos + var.seqs[0].size() - 1;
 
   // We want to avoid getting the coverage at the first pos if possible, since the first positions very often
   // match in more than one path
   if (var.seqs[0].size() > 1)
     ++start_pos;
 
-  std::size_t const start_index = start_pos_to_index(start_pos);
-  std::size_t const end_index = end_pos_to_index(end_pos, depths[0].size());
+  long const start_index = start_pos_to_index(start_pos);
+  long const end_index = end_pos_to_index(end_pos, reference_size);
   uint64_t total_read_depth = 0;
 
   for (auto const & pn : sample_indexes)
   {
     assert(pn < depths.size());
-    auto const & depth = depths[pn];
-
-    if (depth.size() == 0)
-    {
-      // This happens only when this pn did not have any reads overlapping the graph,
-      // so we can safely continue to the next one
-      continue;
-    }
-
-    auto max_depth_it = std::max_element(depth.begin() + start_index, depth.begin() + end_index);
-    assert(max_depth_it != depth.begin() + end_index);
-    total_read_depth += *max_depth_it;
+    total_read_depth += depths[pn].get_max_depth(start_index, end_index);
   }
 
   return total_read_depth;
@@ -132,7 +211,6 @@ ReferenceDepth::add_genotype_paths(GenotypePaths const & geno, long const sample
     return;
 
   auto & depth = depths[sample_index];
-  assert(depth.size() > 0);
 
   // Simple algorithm for the case there is only one path
   if (geno.paths.size() == 1)
@@ -140,41 +218,27 @@ ReferenceDepth::add_genotype_paths(GenotypePaths const & geno, long const sample
     auto const & path = geno.paths[0];
     long const start_pos = path.start_ref_reach_pos() - path.read_start_index;
     long const end_pos = path.end_ref_reach_pos() + (geno.read_length - 1 - path.read_end_index);
-
-    long const start_index = start_pos_to_index(start_pos);
-    auto const end = depth.begin() + end_pos_to_index(end_pos, depth.size());
-
-    if (start_index < static_cast<long>(depth.size()))
-    {
-      for (auto it = depth.begin() + start_index; it != end && it != depth.end(); ++it)
-        ++(*it); // Increase the depth by one
-    }
+    depth.add(start_pos_to_index(start_pos), end_pos_to_index(end_pos, reference_size));
   }
   else
   {
-    std::unordered_set<long> local_depth;
+    // The read should only add depth once to each base, even if its paths overlap
+    std::vector<std::pair<long, long> > intervals;
 
-    auto increase_local_depth_lambda =
+    auto add_interval_lambda =
       [&](long start_pos, long end_pos)
       {
         assert(end_pos >= start_pos);
 
         // Needed for SV breakpoint indel calling
-        if (end_pos < reference_offset)
+        if (end_pos < static_cast<long>(reference_offset))
           return;
 
-        assert(end_pos >= reference_offset);
-        assert(depth.size() > 0);
         long const start_index = start_pos_to_index(start_pos);
-        auto const end = depth.begin() + end_pos_to_index(end_pos, depth.size());
-
-        // TODO: Super rarely this fails, find out why.
-        // Must likely it is related to SV breakpoint indel calling
-        if (start_index < static_cast<long>(depth.size()))
-        {
-          for (auto it = depth.begin() + start_index; it != end && it != depth.end(); ++it)
-            local_depth.insert(std::distance(depth.begin(), it)); // Increase the depth by one
-        }
+        long const end_index = end_pos_to_index(end_pos, reference_size);
+
+        if (start_index < end_index)
+          intervals.push_back(std::make_pair(start_index, end_index));
       };
 
     for (auto const & path : geno.paths)
@@ -183,21 +247,28 @@ ReferenceDepth::add_genotype_paths(GenotypePaths const & geno, long const sample
       long const end_pos = path.end_ref_reach_pos() + (geno.read_length - 1 - path.read_end_index);
 
       if (end_pos - start_pos >= 50)
-        increase_local_depth_lambda(start_pos + 4, end_pos - 4);
+        add_interval_lambda(start_pos + 4, end_pos - 4);
       else
-        increase_local_depth_lambda(start_pos, end_pos);
+        add_interval_lambda(start_pos, end_pos);
     }
 
-    // Commit depth
-    for (auto it = local_depth.begin(); it != local_depth.end(); ++it)
+    // Commit depth of the union of the intervals
+    std::sort(intervals.begin(), intervals.end());
+    long begin{0};
+    long end{-1};
+
+    for (auto const & interval : intervals)
     {
-      assert(*it < static_cast<long>(depth.size()));
-      auto & pn_depth = depth[*it];
+      if (interval.first > end)
+      {
+        depth.add(begin, end);
+        begin = interval.first;
+      }
 
-      // Check for overflow
-      if (pn_depth < 0xFFFFul)
-        ++pn_depth;
+      end = std::max(end, interval.second);
     }
+
+    depth.add(begin, end);
   }
 }
 
@@ -206,33 +277,31 @@ void
 ReferenceDepth::add_depth(long const start_pos, long const end_pos, long const sample_index)
 {
   assert(sample_index < static_cast<long>(depths.size()));
-  auto & depth = depths[sample_index];
+  depths[sample_index].add(start_pos_to_index(start_pos), end_pos_to_index(end_pos, reference_size));
+}
 
-  long const start_index = start_pos_to_index(start_pos);
-  auto const end = depth.begin() + end_pos_to_index(end_pos, depth.size());
-  assert(depth.size() > 0);
 
-  if (start_index < static_cast<long>(depth.size()))
-  {
-    for (auto it = depth.begin() + start_index; it != end && it != depth.end(); ++it)
-    {
-      ++(*it); // Increase the depth by one
-    }
-  }
+void
+ReferenceDepth::finalize()
+{
+  for (auto & depth : depths)
+    depth.compact();
 }
 
 
 long
 ReferenceDepth::start_pos_to_index(long const start_pos) const
 {
-  return (start_pos < reference_offset) ? 0 : (start_pos - reference_offset);
+  long const offset = reference_offset;
+  return (start_pos < offset) ? 0 : (start_pos - offset);
 }
 
 
 long
 ReferenceDepth::end_pos_to_index(long const end_pos, long const depth_size) const
 {
-  return (end_pos > reference_offset + depth_size) ? depth_size : end_pos + 1 - reference_offset;
+  long const offset = reference_offset;
+  return (end_pos > offset + depth_size) ? depth_size : end_pos + 1 - offset;
 }
 
 
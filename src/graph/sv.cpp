@@ -174,21 +174,19 @@ reformat_sv_vcf_records(std::vector<Variant> & variants, ReferenceDepth const &
     }
 
     auto merge_alt_info_lambda =
-      [](Variant & new_var, std::string const & id, long const aa)
+      [](std::vector<uint32_t> & values, long const aa)
       {
 #ifndef NDEBUG
-        if (new_var.infos.count(id) == 0)
+        if (values.size() == 0)
         {
-          BOOST_LOG_TRIVIAL(error) << "[graphtyper::graph::sv] Unable to find ID " << id << ".";
+          BOOST_LOG_TRIVIAL(error) << "[graphtyper::graph::sv] Unable to find strand bias.";
           std::exit(1);
         }
 #endif // NDEBUG
 
-        std::vector<uint32_t> values = split_bias_to_numbers(new_var.infos[id]);
         assert(aa + 1l < static_cast<long>(values.size()));
         values[1] = values[aa + 1];
         values.resize(2);
-        new_var.infos[id] = join_strand_bias(values);
       };
 
     auto make_new_sv_var =
@@ -200,13 +198,14 @@ reformat_sv_vcf_records(std::vector<Variant> & variants, ReferenceDepth const &
         new_var.seqs.push_back(old_var.seqs[0]);
         new_var.seqs.push_back(old_var.seqs[aa + 1]);
         new_var.infos = old_var.infos;
-
-        merge_alt_info_lambda(new_var, "SBF", aa);
-        merge_alt_info_lambda(new_var, "SBR", aa);
-        merge_alt_info_lambda(new_var, "SBF1", aa);
-        merge_alt_info_lambda(new_var, "SBR1", aa);
-        merge_alt_info_lambda(new_var, "SBF2", aa);
-        merge_alt_info_lambda(new_var, "SBR2", aa);
+        new_var.stats = old_var.stats;
+
+        merge_alt_info_lambda(new_var.stats.sbf, aa);
+        merge_alt_info_lambda(new_var.stats.sbr, aa);
+        merge_alt_info_lambda(new_var.stats.sbf1, aa);
+        merge_alt_info_lambda(new_var.stats.sbr1, aa);
+        merge_alt_info_lambda(new_var.stats.sbf2, aa);
+        merge_alt_info_lambda(new_var.stats.sbr2, aa);
         //merge_alt_info_lambda(new_var, "RACount", aa);
         //merge_alt_info_lambda(new_var, "RADist", aa);
 
@@ -552,6 +551,7 @@ reformat_sv_vcf_records(std::vector<Variant> & variants, ReferenceDepth const &
       Variant non_sv_var;
       non_sv_var.abs_pos = var.abs_pos;
       non_sv_var.infos = var.infos;
+      non_sv_var.stats = var.stats;
 //      non_sv_var.phase = var.phase;
       non_sv_var.suffix_id = var.suffix_id;
 
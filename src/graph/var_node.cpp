@@ -36,7 +36,7 @@ VarNode::get_out_ref_index() const
 
 
 void
-VarNode::change_label_order(uint32_t change)
+VarNode::change_label_order(TAbsPos change)
 {
   // Make sure we do not overflow
   assert(change + label.order >= change);
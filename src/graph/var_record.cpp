@@ -96,11 +96,11 @@ VarRecord::VarRecord()
   :  pos(0u), ref(0), alts(0)
 {}
 
-VarRecord::VarRecord(uint32_t const p)
+VarRecord::VarRecord(TAbsPos const p)
   : pos(p)
 {}
 
-VarRecord::VarRecord(uint32_t const p, std::vector<char> && r, std::vector<std::vector<char> > && a)
+VarRecord::VarRecord(TAbsPos const p, std::vector<char> && r, std::vector<std::vector<char> > && a)
   : pos(std::move(p))
   , ref(std::move(r))
   , alts(std::move(a))
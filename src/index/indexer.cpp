@@ -129,10 +129,10 @@ insert_variant_label(PHIndex & ph_index,
     }
 
     // Add a new element with the new DNA base
-    uint32_t pos = label.order + d;
+    TAbsPos pos = label.order + d;
 
     if (pos > ref_reach)
-      pos = graph.get_special_pos(pos, static_cast<uint32_t>(ref_reach));
+      pos = graph.get_special_pos(pos, static_cast<TAbsPos>(ref_reach));
 
     IndexEntry new_index_entry(pos, static_cast<uint32_t>(v), is_reference, var_count);
     new_index_entry.add_to_dna(dna_base);
@@ -257,10 +257,10 @@ index_graph(Graph const & graph)
   PHIndex ph_index;
 
   assert(graph.ref_nodes.back().out_degree() == 0);
-  uint32_t const start_order = graph.ref_nodes.front().get_label().order;
-  uint32_t const end_order = static_cast<uint32_t>(graph.ref_nodes.back().get_label().order +
-                                                   graph.ref_nodes.back().get_label().dna.size());
-  uint32_t goal_order = start_order;
+  TAbsPos const start_order = graph.ref_nodes.front().get_label().order;
+  TAbsPos const end_order = static_cast<TAbsPos>(graph.ref_nodes.back().get_label().order +
+                                                 graph.ref_nodes.back().get_label().dna.size());
+  TAbsPos goal_order = start_order;
   uint32_t goal = 0;
 
   TNodeIndex r = 0; // Reference node index
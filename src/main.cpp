@@ -508,13 +508,12 @@ subcmd_genotype(paw::Parser & parser)
                       "split/decomposed into smaller variants.");
 
   parser.parse_option(force_copy_reference, ' ', "force_copy_reference",
-                      "Force copy of the reference FASTA to temporary folder.");
+                      "Copy the reference FASTA to temporary folder. The reference is only copied if this is set.");
 
   parser.parse_option(force_no_copy_reference,
                       ' ',
                       "force_no_copy_reference",
-                      "Force that the reference FASTA is NOT copied to temporary folder. "
-                      "Useful if you have limit storage on your local disk or the reference is already on your local disk.");
+                      "(deprecated) Has no effect, the reference FASTA is only copied with --force_copy_reference.");
 
   parser.parse_option(output_dir,
                       'O',
@@ -578,7 +577,8 @@ subcmd_genotype(paw::Parser & parser)
     parser.parse_option(opts.is_sam_merging_allowed,
                         ' ',
                         "is_sam_merging_allowed",
-                        "(advanced) Set to allow SAM files to be merged interally in graphtyper. For this to be possible you must make sure they all have read groups and their name is never duplicates.");
+                        "(advanced) Set to allow SAM files to be merged interally in graphtyper. For this to be possible you must make sure they all have read groups and their name is never duplicates. "
+                        "The merged files are written as uncompressed BAM to the temporary folder, which needs several times more disk space than the shrinked BAMs.");
 
     parser.parse_option(no_filter_on_proper_pairs,
                         ' ',
@@ -616,6 +616,11 @@ subcmd_genotype(paw::Parser & parser)
                         "(advanced) Set to output two files for each region, both normal (overlapping)"
                         " and non-overlapping variants.");
 
+    parser.parse_option(opts.output_bcf,
+                        ' ',
+                        "output_bcf",
+                        "Set to write the genotyped records of each region as BCF instead of bgzipped VCF.");
+
     parser.parse_option(opts.max_files_open,
                         ' ',
                         "max_files_open",
@@ -657,6 +662,14 @@ subcmd_genotype(paw::Parser & parser)
                         "bamshrink_as_filter_threshold",
                         "(advanced) Threshold for alignment score filter. Lower value is stricter.");
 
+    parser.parse_option(opts.bamshrink_regions_per_pass,
+                        ' ',
+                        "bamshrink_regions_per_pass",
+                        "(advanced) Number of regions bamShrink copies with a single pass over each input file. "
+                        "By default each region is copied separately. The copies of all regions of a pass are kept "
+                        "in the temporary folder until they are genotyped, so it needs more disk space. Not used "
+                        "with --no_bamshrink or --is_cigar_discovery_in_bamshrink.");
+
     parser.parse_option(opts.force_use_input_ref_for_cram_reading, ' ', "force_use_input_ref_for_cram_reading",
                         "Force using the input reference FASTA file when reading CRAMs.");
 
@@ -685,6 +698,12 @@ subcmd_genotype(paw::Parser & parser)
                         "is_only_cigar_discovery",
                         "(advanced) If set, graphtyper will only discover variants from the aligner via the cigar.");
 
+    parser.parse_option(opts.is_cigar_discovery_in_bamshrink,
+                        ' ',
+                        "is_cigar_discovery_in_bamshrink",
+                        "(advanced) If set, variants are discovered via the cigar while bamShrink copies the reads "
+                        "instead of reading the copied reads again. Each region is then copied separately.");
+
     parser.parse_option(opts.is_discovery_only_for_paired_reads,
                         ' ',
                         "is_discovery_only_for_paired_reads",
@@ -751,10 +770,12 @@ subcmd_genotype(paw::Parser & parser)
   std::vector<std::string> sams_fn = get_sams(sam, sams);
   long const NUM_SAMPLES = sams_fn.size();
 
-  // If neither force copy reference or force no copy reference we determine it from number of SAMs and
-  // whether REF_CACHE is set or not
-  bool is_copy_reference = force_copy_reference ||
-                           (!force_no_copy_reference && NUM_SAMPLES >= 100 && !gyper::is_defined_in_env("REF_CACHE"));
+  // CRAM decoders share reference sequences in-process, each contig is read only once from the FASTA. Therefore we
+  // only copy the reference to the temporary folder if explicitly asked to
+  if (force_no_copy_reference)
+    BOOST_LOG_TRIVIAL(warning) << "--force_no_copy_reference is deprecated and has no effect.";
+
+  bool const is_copy_reference = force_copy_reference;
 
   // Get the avgCovByReadLen for each of the SAM/BAM/CRAM
   std::vector<double> avg_cov_by_readlen = get_avg_cov_by_readlen(avg_cov_by_readlen_fn, NUM_SAMPLES);
@@ -795,9 +816,9 @@ subcmd_genotype_sv(paw::Parser & parser)
   parser.parse_option(opts.no_cleanup, ' ', "no_cleanup",
                       "Set to skip removing temporary files. Useful for debugging.");
   parser.parse_option(force_copy_reference, ' ', "force_copy_reference",
-                      "Force copy of the reference FASTA to temporary folder.");
+                      "Copy the reference FASTA to temporary folder. The reference is only copied if this is set.");
   parser.parse_option(force_no_copy_reference, ' ', "force_no_copy_reference",
-                      "Force that the reference FASTA is NOT copied to temporary folder.");
+                      "(deprecated) Has no effect, the reference FASTA is only copied with --force_copy_reference.");
   parser.parse_option(output_dir, 'O', "output", "Output directory.");
   parser.parse_option(opts_region, 'r', "region", "Genomic region to genotype.");
   parser.parse_option(opts_region_file, 'R', "region_file", "File with genomic regions to genotype.");
@@ -829,8 +850,11 @@ subcmd_genotype_sv(paw::Parser & parser)
   // Get the SAM/BAM/CRAM file names
   std::vector<std::string> sams_fn = get_sams(sam, sams);
 
-  // If neither force copy reference or force no copy reference we determine it from number of SAMs
-  bool is_copy_reference = force_copy_reference || (!force_no_copy_reference && sams_fn.size() >= 100);
+  // The reference is only copied to the temporary folder if explicitly asked to, see the 'genotype' subcommand
+  if (force_no_copy_reference)
+    BOOST_LOG_TRIVIAL(warning) << "--force_no_copy_reference is deprecated and has no effect.";
+
+  bool const is_copy_reference = force_copy_reference;
 
   gyper::genotype_sv_regions(ref_fn,
                              sv_vcf,
@@ -17,6 +17,7 @@
 #include <graphtyper/utilities/kmer_help_functions.hpp>
 #include <graphtyper/utilities/io.hpp>
 #include <graphtyper/utilities/options.hpp>
+#include <graphtyper/utilities/stage_report.hpp>
 #include <graphtyper/utilities/type_conversions.hpp>
 
 
@@ -36,6 +37,15 @@ find_genotype_paths_of_one_of_the_sequences(seqan::IupacString const & read,
   TKmerLabels r_hamming1 = query_index_hamming_distance1_without_index(read, ph_index);
   assert(r_hamming0.size() > 0);
 
+  {
+    uint64_t num_seeds{0};
+
+    for (long i = 0; i < static_cast<long>(r_hamming0.size()); ++i)
+      num_seeds += r_hamming0[i].size() + r_hamming1[i].size();
+
+    stage_report.seeds.fetch_add(num_seeds, std::memory_order_relaxed);
+  }
+
   // Stop if all kmer are extremely common
   for (auto it = r_hamming0.cbegin();;)
   {
@@ -168,6 +178,11 @@ align_read(bam1_t * rec,
   {
     find_genotype_paths_of_one_of_the_sequences(seq, geno_paths.first, ph_index);
     find_genotype_paths_of_one_of_the_sequences(rseq, geno_paths.second, ph_index);
+
+    if (geno_paths.first.paths.size() > 0 || geno_paths.second.paths.size() > 0)
+      stage_report.reads_aligned.fetch_add(1, std::memory_order_relaxed);
+
+    stage_report.add_thread_counters(); // Graph walks of this read
   }
 
   return geno_paths;
@@ -1,3 +1,4 @@
+#include <algorithm> // std::max_element, std::min
 #include <cassert> // assert
 #include <memory> // std::unique_ptr
 #include <sstream> // std::ostringstream
@@ -7,10 +8,7 @@
 
 #include <paw/station.hpp>
 
-#include <seqan/basic.h>
-#include <seqan/sequence.h>
-#include <seqan/seq_io.h>
-#include <seqan/hts_io.h>
+#include <htslib/sam.h>
 
 #include <boost/log/trivial.hpp> // BOOST_LOG_TRIVIAL
 
@@ -97,6 +95,18 @@ _determine_num_jobs_and_num_parts(long & jobs,
 }
 
 
+// Appends bases [begin, begin + count) of a packed read sequence, stopping at the end of the read
+void
+append_read_bases(std::string & read_seq, bam1_t const * record, long const begin, long const count)
+{
+  uint8_t const * seq = bam_get_seq(record);
+  long const end = std::min(begin + count, static_cast<long>(record->core.l_qseq));
+
+  for (long i = begin; i < end; ++i)
+    read_seq.push_back(seq_nt16_str[bam_seqi(seq, i)]);
+}
+
+
 } // anon namespace
 
 
@@ -232,73 +242,75 @@ call(std::vector<std::string> const & hts_paths,
 
 
 std::vector<VariantCandidate>
-find_variants_in_cigar(seqan::BamAlignmentRecord const & record,
+find_variants_in_cigar(bam1_t const * record,
                        GenomicRegion const & region,
                        std::string const & ref)
 {
   std::vector<VariantCandidate> new_var_candidates;
-  assert(record.beginPos != -1);
-  long ref_abs_pos = absolute_pos.get_absolute_position(region.chr, record.beginPos + 1);
+  assert(record->core.pos != -1);
+  long ref_abs_pos = absolute_pos.get_absolute_position(region.chr, record->core.pos + 1);
   long const reference_offset = graph.ref_nodes.size() > 0 ?
                                 graph.ref_nodes[0].get_label().order :
                                 0;
 
+  uint32_t const * cigar = bam_get_cigar(record);
+  long const n_cigar = record->core.n_cigar;
   long read_pos = 0;
-  std::string read(seqan::begin(record.seq), seqan::end(record.seq));
   long begin_clipping_size = 0;
   bool is_clipped = false;
   std::string reference_seq;
   std::string read_seq;
 
-  for (long c = 0; c < static_cast<long>(seqan::length(record.cigar)); ++c)
+  for (long c = 0; c < n_cigar; ++c)
   {
-    auto const & cigar = record.cigar[c];
+    uint32_t const op = bam_cigar_op(cigar[c]);
+    long const count = bam_cigar_oplen(cigar[c]);
 
-    if (cigar.operation == 'M')
+    if (op == BAM_CMATCH || op == BAM_CEQUAL || op == BAM_CDIFF)
     {
       /// Add both read and reference
       // Get reference sequence overlapping this cigar
-      reference_seq += ref.substr(ref_abs_pos - reference_offset, cigar.count);
+      reference_seq.append(ref, ref_abs_pos - reference_offset, count);
 
       // Get read sequence overlapping this cigar
-      read_seq += read.substr(read_pos, cigar.count);
+      append_read_bases(read_seq, record, read_pos, count);
 
       // Matches/mismatches advance both the read and the reference position
-      read_pos    += cigar.count;
-      ref_abs_pos += cigar.count;
+      read_pos    += count;
+      ref_abs_pos += count;
     }
-    else if (cigar.operation == 'I')
+    else if (op == BAM_CINS)
     {
       // Ignore if we haven't moved in the read
       if (read_pos > 0)
       {
-        reference_seq.append(cigar.count, '-');
-        read_seq += read.substr(read_pos, cigar.count);
+        reference_seq.append(count, '-');
+        append_read_bases(read_seq, record, read_pos, count);
       }
 
       // Insertions advance only the read position
-      read_pos += cigar.count;
+      read_pos += count;
     }
-    else if (cigar.operation == 'D')
+    else if (op == BAM_CDEL)
     {
       // Ignore if we haven't moved in the read
       if (read_pos > 0)
       {
-        reference_seq += ref.substr(ref_abs_pos - reference_offset, cigar.count);
-        read_seq.append(cigar.count, '-');
+        reference_seq.append(ref, ref_abs_pos - reference_offset, count);
+        read_seq.append(count, '-');
       }
 
       // Deletions advance only the reference position
-      ref_abs_pos += cigar.count;
+      ref_abs_pos += count;
     }
-    else if (cigar.operation == 'S')
+    else if (op == BAM_CSOFT_CLIP)
     {
       // soft-clips advance only the read position
-      read_pos += cigar.count;
+      read_pos += count;
       is_clipped = true;
 
       if (c == 0)
-        begin_clipping_size = cigar.count;
+        begin_clipping_size = count;
     }
     // else hard-clips ('H') advance neither the read nor the reference position
   }
@@ -311,7 +323,7 @@ find_variants_in_cigar(seqan::BamAlignmentRecord const & record,
   long ref_to_seq_offset = 0;
 
   // Reset to original ref_abs_pos
-  ref_abs_pos = absolute_pos.get_absolute_position(region.chr, record.beginPos + 1);
+  ref_abs_pos = absolute_pos.get_absolute_position(region.chr, record->core.pos + 1);
 
   Variant new_var =
     make_variant_of_gapped_strings(reference_seq, read_seq, ref_abs_pos, ref_to_seq_offset);
@@ -324,6 +336,10 @@ find_variants_in_cigar(seqan::BamAlignmentRecord const & record,
 
   new_var_candidates.resize(new_vars.size());
 
+  // Base qualities are not stored as offset ASCII in BAM, and 0xff means they are missing
+  uint8_t const * qual = bam_get_qual(record);
+  long const qual_size = (record->core.l_qseq > 0 && qual[0] != 0xff) ? record->core.l_qseq : 0;
+
   for (unsigned i = 0; i < new_vars.size(); ++i)
   {
     assert(i < new_var_candidates.size());
@@ -336,38 +352,26 @@ find_variants_in_cigar(seqan::BamAlignmentRecord const & record,
     long r = new_var.abs_pos - ref_to_seq_offset;
 
     // Fix r if the read was clipped
-    if (length(record.cigar) > 0 && record.cigar[0].operation == 'S')
-      r += record.cigar[0].count;
+    if (n_cigar > 0 && bam_cigar_op(cigar[0]) == BAM_CSOFT_CLIP)
+      r += bam_cigar_oplen(cigar[0]);
 
     long r_end = r + new_var.seqs[1].size();
     ref_to_seq_offset += static_cast<long>(new_var.seqs[0].size()) - static_cast<long>(new_var.seqs[1].size());
 
     new_var_candidate.abs_pos = new_var.abs_pos;
-    new_var_candidate.original_pos = static_cast<uint32_t>(record.beginPos + 1 - begin_clipping_size);
+    new_var_candidate.original_pos = static_cast<uint32_t>(record->core.pos + 1 - begin_clipping_size);
     new_var_candidate.seqs = std::move(new_var.seqs);
-    new_var_candidate.flags = record.flag;
+    new_var_candidate.flags = record->core.flag;
 
     //// In case no qual is available
-    if (static_cast<long>(seqan::length(record.qual)) > r)
+    if (qual_size > r)
     {
-      int MAX_QUAL;
-
-      if (r_end < static_cast<long>(seqan::length(record.qual)))
-      {
-        MAX_QUAL = *std::max_element(seqan::begin(record.qual) + r,
-                                     seqan::begin(record.qual) + r_end) - 33;
-      }
-      else
-      {
-        MAX_QUAL = *std::max_element(seqan::begin(record.qual) + r,
-                                     seqan::end(record.qual)) - 33;
-      }
+      int const MAX_QUAL = *std::max_element(qual + r, qual + std::min(r_end, qual_size));
 
       new_var_candidate.flags |= static_cast<uint16_t>(static_cast<bool>(MAX_QUAL < 25)) << IS_LOW_BASE_QUAL_SHIFT;
     }
 
-    //new_var_candidate.flags |= is_in_proper_pair = seqan::hasFlagAllProper(record);
-    new_var_candidate.flags |= static_cast<uint16_t>(record.mapQ < 25) << IS_MAPQ_BAD_SHIFT;
+    new_var_candidate.flags |= static_cast<uint16_t>(record->core.qual < 25) << IS_MAPQ_BAD_SHIFT;
     new_var_candidate.flags |= static_cast<uint16_t>(is_clipped) << IS_CLIPPED_SHIFT;
   }
 
@@ -375,148 +379,136 @@ find_variants_in_cigar(seqan::BamAlignmentRecord const & record,
 }
 
 
-void
-parallel_discover_from_cigar(std::string * output_ptr,
-                             std::vector<std::string> const * hts_paths_ptr,
-                             GenomicRegion const & region,
-                             std::string const & output_dir,
-                             std::string const & ref_str,
-                             long minimum_variant_support,
-                             double minimum_variant_support_ratio)
+CigarDiscovery::CigarDiscovery(GenomicRegion const & _region,
+                               long const minimum_variant_support,
+                               double const minimum_variant_support_ratio)
+  : region(_region)
+  , ref_str(graph.reference.to_string())
 {
-  assert(output_ptr);
-  assert(hts_paths_ptr);
-  auto const & hts_paths = *hts_paths_ptr;
-
   if (ref_str.size() == 0)
   {
     BOOST_LOG_TRIVIAL(error) << "Trying to discover variants with no reference string";
     std::exit(1);
   }
 
-  // Determine the size of the region we are discovery variants on
-  std::size_t const REGION_SIZE = region.end - region.begin;
+  varmap.minimum_variant_support = minimum_variant_support;
+  varmap.minimum_variant_support_ratio = minimum_variant_support_ratio;
+}
 
-  // Extract sample names from SAM
-  std::vector<std::string> samples;
-  std::vector<std::unordered_map<std::string, int> > vec_rg2sample_i; // Read group to sample index
 
-  // Gather all the sample names
-  _read_rg_and_samples(samples, vec_rg2sample_i, hts_paths);
+void
+CigarDiscovery::add_file(std::string const & hts_path)
+{
+  std::vector<std::unordered_map<std::string, int> > vec_rg2sample_i;
+  _read_rg_and_samples(samples, vec_rg2sample_i, std::vector<std::string>(1, hts_path));
+  assert(vec_rg2sample_i.size() == 1);
   assert(samples.size() > 0);
+  rg2sample_i = std::move(vec_rg2sample_i[0]);
+  file_sample_index = samples.size() - 1;
 
-  // Set up reference depth tracks
-  ReferenceDepth reference_depth;
-  reference_depth.set_depth_sizes(samples.size(), REGION_SIZE);
+  // Determine the size of the region we are discovery variants on
+  std::size_t const REGION_SIZE = region.end - region.begin;
 
-  // Set up variant map
-  VariantMap varmap;
+  // Set up reference depth tracks and variant maps of any new samples
+  reference_depth.set_depth_sizes(samples.size(), REGION_SIZE);
   varmap.set_samples(samples);
-  varmap.minimum_variant_support = minimum_variant_support;
-  varmap.minimum_variant_support_ratio = minimum_variant_support_ratio;
-
-  for (long file_i = 0; file_i < static_cast<long>(hts_paths.size()); ++file_i)
-  {
-    assert(vec_rg2sample_i.size() == hts_paths.size());
-
-    auto const & sam = hts_paths[file_i];
-    auto & rg2sample_i = vec_rg2sample_i[file_i];
+}
 
-    seqan::HtsFile hts(sam.c_str(), "r");
-    seqan::BamAlignmentRecord record;
 
-    while (seqan::readRecord(record, hts))
-    {
-      // Skip supplementary, secondary and QC fail, duplicated and unmapped reads
-      if (((record.flag & Options::const_instance()->sam_flag_filter) != 0) ||
-          seqan::hasFlagUnmapped(record))
-      {
-        continue;
-      }
+void
+CigarDiscovery::add_read(bam1_t const * record)
+{
+  // Skip supplementary, secondary and QC fail, duplicated and unmapped reads
+  if (((record->core.flag & Options::const_instance()->sam_flag_filter) != 0) ||
+      (record->core.flag & BAM_FUNMAP) != 0)
+  {
+    return;
+  }
 
-      // Skip reads that are clipped on both ends. It is also fine to skip reads with no cigar since they cannot be useful here
-      if (length(record.cigar) == 0 ||
-          (record.cigar[0].operation == 'S' &&
-           record.cigar[length(record.cigar) - 1].operation == 'S'))
-      {
-        continue;
-      }
+  // Skip reads that are clipped on both ends. It is also fine to skip reads with no cigar since they cannot be useful here
+  uint32_t const * cigar = bam_get_cigar(record);
+  long const n_cigar = record->core.n_cigar;
 
-      if (Options::const_instance()->is_discovery_only_for_paired_reads &&
-          (((record.flag & IS_PAIRED) == 0) ||
-           ((record.flag & IS_PROPER_PAIR) == 0)))
-      {
-        continue;
-      }
+  if (n_cigar == 0 ||
+      (bam_cigar_op(cigar[0]) == BAM_CSOFT_CLIP &&
+       bam_cigar_op(cigar[n_cigar - 1]) == BAM_CSOFT_CLIP))
+  {
+    return;
+  }
 
-      assert(record.beginPos >= 0);
+  if (Options::const_instance()->is_discovery_only_for_paired_reads &&
+      (((record->core.flag & IS_PAIRED) == 0) ||
+       ((record->core.flag & IS_PROPER_PAIR) == 0)))
+  {
+    return;
+  }
 
-      // 0-based positions
-      int64_t begin_pos = absolute_pos.get_absolute_position(region.chr, record.beginPos + 1);
-      int64_t end_pos = begin_pos + seqan::getAlignmentLengthInRef(record);
+  assert(record->core.pos >= 0);
 
-      // Check if read is within region
-      if (begin_pos < region.get_absolute_begin_position() || end_pos > region.get_absolute_end_position())
-        continue;
+  // 0-based positions
+  int64_t begin_pos = absolute_pos.get_absolute_position(region.chr, record->core.pos + 1);
+  int64_t end_pos = begin_pos + bam_cigar2rlen(n_cigar, cigar);
 
-      assert(begin_pos >= 0);
-      assert(end_pos >= 0);
+  // Check if read is within region
+  if (begin_pos < region.get_absolute_begin_position() || end_pos > region.get_absolute_end_position())
+    return;
 
-      // Determine the sample index
-      assert(hts.hts_record);
+  assert(begin_pos >= 0);
+  assert(end_pos >= 0);
 
-      long sample_i;
+  // Determine the sample index
+  long sample_i;
 
-      if (rg2sample_i.size() > 0)
-      {
-        uint8_t * rg_tag = bam_aux_get(hts.hts_record, "RG");
+  if (rg2sample_i.size() > 0)
+  {
+    uint8_t * rg_tag = bam_aux_get(record, "RG");
 
-        if (!rg_tag)
-        {
-          BOOST_LOG_TRIVIAL(error) << "[graphtyper::typer::caller] Unable to find RG tag in read.";
-          std::exit(1);
-        }
+    if (!rg_tag)
+    {
+      BOOST_LOG_TRIVIAL(error) << "[graphtyper::typer::caller] Unable to find RG tag in read.";
+      std::exit(1);
+    }
 
-        std::string read_group(reinterpret_cast<char *>(rg_tag + 1)); // Skip 'Z'
+    std::string read_group(reinterpret_cast<char *>(rg_tag + 1)); // Skip 'Z'
 
-        auto find_rg_it = rg2sample_i.find(read_group);
+    auto find_rg_it = rg2sample_i.find(read_group);
 
-        if (find_rg_it == rg2sample_i.end())
-        {
-          BOOST_LOG_TRIVIAL(error) << "[graphtyper::typer::caller] Unable to find read group. " << read_group;
-          std::exit(1);
-        }
+    if (find_rg_it == rg2sample_i.end())
+    {
+      BOOST_LOG_TRIVIAL(error) << "[graphtyper::typer::caller] Unable to find read group. " << read_group;
+      std::exit(1);
+    }
 
-        sample_i = find_rg_it->second;
-      }
-      else
-      {
-        sample_i = file_i;
-      }
+    sample_i = find_rg_it->second;
+  }
+  else
+  {
+    sample_i = file_sample_index;
+  }
 
-      // Update reference depth (very arbitrarily)
-      if (end_pos - begin_pos < 50)
-        reference_depth.add_depth(begin_pos, end_pos, sample_i);
-      else
-        reference_depth.add_depth(begin_pos + 4, end_pos - 4, sample_i);
+  // Update reference depth (very arbitrarily)
+  if (end_pos - begin_pos < 50)
+    reference_depth.add_depth(begin_pos, end_pos, sample_i);
+  else
+    reference_depth.add_depth(begin_pos + 4, end_pos - 4, sample_i);
 
-      // Add variant candidates
-      std::vector<VariantCandidate> var_candidates = find_variants_in_cigar(record, region, ref_str);
+  // Add variant candidates
+  std::vector<VariantCandidate> var_candidates = find_variants_in_cigar(record, region, ref_str);
 
-      if (var_candidates.size() > 0)
-      {
-        varmap.add_variants(std::move(var_candidates), sample_i);
-      }
-    }
+  if (var_candidates.size() > 0)
+  {
+    varmap.add_variants(std::move(var_candidates), sample_i);
   }
+}
 
-  // Write variant map
-  std::ostringstream variant_map_path;
-  variant_map_path << output_dir << "/" << samples[0] << "_variant_map";
 
+void
+CigarDiscovery::save(std::string const & variant_map_path)
+{
   BOOST_LOG_TRIVIAL(debug) << "[graphtyper::caller] Writing variant map to '"
-                           << variant_map_path.str();
+                           << variant_map_path;
 
+  reference_depth.finalize();
   varmap.create_varmap_for_all(reference_depth);
 
 #ifndef NDEBUG
@@ -524,7 +516,70 @@ parallel_discover_from_cigar(std::string * output_ptr,
     varmap.write_stats("1");
 #endif // NDEBUG
 
-  save_variant_map(variant_map_path.str(), varmap);
+  save_variant_map(variant_map_path, varmap);
+}
+
+
+void
+parallel_discover_from_cigar(std::string * output_ptr,
+                             std::vector<std::string> const * hts_paths_ptr,
+                             GenomicRegion const & region,
+                             std::string const & output_dir,
+                             long minimum_variant_support,
+                             double minimum_variant_support_ratio)
+{
+  assert(output_ptr);
+  assert(hts_paths_ptr);
+  auto const & hts_paths = *hts_paths_ptr;
+  CigarDiscovery discovery(region, minimum_variant_support, minimum_variant_support_ratio);
+
+  for (auto const & sam : hts_paths)
+  {
+    discovery.add_file(sam);
+    htsFile * fp = hts_open(sam.c_str(), "r");
+
+    if (!fp)
+    {
+      BOOST_LOG_TRIVIAL(error) << __HERE__ << " Could not open " << sam;
+      std::exit(1);
+    }
+
+    htsThreadPool * thread_pool = get_hts_thread_pool();
+
+    if (thread_pool)
+      hts_set_thread_pool(fp, thread_pool);
+
+    bam_hdr_t * hdr = sam_hdr_read(fp);
+
+    if (!hdr)
+    {
+      BOOST_LOG_TRIVIAL(error) << __HERE__ << " Could not read header of " << sam;
+      std::exit(1);
+    }
+
+    bam1_t * record = bam_init1();
+    int ret{0};
+
+    while ((ret = sam_read1(fp, hdr, record)) >= 0)
+      discovery.add_read(record);
+
+    // -1 is the end of the file, lower values are errors
+    if (ret < -1)
+    {
+      BOOST_LOG_TRIVIAL(error) << __HERE__ << " Could not read record from " << sam << " (error " << ret << ")";
+      std::exit(1);
+    }
+
+    bam_destroy1(record);
+    bam_hdr_destroy(hdr);
+    hts_close(fp);
+  }
+
+  // Write variant map
+  assert(discovery.samples.size() > 0);
+  std::ostringstream variant_map_path;
+  variant_map_path << output_dir << "/" << discovery.samples[0] << "_variant_map";
+  discovery.save(variant_map_path.str());
   *output_ptr = variant_map_path.str();
 }
 
@@ -542,9 +597,6 @@ discover_directly_from_bam(std::string const & graph_path,
   if (graph_path.size() > 0)
     load_graph(graph_path);
 
-  //graph.generate_reference_genome();
-  std::string ref_str(graph.reference.begin(), graph.reference.end());
-
   // parse region
   GenomicRegion const region(region_str);
 
@@ -585,7 +637,6 @@ discover_directly_from_bam(std::string const & graph_path,
                             spl_hts_paths[i].get(),
                             region,
                             output_dir,
-                            ref_str,
                             minimum_variant_support,
                             minimum_variant_support_ratio);
     }
@@ -597,7 +648,6 @@ discover_directly_from_bam(std::string const & graph_path,
                                spl_hts_paths[NUM_POOLS - 1].get(),
                                region,
                                output_dir,
-                               ref_str,
                                minimum_variant_support,
                                minimum_variant_support_ratio);
 
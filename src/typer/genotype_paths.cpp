@@ -692,9 +692,9 @@ GenotypePaths::find_new_variants() const
   if (all_paths_fully_aligned() && is_purely_reference())
   {
     // Discover SNPs
-    uint32_t pos = path.start_ref_reach_pos();
-    uint32_t end_pos = path.end_ref_reach_pos() + 1;
-    std::vector<char> const reference = graph.get_generated_reference_genome(pos, end_pos);
+    TAbsPos pos = path.start_ref_reach_pos();
+    TAbsPos end_pos = path.end_ref_reach_pos() + 1;
+    PackedSequenceView const reference = graph.get_generated_reference_view(pos, end_pos);
     assert(pos == path.start);
     assert(end_pos == path.end_pos() + 1);
     assert(reference.size() == read2.size());
@@ -704,7 +704,7 @@ GenotypePaths::find_new_variants() const
       std::vector<char> ref;
       std::vector<char> alt;
       int64_t const MIN_VAR_THRESHOLD = 5;
-      uint32_t var_pos = 0;
+      TAbsPos var_pos = 0;
 
       for (unsigned i = 0; i < reference.size(); ++i)
       {
@@ -837,18 +837,18 @@ GenotypePaths::find_new_variants() const
   else
   {
     // Discover SNPs and indels
-    uint32_t const read_pos_start = path.start_ref_reach_pos() - path.read_start_index;
+    TAbsPos const read_pos_start = path.start_ref_reach_pos() - path.read_start_index;
 
     // Parameters
     uint32_t constexpr EXTRA_BASES_BEFORE = 50;
     uint32_t constexpr EXTRA_BASES_AFTER = 50;
-    uint32_t ref_pos_start{0};
+    TAbsPos ref_pos_start{0};
 
     // Check if we would underflow, and if we would then prevent an underflow
     if (read_pos_start <= path.start_ref_reach_pos() && read_pos_start > EXTRA_BASES_BEFORE)
       ref_pos_start = read_pos_start - EXTRA_BASES_BEFORE;
 
-    uint32_t ref_pos_end = static_cast<uint32_t>(read_pos_start + read2.size() + EXTRA_BASES_AFTER);
+    TAbsPos ref_pos_end = static_cast<TAbsPos>(read_pos_start + read2.size() + EXTRA_BASES_AFTER);
     std::vector<char> reference = graph.get_generated_reference_genome(ref_pos_start, ref_pos_end);
 
     // Make sure the extracted reference is much larger than the read
@@ -943,7 +943,7 @@ GenotypePaths::check_no_variant_is_missing() const
 {
   for (auto const & path : paths)
   {
-    std::vector<uint32_t> expected_orders = graph.get_var_orders(path.start_ref_reach_pos(), path.end_ref_reach_pos());
+    std::vector<TAbsPos> expected_orders = graph.get_var_orders(path.start_ref_reach_pos(), path.end_ref_reach_pos());
 
     if (expected_orders.size() != path.var_order.size())
     {
@@ -952,7 +952,7 @@ GenotypePaths::check_no_variant_is_missing() const
       return false;
     }
 
-    auto all_orders_match = [&](std::vector<uint32_t> const & o1, std::vector<uint32_t> const & o2)
+    auto all_orders_match = [&](std::vector<TAbsPos> const & o1, std::vector<TAbsPos> const & o2)
                             {
                               for (auto const & o : o1)
                               {
@@ -128,42 +128,42 @@ Path::merge_with_current(KmerLabel const & l)
  * PATH INFORMATION *
  ********************/
 
-uint32_t
+TAbsPos
 Path::start_pos() const
 {
   return start;
 }
 
 
-uint32_t
+TAbsPos
 Path::end_pos() const
 {
   return end;
 }
 
 
-uint32_t
+TAbsPos
 Path::start_correct_pos() const
 {
   return graph.get_actual_pos(start);
 }
 
 
-uint32_t
+TAbsPos
 Path::start_ref_reach_pos() const
 {
   return graph.get_ref_reach_pos(start);
 }
 
 
-uint32_t
+TAbsPos
 Path::end_correct_pos() const
 {
   return graph.get_actual_pos(end);
 }
 
 
-uint32_t
+TAbsPos
 Path::end_ref_reach_pos() const
 {
   return graph.get_ref_reach_pos(end);
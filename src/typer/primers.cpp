@@ -103,7 +103,7 @@ Primers::check_left(GenotypePaths & genos) const
         // Detected that the path starts in the primer
         if (pos >= abs_begin && pos <= abs_end)
         {
-          std::vector<uint32_t> var_orders = graph.get_var_orders(abs_begin, abs_end);
+          std::vector<TAbsPos> var_orders = graph.get_var_orders(abs_begin, abs_end);
 
           for (long i = path.var_order.size() - 1; i >= 0l; --i)
           {
@@ -148,7 +148,7 @@ Primers::check_right(GenotypePaths & genos) const
         // Detected that the path ends in the primer
         if (pos >= abs_begin && pos <= abs_end)
         {
-          std::vector<uint32_t> var_orders = graph.get_var_orders(abs_begin, abs_end);
+          std::vector<TAbsPos> var_orders = graph.get_var_orders(abs_begin, abs_end);
 
           for (long i = path.var_order.size() - 1; i >= 0l; --i)
           {
@@ -65,7 +65,7 @@ namespace gyper
 Segment::Segment(){}
 
 
-Segment::Segment(uint32_t _id, std::size_t _ref_size, std::vector<std::string> const & _allele_names)
+Segment::Segment(TAbsPos _id, std::size_t _ref_size, std::vector<std::string> const & _allele_names)
   : id(_id)
   , ref_size(_ref_size)
   , allele_names(_allele_names)
@@ -2,13 +2,15 @@
 #include <cmath> // sqrt
 #include <cstdlib> // std::abs(int64_t)
 #include <cstdint> // uint64_t
-#include <map> // std::map<Key, Value>
 #include <numeric> // std::accumulate
 #include <string> // std::string
 #include <sstream> // std::ostringstream
 #include <vector> // std::vector
 
 #include <boost/algorithm/string/split.hpp> // boost::split
+#include <boost/archive/binary_iarchive.hpp>
+#include <boost/archive/binary_oarchive.hpp>
+#include <boost/serialization/vector.hpp>
 
 #include <graphtyper/graph/absolute_position.hpp> // gyper::absolute_pos
 #include <graphtyper/typer/var_stats.hpp> // gyper::VarStats
@@ -67,111 +69,139 @@ VarStats::add_realignment_distance(uint8_t const allele_id,
 //}
 
 
-std::string
-VarStats::get_forward_strand_bias() const
+void
+VarStats::add_mapq(uint8_t const new_mapq)
 {
-  if (read_strand.size() == 0)
-    return ".";
-
-  std::stringstream ss;
-  ss << (read_strand[0].r1_forward + read_strand[0].r2_forward);
-
-  for (long i = 1; i < static_cast<long>(read_strand.size()); ++i)
-    ss << ',' << (read_strand[i].r1_forward + read_strand[i].r2_forward);
-
-  return ss.str();
+  // Ignore MapQ == 255, that means MapQ is unavailable
+  if (new_mapq < 255u)
+    mapq_squared += static_cast<uint64_t>(new_mapq) * static_cast<uint64_t>(new_mapq);
 }
 
 
-std::string
-VarStats::get_reverse_strand_bias() const
+/**
+ * InfoStats
+ */
+InfoStats::InfoStats(VarStats const & stat)
+  : has_clipped_reads(true)
+  , has_mapq_squared(true)
+  , has_strand_bias(true)
+  , clipped_reads(stat.clipped_reads)
+  , mapq_squared(stat.mapq_squared)
 {
-  if (read_strand.size() == 0)
-    return ".";
-
-  std::stringstream ss;
-  ss << (read_strand[0].r1_reverse + read_strand[0].r2_reverse);
-
-  for (long i = 1; i < static_cast<long>(read_strand.size()); ++i)
-    ss << ',' << (read_strand[i].r1_reverse + read_strand[i].r2_reverse);
-
-  return ss.str();
+  long const num_alleles = stat.read_strand.size();
+  sbf.reserve(num_alleles);
+  sbr.reserve(num_alleles);
+  sbf1.reserve(num_alleles);
+  sbf2.reserve(num_alleles);
+  sbr1.reserve(num_alleles);
+  sbr2.reserve(num_alleles);
+
+  for (auto const & rs : stat.read_strand)
+  {
+    sbf.push_back(rs.r1_forward + rs.r2_forward);
+    sbr.push_back(rs.r1_reverse + rs.r2_reverse);
+    sbf1.push_back(rs.r1_forward);
+    sbf2.push_back(rs.r2_forward);
+    sbr1.push_back(rs.r1_reverse);
+    sbr2.push_back(rs.r2_reverse);
+  }
 }
 
 
-std::string
-VarStats::get_r1_forward_strand_bias() const
+void
+InfoStats::merge_with(InfoStats const & other)
 {
-  if (read_strand.size() == 0)
-    return ".";
-
-  std::stringstream ss;
-  ss << read_strand[0].r1_forward;
-
-  for (long i = 1; i < static_cast<long>(read_strand.size()); ++i)
-    ss << ',' << read_strand[i].r1_forward;
-
-  return ss.str();
+  auto add_to_bias_lambda =
+    [](std::vector<uint32_t> & bias, std::vector<uint32_t> const & other_bias)
+    {
+      if (other_bias.size() > bias.size())
+        bias.resize(other_bias.size(), 0u);
+
+      for (long i = 0; i < static_cast<long>(other_bias.size()); ++i)
+        bias[i] += other_bias[i];
+    };
+
+  has_clipped_reads |= other.has_clipped_reads;
+  has_mapq_squared |= other.has_mapq_squared;
+  has_strand_bias |= other.has_strand_bias;
+
+  clipped_reads += other.clipped_reads;
+  mapq_squared += other.mapq_squared;
+
+  add_to_bias_lambda(sbf, other.sbf);
+  add_to_bias_lambda(sbr, other.sbr);
+  add_to_bias_lambda(sbf1, other.sbf1);
+  add_to_bias_lambda(sbf2, other.sbf2);
+  add_to_bias_lambda(sbr1, other.sbr1);
+  add_to_bias_lambda(sbr2, other.sbr2);
 }
 
 
-std::string
-VarStats::get_r2_forward_strand_bias() const
+void
+InfoStats::set_all()
 {
-  if (read_strand.size() == 0)
-    return ".";
-
-  std::stringstream ss;
-  ss << read_strand[0].r2_forward;
-
-  for (long i = 1; i < static_cast<long>(read_strand.size()); ++i)
-    ss << ',' << read_strand[i].r2_forward;
-
-  return ss.str();
+  has_clipped_reads = true;
+  has_mapq_squared = true;
+  has_strand_bias = true;
 }
 
 
-std::string
-VarStats::get_r1_reverse_strand_bias() const
+bool
+InfoStats::empty() const
 {
-  if (read_strand.size() == 0)
-    return ".";
-
-  std::stringstream ss;
-  ss << read_strand[0].r1_reverse;
-
-  for (long i = 1; i < static_cast<long>(read_strand.size()); ++i)
-    ss << ',' << read_strand[i].r1_reverse;
-
-  return ss.str();
+  return !has_clipped_reads && !has_mapq_squared && !has_strand_bias;
 }
 
 
-std::string
-VarStats::get_r2_reverse_strand_bias() const
+std::vector<std::pair<char const *, std::string> >
+InfoStats::get_infos() const
 {
-  if (read_strand.size() == 0)
-    return ".";
+  std::vector<std::pair<char const *, std::string> > infos;
 
-  std::stringstream ss;
-  ss << read_strand[0].r2_reverse;
+  if (has_clipped_reads)
+    infos.emplace_back("CR", std::to_string(clipped_reads));
 
-  for (long i = 1; i < static_cast<long>(read_strand.size()); ++i)
-    ss << ',' << read_strand[i].r2_reverse;
+  if (has_mapq_squared)
+    infos.emplace_back("MQsquared", std::to_string(mapq_squared));
 
-  return ss.str();
+  if (has_strand_bias)
+  {
+    infos.emplace_back("SBF", join_strand_bias(sbf));
+    infos.emplace_back("SBF1", join_strand_bias(sbf1));
+    infos.emplace_back("SBF2", join_strand_bias(sbf2));
+    infos.emplace_back("SBR", join_strand_bias(sbr));
+    infos.emplace_back("SBR1", join_strand_bias(sbr1));
+    infos.emplace_back("SBR2", join_strand_bias(sbr2));
+  }
+
+  return infos;
 }
 
 
+template <typename Archive>
 void
-VarStats::add_mapq(uint8_t const new_mapq)
+InfoStats::serialize(Archive & ar, unsigned const int /*version*/)
 {
-  // Ignore MapQ == 255, that means MapQ is unavailable
-  if (new_mapq < 255u)
-    mapq_squared += static_cast<uint64_t>(new_mapq) * static_cast<uint64_t>(new_mapq);
+  ar & has_clipped_reads;
+  ar & has_mapq_squared;
+  ar & has_strand_bias;
+  ar & clipped_reads;
+  ar & mapq_squared;
+  ar & sbf;
+  ar & sbr;
+  ar & sbf1;
+  ar & sbf2;
+  ar & sbr1;
+  ar & sbr2;
 }
 
 
+template void InfoStats::serialize<boost::archive::binary_iarchive>(boost::archive::binary_iarchive &,
+                                                                    const unsigned int);
+template void InfoStats::serialize<boost::archive::binary_oarchive>(boost::archive::binary_oarchive &,
+                                                                    const unsigned int);
+
+
 /** Non-member functions */
 template <class T>
 std::string
@@ -242,33 +272,16 @@ split_bias_to_numbers(std::string const & bias)
 }
 
 
-std::vector<uint32_t>
-get_strand_bias(std::map<std::string, std::string> const & infos, std::string const & bias)
-{
-  auto find_it = infos.find(bias);
-
-  if (find_it != infos.end())
-    return split_bias_to_numbers(find_it->second);
-  else
-    return std::vector<uint32_t>(0);
-}
-
-
 long
-get_accumulated_strand_bias(std::map<std::string, std::string> const & infos,
-                            std::string const & bias)
+get_accumulated_strand_bias(std::vector<uint32_t> const & strand_bias)
 {
-  std::vector<uint32_t> strand_bias = get_strand_bias(infos, bias);
   return std::accumulate(strand_bias.begin(), strand_bias.end(), 0l);
 }
 
 
 long
-get_accumulated_alt_strand_bias(std::map<std::string, std::string> const & infos,
-                                std::string const & bias)
+get_accumulated_alt_strand_bias(std::vector<uint32_t> const & strand_bias)
 {
-  std::vector<uint32_t> strand_bias = get_strand_bias(infos, bias);
-
   if (strand_bias.size() == 0)
     return 0;
 
@@ -36,18 +36,15 @@ update_strand_bias(std::size_t const num_seqs,
                    gyper::Variant const & var,
                    gyper::Variant & new_var)
 {
-  using gyper::get_strand_bias;
-  using gyper::join_strand_bias;
-
   std::vector<uint64_t> seq_depths = var.get_seq_depth_of_all_alleles();
 
-  std::vector<uint32_t> sbf = get_strand_bias(var.infos, "SBF");
-  std::vector<uint32_t> sbr = get_strand_bias(var.infos, "SBR");
+  std::vector<uint32_t> const & sbf = var.stats.sbf;
+  std::vector<uint32_t> const & sbr = var.stats.sbr;
 
-  std::vector<uint32_t> sbf1 = get_strand_bias(var.infos, "SBF1");
-  std::vector<uint32_t> sbf2 = get_strand_bias(var.infos, "SBF2");
-  std::vector<uint32_t> sbr1 = get_strand_bias(var.infos, "SBR1");
-  std::vector<uint32_t> sbr2 = get_strand_bias(var.infos, "SBR2");
+  std::vector<uint32_t> const & sbf1 = var.stats.sbf1;
+  std::vector<uint32_t> const & sbf2 = var.stats.sbf2;
+  std::vector<uint32_t> const & sbr1 = var.stats.sbr1;
+  std::vector<uint32_t> const & sbr2 = var.stats.sbr2;
 
   assert(sbf.size() > 0);
   assert(sbf.size() == num_seqs);
@@ -95,13 +92,14 @@ update_strand_bias(std::size_t const num_seqs,
 //      new_ra_dist[new_y] += ra_dist[y];
     }
 
-    new_var.infos["SBF"] = join_strand_bias(new_sbf);
-    new_var.infos["SBR"] = join_strand_bias(new_sbr);
+    new_var.stats.has_strand_bias = true;
+    new_var.stats.sbf = std::move(new_sbf);
+    new_var.stats.sbr = std::move(new_sbr);
 
-    new_var.infos["SBF1"] = join_strand_bias(new_sbf1);
-    new_var.infos["SBF2"] = join_strand_bias(new_sbf2);
-    new_var.infos["SBR1"] = join_strand_bias(new_sbr1);
-    new_var.infos["SBR2"] = join_strand_bias(new_sbr2);
+    new_var.stats.sbf1 = std::move(new_sbf1);
+    new_var.stats.sbf2 = std::move(new_sbf2);
+    new_var.stats.sbr1 = std::move(new_sbr1);
+    new_var.stats.sbr2 = std::move(new_sbr2);
 
 //    new_var.infos["RACount"] = join_strand_bias(new_ra_count);
 //    new_var.infos["RADist"] = join_strand_bias(new_ra_dist);
@@ -109,6 +107,43 @@ update_strand_bias(std::size_t const num_seqs,
 }
 
 
+// How break_down_variant breaks down a variant
+enum BreakDownMethod
+{
+  BREAK_DOWN_SKIPPED, // SVs, or "no_decompose" was given. The variant is kept as it is
+  BREAK_DOWN_SNPS, // All alleles have the same size, so the variant is broken into SNPs
+  BREAK_DOWN_SKYR, // Broken down by skyr, which depends on the reach of the variants before
+  BREAK_DOWN_BIALLELIC_ONLY // Overlapping variants are not allowed, it is only made biallelic if asked for
+};
+
+
+BreakDownMethod
+get_break_down_method(gyper::Variant const & var, bool const is_no_variant_overlapping)
+{
+  // Don't break down SVs or if "no_decompose" was given
+  if (gyper::Options::const_instance()->no_decompose ||
+      (var.seqs.size() == 2 &&
+       std::any_of(var.seqs[1].begin(), var.seqs[1].end(), [](char const c){
+      return c == '<' || c == '[' || c == ']';
+    })))
+  {
+    return BREAK_DOWN_SKIPPED;
+  }
+
+  bool const all_same_size =
+    std::find_if(var.seqs.begin() + 1, var.seqs.end(), [&](std::vector<char> const & seq){
+      return var.seqs[0].size() != seq.size();
+    }) == var.seqs.end();
+
+  if (all_same_size)
+    return BREAK_DOWN_SNPS;
+  else if (!is_no_variant_overlapping)
+    return BREAK_DOWN_SKYR;
+  else
+    return BREAK_DOWN_BIALLELIC_ONLY;
+}
+
+
 } // anon namesapce
 
 
@@ -124,15 +159,17 @@ Variant::Variant(Variant const & var) noexcept
   , seqs(var.seqs)
   , calls(var.calls)
   , infos(var.infos)
+  , stats(var.stats)
   , suffix_id(var.suffix_id)
   , is_info_generated(var.is_info_generated)
 {}
 
 Variant::Variant(Variant && var) noexcept
-  : abs_pos(std::forward<uint32_t>(var.abs_pos))
+  : abs_pos(std::forward<TAbsPos>(var.abs_pos))
   , seqs(std::forward<std::vector<std::vector<char> > >(var.seqs))
   , calls(std::forward<std::vector<SampleCall> >(var.calls))
   , infos(std::forward<std::map<std::string, std::string> >(var.infos))
+  , stats(std::forward<InfoStats>(var.stats))
   , suffix_id(std::forward<std::string>(var.suffix_id))
   , is_info_generated(var.is_info_generated)
 {}
@@ -145,6 +182,7 @@ Variant::operator=(Variant const & o) noexcept
   seqs = o.seqs;
   calls = o.calls;
   infos = o.infos;
+  stats = o.stats;
   suffix_id = o.suffix_id;
   is_info_generated = o.is_info_generated;
   return *this;
@@ -158,6 +196,7 @@ Variant::operator=(Variant && o) noexcept
   seqs = std::move(o.seqs);
   calls = std::move(o.calls);
   infos = std::move(o.infos);
+  stats = std::move(o.stats);
   suffix_id = std::move(o.suffix_id);
   is_info_generated = o.is_info_generated;
   return *this;
@@ -596,8 +635,8 @@ Variant::generate_infos()
 
   // Write Strand Bias (SB)
   {
-    uint32_t total_f = get_accumulated_strand_bias(infos, "SBF");
-    uint32_t total_r = get_accumulated_strand_bias(infos, "SBR");
+    uint32_t total_f = get_accumulated_strand_bias(stats.sbf);
+    uint32_t total_r = get_accumulated_strand_bias(stats.sbr);
 
     std::stringstream ss_sb;
     ss_sb.precision(4);
@@ -614,8 +653,8 @@ Variant::generate_infos()
 
   // Write Alternative Strand Bias (SBAlt)
   {
-    uint32_t total_f = get_accumulated_alt_strand_bias(infos, "SBF");
-    uint32_t total_r = get_accumulated_alt_strand_bias(infos, "SBR");
+    uint32_t total_f = get_accumulated_alt_strand_bias(stats.sbf);
+    uint32_t total_r = get_accumulated_alt_strand_bias(stats.sbr);
 
     std::stringstream ss_sb;
     ss_sb.precision(4);
@@ -727,11 +766,9 @@ Variant::generate_infos()
 
   // Calculate MQ
   {
-    auto find_mapq_squared_it = infos.find("MQsquared");
-
-    if (find_mapq_squared_it != infos.end())
+    if (stats.has_mapq_squared)
     {
-      double mapq_squared = std::stoull(find_mapq_squared_it->second);
+      double mapq_squared = stats.mapq_squared;
 
       if (seqdepth > 0)
       {
@@ -748,7 +785,7 @@ Variant::generate_infos()
 
   // Logistic regression quality filter (LOGF). Work in progress
   {
-    long const info_cr = infos.count("CR") ? std::stol(infos.at("CR")) : 0;
+    long const info_cr = stats.has_clipped_reads ? static_cast<long>(stats.clipped_reads) : 0;
     long const ab_het_bin = static_cast<long>(info_ab_het * 10.0 + 0.00001);
     long const sbalt_bin = static_cast<long>(info_sbalt * 10.0 + 0.00001);
     double const cr_by_seqdepth = static_cast<double>(info_cr) / static_cast<double>(seqdepth);
@@ -820,9 +857,9 @@ Variant::trim_sequences(bool const keep_one_match)
 bool
 Variant::add_base_in_front(bool const add_N)
 {
-  uint32_t abs_pos_copy = abs_pos;
-  uint32_t new_abs_pos = abs_pos - 1;
-  std::vector<char> first_base = graph.get_generated_reference_genome(new_abs_pos, abs_pos_copy);
+  TAbsPos abs_pos_copy = abs_pos;
+  TAbsPos new_abs_pos = abs_pos - 1;
+  PackedSequenceView const first_base = graph.get_generated_reference_view(new_abs_pos, abs_pos_copy);
 
   if (first_base.size() != 1 || abs_pos_copy != abs_pos || new_abs_pos != abs_pos - 1)
     return false; // The base in front could not be extracted
@@ -883,9 +920,9 @@ bool
 Variant::add_base_in_back(bool const add_N)
 {
   assert(seqs.size() >= 1);
-  uint32_t abs_pos_copy = abs_pos + static_cast<uint32_t>(seqs[0].size());
-  uint32_t abs_pos_end = abs_pos_copy + 1;
-  std::vector<char> last_base = graph.get_generated_reference_genome(abs_pos_copy, abs_pos_end);
+  TAbsPos abs_pos_copy = abs_pos + static_cast<TAbsPos>(seqs[0].size());
+  TAbsPos abs_pos_end = abs_pos_copy + 1;
+  PackedSequenceView const last_base = graph.get_generated_reference_view(abs_pos_copy, abs_pos_end);
 
   if (last_base.size() != 1 || abs_pos_copy != (abs_pos + seqs[0].size()) ||
       abs_pos_end != (abs_pos + seqs[0].size() + 1))
@@ -1261,6 +1298,7 @@ make_biallelic(Variant && var)
     new_var.seqs.push_back(var.seqs[a]);
     new_var.abs_pos = var.abs_pos; // Add the pos
     new_var.infos = var.infos; // Copy the INFOs
+    new_var.stats = var.stats;
     new_var.suffix_id = var.suffix_id; // Copy the suffix ID
     std::vector<uint16_t> old_phred_to_new_phred(var.seqs.size(), 0);
     old_phred_to_new_phred[a] = 1;
@@ -1326,23 +1364,15 @@ break_down_variant(Variant && var,
                    bool const is_all_biallelic)
 {
   std::vector<Variant> broken_down_vars;
+  BreakDownMethod const method = get_break_down_method(var, is_no_variant_overlapping);
 
-  if (Options::const_instance()->no_decompose ||
-      (var.seqs.size() == 2 &&
-       std::any_of(var.seqs[1].begin(), var.seqs[1].end(), [](char const c){
-      return c == '<' || c == '[' || c == ']';
-    })))
+  if (method == BREAK_DOWN_SKIPPED)
   {
-    broken_down_vars.push_back(std::move(var)); // Don't break down SVs or if "no_decompose" was given
+    broken_down_vars.push_back(std::move(var));
     return broken_down_vars;
   }
 
-  bool const all_same_size =
-    std::find_if(var.seqs.begin() + 1, var.seqs.end(), [&](std::vector<char> const & seq){
-      return var.seqs[0].size() != seq.size();
-    }) == var.seqs.end();
-
-  if (all_same_size)
+  if (method == BREAK_DOWN_SNPS)
   {
     // We need to make sure there is a matching first base
     if (not var.is_with_matching_first_bases())
@@ -1362,7 +1392,7 @@ break_down_variant(Variant && var,
               std::back_inserter(broken_down_vars)
               );
   }
-  else if (!is_no_variant_overlapping)
+  else if (method == BREAK_DOWN_SKYR)
   {
     // Use the skyr
     BOOST_LOG_TRIVIAL(debug) << "Using the skyr";
@@ -1397,16 +1427,23 @@ break_down_variant(Variant && var,
 }
 
 
+bool
+is_break_down_using_reach(Variant const & var, bool const is_no_variant_overlapping)
+{
+  return get_break_down_method(var, is_no_variant_overlapping) == BREAK_DOWN_SKYR;
+}
+
+
 std::vector<Variant>
 extract_sequences_from_aligned_variant(Variant const && var, std::size_t const THRESHOLD)
 {
   std::vector<Variant> new_vars;
-  uint32_t const original_pos = var.abs_pos;
+  TAbsPos const original_pos = var.abs_pos;
   assert(var.seqs.size() >= 2);
   assert(var.seqs[0].size() > 0);
   assert(var.seqs[0].size() == var.seqs[1].size());
   char first_base = var.seqs[0][0];
-  uint32_t pos = var.abs_pos;
+  TAbsPos pos = var.abs_pos;
 
   // match_length == -1 means that we have not found a mismatch yet
   long match_length = -1;
@@ -1418,6 +1455,7 @@ extract_sequences_from_aligned_variant(Variant const && var, std::size_t const T
     std::vector<std::vector<char> >(var.seqs.size(), std::vector<char>(1, first_base));
 
   new_var.infos = var.infos; // Copy INFOs
+  new_var.stats = var.stats;
 //  new_var.phase = var.phase; // Copy phase
   new_var.suffix_id = var.suffix_id; // Copy suffix ID
 
@@ -1515,8 +1553,6 @@ extract_sequences_from_aligned_variant(Variant const && var, std::size_t const T
 void
 find_variant_sequences(gyper::Variant & new_var, gyper::Variant const & old_var)
 {
-  using gyper::get_strand_bias;
-  using gyper::join_strand_bias;
   using gyper::to_index;
   using gyper::SampleCall;
 
@@ -1640,7 +1676,7 @@ find_variant_sequences(gyper::Variant & new_var, gyper::Variant const & old_var)
 std::vector<Variant>
 break_multi_snps(Variant const && var)
 {
-  uint32_t const pos = var.abs_pos;
+  TAbsPos const pos = var.abs_pos;
   std::vector<std::vector<char> > const & seqs = var.seqs;
   std::vector<Variant> new_vars;
 
@@ -1680,6 +1716,7 @@ break_multi_snps(Variant const && var)
 
     new_var.abs_pos = pos + j; // Add the pos of the SNP
     new_var.infos = var.infos; // Copy the INFOs
+    new_var.stats = var.stats;
     //new_var.phase = var.phase; // Copy the old phase
     new_var.suffix_id = var.suffix_id; // Copy the suffix ID
 
@@ -1726,7 +1763,7 @@ break_multi_snps(Variant const && var)
       new_var.calls.push_back(std::move(new_sample_call));
     }
 
-    if (var.infos.count("SBF1") == 1)
+    if (var.stats.has_strand_bias)
       update_strand_bias(seqs.size(), new_var.seqs.size(), old_phred_to_new_phred, var, new_var);
 
     new_vars.push_back(std::move(new_var));
@@ -1778,6 +1815,7 @@ break_down_skyr(Variant && var, long const reach)
       new_var.add_base_in_front(true); // Add N is true
 
     new_var.infos = var.infos; // Copy the INFOs
+    new_var.stats = var.stats;
     new_var.suffix_id = var.suffix_id; // Copy the suffix ID
 
     auto const & old_phred_to_new_phred = new_edit.calls;
@@ -1861,12 +1899,17 @@ Variant::operator<(Variant const & b) const
 
 template <typename Archive>
 void
-Variant::serialize(Archive & ar, unsigned const int /*version*/)
+Variant::serialize(Archive & ar, unsigned const int version)
 {
+  // Newer versions are rejected by Boost, older ones are rejected here
+  if (version != ABS_POS_ARCHIVE_VERSION)
+    throw boost::archive::archive_exception(boost::archive::archive_exception::unsupported_class_version);
+
   ar & abs_pos;
   ar & seqs;
   ar & calls;
   ar & infos;
+  ar & stats;
   ar & suffix_id;
 }
 
@@ -1881,7 +1924,7 @@ std::size_t
 VariantHash::operator()(Variant const & v) const
 {
   assert(v.seqs.size() == 2);
-  std::size_t h1 = std::hash<uint32_t>()(v.abs_pos);
+  std::size_t h1 = std::hash<TAbsPos>()(v.abs_pos);
   std::size_t h2 = boost::hash_range(v.seqs[0].begin(), v.seqs[0].end());
   std::size_t h3 = 42 + boost::hash_range(v.seqs[1].begin(), v.seqs[1].end());
   return h1 ^ (h2 << 1) ^ (h3 + 0x9e3779b9);
@@ -145,7 +145,7 @@ std::size_t
 VariantCandidateHash::operator()(VariantCandidate const & v) const
 {
   assert(v.seqs.size() == 2);
-  std::size_t h1 = std::hash<uint32_t>()(v.abs_pos);
+  std::size_t h1 = std::hash<TAbsPos>()(v.abs_pos);
   std::size_t h2 = boost::hash_range(v.seqs[0].begin(), v.seqs[0].end());
   std::size_t h3 = 42 + boost::hash_range(v.seqs[1].begin(), v.seqs[1].end());
   return h1 ^ (h2 << 1) ^ (h3 + 0x9e3779b9);
@@ -1,15 +1,17 @@
+#include <algorithm> // std::lower_bound, std::stable_sort
 #include <cassert>
 #include <cstdlib> // abs
 #include <cstdint> // uint32_t
 #include <ios>
 #include <iomanip>
+#include <iterator> // std::back_inserter
 #include <unordered_map>
 #include <utility>
 
 #include <boost/archive/binary_oarchive.hpp>
 #include <boost/archive/binary_iarchive.hpp>
-#include <boost/serialization/map.hpp>
-#include <boost/serialization/set.hpp>
+#include <boost/functional/hash.hpp>
+#include <boost/serialization/utility.hpp>
 #include <boost/serialization/vector.hpp>
 #include <boost/serialization/unordered_map.hpp>
 
@@ -23,6 +25,7 @@
 #include <graphtyper/typer/vcf.hpp>
 #include <graphtyper/utilities/io.hpp>
 #include <graphtyper/utilities/options.hpp>
+#include <graphtyper/utilities/parallel.hpp> // gyper::parallel_for_each_index
 #include <graphtyper/utilities/type_conversions.hpp>
 
 
@@ -64,12 +67,164 @@ get_abs_dev_read_bias(std::vector<gyper::VariantSupport> const & supports)
 }
 
 
+// Returns the variant in the sorted pool varmap or pool_varmap.end() if it is not there
+gyper::PoolVarMap::const_iterator
+find_in_pool(gyper::PoolVarMap const & pool_varmap, gyper::VariantCandidate const & var)
+{
+  auto it = std::lower_bound(pool_varmap.begin(),
+                             pool_varmap.end(),
+                             var,
+                             [](gyper::PoolVarMap::value_type const & a, gyper::VariantCandidate const & b) -> bool
+    {
+      return a.first < b;
+    });
+
+  if (it != pool_varmap.end() && it->first == var)
+    return it;
+
+  return pool_varmap.end();
+}
+
+
+// Removes variants marked as erased while keeping the order of the rest
+void
+remove_erased(gyper::PoolVarMap & pool_varmap, std::vector<char> const & is_erased)
+{
+  assert(pool_varmap.size() == is_erased.size());
+  long new_size{0};
+
+  for (long i{0}; i < static_cast<long>(pool_varmap.size()); ++i)
+  {
+    if (is_erased[i])
+      continue;
+
+    if (new_size != i)
+      pool_varmap[new_size] = std::move(pool_varmap[i]);
+
+    ++new_size;
+  }
+
+  pool_varmap.erase(pool_varmap.begin() + new_size, pool_varmap.end());
+}
+
+
+// Merges two sorted pool varmaps. If a variant is in both, the supports from 'b' are placed after the ones from 'a'
+gyper::PoolVarMap
+merge_pool_varmaps(gyper::PoolVarMap && a, gyper::PoolVarMap && b)
+{
+  gyper::PoolVarMap merged;
+  merged.reserve(a.size() + b.size());
+  auto a_it = a.begin();
+  auto b_it = b.begin();
+
+  while (a_it != a.end() && b_it != b.end())
+  {
+    if (a_it->first < b_it->first)
+    {
+      merged.push_back(std::move(*a_it));
+      ++a_it;
+    }
+    else if (b_it->first < a_it->first)
+    {
+      merged.push_back(std::move(*b_it));
+      ++b_it;
+    }
+    else
+    {
+      merged.push_back(std::move(*a_it));
+      std::move(b_it->second.begin(), b_it->second.end(), std::back_inserter(merged.back().second));
+      ++a_it;
+      ++b_it;
+    }
+  }
+
+  std::move(a_it, a.end(), std::back_inserter(merged));
+  std::move(b_it, b.end(), std::back_inserter(merged));
+  return merged;
+}
+
+
 } // anon namespace
 
 
 namespace gyper
 {
 
+uint32_t
+AlleleArena::insert(std::vector<char> const & seq)
+{
+  return insert(seq, boost::hash_range(seq.begin(), seq.end()));
+}
+
+
+uint32_t
+AlleleArena::insert(std::vector<char> const & seq, std::size_t const h)
+{
+  auto range = ids.equal_range(h);
+
+  for (auto it = range.first; it != range.second; ++it)
+  {
+    uint32_t const begin = it->second == 0 ? 0u : ends[it->second - 1];
+    uint32_t const end = ends[it->second];
+
+    if (end - begin == seq.size() && std::equal(seq.begin(), seq.end(), sequences.begin() + begin))
+      return it->second;
+  }
+
+  uint32_t const id = ends.size();
+  sequences.insert(sequences.end(), seq.begin(), seq.end());
+  ends.push_back(sequences.size());
+  ids.insert(std::make_pair(h, id));
+  return id;
+}
+
+
+std::vector<char>
+AlleleArena::get(uint32_t const id) const
+{
+  assert(id < ends.size());
+  uint32_t const begin = id == 0 ? 0u : ends[id - 1];
+  return std::vector<char>(sequences.begin() + begin, sequences.begin() + ends[id]);
+}
+
+
+void
+AlleleArena::clear()
+{
+  sequences = std::vector<char>();
+  ends = std::vector<uint32_t>();
+  ids.clear();
+}
+
+
+bool
+VarMapKey::operator==(VarMapKey const & b) const
+{
+  return abs_pos == b.abs_pos && ref_id == b.ref_id && alt_id == b.alt_id;
+}
+
+
+std::size_t
+VarMapKeyHash::operator()(VarMapKey const & key) const
+{
+  std::size_t h = std::hash<TAbsPos>()(key.abs_pos);
+  boost::hash_combine(h, key.ref_id);
+  boost::hash_combine(h, key.alt_id);
+  return h;
+}
+
+
+VariantCandidate
+VariantMap::get_variant_candidate(VarMapKey const & key) const
+{
+  VariantCandidate var;
+  var.abs_pos = key.abs_pos;
+  var.seqs.push_back(alleles.get(key.ref_id));
+  var.seqs.push_back(alleles.get(key.alt_id));
+  return var;
+}
+
+
 void
 VariantMap::add_variants(std::vector<VariantCandidate> && vars, long const sample_index)
 {
@@ -87,13 +242,15 @@ VariantMap::add_variants(std::vector<VariantCandidate> && vars, long const sampl
     // Extract all required information
     uint32_t const ORIGINAL_POS = var.original_pos;
 
-    auto it = varmap.find(var);
+    VarMapKey key;
+    key.abs_pos = var.abs_pos;
+    key.ref_id = alleles.insert(var.seqs[0]);
+    key.alt_id = alleles.insert(var.seqs[1]);
+    auto it = varmap.find(key);
 
     if (it == varmap.end())
     {
-      it = varmap.insert(std::make_pair<VariantCandidate, VariantSupport>(
-                           VariantCandidate(var),
-                           VariantSupport())).first;
+      it = varmap.insert(std::make_pair(key, VariantSupport())).first;
 
       // Expand to learn the true size
       it->second.is_indel = var.seqs[0].size() != var.seqs[1].size();
@@ -116,7 +273,7 @@ VariantMap::add_variants(std::vector<VariantCandidate> && vars, long const sampl
     it->second.first_in_pairs += ((var.flags & IS_FIRST_IN_PAIR) != 0);
     it->second.sequence_reversed += ((var.flags & IS_SEQ_REVERSED) != 0);
     it->second.clipped += ((var.flags & IS_CLIPPED) != 0);
-    it->second.unique_positions.insert(ORIGINAL_POS);
+    it->second.add_unique_position(ORIGINAL_POS);
   }
 }
 
@@ -127,6 +284,9 @@ VariantMap::create_varmap_for_all(ReferenceDepth const & reference_depth)
   assert(varmaps.size() == reference_depth.depths.size());
   long const NUM_SAMPLES = static_cast<long>(varmaps.size());
 
+  // Variants which pass in each sample and their support
+  std::vector<std::pair<VariantCandidate, VariantSupport const *> > passed_vars;
+
   for (long i = 0; i < NUM_SAMPLES; ++i)
   {
     auto & varmap = varmaps[i];
@@ -145,7 +305,7 @@ VariantMap::create_varmap_for_all(ReferenceDepth const & reference_depth)
           if (it->second.is_support_above_cutoff(new_min_support))
           {
             ++num_above_threshold;
-            int ret = it->first.is_transition_or_transversion();
+            int ret = get_variant_candidate(it->first).is_transition_or_transversion();
 
             if (ret == 1)
               ++transitions;
@@ -178,13 +338,13 @@ VariantMap::create_varmap_for_all(ReferenceDepth const & reference_depth)
 
     for (auto map_it = varmap.begin(); map_it != varmap.end(); ++map_it)
     {
-      VariantCandidate const & var = map_it->first;
       VariantSupport & new_var_support = map_it->second;
 
       // Check if support is above cutoff and some reasonable hard filters
       if (new_var_support.is_support_above_cutoff(new_min_support))
       {
-        new_var_support.set_depth(reference_depth.get_read_depth(map_it->first, i));
+        VariantCandidate var = get_variant_candidate(map_it->first);
+        new_var_support.set_depth(reference_depth.get_read_depth(var, i));
 
         // Check if ratio is above cutoff
         if (new_var_support.is_ratio_above_cutoff(min_ratio))
@@ -194,12 +354,33 @@ VariantMap::create_varmap_for_all(ReferenceDepth const & reference_depth)
           new_var_support.pn_index = static_cast<uint32_t>(i);
           #endif // NDEBUG
 
-          pool_varmap[var].push_back(new_var_support);
+          passed_vars.push_back(std::make_pair(std::move(var), &new_var_support));
         }
       }
     }
   } // for (long i = 0; i < NUM_SAMPLES; ++i)
 
+  // Group the supports of each variant. The sort is stable so the supports stay in the order of the samples
+  std::stable_sort(passed_vars.begin(),
+                   passed_vars.end(),
+                   [](std::pair<VariantCandidate, VariantSupport const *> const & a,
+                      std::pair<VariantCandidate, VariantSupport const *> const & b) -> bool
+    {
+      return a.first < b.first;
+    });
+
+  PoolVarMap new_pool_varmap;
+
+  for (auto & passed_var : passed_vars)
+  {
+    if (new_pool_varmap.size() == 0 || new_pool_varmap.back().first != passed_var.first)
+      new_pool_varmap.emplace_back(std::move(passed_var.first), std::vector<VariantSupport>());
+
+    new_pool_varmap.back().second.push_back(*passed_var.second);
+  }
+
+  pool_varmap = merge_pool_varmaps(std::move(pool_varmap), std::move(new_pool_varmap));
+
 #ifndef NDEBUG
   BOOST_LOG_TRIVIAL(debug) << "Pool varmap size " << pool_varmap.size();
 
@@ -223,7 +404,9 @@ VariantMap::filter_varmap_for_all()
 
   // Filter on strand bias
   //*
-  for (auto it = pool_varmap.begin(); it != pool_varmap.end();)  // no increment
+  std::vector<char> is_erased(pool_varmap.size(), false);
+
+  for (auto it = pool_varmap.begin(); it != pool_varmap.end(); ++it)
   {
     // Skip read bias on indels
     bool is_any_hq = false;
@@ -259,7 +442,7 @@ VariantMap::filter_varmap_for_all()
 #ifndef NDEBUG
         BOOST_LOG_TRIVIAL(debug) << "Strand bias removed " << it->first.print() << " " << abs_dev_sb << " " << depth;
 #endif // NDEBUG
-        it = pool_varmap.erase(it);
+        is_erased[it - pool_varmap.begin()] = true;
         continue;
       }
 
@@ -278,14 +461,14 @@ VariantMap::filter_varmap_for_all()
 #ifndef NDEBUG
           BOOST_LOG_TRIVIAL(debug) << "Read bias removed " << it->first.print() << " " << abs_dev_rb << " " << depth;
 #endif // NDEBUG
-          it = pool_varmap.erase(it);
+          is_erased[it - pool_varmap.begin()] = true;
           continue;
         }
       }
     }
-
-    ++it;
   }
+
+  remove_erased(pool_varmap, is_erased);
   //*/
 
   /// Limit to the number of variants in a 100 bp window
@@ -299,11 +482,12 @@ VariantMap::filter_varmap_for_all()
 
     // Gather how many variants fall into each bucket (which covers 100 bp)
     std::vector<long> max_scores_in_bucket;
-    auto window_it = pool_varmap.begin();
-    long current_bucket = window_it->first.abs_pos / 100l;
+    is_erased.assign(pool_varmap.size(), false);
+    long window_begin{0};
+    long current_bucket = pool_varmap[0].first.abs_pos / 100l;
 
     auto filter_window =
-      [&max_scores_in_bucket, max_variants_in_100bp_window, this](PoolVarMap::iterator window_it)
+      [&max_scores_in_bucket, &is_erased, max_variants_in_100bp_window, this](long const window_begin)
       {
         BOOST_LOG_TRIVIAL(debug) << "[graphtyper::variant_map] Too many variants! " << max_scores_in_bucket.size();
 
@@ -317,28 +501,22 @@ VariantMap::filter_varmap_for_all()
 
         for (long s{0}; s < static_cast<long>(max_scores_in_bucket.size()); ++s)
         {
-          if (max_scores_in_bucket[s] >= min_score_pass)
-          {
-            ++window_it;
-          }
-          else
+          if (max_scores_in_bucket[s] < min_score_pass)
           {
             #ifndef NDEBUG
             BOOST_LOG_TRIVIAL(debug) << "Due to too high graph complexity I erased the variant: "
-                                     << window_it->first.print()
-                                     << ". It had support in " << window_it->second.size()
+                                     << pool_varmap[window_begin + s].first.print()
+                                     << ". It had support in " << pool_varmap[window_begin + s].second.size()
                                      << " samples and score of " << max_scores_in_bucket[s];
             #endif // NDEBUG
-            window_it = pool_varmap.erase(window_it);
+            is_erased[window_begin + s] = true;
           }
         }
-
-        return window_it; // return the new iterator
       };
 
-    for (auto map_it = std::next(pool_varmap.begin()); map_it != pool_varmap.end(); ++map_it)
+    for (long v{1}; v < static_cast<long>(pool_varmap.size()); ++v)
     {
-      long const bucket = map_it->first.abs_pos / 100l;
+      long const bucket = pool_varmap[v].first.abs_pos / 100l;
       assert(bucket >= current_bucket); // We should never go backwards in order
 
       {
@@ -346,7 +524,7 @@ VariantMap::filter_varmap_for_all()
         long max_score{0};
 
         // Get the max score for this variant
-        for (VariantSupport const & supp : map_it->second)
+        for (VariantSupport const & supp : pool_varmap[v].second)
         {
           long const score = supp.get_score();
 
@@ -363,15 +541,12 @@ VariantMap::filter_varmap_for_all()
       // We have reached a new bucket, check if there are too many variants in the bucket
       if (static_cast<long>(max_scores_in_bucket.size()) > max_variants_in_100bp_window)
       {
-        assert(std::distance(window_it, map_it) == static_cast<long>(max_scores_in_bucket.size()));
-        window_it = filter_window(window_it);
-        map_it = window_it;
-      }
-      else
-      {
-        window_it = map_it;
+        assert(v - window_begin == static_cast<long>(max_scores_in_bucket.size()));
+        filter_window(window_begin);
       }
 
+      window_begin = v;
+
       // Update current bucket
       current_bucket = bucket;
       max_scores_in_bucket.clear();
@@ -380,10 +555,12 @@ VariantMap::filter_varmap_for_all()
     // Check if the last bucket has too many variants
     if (static_cast<long>(max_scores_in_bucket.size()) > max_variants_in_100bp_window)
     {
-      assert(std::distance(window_it, pool_varmap.end()) == static_cast<long>(max_scores_in_bucket.size()));
-      filter_window(window_it);
-      // Do stuff to filter variants in range [window_it, map_it[
+      assert(static_cast<long>(pool_varmap.size()) - window_begin ==
+             static_cast<long>(max_scores_in_bucket.size()));
+      filter_window(window_begin);
     }
+
+    remove_erased(pool_varmap, is_erased);
   }
 
   /** Break down variants to check if they are duplicates */
@@ -391,7 +568,9 @@ VariantMap::filter_varmap_for_all()
   //std::vector<VariantCandidate> broken_vars_to_add;
   //std::vector<std::vector<VariantSupport> > supports_to_add;
 
-  for (auto map_it = pool_varmap.begin(); map_it != pool_varmap.end();)  // no increment
+  is_erased.assign(pool_varmap.size(), false);
+
+  for (auto map_it = pool_varmap.begin(); map_it != pool_varmap.end(); ++map_it)
   {
     VariantCandidate var(map_it->first);
 
@@ -422,10 +601,7 @@ VariantMap::filter_varmap_for_all()
     assert(new_broken_down_vars.size() != 0);
 
     if (new_broken_down_vars.size() == 1)
-    {
-      ++map_it; // The variant could not be broken down, move on
-      continue;
-    }
+      continue; // The variant could not be broken down, move on
 
     for (auto & broken_var : new_broken_down_vars)
       broken_var.normalize();
@@ -445,7 +621,8 @@ VariantMap::filter_varmap_for_all()
       std::remove_if(new_broken_down_var_candidates.begin(),
                      new_broken_down_var_candidates.end(),
                      [&](VariantCandidate const & broken_var){
-        return pool_varmap.find(broken_var) != pool_varmap.end();
+        auto find_it = find_in_pool(pool_varmap, broken_var);
+        return find_it != pool_varmap.end() && !is_erased[find_it - pool_varmap.begin()];
       }), new_broken_down_var_candidates.end());
 
     // Remove broken variants that are already in the graph
@@ -461,13 +638,11 @@ VariantMap::filter_varmap_for_all()
 #ifndef NDEBUG
       BOOST_LOG_TRIVIAL(debug) << "Erased " << map_it->first.print();
 #endif // NDEBUG
-      map_it = pool_varmap.erase(map_it); // Erase the old variant
-    }
-    else
-    {
-      ++map_it; // Don't erase the old variant, just move on to the next one
+      is_erased[map_it - pool_varmap.begin()] = true; // Erase the old variant
     }
   }
+
+  remove_erased(pool_varmap, is_erased);
   //*/
 }
 
@@ -478,6 +653,7 @@ VariantMap::clear()
   samples.clear();
   pool_varmap.clear();
   varmaps.clear();
+  alleles.clear();
 }
 
 
@@ -584,7 +760,7 @@ VariantMap::write_stats(std::string const & prefix)
 //                     << var_support.clipped << '\t'
                      << var_support.var_size << '\t'
                      << var_support.growth << '\t'
-                     << var_support.unique_positions.size() << '\t'
+                     << static_cast<long>(var_support.num_unique_positions) << '\t'
                      << var_support.sequence_reversed << '\t'
                      << var_support.first_in_pairs << '\t'
                      << var_support.get_corrected_support() << '\t'
@@ -688,48 +864,58 @@ void
 VariantMap::load_many_variant_maps(std::vector<std::string> const & paths)
 {
   this->pool_varmap.clear();  // Should be empty initially
+  long const NUM_MAPS = paths.size();
 
-  for (long p = 0; p < static_cast<long>(paths.size()); ++p)
-  {
-    auto const & file_path = paths[p];
-    VariantMap new_map = load_variant_map(file_path);
+  if (NUM_MAPS == 0)
+    return;
 
-    if (p == 0)
+  std::vector<VariantMap> maps(NUM_MAPS);
+
+  parallel_for_each_index(NUM_MAPS, [&maps, &paths](long const p)
     {
-      minimum_variant_support = new_map.minimum_variant_support;
-      minimum_variant_support_ratio = new_map.minimum_variant_support_ratio;
-    }
+      maps[p] = load_variant_map(paths[p]);
+    });
 
+  minimum_variant_support = maps[0].minimum_variant_support;
+  minimum_variant_support_ratio = maps[0].minimum_variant_support_ratio;
+  std::vector<PoolVarMap> pools(NUM_MAPS);
+
+  for (long p = 0; p < NUM_MAPS; ++p)
+  {
 #ifndef NDEBUG
     // Sample index offset
     long sample_index_offset = samples.size();
-#endif // NDEBUG
 
-    // Copy samples
-    std::copy(new_map.samples.begin(), new_map.samples.end(), std::back_inserter(samples));
-
-    for (auto it = new_map.pool_varmap.begin(); it != new_map.pool_varmap.end(); ++it)
+    // Change all pn_indexes with offset
+    for (auto & var_supports : maps[p].pool_varmap)
     {
-#ifndef NDEBUG
-      // Change all pn_indexes with offset
-      for (auto variant_support : it->second)
+      for (auto & variant_support : var_supports.second)
         variant_support.pn_index += sample_index_offset;
+    }
 #endif // NDEBUG
 
-      auto find_it = pool_varmap.find(it->first);
+    // Copy samples
+    std::copy(maps[p].samples.begin(), maps[p].samples.end(), std::back_inserter(samples));
+    pools[p] = std::move(maps[p].pool_varmap);
+  }
 
-      if (find_it == pool_varmap.end())
-      {
-        // Not found
-        pool_varmap[it->first] = it->second;
-      }
-      else
+  maps.clear();
+
+  // Merge neighbouring pools in rounds until one is left. The merges of each round are independent so they run in
+  // parallel, and the supports of each variant stay in the order of the input files.
+  for (long step = 1; step < NUM_MAPS; step *= 2)
+  {
+    long const NUM_MERGES = (NUM_MAPS + step - 1) / (2 * step); // Pools i and i + step where i = 0, 2 * step, ...
+
+    parallel_for_each_index(NUM_MERGES, [&pools, step](long const m)
       {
-        // Found
-        std::copy(it->second.begin(), it->second.end(), std::back_inserter(find_it->second));
-      }
-    }
+        long const i = 2 * step * m;
+        pools[i] = merge_pool_varmaps(std::move(pools[i]), std::move(pools[i + step]));
+        pools[i + step] = PoolVarMap();
+      });
   }
+
+  pool_varmap = std::move(pools[0]);
 }
 
 
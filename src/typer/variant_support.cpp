@@ -9,6 +9,23 @@ namespace gyper
 {
 
 
+void
+VariantSupport::add_unique_position(uint32_t const pos)
+{
+  if (static_cast<std::size_t>(num_unique_positions) == unique_positions.size())
+    return; // Already have enough positions
+
+  for (long i{0}; i < num_unique_positions; ++i)
+  {
+    if (unique_positions[i] == pos)
+      return;
+  }
+
+  unique_positions[num_unique_positions] = pos;
+  ++num_unique_positions;
+}
+
+
 void
 VariantSupport::set_depth(uint16_t const _depth)
 {
@@ -69,14 +86,14 @@ bool
 VariantSupport::is_support_above_cutoff(long const min_support) const
 {
   int const _depth = hq_support + lq_support;
-  bool const is_promising = unique_positions.size() >= 3 &&
+  bool const is_promising = num_unique_positions >= 3 &&
                             hq_support >= 4 &&
                             proper_pairs >= 3 &&
                             (_depth - clipped >= 3);
 
   Options const & copts = *(Options::const_instance());
 
-  return (copts.no_filter_on_begin_pos || unique_positions.size() > 1)
+  return (copts.no_filter_on_begin_pos || num_unique_positions > 1)
          &&
          (!copts.filter_on_mapq || is_any_mapq_good)
          &&
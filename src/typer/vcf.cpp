@@ -1,8 +1,15 @@
+#include <algorithm>
 #include <cassert>
+#include <cmath> // std::llround
+#include <cstdlib> // std::strtol, std::strtof
+#include <cstring>
 #include <fstream>
 #include <iostream>
+#include <limits> // std::numeric_limits
+#include <map>
 #include <sstream>
 #include <unordered_map>
+#include <unordered_set>
 
 #include <boost/algorithm/string/predicate.hpp> // boost::algorithm::ends_with
 #include <boost/log/trivial.hpp>
@@ -17,12 +24,15 @@
 #include <graphtyper/graph/reference_depth.hpp>
 #include <graphtyper/graph/var_record.hpp>
 #include <graphtyper/typer/vcf.hpp>
+#include <graphtyper/typer/vcf_batch.hpp>
 #include <graphtyper/utilities/graph_help_functions.hpp>
 #include <graphtyper/utilities/options.hpp> // gyper::options::instance()
 #include <graphtyper/utilities/type_conversions.hpp>
 
 #include <paw/align.hpp>
 
+#include <htslib/vcf.h>
+
 #include "tbx.h"
 
 namespace
@@ -158,6 +168,443 @@ get_genotype_phred(gyper::HapSample const & sample,
 }
 
 
+// A range of characters inside a line which has been read
+struct Token
+{
+  char const * begin{nullptr};
+  char const * end{nullptr};
+
+  std::size_t
+  size() const
+  {
+    return end - begin;
+  }
+
+
+  bool
+  equals(char const * str) const
+  {
+    std::size_t const len = std::strlen(str);
+    return size() == len && std::memcmp(begin, str, len) == 0;
+  }
+
+
+  std::string
+  to_string() const
+  {
+    return std::string(begin, end);
+  }
+
+
+};
+
+
+// Returns the characters before the next delimiter and moves 'it' past the delimiter. If there is no delimiter the
+// rest of the range is returned, so the last token of a range is the one which ends at the range end
+inline Token
+next_token(char const *& it, char const * const end, char const delim)
+{
+  Token token;
+  token.begin = it;
+  token.end = static_cast<char const *>(std::memchr(it, delim, end - it));
+
+  if (token.end)
+  {
+    it = token.end + 1;
+  }
+  else
+  {
+    token.end = end;
+    it = end;
+  }
+
+  return token;
+}
+
+
+// Parses an unsigned integer without creating a string, parsing stops at the first character which is not a digit
+template <typename TUint>
+inline TUint
+parse_uint(Token const & token)
+{
+  unsigned long val{0};
+
+  for (char const * c = token.begin; c != token.end && *c >= '0' && *c <= '9'; ++c)
+    val = val * 10ul + static_cast<unsigned long>(*c - '0');
+
+  return static_cast<TUint>(val);
+}
+
+
+// Parses a comma separated list of unsigned integers and appends them to 'values'
+template <typename TUint>
+inline void
+parse_uint_list(Token const & token, std::vector<TUint> & values)
+{
+  values.reserve(values.size() + std::count(token.begin, token.end, ',') + 1);
+  char const * it = token.begin;
+
+  while (true)
+  {
+    Token const value = next_token(it, token.end, ',');
+    values.push_back(parse_uint<TUint>(value));
+
+    if (value.end == token.end)
+      break;
+  }
+}
+
+
+// FORMAT fields which are parsed
+enum FormatField
+{
+  FORMAT_OTHER,
+  FORMAT_AD,
+  FORMAT_GT,
+  FORMAT_PL,
+  FORMAT_MD,
+  FORMAT_RA,
+  FORMAT_PP,
+  FORMAT_FT
+};
+
+
+FormatField
+get_format_field(Token const & field)
+{
+  if (field.equals("AD"))
+    return FORMAT_AD;
+  else if (field.equals("GT"))
+    return FORMAT_GT;
+  else if (field.equals("PL"))
+    return FORMAT_PL;
+  else if (field.equals("MD"))
+    return FORMAT_MD;
+  else if (field.equals("RA"))
+    return FORMAT_RA;
+  else if (field.equals("PP"))
+    return FORMAT_PP;
+  else if (field.equals("FT"))
+    return FORMAT_FT;
+
+  return FORMAT_OTHER;
+}
+
+
+// Parses the graphtyper variant ID suffix, which is within square brackets in the ID
+std::string
+parse_suffix_id(Token const & id)
+{
+  char const * start_it = std::find(id.begin, id.end, '[');
+
+  if (start_it != id.end)
+  {
+    char const * end_it = std::find(start_it + 1, id.end, ']');
+
+    if (end_it != id.end)
+      return std::string(start_it + 1, end_it);
+  }
+
+  return std::string();
+}
+
+
+// INFO fields kept as strings when reading records
+std::unordered_set<std::string> const &
+get_info_keys_to_parse()
+{
+  static std::unordered_set<std::string> const keys_to_parse(
+    {
+//      "AC",
+      "END",
+      "HOMSEQ"
+//      "INV3", "INV5",
+      "LEFT_SVINSSEQ",
+      "NCLUSTERS", "NUM_MERGED_SVS",
+      "OLD_VARIANT_ID", "OREND", "ORSTART",
+      "PS",
+      "RELATED_SV_ID", "RIGHT_SVINSSEQ",
+      "SVLEN", "SVTYPE", "SVSIZE", "SVMODEL", "SEQ", "SVINSSEQ", "SV_ID"
+    }
+    );
+
+  return keys_to_parse;
+}
+
+
+bool
+is_stat_info(std::string const & key)
+{
+  return key == "CR" || key == "MQsquared" || key == "SBF" || key == "SBR" ||
+         key == "SBF1" || key == "SBF2" || key == "SBR1" || key == "SBR2";
+}
+
+
+bool
+is_info_parsed(std::string const & key)
+{
+  return is_stat_info(key) || get_info_keys_to_parse().count(key) == 1;
+}
+
+
+// Parses a single INFO field of a record
+void
+parse_info(gyper::Variant & new_var, std::string const & key, Token const & value, bool const has_value)
+{
+  // Statistics from GraphTyper are parsed directly to numbers
+  if (key == "CR")
+  {
+    new_var.stats.has_clipped_reads = true;
+    new_var.stats.clipped_reads = parse_uint<uint32_t>(value);
+  }
+  else if (key == "MQsquared")
+  {
+    new_var.stats.has_mapq_squared = true;
+    new_var.stats.mapq_squared = parse_uint<uint64_t>(value);
+  }
+  else if (key == "SBF")
+  {
+    new_var.stats.has_strand_bias = true;
+    parse_uint_list(value, new_var.stats.sbf);
+  }
+  else if (key == "SBR")
+  {
+    new_var.stats.has_strand_bias = true;
+    parse_uint_list(value, new_var.stats.sbr);
+  }
+  else if (key == "SBF1")
+  {
+    new_var.stats.has_strand_bias = true;
+    parse_uint_list(value, new_var.stats.sbf1);
+  }
+  else if (key == "SBF2")
+  {
+    new_var.stats.has_strand_bias = true;
+    parse_uint_list(value, new_var.stats.sbf2);
+  }
+  else if (key == "SBR1")
+  {
+    new_var.stats.has_strand_bias = true;
+    parse_uint_list(value, new_var.stats.sbr1);
+  }
+  else if (key == "SBR2")
+  {
+    new_var.stats.has_strand_bias = true;
+    parse_uint_list(value, new_var.stats.sbr2);
+  }
+  else if (get_info_keys_to_parse().count(key) == 1)
+  {
+    if (!has_value)
+      new_var.infos[key] = "";
+    else
+      new_var.infos[key] = value.to_string();
+  }
+}
+
+
+// Returns the names of the filters a record fails, empty if it passes all filters
+std::vector<char const *>
+get_record_filters(gyper::Variant const & var, uint64_t const variant_qual)
+{
+  std::vector<char const *> filters;
+
+  if (var.infos.count("ABHet") == 1 &&
+      var.infos.at("ABHet") != std::string("-1") &&
+      std::stod(var.infos.at("ABHet")) < 0.175)
+  {
+    filters.push_back("LowABHet");
+  }
+
+  if (var.infos.count("ABHom") == 1 &&
+      var.infos.at("ABHom") != std::string("-1") &&
+      std::stod(var.infos.at("ABHom")) < 0.85)
+  {
+    filters.push_back("LowABHom");
+  }
+
+  if (var.infos.count("AN") == 1 && std::stoi(var.infos.at("AN")) >= 6 &&
+      var.infos.count("QD") == 1 && std::stod(var.infos.at("QD")) < 9.0)
+  {
+    filters.push_back("LowQD");
+  }
+
+  if (variant_qual < 10)
+    filters.push_back("LowQUAL");
+
+  // Only filter on PASS_ratio if we have sufficient amount of samples
+  if (var.infos.count("AN") == 1 && std::stoi(var.infos.at("AN")) >= 500 &&
+      var.infos.count("PASS_ratio") == 1 && std::stod(var.infos.at("PASS_ratio")) < 0.05
+      )
+  {
+    filters.push_back("LowPratio");
+  }
+
+  return filters;
+}
+
+bool
+is_bcf_info_in_header(bcf_hdr_t const * hdr, std::string const & key)
+{
+  int const info_id = bcf_hdr_id2int(hdr, BCF_DT_ID, key.c_str());
+  return info_id >= 0 && bcf_hdr_idinfo_exists(hdr, BCF_HL_INFO, info_id);
+}
+
+
+// Declares the INFO fields of the variants which are not in the BCF header. Fields which never have a value are flags,
+// like in the text output, and other fields are strings so their values are kept as they are.
+void
+add_missing_bcf_infos(bcf_hdr_t * hdr, std::vector<gyper::Variant> const & variants)
+{
+  std::map<std::string, bool> missing_infos; // Key and whether any of its values is not empty
+
+  for (auto const & var : variants)
+  {
+    for (auto const & info : var.infos)
+    {
+      if (!is_bcf_info_in_header(hdr, info.first))
+        missing_infos[info.first] |= info.second.size() > 0;
+    }
+  }
+
+  if (missing_infos.empty())
+    return;
+
+  for (auto const & info : missing_infos)
+  {
+    std::ostringstream ss;
+    ss << "##INFO=<ID=" << info.first << (info.second ? ",Number=.,Type=String" : ",Number=0,Type=Flag")
+       << ",Description=\"INFO field of an input VCF.\">";
+
+    if (bcf_hdr_append(hdr, ss.str().c_str()) < 0)
+    {
+      BOOST_LOG_TRIVIAL(error) << __HERE__ << " Could not add INFO field " << info.first << " to the BCF header.";
+      std::exit(1);
+    }
+  }
+
+  if (bcf_hdr_sync(hdr) < 0)
+  {
+    BOOST_LOG_TRIVIAL(error) << __HERE__ << " Could not update the BCF header.";
+    std::exit(1);
+  }
+}
+
+
+// Adds an INFO field to a BCF record. The value is converted to the type of the INFO field in the header
+void
+update_bcf_info(bcf_hdr_t * hdr, bcf1_t * rec, std::string const & key, std::string const & value)
+{
+  int const info_id = bcf_hdr_id2int(hdr, BCF_DT_ID, key.c_str());
+
+  // The text output keeps every INFO field, so the BCF output must not lose any
+  if (info_id < 0 || !bcf_hdr_idinfo_exists(hdr, BCF_HL_INFO, info_id))
+  {
+    BOOST_LOG_TRIVIAL(error) << __HERE__ << " INFO field " << key << " is not in the BCF header. It is only declared "
+                             << "for the variants the file has when its header is written, use VCF output instead.";
+    std::exit(1);
+  }
+
+  int ret{0};
+
+  switch (bcf_hdr_id2type(hdr, BCF_HL_INFO, info_id))
+  {
+  case BCF_HT_FLAG:
+    ret = bcf_update_info_flag(hdr, rec, key.c_str(), nullptr, 1);
+    break;
+
+  case BCF_HT_INT:
+  {
+    std::vector<int32_t> values;
+    char const * it = value.c_str();
+
+    while (true)
+    {
+      char * end = const_cast<char *>(it);
+
+      if (*it == '.')
+        values.push_back(bcf_int32_missing);
+      else
+        values.push_back(static_cast<int32_t>(std::strtol(it, &end, 10)));
+
+      it = std::strchr(end, ',');
+
+      if (!it)
+        break;
+
+      ++it;
+    }
+
+    ret = bcf_update_info_int32(hdr, rec, key.c_str(), values.data(), values.size());
+    break;
+  }
+
+  case BCF_HT_REAL:
+  {
+    std::vector<float> values;
+    char const * it = value.c_str();
+
+    while (true)
+    {
+      char * end = const_cast<char *>(it);
+      values.push_back(0.0);
+
+      if (*it == '.')
+        bcf_float_set_missing(values.back());
+      else
+        values.back() = std::strtof(it, &end);
+
+      it = std::strchr(end, ',');
+
+      if (!it)
+        break;
+
+      ++it;
+    }
+
+    ret = bcf_update_info_float(hdr, rec, key.c_str(), values.data(), values.size());
+    break;
+  }
+
+  default:
+    ret = bcf_update_info_string(hdr, rec, key.c_str(), value.c_str());
+    break;
+  }
+
+  if (ret < 0)
+  {
+    BOOST_LOG_TRIVIAL(error) << __HERE__ << " Failed adding INFO field " << key << "=" << value << " to a BCF record.";
+    std::exit(1);
+  }
+}
+
+
+// Adds an INFO field with unsigned integers to a BCF record. BCF integers are 32-bit, so larger values are an error.
+template <typename TUint>
+void
+update_bcf_info_uint(bcf_hdr_t * hdr, bcf1_t * rec, char const * key, std::vector<TUint> const & values)
+{
+  std::vector<int32_t> bcf_values(values.size());
+
+  for (long i = 0; i < static_cast<long>(values.size()); ++i)
+  {
+    if (static_cast<uint64_t>(values[i]) > static_cast<uint64_t>(INT32_MAX))
+    {
+      BOOST_LOG_TRIVIAL(error) << __HERE__ << " The value " << values[i] << " of INFO field " << key
+                               << " is too large for a BCF integer.";
+      std::exit(1);
+    }
+
+    bcf_values[i] = static_cast<int32_t>(values[i]);
+  }
+
+  if (bcf_update_info_int32(hdr, rec, key, bcf_values.data(), bcf_values.size()) < 0)
+  {
+    BOOST_LOG_TRIVIAL(error) << __HERE__ << " Failed adding INFO field " << key << " to a BCF record.";
+    std::exit(1);
+  }
+}
+
+
 } // anon namespace
 
 
@@ -173,6 +620,12 @@ Vcf::Vcf(VCF_FILE_MODE const _filemode, std::string const & _filename)
 }
 
 
+Vcf::~Vcf()
+{
+  close_vcf_file();
+}
+
+
 void
 Vcf::open(VCF_FILE_MODE const _filemode, std::string const & _filename)
 {
@@ -188,6 +641,8 @@ Vcf::set_filemode(VCF_FILE_MODE const _filemode)
   {
     if (boost::algorithm::ends_with(filename, ".vcf.gz"))
       filemode = READ_BGZF_MODE;
+    else if (boost::algorithm::ends_with(filename, ".bcf"))
+      filemode = READ_BCF_MODE;
     else
       filemode = READ_UNCOMPRESSED_MODE;
   }
@@ -195,6 +650,8 @@ Vcf::set_filemode(VCF_FILE_MODE const _filemode)
   {
     if (boost::algorithm::ends_with(filename, ".vcf.gz"))
       filemode = WRITE_BGZF_MODE;
+    else if (boost::algorithm::ends_with(filename, ".bcf"))
+      filemode = WRITE_BCF_MODE;
     else
       filemode = WRITE_UNCOMPRESSED_MODE;
   }
@@ -205,6 +662,20 @@ Vcf::set_filemode(VCF_FILE_MODE const _filemode)
 }
 
 
+bool
+Vcf::is_bcf() const
+{
+  return filemode == READ_BCF_MODE || filemode == WRITE_BCF_MODE;
+}
+
+
+bool
+Vcf::is_open_for_reading() const
+{
+  return bgzf_in.is_open() || (bcf_fp && filemode == READ_BCF_MODE);
+}
+
+
 /******************
  * CLASS MODIFERS *
  ******************/
@@ -221,9 +692,9 @@ Vcf::open_vcf_file_for_reading()
     break;
 
   case READ_BGZF_MODE:
-    bgzf_in.open(filename.c_str());
+    bgzf_in.open(filename);
 
-    if (!bgzf_in.rdbuf()->is_open())
+    if (!bgzf_in.is_open())
     {
       BOOST_LOG_TRIVIAL(error) << "Could not open " << filename;
       std::exit(1);
@@ -231,6 +702,18 @@ Vcf::open_vcf_file_for_reading()
 
     break;
 
+  case READ_BCF_MODE:
+    bcf_fp = hts_open(filename.c_str(), "rb");
+
+    if (!bcf_fp)
+    {
+      BOOST_LOG_TRIVIAL(error) << "Could not open " << filename;
+      std::exit(1);
+    }
+
+    bcf_record = bcf_init();
+    break;
+
   default:
     BOOST_LOG_TRIVIAL(error) << "Trying to read in writing mode.";
     std::exit(1);
@@ -241,256 +724,255 @@ Vcf::open_vcf_file_for_reading()
 bool
 Vcf::read_record(bool const SITES_ONLY)
 {
-  std::string line;
+  if (bcf_fp)
+    return read_bcf_record(SITES_ONLY);
 
-  if (!std::getline(bgzf_in, line))
-    return false;
+  char const * line_begin;
+  char const * line_end;
 
-  // Get all positions of TABs in the line
-  std::vector<std::size_t> const tabs = get_all_pos(line, '\t');
-  // We ignore the following fields: qual (5), filter (6), info (7)
+  if (!bgzf_in.read_line(line_begin, line_end))
+    return false;
 
-  std::string const chrom = get_string_at_tab_index(line, tabs, 0);
-  uint32_t const pos = static_cast<uint32_t>(std::stoul(get_string_at_tab_index(line, tabs, 1)));
-  std::string const id = get_string_at_tab_index(line, tabs, 2);
-  std::string const ref = get_string_at_tab_index(line, tabs, 3);
-  std::string const alts = get_string_at_tab_index(line, tabs, 4);
-  std::vector<std::size_t> const alt_commas = get_all_pos(alts, ',');
+  char const * it = line_begin;
+  Token const chrom = next_token(it, line_end, '\t');
+  uint32_t const pos = parse_uint<uint32_t>(next_token(it, line_end, '\t'));
+  Token const id = next_token(it, line_end, '\t');
+  Token const ref = next_token(it, line_end, '\t');
+  Token const alts = next_token(it, line_end, '\t');
+  next_token(it, line_end, '\t'); // qual
+  next_token(it, line_end, '\t'); // filter
+  Token const info = next_token(it, line_end, '\t');
 
   Variant new_var; // Create a new variant for this position
-  new_var.abs_pos = absolute_pos.get_absolute_position(chrom, pos); // Parse positions
+  new_var.abs_pos = absolute_pos.get_absolute_position(chrom.to_string(), pos); // Parse positions
 
   // Check for graphtyper variant ID suffix
+  new_var.suffix_id = parse_suffix_id(id);
+
+  // Parse sequences
+  new_var.seqs.push_back(std::vector<char>(ref.begin, ref.end));
+
   {
-    auto start_it = std::find(id.begin(), id.end(), '[');
+    char const * alt_it = alts.begin;
 
-    if (start_it != id.end())
+    while (true)
     {
-      auto end_it = std::find(start_it + 1, id.end(), ']');
+      Token const alt = next_token(alt_it, alts.end, ',');
+      new_var.seqs.push_back(std::vector<char>(alt.begin, alt.end));
 
-      if (end_it != id.end())
-      {
-        new_var.suffix_id = std::string(start_it + 1, end_it);
-      }
+      if (alt.end == alts.end)
+        break;
     }
   }
 
-  // Parse sequences
-  new_var.seqs.push_back(gyper::to_vec(std::string(ref)));
-  assert(alt_commas.size() >= 2);
-
-  for (int a = 0; a < static_cast<int>(alt_commas.size()) - 1; ++a)
-    new_var.seqs.push_back(gyper::to_vec(get_string_at_tab_index(alts, alt_commas, a)));
-
   // Parse infos
+  // Don't parse anything if the INFO field is empty
+  if (info.size() > 0)
   {
-    std::string const info = get_string_at_tab_index(line, tabs, 7);
+    std::string key; // Reused for every key to avoid allocations
+    char const * info_it = info.begin;
 
-    // Don't parse anything if the INFO field is empty
-    if (info.size() > 0)
+    while (true)
     {
-      std::vector<std::size_t> const info_semicolons = get_all_pos(info, ';');
+      Token const key_value = next_token(info_it, info.end, ';');
+      char const * eq_it = std::find(key_value.begin, key_value.end, '=');
+      key.assign(key_value.begin, eq_it);
+      Token value;
+      value.begin = eq_it == key_value.end ? eq_it : eq_it + 1;
+      value.end = key_value.end;
+      parse_info(new_var, key, value, eq_it != key_value.end);
+
+      if (key_value.end == info.end)
+        break;
+    }
+  }
 
-      std::unordered_set<std::string> const keys_to_parse(
-        {
-//          "AC",
-          "CR",
-          "END",
-          "HOMSEQ"
-//          "INV3", "INV5",
-          "LEFT_SVINSSEQ",
-          "NCLUSTERS", "NUM_MERGED_SVS",
-          "MQsquared",
-          "OLD_VARIANT_ID", "OREND", "ORSTART",
-          "PS",
-          "RELATED_SV_ID", "RIGHT_SVINSSEQ",
-          "SBF", "SBF1", "SBF2",
-          "SBR", "SBR1", "SBR2",
-          "SVLEN", "SVTYPE", "SVSIZE", "SVMODEL", "SEQ", "SVINSSEQ", "SV_ID"
-        }
-        );
+  // The calls are decoded when they are needed
+  has_undecoded_calls = sample_names.size() > 0;
+  undecoded_calls_begin = it;
+  undecoded_calls_end = line_end;
+  variants.push_back(std::move(new_var));
 
-      for (int s = 0; s < static_cast<int>(info_semicolons.size()) - 1; ++s)
-      {
-        std::string const info_key_value = get_string_at_tab_index(info, info_semicolons, s);
-        auto eq_it = std::find(info_key_value.begin(), info_key_value.end(), '=');
+  if (!SITES_ONLY)
+    decode_calls();
 
-        if (eq_it == info_key_value.end())
-        {
-          if (keys_to_parse.count(info_key_value) == 1)
-            new_var.infos[info_key_value] = "";
+  return true;
+}
 
-          continue;
-        }
 
-        std::string const key(info_key_value.begin(), eq_it);
+void
+Vcf::decode_calls()
+{
+  if (!has_undecoded_calls)
+    return;
+
+  assert(variants.size() > 0);
+  has_undecoded_calls = false;
+
+  if (bcf_fp)
+    decode_bcf_calls(variants.back());
+  else
+    decode_text_calls(variants.back());
+}
 
-        if (keys_to_parse.count(key) == 1)
-          new_var.infos[key] = std::string(eq_it + 1, info_key_value.end());
-      }
-    }
-  }
 
-  // Parse samples, if any
-  if (!SITES_ONLY && sample_names.size() > 0)
+void
+Vcf::decode_text_calls(Variant & new_var)
+{
+  char const * it = undecoded_calls_begin;
+  char const * const line_end = undecoded_calls_end;
+  Token const format = next_token(it, line_end, '\t');
+  std::vector<FormatField> format_fields;
+
   {
-    std::string const format = get_string_at_tab_index(line, tabs, 8);
-    std::vector<std::size_t> all_format_colon = get_all_pos(format, ':');
-    int ad_field = -1;
-    int gt_field = -1;
-    int pl_field = -1;
-    int md_field = -1;
-    int ra_field = -1;
-    int pp_field = -1;
-    int ft_field = -1;
+    char const * format_it = format.begin;
 
-    for (int32_t f = 0; f < static_cast<int>(all_format_colon.size() - 1); ++f)
+    while (true)
     {
-      std::string const field = get_string_at_tab_index(format, all_format_colon, f);
-
-      if (field == "AD")
-        ad_field = f;
-      else if (field == "GT")
-        gt_field = f;
-      else if (field == "PL")
-        pl_field = f;
-      else if (field == "MD")
-        md_field = f;
-      else if (field == "RA")
-        ra_field = f;
-      else if (field == "PP")
-        pp_field = f;
-      else if (field == "FT")
-        ft_field = f;
-    }
+      Token const field = next_token(format_it, format.end, ':');
+      format_fields.push_back(get_format_field(field));
 
-    assert(ad_field != -1);
-    assert(gt_field != -1);
-    assert(pl_field != -1);
-    int constexpr FIELD_OFFSET = 9;
+      if (field.end == format.end)
+        break;
+    }
+  }
 
-    for (int i = FIELD_OFFSET; i < static_cast<int>(sample_names.size()) + FIELD_OFFSET; ++i)
-    {
-      // Create a new sample call
-      SampleCall new_call;
+  assert(std::count(format_fields.begin(), format_fields.end(), FORMAT_AD) == 1);
+  assert(std::count(format_fields.begin(), format_fields.end(), FORMAT_GT) == 1);
+  assert(std::count(format_fields.begin(), format_fields.end(), FORMAT_PL) == 1);
+  new_var.calls.reserve(sample_names.size());
+  long const n_columns = sample_mask.size() > 0 ? sample_mask.size() : sample_names.size();
 
-      // Parse string of sample i
-      std::string sample_string = get_string_at_tab_index(line, tabs, i);
-      std::vector<std::size_t> sample_string_colon = get_all_pos(sample_string, ':');
+  for (long i = 0; i < n_columns; ++i)
+  {
+    // Parse string of sample i
+    Token const sample = next_token(it, line_end, '\t');
 
-      // Parse GT (for phase)
-      std::string const gt_str = get_string_at_tab_index(sample_string, sample_string_colon, gt_field);
+    if (sample_mask.size() > 0 && !sample_mask[i])
+      continue; // The sample is not in the subset
 
-      // Check if the genotypes are phased
-      /*
-      if (std::find(gt_str.begin(), gt_str.end(), '|') != gt_str.end())
-      {
-        // Check if gt is missing
-        if (gt_str[0] == '.')
-        {
-          new_var.phase.push_back(0);
-        }
-        else
-        {
-          std::vector<std::size_t> gt_str_pos = get_all_pos(gt_str, '|');
-          assert(gt_str_pos.size() == 3);
-          uint8_t call1 = static_cast<uint8_t>(std::stoul(get_string_at_tab_index(gt_str, gt_str_pos, 0)));
-          uint8_t call2 = static_cast<uint8_t>(std::stoul(get_string_at_tab_index(gt_str, gt_str_pos, 1)));
+    // Create a new sample call
+    SampleCall new_call;
+    char const * sample_it = sample.begin;
 
-          if (call1 <= call2)
-            new_var.phase.push_back(0);
-          else
-            new_var.phase.push_back(1);
-        }
-      }
-      */
+    for (auto const format_field : format_fields)
+    {
+      Token const value = next_token(sample_it, sample.end, ':');
 
-      // Parse AD
-      std::string const ad_str = get_string_at_tab_index(sample_string, sample_string_colon, ad_field);
-      std::vector<std::size_t> ad_str_comma = get_all_pos(ad_str, ',');
+      switch (format_field)
+      {
+      case FORMAT_AD:
+        parse_uint_list(value, new_call.coverage);
+        break;
 
-      for (int j = 0; j < static_cast<int>(ad_str_comma.size()) - 1; ++j)
-        new_call.coverage.push_back(static_cast<uint16_t>(std::stoul(get_string_at_tab_index(ad_str, ad_str_comma,
-                                                                                             j))));
+      case FORMAT_PL:
+        parse_uint_list(value, new_call.phred);
+        break;
 
-      // Parse MD
-      if (md_field != -1)
+      case FORMAT_MD:
       {
-        std::string const md_str = get_string_at_tab_index(sample_string, sample_string_colon, md_field);
-        unsigned long const md = std::stoul(md_str);
+        unsigned long const md = parse_uint<unsigned long>(value);
         assert(md <= 0xFFu);
         new_call.ambiguous_depth = static_cast<uint8_t>(md);
+        break;
       }
 
-      // Parse RA
-      if (ra_field != -1)
+      case FORMAT_RA:
       {
-        std::string const ra_str = get_string_at_tab_index(sample_string, sample_string_colon, ra_field);
-        std::vector<std::size_t> ra_str_comma = get_all_pos(ra_str, ',');
-
-        assert(ra_str_comma.size() == 3);
-        new_call.ref_total_depth = static_cast<uint16_t>(std::stoul(get_string_at_tab_index(ra_str, ra_str_comma, 0)));
-        new_call.alt_total_depth = static_cast<uint16_t>(std::stoul(get_string_at_tab_index(ra_str, ra_str_comma, 1)));
+        assert(std::count(value.begin, value.end, ',') == 1);
+        char const * ra_it = value.begin;
+        new_call.ref_total_depth = parse_uint<uint16_t>(next_token(ra_it, value.end, ','));
+        new_call.alt_total_depth = parse_uint<uint16_t>(next_token(ra_it, value.end, ','));
+        break;
       }
 
-      // Parse PP
-      if (pp_field != -1)
-      {
-        std::string const pp_str = get_string_at_tab_index(sample_string, sample_string_colon, pp_field);
-        new_call.alt_proper_pair_depth = static_cast<uint8_t>(std::stoul(std::move(pp_str)));
-      }
+      case FORMAT_PP:
+        new_call.alt_proper_pair_depth = parse_uint<uint8_t>(value);
+        break;
 
-      // Parse FT
-      if (ft_field != -1)
+      case FORMAT_FT:
       {
-        std::string const ft_str = get_string_at_tab_index(sample_string, sample_string_colon, ft_field);
-
-        if (ft_str == "PASS")
+        if (value.equals("PASS"))
         {
           new_call.filter = 0;
         }
         else
         {
-          new_call.filter = static_cast<int8_t>(std::atoi(ft_str.substr(4).c_str()));
+          Token filter_number(value);
+          filter_number.begin += std::min(4ul, value.size());
+          new_call.filter = parse_uint<int8_t>(filter_number);
         }
-      }
 
-      // Parse PL
-      std::string const pl_str = get_string_at_tab_index(sample_string, sample_string_colon, pl_field);
-      std::vector<std::size_t> pl_str_comma = get_all_pos(pl_str, ',');
+        break;
+      }
 
-      for (int j = 0; j < static_cast<int>(pl_str_comma.size()) - 1; ++j)
-        new_call.phred.push_back(static_cast<uint8_t>(std::stoul(get_string_at_tab_index(pl_str, pl_str_comma, j))));
+      default: // GT is not needed, phase is not parsed
+        break;
+      }
 
-      assert(new_call.coverage.size() * (new_call.coverage.size() + 1) / 2 == new_call.phred.size());
-      new_var.calls.push_back(std::move(new_call));
+      if (value.end == sample.end)
+        break;
     }
-  }
 
-  variants.push_back(std::move(new_var));
-  return true;
+    assert(new_call.coverage.size() * (new_call.coverage.size() + 1) / 2 == new_call.phred.size());
+    new_var.calls.push_back(std::move(new_call));
+  }
 }
 
 
 void
 Vcf::read_samples()
 {
-  if (!bgzf_in.rdbuf()->is_open())
+  bool const is_checking_contigs = gyper::graph.contigs.size() == 0ull;
+
+  if (bcf_fp)
+  {
+    assert(sample_names.size() == 0);
+    bcf_hdr = bcf_hdr_read(bcf_fp);
+
+    if (!bcf_hdr)
+    {
+      BOOST_LOG_TRIVIAL(error) << "[vcf] Could not read the BCF header of '" << filename << "'.";
+      std::exit(1);
+    }
+
+    // Read contigs
+    if (is_checking_contigs)
+    {
+      for (int i = 0; i < bcf_hdr->n[BCF_DT_CTG]; ++i)
+      {
+        Contig contig;
+        contig.name = bcf_hdr_id2name(bcf_hdr, i);
+        contig.length = static_cast<uint32_t>(bcf_hdr->id[BCF_DT_CTG][i].val->info[0]);
+        gyper::graph.contigs.push_back(std::move(contig));
+      }
+
+      absolute_pos.calculate_offsets(gyper::graph.contigs);
+    }
+
+    for (int i = 0; i < bcf_hdr_nsamples(bcf_hdr); ++i)
+      sample_names.push_back(bcf_hdr->samples[i]);
+
     return;
+  }
 
-  bool const is_checking_contigs = gyper::graph.contigs.size() == 0ull;
+  if (!bgzf_in.is_open())
+    return;
 
   while (true)
   {
-    std::string line;
+    char const * line_begin;
+    char const * line_end;
 
-    if (!std::getline(bgzf_in, line))
+    if (!bgzf_in.read_line(line_begin, line_end))
     {
       BOOST_LOG_TRIVIAL(error) << "[vcf] Could not find any line with samples in '"
                                << filename << "'.";
       std::exit(1);
     }
 
+    std::string const line(line_begin, line_end); // Header lines are few, so copying them is fine
+
     assert(line.size() > 2);
 
     // Read contigs
@@ -531,6 +1013,69 @@ Vcf::read_samples()
 }
 
 
+void
+Vcf::set_sample_subset(std::vector<std::string> const & subset)
+{
+  std::unordered_set<std::string> const subset_set(subset.begin(), subset.end());
+
+  for (auto const & sample : subset)
+  {
+    if (std::find(sample_names.begin(), sample_names.end(), sample) == sample_names.end())
+    {
+      BOOST_LOG_TRIVIAL(error) << __HERE__ << " Sample " << sample << " is not in " << filename;
+      std::exit(1);
+    }
+  }
+
+  if (bcf_fp)
+  {
+    // htslib removes the other samples from the records when they are read
+    std::string samples_list;
+
+    for (auto const & sample : subset)
+    {
+      if (samples_list.size() > 0)
+        samples_list.push_back(',');
+
+      samples_list.append(sample);
+    }
+
+    // "-" selects all samples
+    if (bcf_hdr_set_samples(bcf_hdr, subset.size() > 0 ? samples_list.c_str() : "-", 0) != 0)
+    {
+      BOOST_LOG_TRIVIAL(error) << __HERE__ << " Could not select samples of " << filename;
+      std::exit(1);
+    }
+
+    sample_names.clear();
+
+    for (int i = 0; i < bcf_hdr_nsamples(bcf_hdr); ++i)
+      sample_names.push_back(bcf_hdr->samples[i]);
+
+    return;
+  }
+
+  if (subset.size() == 0)
+  {
+    sample_mask.clear(); // Read all sample columns
+    return;
+  }
+
+  std::vector<std::string> subset_names;
+  sample_mask.resize(sample_names.size());
+
+  for (long i = 0; i < static_cast<long>(sample_names.size()); ++i)
+  {
+    sample_mask[i] = subset_set.count(sample_names[i]) > 0;
+
+    if (sample_mask[i])
+      subset_names.push_back(sample_names[i]);
+  }
+
+  sample_names = std::move(subset_names);
+}
+
+
 void
 Vcf::read(bool const SITES_ONLY)
 {
@@ -547,8 +1092,10 @@ Vcf::read(bool const SITES_ONLY)
 
 
 void
-Vcf::open_for_writing(long const n_threads)
+Vcf::open_for_writing(long const n_threads, bool const _is_indexing)
 {
+  is_indexing = _is_indexing && filemode != WRITE_UNCOMPRESSED_MODE;
+
   switch (filemode)
   {
   case WRITE_UNCOMPRESSED_MODE:
@@ -559,6 +1106,21 @@ Vcf::open_for_writing(long const n_threads)
     bgzf_stream.open(filename, "wb", n_threads);
     break;
 
+  case WRITE_BCF_MODE:
+    bcf_fp = hts_open(filename.c_str(), "wb");
+
+    if (!bcf_fp)
+    {
+      BOOST_LOG_TRIVIAL(error) << "Could not open " << filename << " for writing.";
+      std::exit(1);
+    }
+
+    if (n_threads > 1)
+      hts_set_threads(bcf_fp, n_threads);
+
+    bcf_record = bcf_init();
+    break;
+
   default:
     BOOST_LOG_TRIVIAL(error) << "Trying to write in reading mode.";
     std::exit(1);
@@ -566,29 +1128,31 @@ Vcf::open_for_writing(long const n_threads)
 }
 
 
-void
-Vcf::write_header()
+std::string
+Vcf::get_header() const
 {
+  std::ostringstream ss;
+
   // Basic info
-  bgzf_stream.ss << "##fileformat=VCFv4.2\n"
-                 << "##fileDate=" << current_date() << "\n"
-                 << "##source=Graphtyper\n"
-                 << "##graphtyperVersion=" << graphtyper_VERSION_MAJOR << "." << graphtyper_VERSION_MINOR;
+  ss << "##fileformat=VCFv4.2\n"
+     << "##fileDate=" << current_date() << "\n"
+     << "##source=Graphtyper\n"
+     << "##graphtyperVersion=" << graphtyper_VERSION_MAJOR << "." << graphtyper_VERSION_MINOR;
 
   if (std::string(GIT_NUM_DIRTY_LINES) != std::string("0"))
-    bgzf_stream.ss << "-dirty";
+    ss << "-dirty";
 
-  bgzf_stream.ss << "\n"
-                 << "##graphtyperGitBranch=" << GIT_BRANCH << '\n'
-                 << "##graphtyperSHA1=" << GIT_COMMIT_LONG_HASH << '\n';
+  ss << "\n"
+     << "##graphtyperGitBranch=" << GIT_BRANCH << '\n'
+     << "##graphtyperSHA1=" << GIT_COMMIT_LONG_HASH << '\n';
 
   // Definitions of contigs
   for (auto const & contig : graph.contigs)
-    bgzf_stream.ss << "##contig=<ID=" << contig.name << ",length=" << contig.length << ">\n";
+    ss << "##contig=<ID=" << contig.name << ",length=" << contig.length << ">\n";
 
   // INFO definitions
   {
-    bgzf_stream.ss
+    ss
       << "##INFO=<ID=ABHet,Number=1,Type=Float,Description=\"Allele Balance for heterozygous"
        "calls (read count of call2/(call1+call2)) where the called genotype is call1/call2. "
        "-1 if no heterozygous calls.\">\n"
@@ -621,7 +1185,7 @@ Vcf::write_header()
       << "##INFO=<ID=MaxAltPP,Number=1,Type=Integer,Description=\"Maximum number of proper pairs "
        "support the alternative allele.\">\n"
       << "##INFO=<ID=MQ,Number=1,Type=Integer,Description=\"Root-mean-square mapping quality.\">\n"
-      << "##INFO=<ID=MQsquared,Number=1,Type=Integer,Description=\"Sum of squared mapping qualities. "
+      << "##INFO=<ID=MQsquared,Number=1,Type=Float,Description=\"Sum of squared mapping qualities. "
        "Used to calculate MQ.\">\n"
       << "##INFO=<ID=NCLUSTERS,Number=1,Type=Integer,Description=\"Number of SV candidates in "
        "cluster, as reported by popSVar.\">\n"
@@ -684,7 +1248,7 @@ Vcf::write_header()
 
   // FORMAT definitions
   {
-    bgzf_stream.ss
+    ss
       << "##FORMAT=<ID=GT,Number=1,Type=String,Description=\"GenoType call. ./. is called if there is no "
        "coverage at the variant site.\">\n"
       << "##FORMAT=<ID=FT,Number=1,Type=String,Description=\"Filter. PASS or FAILN where N is a number.\">\n"
@@ -701,285 +1265,736 @@ Vcf::write_header()
       << "##FORMAT=<ID=PL,Number=G,Type=Integer,Description=\"PHRED-scaled genotype likelihoods.\">\n";
   }
 
-  // FILTER definitions
-  {
-    bgzf_stream.ss << "##FILTER=<ID=LowABHet,Description=\"Allele balance of heterozygous carriers is below 17.5%.\">\n"
-                   << "##FILTER=<ID=LowABHom,Description=\"Allele balance of homozygous carriers is below 90%.\">\n"
-                   << "##FILTER=<ID=LowQD,Description=\"QD (quality by depth) is below 9.0.\">\n"
-                   << "##FILTER=<ID=LowQUAL,Description=\"QUAL score is less than 10.\">\n"
-                   << "##FILTER=<ID=LowPratio,Description=\"Ratio of PASSed calls was too low.\">\n";
+  // FILTER definitions
+  {
+    ss << "##FILTER=<ID=LowABHet,Description=\"Allele balance of heterozygous carriers is below 17.5%.\">\n"
+       << "##FILTER=<ID=LowABHom,Description=\"Allele balance of homozygous carriers is below 90%.\">\n"
+       << "##FILTER=<ID=LowQD,Description=\"QD (quality by depth) is below 9.0.\">\n"
+       << "##FILTER=<ID=LowQUAL,Description=\"QUAL score is less than 10.\">\n"
+       << "##FILTER=<ID=LowPratio,Description=\"Ratio of PASSed calls was too low.\">\n";
+
+  }
+
+  // Column names
+  ss << "#CHROM\tPOS\tID\tREF\tALT\tQUAL\tFILTER\tINFO";
+
+  if (sample_names.size() > 0)
+  {
+    // Only a "format" column if there are any samples
+    ss << "\tFORMAT";
+
+    for (auto const & sample_name : sample_names)
+      ss << "\t" << sample_name;
+  }
+
+  ss << "\n";
+  return ss.str();
+}
+
+
+void
+Vcf::write_header()
+{
+  if (!bcf_fp)
+  {
+    bgzf_stream << get_header();
+    return;
+  }
+
+  // The BCF header is parsed from the text header so both formats have the same header lines
+  std::string header = get_header();
+  bcf_hdr = bcf_hdr_init("r");
+
+  if (!bcf_hdr || bcf_hdr_parse(bcf_hdr, &header[0]) < 0)
+  {
+    BOOST_LOG_TRIVIAL(error) << __HERE__ << " Failed writing BCF header to " << filename;
+    std::exit(1);
+  }
+
+  add_missing_bcf_infos(bcf_hdr, variants);
+
+  if (bcf_hdr_write(bcf_fp, bcf_hdr) < 0)
+  {
+    BOOST_LOG_TRIVIAL(error) << __HERE__ << " Failed writing BCF header to " << filename;
+    std::exit(1);
+  }
+
+  // htslib indexes BCF records as they are written
+  if (is_indexing && bcf_idx_init(bcf_fp, bcf_hdr, 14, (filename + ".csi").c_str()) < 0)
+  {
+    BOOST_LOG_TRIVIAL(error) << __HERE__ << " Could not create the index of " << filename;
+    std::exit(1);
+  }
+}
+
+
+void
+Vcf::write_record(Variant const & var, std::string const & suffix, bool const FILTER_ZERO_QUAL)
+{
+  // Parse the position
+  auto contig_pos = absolute_pos.get_contig_position(var.abs_pos, gyper::graph.contigs);
+
+  if (is_skipped(var, contig_pos))
+    return;
+
+  // Calculate qual
+  const uint64_t variant_qual = var.get_qual();
+
+  if (FILTER_ZERO_QUAL && (sample_names.size() > 0 && variant_qual == 0))
+  {
+    //BOOST_LOG_TRIVIAL(warning) << "Zero qual variant at pos " << contig_pos.first << ":" << contig_pos.second;
+    BOOST_LOG_TRIVIAL(debug) << "Skipped outputting variant at position "
+                             << contig_pos.first << ":" << contig_pos.second
+                             << " because the variant had zero quality.";
+    return;
+  }
+
+  if (bcf_fp)
+  {
+    std::string id = contig_pos.first + ":" + std::to_string(contig_pos.second) + ":" + var.determine_variant_type();
+
+    if (var.suffix_id.size() > 0)
+      id += "[" + var.suffix_id + "]";
+
+    id += suffix;
+    write_bcf_record(var, contig_pos, id, variant_qual);
+    return;
+  }
+
+  bgzf_stream << contig_pos.first << '\t';
+  bgzf_stream << contig_pos.second << '\t';
+
+  // Write the ID field
+  bgzf_stream << contig_pos.first; // Keep the 'chr'
+
+  bgzf_stream << ':' << contig_pos.second << ':' << var.determine_variant_type();
+
+  if (var.suffix_id.size() > 0)
+    bgzf_stream << "[" << var.suffix_id << "]";
+
+  bgzf_stream << suffix;
+
+  // Parse the sequences
+  assert(var.seqs.size() >= 2);
+  bgzf_stream << '\t';
+  bgzf_stream.write(var.seqs[0].data(), var.seqs[0].size());
+  bgzf_stream << '\t';
+  bgzf_stream.write(var.seqs[1].data(), var.seqs[1].size());
+
+  // Print other allele sequences if it is multi-allelic marker
+  for (long a = 2; a < static_cast<long>(var.seqs.size()); ++a)
+  {
+    bgzf_stream << ',';
+    bgzf_stream.write(var.seqs[a].data(), var.seqs[a].size());
+  }
+
+  // Parse qual
+  bgzf_stream << "\t" << variant_qual << "\t";
+
+  // Parse filter
+  if (sample_names.size() == 0 || Options::const_instance()->ploidy > 2)
+  {
+    bgzf_stream << ".\t";
+  }
+  else
+  {
+    std::vector<char const *> const filters = get_record_filters(var, variant_qual);
+
+    if (filters.empty())
+    {
+      bgzf_stream << "PASS";
+    }
+    else
+    {
+      bgzf_stream << filters[0];
+
+      for (long f = 1; f < static_cast<long>(filters.size()); ++f)
+        bgzf_stream << ';' << filters[f];
+    }
+
+    bgzf_stream << "\t";
+  }
+
+
+  // Parse info
+  if (var.infos.empty() && var.stats.empty())
+  {
+    bgzf_stream << ".";
+  }
+  else
+  {
+    // The typed statistics are written among the other INFO fields so the keys stay in alphabetical order
+    std::vector<std::pair<char const *, std::string> > const stat_infos = var.stats.get_infos();
+    auto stat_it = stat_infos.cbegin();
+    bool is_first{true};
+
+    auto write_info = [&](char const * key, std::string const & value)
+                      {
+                        if (!is_first)
+                          bgzf_stream << ';';
+
+                        is_first = false;
+                        bgzf_stream << key;
+
+                        if (value.size() > 0)
+                          bgzf_stream << '=' << value;
+                      };
+
+    for (auto map_it = var.infos.cbegin(); map_it != var.infos.cend(); ++map_it)
+    {
+      for (; stat_it != stat_infos.cend() && map_it->first.compare(stat_it->first) > 0; ++stat_it)
+        write_info(stat_it->first, stat_it->second);
+
+      write_info(map_it->first.c_str(), map_it->second);
+    }
+
+    for (; stat_it != stat_infos.cend(); ++stat_it)
+      write_info(stat_it->first, stat_it->second);
+  }
+
+  assert(sample_names.size() == var.calls.size());
+  bool const is_sv = var.is_sv();
+
+  // Parse FORMAT
+  if (var.calls.size() > 0)
+  {
+    if (is_sv)
+      bgzf_stream << "\tGT:FT:AD:MD:DP:RA:PP:GQ:PL";
+    else
+      bgzf_stream << "\tGT:AD:MD:DP:GQ:PL";
+  }
+
+  for (long i = 0; i < static_cast<long>(var.calls.size()); ++i)
+  {
+    auto const & call = var.calls[i];
+
+    // Write GT
+    auto pl_non_zero = [](uint8_t const pl) -> bool
+                       {
+                         return pl != 0;
+                       };
+
+    if (std::find_if(call.phred.begin(), call.phred.end(), pl_non_zero) == call.phred.end())
+    {
+      bgzf_stream << "\t./.";
+    }
+    else
+    {
+      std::pair<uint16_t, uint16_t> const gt_call = call.get_gt_call();
+      bgzf_stream << "\t" << gt_call.first << "/" << gt_call.second;
+    }
+
+    // Write FT
+    long const gq = call.get_gq();
+
+    if (is_sv)
+    {
+      bgzf_stream << ":";
+      long filter = call.check_filter(gq);
+
+      if (filter == 0)
+      {
+        bgzf_stream << "PASS";
+      }
+      else
+      {
+        assert(filter > 0);
+        bgzf_stream << "FAIL" << filter;
+      }
+    }
+
+    // Write AD
+    assert(call.coverage.size() > 0);
+    bgzf_stream << ":" << call.coverage[0];
+
+    for (auto ad_it = call.coverage.begin() + 1; ad_it != call.coverage.end(); ++ad_it)
+      bgzf_stream << "," << *ad_it;
+
+    // Write MD (Multi-depth)
+    bgzf_stream << ":" << static_cast<uint64_t>(call.ambiguous_depth);
+
+    // Write DP
+    bgzf_stream << ":" << call.get_depth();
+
+    // Write RA
+    if (is_sv)
+    {
+      bgzf_stream << ":" << call.ref_total_depth << "," << call.alt_total_depth;
+    }
+
+    // Write PP
+    if (is_sv)
+    {
+      bgzf_stream << ':' << static_cast<std::size_t>(call.alt_proper_pair_depth);
+    }
+
+    // Write GQ
+    bgzf_stream << ':' << std::min(99l, gq);
+
+    // Write PL
+    bgzf_stream << ':';
+    bgzf_stream.write_phred(call.phred);
+  }
+
+  // Fin.
+  bgzf_stream << '\n';
+  bgzf_stream.check_cache();
+}
+
+
+bool
+Vcf::read_bcf_record(bool const SITES_ONLY)
+{
+  int const ret = bcf_read(bcf_fp, bcf_hdr, bcf_record);
+
+  if (ret == -1)
+    return false; // No more records
+
+  if (ret < -1)
+  {
+    BOOST_LOG_TRIVIAL(error) << __HERE__ << " Failed reading a record from " << filename;
+    std::exit(1);
+  }
+
+  bcf_unpack(bcf_record, BCF_UN_INFO); // The FORMAT fields are unpacked when the calls are decoded
+
+  Variant new_var; // Create a new variant for this position
+  new_var.abs_pos = absolute_pos.get_absolute_position(bcf_hdr_id2name(bcf_hdr, bcf_record->rid),
+                                                       static_cast<uint32_t>(bcf_record->pos + 1));
+
+  // Check for graphtyper variant ID suffix
+  {
+    Token id;
+    id.begin = bcf_record->d.id;
+    id.end = id.begin + std::strlen(id.begin);
+    new_var.suffix_id = parse_suffix_id(id);
+  }
+
+  // Parse sequences
+  for (int a = 0; a < bcf_record->n_allele; ++a)
+  {
+    char const * allele = bcf_record->d.allele[a];
+    new_var.seqs.push_back(std::vector<char>(allele, allele + std::strlen(allele)));
+  }
+
+  // Parse infos. The values are formatted as in VCF text so the same INFO parsing is used for both formats
+  {
+    std::string key;
+
+    for (int i = 0; i < static_cast<int>(bcf_record->n_info); ++i)
+    {
+      bcf_info_t const & info = bcf_record->d.info[i];
+
+      if (!info.vptr)
+        continue; // The INFO field has been removed
+
+      key = bcf_hdr_int2id(bcf_hdr, BCF_DT_ID, info.key);
+
+      if (!is_info_parsed(key))
+        continue;
+
+      // Formatting a Float would round it to a few digits
+      if (key == "MQsquared" && info.type == BCF_BT_FLOAT && info.len == 1)
+      {
+        new_var.stats.has_mapq_squared = true;
+        new_var.stats.mapq_squared = static_cast<uint64_t>(std::llround(info.v1.f));
+        continue;
+      }
+
+      bcf_str.l = 0;
+
+      if (info.len > 0)
+        bcf_fmt_array(&bcf_str, info.len, info.type, info.vptr);
 
+      Token value;
+      value.begin = bcf_str.s;
+      value.end = bcf_str.s + bcf_str.l;
+      parse_info(new_var, key, value, info.len > 0);
+    }
   }
 
-  // Column names
-  bgzf_stream.ss << "#CHROM\tPOS\tID\tREF\tALT\tQUAL\tFILTER\tINFO";
-
-  if (sample_names.size() > 0)
-  {
-    // Only a "format" column if there are any samples
-    bgzf_stream.ss << "\tFORMAT";
+  has_undecoded_calls = sample_names.size() > 0;
+  variants.push_back(std::move(new_var));
 
-    for (auto const & sample_name : sample_names)
-      bgzf_stream.ss << "\t" << sample_name;
-  }
+  if (!SITES_ONLY)
+    decode_calls();
 
-  bgzf_stream.ss << "\n";
+  return true;
 }
 
 
 void
-Vcf::write_record(Variant const & var, std::string const & suffix, bool const FILTER_ZERO_QUAL)
+Vcf::decode_bcf_calls(Variant & new_var)
 {
-  // Parse the position
-  auto contig_pos = absolute_pos.get_contig_position(var.abs_pos, gyper::graph.contigs);
-
-  if (!Options::instance()->output_all_variants && var.calls.size() > 0 && var.seqs.size() > 100)
+  bcf_unpack(bcf_record, BCF_UN_ALL);
+  long const n_samples = sample_names.size();
+  new_var.calls.resize(n_samples);
+
+  // Reads an integer FORMAT field and returns the number of values per sample, or zero if the field is missing
+  auto read_format = [&](char const * tag) -> long
+                     {
+                       int const n = bcf_get_format_int32(bcf_hdr,
+                                                          bcf_record,
+                                                          tag,
+                                                          &bcf_read_values,
+                                                          &bcf_read_values_size);
+                       return n > 0 ? n / n_samples : 0;
+                     };
+
+  auto is_value = [](int32_t const val) -> bool
+                  {
+                    return val != bcf_int32_missing && val != bcf_int32_vector_end;
+                  };
+
+  long width = read_format("AD");
+
+  for (long i = 0; i < n_samples; ++i)
   {
-    BOOST_LOG_TRIVIAL(info) << "Skipped outputting variant at position "
-                            << contig_pos.first << ":" << contig_pos.second
-                            << " because there are " << var.seqs.size() << " alleles.";
-    return;
+    int32_t const * values = bcf_read_values + i * width;
+
+    for (long k = 0; k < width && is_value(values[k]); ++k)
+      new_var.calls[i].coverage.push_back(static_cast<uint16_t>(values[k]));
   }
 
-  if (!Options::instance()->output_all_variants)
+  width = read_format("PL");
+
+  for (long i = 0; i < n_samples; ++i)
   {
-    std::size_t total_allele_length = 0;
+    int32_t const * values = bcf_read_values + i * width;
 
-    for (auto const & seq : var.seqs)
-    {
-      total_allele_length += seq.size();
+    for (long k = 0; k < width && is_value(values[k]); ++k)
+      new_var.calls[i].phred.push_back(static_cast<uint8_t>(values[k]));
+  }
 
-      if (total_allele_length > 16000)
-      {
-        BOOST_LOG_TRIVIAL(warning) << "Skipped outputting variant at position "
-                                   << contig_pos.first << ":" << contig_pos.second
-                                   << " because the total length of alleles is too high.";
-        return;
-      }
-    }
+  width = read_format("MD");
+
+  for (long i = 0; width > 0 && i < n_samples; ++i)
+  {
+    assert(bcf_read_values[i * width] <= 0xFF);
+    new_var.calls[i].ambiguous_depth = static_cast<uint8_t>(bcf_read_values[i * width]);
   }
 
-  // Calculate qual
-  const uint64_t variant_qual = var.get_qual();
+  width = read_format("RA");
 
-  if (FILTER_ZERO_QUAL && (sample_names.size() > 0 && variant_qual == 0))
+  for (long i = 0; width >= 2 && i < n_samples; ++i)
   {
-    //BOOST_LOG_TRIVIAL(warning) << "Zero qual variant at pos " << contig_pos.first << ":" << contig_pos.second;
-    BOOST_LOG_TRIVIAL(debug) << "Skipped outputting variant at position "
-                             << contig_pos.first << ":" << contig_pos.second
-                             << " because the variant had zero quality.";
-    return;
+    new_var.calls[i].ref_total_depth = static_cast<uint16_t>(bcf_read_values[i * width]);
+    new_var.calls[i].alt_total_depth = static_cast<uint16_t>(bcf_read_values[i * width + 1]);
   }
 
-  bgzf_stream.ss << contig_pos.first << '\t';
-  bgzf_stream.ss << contig_pos.second << '\t';
+  width = read_format("PP");
 
-  // Write the ID field
-  bgzf_stream.ss << contig_pos.first; // Keep the 'chr'
+  for (long i = 0; width > 0 && i < n_samples; ++i)
+    new_var.calls[i].alt_proper_pair_depth = static_cast<uint8_t>(bcf_read_values[i * width]);
 
-  bgzf_stream.ss << ':' << contig_pos.second << ':' << var.determine_variant_type();
+  // FT
+  {
+    char ** fts = nullptr;
+    int n_fts = 0;
 
-  if (var.suffix_id.size() > 0)
-    bgzf_stream.ss << "[" << var.suffix_id << "]";
+    if (bcf_get_format_string(bcf_hdr, bcf_record, "FT", &fts, &n_fts) > 0)
+    {
+      for (long i = 0; i < n_samples; ++i)
+      {
+        Token value;
+        value.begin = fts[i];
+        value.end = fts[i] + std::strlen(fts[i]);
 
-  bgzf_stream.ss << suffix;
+        if (value.equals("PASS"))
+        {
+          new_var.calls[i].filter = 0;
+        }
+        else
+        {
+          Token filter_number(value);
+          filter_number.begin += std::min(4ul, value.size());
+          new_var.calls[i].filter = parse_uint<int8_t>(filter_number);
+        }
+      }
 
-  // Parse the sequences
-  assert(var.seqs.size() >= 2);
-  bgzf_stream.ss << '\t' << std::string(var.seqs[0].begin(), var.seqs[0].end()) << '\t'
-                 << std::string(var.seqs[1].begin(), var.seqs[1].end());
+      free(fts[0]);
+      free(fts);
+    }
+  }
 
-  // Print other allele sequences if it is multi-allelic marker
-  for (long a = 2; a < static_cast<long>(var.seqs.size()); ++a)
-    bgzf_stream.ss << ',' << std::string(var.seqs[a].begin(), var.seqs[a].end());
+#ifndef NDEBUG
+  for (auto const & new_call : new_var.calls)
+    assert(new_call.coverage.size() * (new_call.coverage.size() + 1) / 2 == new_call.phred.size());
+#endif // NDEBUG
+}
 
-  // Parse qual
-  bgzf_stream.ss << "\t" << std::to_string(variant_qual) << "\t";
 
-  // Parse filter
-  if (sample_names.size() == 0 || Options::const_instance()->ploidy > 2)
+void
+Vcf::write_bcf_record(Variant const & var,
+                      std::pair<std::string, uint32_t> const & contig_pos,
+                      std::string const & id,
+                      uint64_t const variant_qual)
+{
+  bcf1_t * rec = bcf_record;
+  bcf_clear(rec);
+  rec->rid = bcf_hdr_name2id(bcf_hdr, contig_pos.first.c_str());
+
+  if (rec->rid < 0)
   {
-    bgzf_stream.ss << ".\t";
+    BOOST_LOG_TRIVIAL(error) << __HERE__ << " Contig " << contig_pos.first << " is not in the BCF header.";
+    std::exit(1);
   }
-  else
-  {
-    bool is_pass = true;
 
-    if (var.infos.count("ABHet") == 1 &&
-        var.infos.at("ABHet") != std::string("-1") &&
-        std::stod(var.infos.at("ABHet")) < 0.175)
-    {
-      if (!is_pass)
-        bgzf_stream.ss << ";";
+  rec->pos = contig_pos.second - 1;
+  rec->qual = static_cast<float>(variant_qual);
+  bcf_update_id(bcf_hdr, rec, id.c_str());
 
-      bgzf_stream.ss << "LowABHet";
-      is_pass = false;
-    }
+  // Alleles
+  {
+    assert(var.seqs.size() >= 2);
+    std::string alleles(var.seqs[0].begin(), var.seqs[0].end());
 
-    if (var.infos.count("ABHom") == 1 &&
-        var.infos.at("ABHom") != std::string("-1") &&
-        std::stod(var.infos.at("ABHom")) < 0.85)
+    for (long a = 1; a < static_cast<long>(var.seqs.size()); ++a)
     {
-      if (!is_pass)
-        bgzf_stream.ss << ";";
-
-      bgzf_stream.ss << "LowABHom";
-      is_pass = false;
+      alleles.push_back(',');
+      alleles.append(var.seqs[a].begin(), var.seqs[a].end());
     }
 
-    if (var.infos.count("AN") == 1 && std::stoi(var.infos.at("AN")) >= 6 &&
-        var.infos.count("QD") == 1 && std::stod(var.infos.at("QD")) < 9.0)
-    {
-      if (!is_pass)
-        bgzf_stream.ss << ";";
+    bcf_update_alleles_str(bcf_hdr, rec, alleles.c_str());
+  }
 
-      bgzf_stream.ss << "LowQD";
-      is_pass = false;
-    }
+  // Filter
+  if (sample_names.size() > 0 && Options::const_instance()->ploidy <= 2)
+  {
+    std::vector<char const *> const filters = get_record_filters(var, variant_qual);
+    bcf_values.clear();
 
-    if (variant_qual < 10)
-    {
-      if (!is_pass)
-        bgzf_stream.ss << ";";
+    if (filters.empty())
+      bcf_values.push_back(bcf_hdr_id2int(bcf_hdr, BCF_DT_ID, "PASS"));
 
-      bgzf_stream.ss << "LowQUAL";
-      is_pass = false;
-    }
+    for (auto const filter : filters)
+      bcf_values.push_back(bcf_hdr_id2int(bcf_hdr, BCF_DT_ID, filter));
 
-    // Only filter on PASS_ratio if we have sufficient amount of samples
-    if (var.infos.count("AN") == 1 && std::stoi(var.infos.at("AN")) >= 500 &&
-        var.infos.count("PASS_ratio") == 1 && std::stod(var.infos.at("PASS_ratio")) < 0.05
-        )
-    {
-      if (!is_pass)
-        bgzf_stream.ss << ";";
+    bcf_update_filter(bcf_hdr, rec, bcf_values.data(), bcf_values.size());
+  }
 
-      bgzf_stream.ss << "LowPratio";
-      is_pass = false;
-    }
+  // INFO
+  for (auto const & info : var.infos)
+    update_bcf_info(bcf_hdr, rec, info.first, info.second);
 
-    if (is_pass)
-      bgzf_stream.ss << "PASS";
+  if (var.stats.has_clipped_reads)
+    update_bcf_info_uint(bcf_hdr, rec, "CR", std::vector<uint32_t>(1, var.stats.clipped_reads));
 
-    bgzf_stream.ss << "\t";
-  }
+  // MQsquared overflows BCF integers in large cohorts, so it is a Float
+  if (var.stats.has_mapq_squared)
+  {
+    float const mapq_squared = static_cast<float>(var.stats.mapq_squared);
 
+    if (bcf_update_info_float(bcf_hdr, rec, "MQsquared", &mapq_squared, 1) < 0)
+    {
+      BOOST_LOG_TRIVIAL(error) << __HERE__ << " Failed adding INFO field MQsquared to a BCF record.";
+      std::exit(1);
+    }
+  }
 
-  // Parse info
-  if (var.infos.empty())
+  if (var.stats.has_strand_bias)
   {
-    bgzf_stream.ss << ".";
+    update_bcf_info_uint(bcf_hdr, rec, "SBF", var.stats.sbf);
+    update_bcf_info_uint(bcf_hdr, rec, "SBF1", var.stats.sbf1);
+    update_bcf_info_uint(bcf_hdr, rec, "SBF2", var.stats.sbf2);
+    update_bcf_info_uint(bcf_hdr, rec, "SBR", var.stats.sbr);
+    update_bcf_info_uint(bcf_hdr, rec, "SBR1", var.stats.sbr1);
+    update_bcf_info_uint(bcf_hdr, rec, "SBR2", var.stats.sbr2);
   }
-  else
+
+  // FORMAT
+  if (var.calls.size() > 0)
   {
-    auto write_info = [&](std::map<std::string, std::string>::const_iterator it)
-                      {
-                        bgzf_stream.ss << it->first;
+    assert(sample_names.size() == var.calls.size());
+    long const n_calls = var.calls.size();
+    long const n_alleles = var.seqs.size();
+    bool const is_sv = var.is_sv();
 
-                        if (it->second.size() > 0)
-                          bgzf_stream.ss << '=' << it->second;
-                      };
+    // Writes an integer FORMAT field from bcf_values, which has 'width' values per sample
+    auto write_format = [&](char const * tag, long const width)
+                        {
+                          assert(static_cast<long>(bcf_values.size()) == n_calls * width);
+
+                          if (bcf_update_format_int32(bcf_hdr, rec, tag, bcf_values.data(), n_calls * width) < 0)
+                          {
+                            BOOST_LOG_TRIVIAL(error) << __HERE__ << " Failed adding FORMAT field " << tag
+                                                     << " to a BCF record.";
+                            std::exit(1);
+                          }
+                        };
 
-    write_info(var.infos.cbegin());
+    // GT
+    bcf_values.resize(2 * n_calls);
 
-    for (auto map_it = std::next(var.infos.cbegin(), 1); map_it != var.infos.cend(); ++map_it)
+    for (long i = 0; i < n_calls; ++i)
     {
-      bgzf_stream.ss << ';';
-      write_info(map_it);
-    }
+      auto const & call = var.calls[i];
 
-  }
+      if (std::find_if(call.phred.begin(), call.phred.end(), [](uint8_t const pl){
+          return pl != 0;
+        }) == call.phred.end())
+      {
+        bcf_values[2 * i] = bcf_gt_missing;
+        bcf_values[2 * i + 1] = bcf_gt_missing;
+      }
+      else
+      {
+        std::pair<uint16_t, uint16_t> const gt_call = call.get_gt_call();
+        bcf_values[2 * i] = bcf_gt_unphased(gt_call.first);
+        bcf_values[2 * i + 1] = bcf_gt_unphased(gt_call.second);
+      }
+    }
 
-  assert(sample_names.size() == var.calls.size());
-  bool const is_sv = var.is_sv();
+    write_format("GT", 2);
 
-  // Parse FORMAT
-  if (var.calls.size() > 0)
-  {
+    // FT
     if (is_sv)
-      bgzf_stream.ss << "\tGT:FT:AD:MD:DP:RA:PP:GQ:PL";
-    else
-      bgzf_stream.ss << "\tGT:AD:MD:DP:GQ:PL";
-  }
-
-  for (long i = 0; i < static_cast<long>(var.calls.size()); ++i)
-  {
-    auto const & call = var.calls[i];
+    {
+      std::vector<std::string> fts(n_calls);
+      std::vector<char const *> ft_ptrs(n_calls);
 
-    // Write GT
-    auto pl_non_zero = [](uint8_t const pl) -> bool
-                       {
-                         return pl != 0;
-                       };
+      for (long i = 0; i < n_calls; ++i)
+      {
+        long const filter = var.calls[i].check_filter(var.calls[i].get_gq());
+        assert(filter >= 0);
+        fts[i] = filter == 0 ? std::string("PASS") : std::string("FAIL") + std::to_string(filter);
+        ft_ptrs[i] = fts[i].c_str();
+      }
 
-    if (std::find_if(call.phred.begin(), call.phred.end(), pl_non_zero) == call.phred.end())
-    {
-      bgzf_stream.ss << "\t./.";
+      bcf_update_format_string(bcf_hdr, rec, "FT", ft_ptrs.data(), n_calls);
     }
-    else
+
+    // AD
+    bcf_values.assign(n_calls * n_alleles, bcf_int32_vector_end);
+
+    for (long i = 0; i < n_calls; ++i)
     {
-      std::pair<uint16_t, uint16_t> const gt_call = call.get_gt_call();
-      bgzf_stream.ss << "\t" << gt_call.first << "/" << gt_call.second;
+      auto const & coverage = var.calls[i].coverage;
+      std::copy(coverage.begin(),
+                coverage.begin() + std::min(n_alleles, static_cast<long>(coverage.size())),
+                bcf_values.begin() + i * n_alleles);
     }
 
-    // Write FT
-    long const gq = call.get_gq();
+    write_format("AD", n_alleles);
+
+    // MD (Multi-depth)
+    bcf_values.resize(n_calls);
+
+    for (long i = 0; i < n_calls; ++i)
+      bcf_values[i] = var.calls[i].ambiguous_depth;
+
+    write_format("MD", 1);
+
+    // DP
+    for (long i = 0; i < n_calls; ++i)
+      bcf_values[i] = static_cast<int32_t>(var.calls[i].get_depth());
+
+    write_format("DP", 1);
 
     if (is_sv)
     {
-      bgzf_stream.ss << ":";
-      long filter = call.check_filter(gq);
+      // RA
+      bcf_values.resize(2 * n_calls);
 
-      if (filter == 0)
-      {
-        bgzf_stream.ss << "PASS";
-      }
-      else
+      for (long i = 0; i < n_calls; ++i)
       {
-        assert(filter > 0);
-        bgzf_stream.ss << "FAIL" << filter;
+        bcf_values[2 * i] = var.calls[i].ref_total_depth;
+        bcf_values[2 * i + 1] = var.calls[i].alt_total_depth;
       }
+
+      write_format("RA", 2);
+
+      // PP
+      bcf_values.resize(n_calls);
+
+      for (long i = 0; i < n_calls; ++i)
+        bcf_values[i] = var.calls[i].alt_proper_pair_depth;
+
+      write_format("PP", 1);
     }
 
-    // Write AD
-    assert(call.coverage.size() > 0);
-    bgzf_stream.ss << ":" << call.coverage[0];
+    // GQ
+    bcf_values.resize(n_calls);
 
-    for (auto ad_it = call.coverage.begin() + 1; ad_it != call.coverage.end(); ++ad_it)
-      bgzf_stream.ss << "," << *ad_it;
+    for (long i = 0; i < n_calls; ++i)
+      bcf_values[i] = std::min(99, static_cast<int32_t>(var.calls[i].get_gq()));
 
-    // Write MD (Multi-depth)
-    bgzf_stream.ss << ":" << static_cast<uint64_t>(call.ambiguous_depth);
+    write_format("GQ", 1);
 
-    // Write DP
-    bgzf_stream.ss << ":" << call.get_depth();
+    // PL
+    long const n_phred = n_alleles * (n_alleles + 1) / 2;
+    bcf_values.assign(n_calls * n_phred, bcf_int32_vector_end);
 
-    // Write RA
-    if (is_sv)
+    for (long i = 0; i < n_calls; ++i)
     {
-      bgzf_stream.ss << ":" << call.ref_total_depth << "," << call.alt_total_depth;
+      auto const & phred = var.calls[i].phred;
+      std::copy(phred.begin(),
+                phred.begin() + std::min(n_phred, static_cast<long>(phred.size())),
+                bcf_values.begin() + i * n_phred);
     }
 
-    // Write PP
-    if (is_sv)
+    write_format("PL", n_phred);
+  }
+
+  if (bcf_write(bcf_fp, bcf_hdr, rec) < 0)
+  {
+    BOOST_LOG_TRIVIAL(error) << __HERE__ << " Failed writing a BCF record to " << filename;
+    std::exit(1);
+  }
+}
+
+
+bool
+Vcf::is_skipped(Variant const & var, std::pair<std::string, uint32_t> const & contig_pos) const
+{
+  if (!Options::instance()->output_all_variants && var.calls.size() > 0 && var.seqs.size() > 100)
+  {
+    BOOST_LOG_TRIVIAL(info) << "Skipped outputting variant at position "
+                            << contig_pos.first << ":" << contig_pos.second
+                            << " because there are " << var.seqs.size() << " alleles.";
+    return true;
+  }
+
+  if (!Options::instance()->output_all_variants)
+  {
+    std::size_t total_allele_length = 0;
+
+    for (auto const & seq : var.seqs)
     {
-      bgzf_stream.ss << ':' << static_cast<std::size_t>(call.alt_proper_pair_depth);
+      total_allele_length += seq.size();
+
+      if (total_allele_length > 16000)
+      {
+        BOOST_LOG_TRIVIAL(warning) << "Skipped outputting variant at position "
+                                   << contig_pos.first << ":" << contig_pos.second
+                                   << " because the total length of alleles is too high.";
+        return true;
+      }
     }
+  }
 
-    // Write GQ
-    bgzf_stream.ss << ':' << std::min(99l, gq);
+  return false;
+}
 
-    // Write PL
-    bgzf_stream.ss << ':' << static_cast<uint16_t>(call.phred[0]);
-    // This cast to uint16_t is needed! Otherwise uint8_t is represented as a char
 
-    for (std::size_t p = 1; p < call.phred.size(); ++p)
-      bgzf_stream.ss << ',' << static_cast<uint16_t>(call.phred[p]);
+std::vector<Variant>
+Vcf::get_sites() const
+{
+  std::vector<Variant> sites;
+  sites.reserve(variants.size());
+
+  for (auto const & var : variants)
+  {
+    if (is_skipped(var, absolute_pos.get_contig_position(var.abs_pos, gyper::graph.contigs)))
+      continue;
+
+    Variant site;
+    site.abs_pos = var.abs_pos;
+    site.seqs = var.seqs;
+    sites.push_back(std::move(site));
   }
 
-  // Fin.
-  bgzf_stream.ss << '\n';
-  bgzf_stream.check_cache();
+  return sites;
 }
 
 
@@ -994,8 +2009,8 @@ Vcf::write(std::string const & region, long const n_threads)
 
 
 void
-Vcf::write_records(uint32_t const region_begin,
-                   uint32_t const region_end,
+Vcf::write_records(TAbsPos const region_begin,
+                   TAbsPos const region_end,
                    bool const FILTER_ZERO_QUAL,
                    std::vector<Variant> const & vars
                    )
@@ -1027,7 +2042,7 @@ Vcf::write_records(uint32_t const region_begin,
                            return a.abs_pos == b.abs_pos && a.determine_variant_type() == b.determine_variant_type();
                          };
 
-  auto inside_region = [region_begin, region_end](uint32_t const pos) -> bool
+  auto inside_region = [region_begin, region_end](TAbsPos const pos) -> bool
                        {
                          return pos >= region_begin && pos <= region_end;
                        };
@@ -1091,8 +2106,8 @@ Vcf::write_records(uint32_t const region_begin,
 void
 Vcf::write_records(std::string const & region, bool const FILTER_ZERO_QUAL)
 {
-  uint32_t region_begin = 0;
-  uint32_t region_end = 0xFFFFFFFFull;
+  TAbsPos region_begin = 0;
+  TAbsPos region_end = std::numeric_limits<TAbsPos>::max();
 
   // Restrict to a region if it is given
   if (region != ".")
@@ -1118,6 +2133,12 @@ Vcf::write_records(std::string const & region, bool const FILTER_ZERO_QUAL)
 void
 Vcf::write_segments()
 {
+  if (bcf_fp)
+  {
+    BOOST_LOG_TRIVIAL(error) << __HERE__ << " Segments can only be written to a VCF file, not BCF.";
+    std::exit(1);
+  }
+
   BOOST_LOG_TRIVIAL(debug) << "[graphtyper::vcf] Writing "
                            << segments.size()
                            << " segments to "
@@ -1129,10 +2150,10 @@ Vcf::write_segments()
     auto contig_pos = absolute_pos.get_contig_position(segment.id, gyper::graph.contigs);
 
     // Write CHROM and POS
-    bgzf_stream.ss << contig_pos.first << "\t" << contig_pos.second;
+    bgzf_stream << contig_pos.first << "\t" << contig_pos.second;
 
     // Write the ID
-    bgzf_stream.ss << "\t" << contig_pos.first << ":" << contig_pos.second << ":" << segment.var_type;
+    bgzf_stream << "\t" << contig_pos.first << ":" << contig_pos.second << ":" << segment.var_type;
 
     if (segment.segment_name.size() > 0)
       bgzf_stream << ":" << segment.segment_name;
@@ -1175,16 +2196,72 @@ Vcf::close_vcf_file()
 {
   bgzf_stream.close();
 
+  if (is_indexing && filemode == WRITE_BGZF_MODE)
+  {
+    // TBI cannot index positions beyond 2^29, a CSI index is built if any contig is that long
+    bool const is_csi = std::any_of(graph.contigs.begin(), graph.contigs.end(), [](Contig const & contig){
+        return contig.length >= (1u << 29);
+      });
+
+    if (tbx_index_build(filename.c_str(), is_csi ? 14 : 0, &tbx_conf_vcf) < 0)
+    {
+      BOOST_LOG_TRIVIAL(error) << __HERE__ << " Could not build the index of " << filename;
+      std::exit(1);
+    }
+  }
+
   if (bgzf_in)
   {
     bgzf_in.close();
   }
+
+  if (bcf_fp)
+  {
+    if (is_indexing && filemode == WRITE_BCF_MODE && bcf_idx_save(bcf_fp) < 0)
+      BOOST_LOG_TRIVIAL(warning) << __HERE__ << " Failed saving the index of " << filename;
+
+    if (hts_close(bcf_fp) != 0)
+      BOOST_LOG_TRIVIAL(warning) << __HERE__ << " Failed closing " << filename;
+
+    bcf_fp = nullptr;
+  }
+
+  if (bcf_hdr)
+  {
+    bcf_hdr_destroy(bcf_hdr);
+    bcf_hdr = nullptr;
+  }
+
+  if (bcf_record)
+  {
+    bcf_destroy(bcf_record);
+    bcf_record = nullptr;
+  }
+
+  free(bcf_read_values);
+  bcf_read_values = nullptr;
+  bcf_read_values_size = 0;
+  free(bcf_str.s);
+  bcf_str.s = nullptr;
+  bcf_str.l = 0;
+  bcf_str.m = 0;
+  has_undecoded_calls = false;
+  is_indexing = false;
 }
 
 
 void
 Vcf::write_tbi_index() const
 {
+  if (is_bcf())
+  {
+    // BCF files have a CSI index
+    if (bcf_index_build(filename.c_str(), 14) < 0)
+      BOOST_LOG_TRIVIAL(warning) << __HERE__ << " Could not build BCF index";
+
+    return;
+  }
+
   int ret = tbx_index_build(filename.c_str(), 0, &tbx_conf_vcf);
 
   if (ret < 0)
@@ -1239,15 +2316,8 @@ Vcf::add_haplotype(Haplotype & haplotype, bool const clear_haplotypes, uint32_t
     auto const & stat = haplotype.var_stats[i];
     auto & new_var = new_vars[i];
 
-    new_var.infos["CR"] = std::to_string(stat.clipped_reads);
     new_var.infos["PS"] = std::to_string(phase_set);
-    new_var.infos["MQsquared"] = std::to_string(stat.mapq_squared);
-    new_var.infos["SBF"] = stat.get_forward_strand_bias();
-    new_var.infos["SBR"] = stat.get_reverse_strand_bias();
-    new_var.infos["SBF1"] = stat.get_r1_forward_strand_bias();
-    new_var.infos["SBF2"] = stat.get_r2_forward_strand_bias();
-    new_var.infos["SBR1"] = stat.get_r1_reverse_strand_bias();
-    new_var.infos["SBR2"] = stat.get_r2_reverse_strand_bias();
+    new_var.stats = InfoStats(stat);
   }
 
   //long const ploidy = Options::const_instance()->ploidy;
@@ -1593,6 +2663,7 @@ save_vcf(Vcf const & vcf, std::string const & filename)
   long v_begin{0};
   long n_alleles{0}; // sqaured number of alleles. We use square because that better capture better the memory requirement
   long const MAX_ALLELES = Options::const_instance()->num_alleles_in_batch; // max number of squared alleles in batch
+  std::vector<std::string> const no_sample_names;
 
   for (long v{0}; v < static_cast<long>(vcf.variants.size()); ++v)
   {
@@ -1603,31 +2674,12 @@ save_vcf(Vcf const & vcf, std::string const & filename)
 
     if (n_alleles >= MAX_ALLELES)
     {
-      // Enough data, lets serialize
-      Vcf new_vcf;
-
-      if (n_batch == 0)
-        new_vcf.sample_names = vcf.sample_names;
-
+      // Enough data, lets save the batch. Only the first batch has the sample names
       assert(v_begin < static_cast<long>(vcf.variants.size()));
-
-      // std::move okay, right?
-      std::move(vcf.variants.begin() + v_begin, vcf.variants.begin() + (v + 1), std::back_inserter(new_vcf.variants));
-
-      // save batch
-      std::string batch_filename = filename + "_" + std::to_string(n_batch);
-      std::ofstream ofs(batch_filename.c_str(), std::ios::binary);
-
-      if (!ofs.is_open())
-      {
-        BOOST_LOG_TRIVIAL(error) << __HERE__ << " Could not save VCF to location '"
-                                 << filename
-                                 << "'";
-        std::exit(1);
-      }
-
-      boost::archive::binary_oarchive oa(ofs);
-      oa << new_vcf; // done saving the batch
+      write_vcf_batch(filename + "_" + std::to_string(n_batch),
+                      n_batch == 0 ? vcf.sample_names : no_sample_names,
+                      vcf.variants.begin() + v_begin,
+                      vcf.variants.begin() + (v + 1));
 
       v_begin = v + 1;
       ++n_batch;
@@ -1636,43 +2688,18 @@ save_vcf(Vcf const & vcf, std::string const & filename)
   }
 
   // Write remaining variants
-  Vcf new_vcf;
-
-  if (n_batch == 0)
-    new_vcf.sample_names = vcf.sample_names;
-
   assert(v_begin <= static_cast<long>(vcf.variants.size()));
-
-  // std::move okay, right?
-  std::move(vcf.variants.begin() + v_begin, vcf.variants.end(), std::back_inserter(new_vcf.variants));
-
-  // save batch
-  std::string batch_filename = filename + "_" + std::to_string(n_batch);
-  std::ofstream ofs(batch_filename.c_str(), std::ios::binary);
-
-  if (!ofs.is_open())
-  {
-    BOOST_LOG_TRIVIAL(error) << __HERE__ << " Could not save VCF to location '"
-                             << filename
-                             << "'";
-    std::exit(1);
-  }
-
-  boost::archive::binary_oarchive oa(ofs);
-  oa << new_vcf; // done saving the batch
+  write_vcf_batch(filename + "_" + std::to_string(n_batch),
+                  n_batch == 0 ? vcf.sample_names : no_sample_names,
+                  vcf.variants.begin() + v_begin,
+                  vcf.variants.end());
 }
 
 
 void
 load_vcf(Vcf & vcf, std::string const & filename, long n_batch)
 {
-  std::string const VCF_GZ = ".vcf.gz";
-
-  if (filename.size() > VCF_GZ.size() &&
-      std::equal(filename.rbegin(),
-                 filename.rbegin() + VCF_GZ.size(),
-                 VCF_GZ.rbegin()))
-
+  if (boost::algorithm::ends_with(filename, ".vcf.gz") || boost::algorithm::ends_with(filename, ".bcf"))
   {
     vcf.open(READ_MODE, filename);
     vcf.read();
@@ -1681,16 +2708,13 @@ load_vcf(Vcf & vcf, std::string const & filename, long n_batch)
   {
     std::string batch_filename = filename + "_" + std::to_string(n_batch);
     BOOST_LOG_TRIVIAL(debug) << __HERE__ << " Loading variants from " << batch_filename;
-    std::ifstream ifs(batch_filename.c_str(), std::ios::binary);
+    vcf.variants.clear();
 
-    if (!ifs.is_open())
+    if (!read_vcf_batch(batch_filename, vcf, true /*is_reading_sample_names*/))
     {
       BOOST_LOG_TRIVIAL(error) << __HERE__ << " Could not open file " << batch_filename;
       std::exit(1);
     }
-
-    boost::archive::binary_iarchive ia(ifs);
-    ia >> vcf;
   }
 }
 
@@ -1698,21 +2722,9 @@ load_vcf(Vcf & vcf, std::string const & filename, long n_batch)
 bool
 append_vcf(Vcf & vcf, std::string const & filename, long n_batch)
 {
-  Vcf new_vcf;
   std::string batch_filename = filename + "_" + std::to_string(n_batch);
   BOOST_LOG_TRIVIAL(debug) << __HERE__ << " Appending variants from " << batch_filename;
-  std::ifstream ifs(batch_filename.c_str(), std::ios::binary);
-
-  if (!ifs.is_open())
-  {
-    // This batch does not exist
-    return false;
-  }
-
-  boost::archive::binary_iarchive ia(ifs);
-  ia >> new_vcf;
-  std::move(new_vcf.variants.begin(), new_vcf.variants.end(), std::back_inserter(vcf.variants));
-  return true;
+  return read_vcf_batch(batch_filename, vcf, false /*is_reading_sample_names*/); // false if the batch does not exist
 }
 
 
@@ -0,0 +1,548 @@
+#include <cassert> // assert
+#include <cstdint> // uint8_t, uint32_t, uint64_t
+#include <cstdlib> // std::exit
+#include <cstring> // std::memcpy
+#include <fstream> // std::ofstream
+#include <iterator> // std::distance
+#include <string> // std::string
+#include <vector> // std::vector
+
+#include <fcntl.h> // open
+#include <sys/mman.h> // mmap, munmap
+#include <sys/stat.h> // fstat
+#include <unistd.h> // close, read
+
+#include <boost/log/trivial.hpp>
+
+#include <graphtyper/constants.hpp>
+#include <graphtyper/typer/variant.hpp>
+#include <graphtyper/typer/vcf.hpp>
+#include <graphtyper/typer/vcf_batch.hpp>
+
+
+namespace
+{
+
+char const BATCH_MAGIC[4] = {'G', 'Y', 'V', 'B'};
+uint32_t const BATCH_VERSION = 2;
+
+// Layouts of the calls of a variant
+uint8_t const CALLS_UNIFORM = 0; // Every call has R * (R + 1) / 2 PL values and R AD values
+uint8_t const CALLS_EXPLICIT = 1; // The number of PL and AD values of each call is stored in the sites section
+
+
+struct BatchHeader
+{
+  char magic[4];
+  uint32_t version;
+  uint64_t abs_pos_size; // Size of absolute positions in bytes in the build which wrote the batch
+  uint64_t n_sample_names;
+  uint64_t n_variants;
+  uint64_t sites_offset;
+  uint64_t phred_offset;
+  uint64_t coverage_offset;
+  uint64_t depth_offset;
+  uint64_t end_offset;
+};
+
+
+void
+put_uint(std::string & out, uint64_t val)
+{
+  while (val >= 0x80)
+  {
+    out.push_back(static_cast<char>((val & 0x7F) | 0x80));
+    val >>= 7;
+  }
+
+  out.push_back(static_cast<char>(val));
+}
+
+
+void
+put_string(std::string & out, char const * str, std::size_t const size)
+{
+  put_uint(out, size);
+  out.append(str, size);
+}
+
+
+template <typename T>
+void
+put_uint_vector(std::string & out, std::vector<T> const & vals)
+{
+  put_uint(out, vals.size());
+
+  for (auto const val : vals)
+    put_uint(out, val);
+}
+
+
+// Reads values from one section of a batch
+class SectionCursor
+{
+public:
+  SectionCursor(char const * _it, char const * _end, std::string const & _filename)
+    : it(_it)
+    , end(_end)
+    , filename(_filename)
+  {}
+
+  uint64_t
+  get_uint()
+  {
+    uint64_t val{0};
+    int shift{0};
+
+    while (true)
+    {
+      check_size(1);
+      uint8_t const byte = static_cast<uint8_t>(*it++);
+      val |= static_cast<uint64_t>(byte & 0x7F) << shift;
+
+      if ((byte & 0x80) == 0)
+        return val;
+
+      shift += 7;
+
+      if (shift >= 64)
+        fail();
+    }
+  }
+
+  uint8_t
+  get_byte()
+  {
+    check_size(1);
+    return static_cast<uint8_t>(*it++);
+  }
+
+  char const *
+  get_bytes(std::size_t const size)
+  {
+    check_size(size);
+    char const * const begin = it;
+    it += size;
+    return begin;
+  }
+
+  template <typename T>
+  void
+  get_uint_vector(std::vector<T> & vals)
+  {
+    vals.resize(get_uint());
+
+    for (auto & val : vals)
+      val = static_cast<T>(get_uint());
+  }
+
+  bool
+  is_at_end() const
+  {
+    return it == end;
+  }
+
+private:
+  char const * it;
+  char const * end;
+  std::string const & filename;
+
+  void
+  check_size(std::size_t const size)
+  {
+    if (static_cast<std::size_t>(end - it) < size)
+      fail();
+  }
+
+  void
+  fail()
+  {
+    BOOST_LOG_TRIVIAL(error) << __HERE__ << " VCF batch file '" << filename << "' is truncated or corrupt.";
+    std::exit(1);
+  }
+
+};
+
+
+// Contents of a batch file, memory mapped if possible
+class BatchFile
+{
+public:
+  BatchFile() = default;
+  BatchFile(BatchFile const &) = delete;
+  BatchFile & operator=(BatchFile const &) = delete;
+
+  ~BatchFile()
+  {
+    if (mapped)
+      munmap(mapped, size);
+  }
+
+  // Returns false if the file could not be opened
+  bool
+  open(std::string const & filename)
+  {
+    int const fd = ::open(filename.c_str(), O_RDONLY);
+
+    if (fd < 0)
+      return false;
+
+    struct stat st;
+
+    if (fstat(fd, &st) != 0)
+    {
+      ::close(fd);
+      return false;
+    }
+
+    size = static_cast<std::size_t>(st.st_size);
+
+    if (size > 0)
+    {
+      void * ptr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+      if (ptr != MAP_FAILED)
+      {
+        mapped = ptr;
+        data = static_cast<char const *>(ptr);
+        madvise(ptr, size, MADV_SEQUENTIAL);
+      }
+      else
+      {
+        // Fall back to reading the file in one go
+        copy.resize(size);
+        std::size_t n_read{0};
+
+        while (n_read < size)
+        {
+          ssize_t const n = ::read(fd, &copy[n_read], size - n_read);
+
+          if (n <= 0)
+          {
+            ::close(fd);
+            return false;
+          }
+
+          n_read += n;
+        }
+
+        data = copy.data();
+      }
+    }
+
+    ::close(fd);
+    return true;
+  }
+
+  char const * data{nullptr};
+  std::size_t size{0};
+
+private:
+  void * mapped{nullptr};
+  std::vector<char> copy;
+
+};
+
+
+} // anon namespace
+
+
+namespace gyper
+{
+
+void
+write_vcf_batch(std::string const & batch_filename,
+                std::vector<std::string> const & sample_names,
+                std::vector<Variant>::const_iterator begin,
+                std::vector<Variant>::const_iterator end)
+{
+  std::string names;
+  std::string sites;
+  std::string phred;
+  std::string coverage;
+  std::string depth;
+
+  for (auto const & sample_name : sample_names)
+    put_string(names, sample_name.data(), sample_name.size());
+
+  for (auto var_it = begin; var_it != end; ++var_it)
+  {
+    Variant const & var = *var_it;
+
+    put_uint(sites, var.abs_pos);
+    put_uint(sites, var.seqs.size());
+
+    for (auto const & seq : var.seqs)
+      put_string(sites, seq.data(), seq.size());
+
+    put_string(sites, var.suffix_id.data(), var.suffix_id.size());
+    put_uint(sites, var.infos.size());
+
+    for (auto const & info : var.infos)
+    {
+      put_string(sites, info.first.data(), info.first.size());
+      put_string(sites, info.second.data(), info.second.size());
+    }
+
+    InfoStats const & stats = var.stats;
+    sites.push_back(static_cast<char>(static_cast<uint8_t>(stats.has_clipped_reads) |
+                                      static_cast<uint8_t>(stats.has_mapq_squared) << 1 |
+                                      static_cast<uint8_t>(stats.has_strand_bias) << 2));
+    put_uint(sites, stats.clipped_reads);
+    put_uint(sites, stats.mapq_squared);
+    put_uint_vector(sites, stats.sbf);
+    put_uint_vector(sites, stats.sbr);
+    put_uint_vector(sites, stats.sbf1);
+    put_uint_vector(sites, stats.sbf2);
+    put_uint_vector(sites, stats.sbr1);
+    put_uint_vector(sites, stats.sbr2);
+
+    // Layout of the calls
+    std::size_t const n_alleles = var.seqs.size();
+    std::size_t const n_phred = n_alleles * (n_alleles + 1) / 2;
+    bool is_uniform{true};
+
+    for (auto const & call : var.calls)
+    {
+      if (call.phred.size() != n_phred || call.coverage.size() != n_alleles)
+      {
+        is_uniform = false;
+        break;
+      }
+    }
+
+    put_uint(sites, var.calls.size());
+
+    if (is_uniform)
+    {
+      sites.push_back(static_cast<char>(CALLS_UNIFORM));
+    }
+    else
+    {
+      sites.push_back(static_cast<char>(CALLS_EXPLICIT));
+
+      for (auto const & call : var.calls)
+      {
+        put_uint(sites, call.phred.size());
+        put_uint(sites, call.coverage.size());
+      }
+    }
+
+    // Calls
+    for (auto const & call : var.calls)
+    {
+      phred.append(reinterpret_cast<char const *>(call.phred.data()), call.phred.size());
+
+      for (auto const cov : call.coverage)
+        put_uint(coverage, cov);
+
+      put_uint(depth, call.ref_total_depth);
+      put_uint(depth, call.alt_total_depth);
+      depth.push_back(static_cast<char>(call.ambiguous_depth));
+      depth.push_back(static_cast<char>(call.alt_proper_pair_depth));
+    }
+  }
+
+  BatchHeader header;
+  std::memcpy(header.magic, BATCH_MAGIC, sizeof(BATCH_MAGIC));
+  header.version = BATCH_VERSION;
+  header.abs_pos_size = sizeof(TAbsPos);
+  header.n_sample_names = sample_names.size();
+  header.n_variants = std::distance(begin, end);
+  header.sites_offset = sizeof(BatchHeader) + names.size();
+  header.phred_offset = header.sites_offset + sites.size();
+  header.coverage_offset = header.phred_offset + phred.size();
+  header.depth_offset = header.coverage_offset + coverage.size();
+  header.end_offset = header.depth_offset + depth.size();
+
+  std::ofstream ofs(batch_filename.c_str(), std::ios::binary);
+
+  if (!ofs.is_open())
+  {
+    BOOST_LOG_TRIVIAL(error) << __HERE__ << " Could not save VCF to location '"
+                             << batch_filename
+                             << "'";
+    std::exit(1);
+  }
+
+  ofs.write(reinterpret_cast<char const *>(&header), sizeof(BatchHeader));
+  ofs.write(names.data(), names.size());
+  ofs.write(sites.data(), sites.size());
+  ofs.write(phred.data(), phred.size());
+  ofs.write(coverage.data(), coverage.size());
+  ofs.write(depth.data(), depth.size());
+
+  if (!ofs.good())
+  {
+    BOOST_LOG_TRIVIAL(error) << __HERE__ << " Failed writing VCF batch to '" << batch_filename << "'";
+    std::exit(1);
+  }
+}
+
+
+bool
+read_vcf_batch(std::string const & batch_filename, Vcf & vcf, bool const is_reading_sample_names)
+{
+  BatchFile file;
+
+  if (!file.open(batch_filename))
+    return false;
+
+  BatchHeader header;
+
+  if (file.size < sizeof(BatchHeader))
+  {
+    BOOST_LOG_TRIVIAL(error) << __HERE__ << " VCF batch file '" << batch_filename << "' is truncated.";
+    std::exit(1);
+  }
+
+  std::memcpy(&header, file.data, sizeof(BatchHeader));
+
+  if (std::memcmp(header.magic, BATCH_MAGIC, sizeof(BATCH_MAGIC)) != 0 || header.version != BATCH_VERSION)
+  {
+    BOOST_LOG_TRIVIAL(error) << __HERE__ << " '" << batch_filename << "' is not a VCF batch file of this version.";
+    std::exit(1);
+  }
+
+  if (header.abs_pos_size > sizeof(TAbsPos))
+  {
+    BOOST_LOG_TRIVIAL(error) << __HERE__ << " VCF batch file '" << batch_filename << "' has "
+                             << (8 * header.abs_pos_size) << "-bit positions but this build uses "
+                             << (8 * sizeof(TAbsPos)) << "-bit positions.";
+    std::exit(1);
+  }
+
+  if (header.sites_offset < sizeof(BatchHeader) ||
+      header.phred_offset < header.sites_offset ||
+      header.coverage_offset < header.phred_offset ||
+      header.depth_offset < header.coverage_offset ||
+      header.end_offset < header.depth_offset ||
+      header.end_offset != file.size)
+  {
+    BOOST_LOG_TRIVIAL(error) << __HERE__ << " VCF batch file '" << batch_filename << "' is truncated or corrupt.";
+    std::exit(1);
+  }
+
+  char const * const data = file.data;
+  SectionCursor names(data + sizeof(BatchHeader), data + header.sites_offset, batch_filename);
+  SectionCursor sites(data + header.sites_offset, data + header.phred_offset, batch_filename);
+  SectionCursor phred(data + header.phred_offset, data + header.coverage_offset, batch_filename);
+  SectionCursor coverage(data + header.coverage_offset, data + header.depth_offset, batch_filename);
+  SectionCursor depth(data + header.depth_offset, data + header.end_offset, batch_filename);
+
+  if (is_reading_sample_names)
+  {
+    vcf.sample_names.resize(header.n_sample_names);
+
+    for (auto & sample_name : vcf.sample_names)
+    {
+      std::size_t const size = names.get_uint();
+      sample_name.assign(names.get_bytes(size), size);
+    }
+  }
+
+  vcf.variants.reserve(vcf.variants.size() + header.n_variants);
+  std::vector<std::pair<std::size_t, std::size_t> > call_sizes;
+
+  for (uint64_t v{0}; v < header.n_variants; ++v)
+  {
+    vcf.variants.emplace_back();
+    Variant & var = vcf.variants.back();
+
+    var.abs_pos = static_cast<TAbsPos>(sites.get_uint());
+    var.seqs.resize(sites.get_uint());
+
+    for (auto & seq : var.seqs)
+    {
+      std::size_t const size = sites.get_uint();
+      char const * str = sites.get_bytes(size);
+      seq.assign(str, str + size);
+    }
+
+    {
+      std::size_t const size = sites.get_uint();
+      var.suffix_id.assign(sites.get_bytes(size), size);
+    }
+
+    std::size_t const n_infos = sites.get_uint();
+
+    for (std::size_t i{0}; i < n_infos; ++i)
+    {
+      std::size_t const key_size = sites.get_uint();
+      std::string key(sites.get_bytes(key_size), key_size);
+      std::size_t const value_size = sites.get_uint();
+      var.infos[std::move(key)].assign(sites.get_bytes(value_size), value_size);
+    }
+
+    InfoStats & stats = var.stats;
+    uint8_t const flags = sites.get_byte();
+    stats.has_clipped_reads = (flags & 1u) != 0;
+    stats.has_mapq_squared = (flags & 2u) != 0;
+    stats.has_strand_bias = (flags & 4u) != 0;
+    stats.clipped_reads = static_cast<uint32_t>(sites.get_uint());
+    stats.mapq_squared = sites.get_uint();
+    sites.get_uint_vector(stats.sbf);
+    sites.get_uint_vector(stats.sbr);
+    sites.get_uint_vector(stats.sbf1);
+    sites.get_uint_vector(stats.sbf2);
+    sites.get_uint_vector(stats.sbr1);
+    sites.get_uint_vector(stats.sbr2);
+
+    // Layout of the calls
+    std::size_t const n_calls = sites.get_uint();
+    uint8_t const layout = sites.get_byte();
+    call_sizes.clear();
+
+    if (layout == CALLS_UNIFORM)
+    {
+      std::size_t const n_alleles = var.seqs.size();
+      call_sizes.resize(n_calls, {n_alleles * (n_alleles + 1) / 2, n_alleles});
+    }
+    else if (layout == CALLS_EXPLICIT)
+    {
+      call_sizes.resize(n_calls);
+
+      for (auto & call_size : call_sizes)
+      {
+        call_size.first = sites.get_uint();
+        call_size.second = sites.get_uint();
+      }
+    }
+    else
+    {
+      BOOST_LOG_TRIVIAL(error) << __HERE__ << " VCF batch file '" << batch_filename << "' is corrupt.";
+      std::exit(1);
+    }
+
+    // Calls
+    var.calls.resize(n_calls);
+
+    for (std::size_t c{0}; c < n_calls; ++c)
+    {
+      SampleCall & call = var.calls[c];
+      std::size_t const n_phred = call_sizes[c].first;
+      uint8_t const * pl = reinterpret_cast<uint8_t const *>(phred.get_bytes(n_phred));
+      call.phred.assign(pl, pl + n_phred);
+      call.coverage.resize(call_sizes[c].second);
+
+      for (auto & cov : call.coverage)
+        cov = static_cast<uint16_t>(coverage.get_uint());
+
+      call.ref_total_depth = static_cast<uint16_t>(depth.get_uint());
+      call.alt_total_depth = static_cast<uint16_t>(depth.get_uint());
+      call.ambiguous_depth = depth.get_byte();
+      call.alt_proper_pair_depth = depth.get_byte();
+    }
+  }
+
+  if (!sites.is_at_end() || !phred.is_at_end() || !coverage.is_at_end() || !depth.is_at_end())
+  {
+    BOOST_LOG_TRIVIAL(error) << __HERE__ << " VCF batch file '" << batch_filename << "' is corrupt.";
+    std::exit(1);
+  }
+
+  return true;
+}
+
+
+} // namespace gyper
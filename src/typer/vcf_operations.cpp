@@ -1,17 +1,357 @@
+#include <algorithm> // std::stable_sort
+#include <cassert> // assert
 #include <cmath> // sqrt
+#include <cstdlib> // free
+#include <cstring> // std::strncmp
+#include <functional> // std::greater
+#include <limits> // std::numeric_limits
+#include <queue> // std::priority_queue
 #include <string> // std::string
 #include <sstream> // std::ostringstream
+#include <utility> // std::pair
 #include <vector> // std::vector
 
 #include <boost/log/trivial.hpp> // BOOST_LOG_TRIVIAL
 
+#include <htslib/kstring.h> // kstring_t
+#include "tbx.h" // part of htslib
+
+#include <graphtyper/constants.hpp> // gyper::TAbsPos
 #include <graphtyper/graph/absolute_position.hpp>
 #include <graphtyper/graph/genomic_region.hpp>
+#include <graphtyper/graph/graph.hpp> // gyper::graph
 #include <graphtyper/typer/variant.hpp> // gyper::break_down_variant
 #include <graphtyper/typer/vcf_operations.hpp>
 #include <graphtyper/typer/vcf.hpp> // gyper::Vcf
-#include <graphtyper/typer/var_stats.hpp> // gyper::join_strand_bias, gyper::split_bias_to_strings
+#include <graphtyper/typer/var_stats.hpp> // gyper::InfoStats
 #include <graphtyper/utilities/options.hpp> // gyper::Options
+#include <graphtyper/utilities/parallel.hpp> // gyper::parallel_for_ranges
+
+
+namespace
+{
+
+void
+normalize_variants(std::vector<gyper::Variant> & vars)
+{
+  for (auto & var : vars)
+  {
+    // If we have not processed this variant before, do so now
+    if (!var.is_info_generated)
+      var.normalize();
+  }
+}
+
+
+void
+generate_infos_of_variants(std::vector<gyper::Variant> & vars, long const ploidy)
+{
+  for (auto & var : vars)
+  {
+    // If we have not processed this variant before, do so now
+    if (!var.is_info_generated)
+    {
+      if (ploidy > 2)
+        var.update_camou_phred(ploidy);
+
+      var.generate_infos();
+
+      // Remove MQsquared
+      var.stats.has_mapq_squared = false;
+      var.infos.erase("PS");
+    }
+  }
+}
+
+
+// A VCF to concatenate, its first record and how far its records reach
+struct ConcatInput
+{
+  std::string filename;
+  std::size_t n_samples{0};
+  bool is_empty{true}; // True if the VCF has no records
+  bool is_bgzf{false};
+  std::string first_chrom;
+  uint32_t first_pos{0}; // 1-based position on first_chrom
+  gyper::TAbsPos first_abs_pos{0};
+  gyper::TAbsPos last_abs_pos{0}; // At or after the position of every record
+};
+
+
+// Reads the header and the first record of a VCF to concatenate. The header may set the contigs of the graph, so this
+// is not thread safe.
+void
+scan_concat_input(ConcatInput & input)
+{
+  gyper::Vcf vcf;
+  vcf.open(gyper::READ_MODE, input.filename);
+  vcf.open_vcf_file_for_reading();
+  vcf.read_samples();
+  input.n_samples = vcf.sample_names.size();
+  input.is_bgzf = vcf.filemode == gyper::READ_BGZF_MODE;
+
+  if (vcf.read_record(true /*SITES_ONLY*/))
+  {
+    assert(vcf.variants.size() == 1);
+    auto const contig_pos = gyper::absolute_pos.get_contig_position(vcf.variants[0].abs_pos, gyper::graph.contigs);
+    input.is_empty = false;
+    input.first_chrom = contig_pos.first;
+    input.first_pos = contig_pos.second;
+    input.first_abs_pos = vcf.variants[0].abs_pos;
+  }
+
+  vcf.close_vcf_file();
+}
+
+
+long
+get_contig_index(std::string const & chrom)
+{
+  auto const & contigs = gyper::graph.contigs;
+  auto find_it = std::find_if(contigs.begin(), contigs.end(), [&chrom](gyper::Contig const & contig){
+      return contig.name == chrom;
+    });
+
+  return find_it != contigs.end() ? std::distance(contigs.begin(), find_it) : -1l;
+}
+
+
+// Finds how far the records of an indexed VCF reach using its index, such that only a few BGZF blocks are read.
+// Returns false if the VCF has no index.
+bool
+find_last_position_using_index(ConcatInput & input)
+{
+  tbx_t * tbx = input.is_bgzf ? tbx_index_load(input.filename.c_str()) : nullptr;
+
+  if (!tbx)
+    return false;
+
+  BGZF * fp = bgzf_open(input.filename.c_str(), "r");
+
+  if (!fp)
+  {
+    BOOST_LOG_TRIVIAL(error) << __HERE__ << " Could not open " << input.filename;
+    std::exit(1);
+  }
+
+  // The records of the last contig reach the furthest
+  int n_names{0};
+  char const ** names = tbx_seqnames(tbx, &n_names);
+  int last_tid{-1};
+  long last_contig_index{-1};
+  bool is_unknown_contig{false};
+
+  for (int tid = 0; tid < n_names; ++tid)
+  {
+    long const contig_index = get_contig_index(names[tid]);
+    is_unknown_contig |= contig_index < 0;
+
+    if (contig_index > last_contig_index)
+    {
+      last_tid = tid;
+      last_contig_index = contig_index;
+    }
+  }
+
+  // True if a record starts at or reaches over a 0-based position of the last contig
+  auto has_record_at_or_after =
+    [&](long const pos)
+    {
+      hts_itr_t * itr = tbx_itr_queryi(tbx, last_tid, pos, HTS_POS_MAX);
+      kstring_t str = {0, 0, nullptr};
+      bool const has_record = !itr || tbx_bgzf_itr_next(fp, tbx, itr, &str) >= 0;
+      free(str.s);
+
+      if (itr)
+        tbx_itr_destroy(itr);
+
+      return has_record;
+    };
+
+  if (is_unknown_contig || last_tid < 0)
+  {
+    // Unknown contigs are assumed to overlap everything after the first record
+    input.last_abs_pos = std::numeric_limits<gyper::TAbsPos>::max();
+  }
+  else
+  {
+    // Binary search for the last 0-based position with a record at or after it
+    long lo{0};
+    long hi = gyper::graph.contigs[last_contig_index].length;
+
+    if (has_record_at_or_after(hi))
+    {
+      lo = hi;
+    }
+    else
+    {
+      while (lo + 1 < hi)
+      {
+        long const mid = lo + (hi - lo) / 2;
+
+        if (has_record_at_or_after(mid))
+          lo = mid;
+        else
+          hi = mid;
+      }
+    }
+
+    input.last_abs_pos = gyper::absolute_pos.get_absolute_position(names[last_tid], lo + 1);
+  }
+
+  free(names);
+  bgzf_close(fp);
+  tbx_destroy(tbx);
+  return true;
+}
+
+
+// Finds how far the records of a VCF without an index reach by reading all of them
+void
+find_last_position_by_reading(ConcatInput & input)
+{
+  gyper::Vcf vcf;
+  vcf.open(gyper::READ_MODE, input.filename);
+  vcf.open_vcf_file_for_reading();
+  vcf.read_samples();
+
+  while (vcf.read_record(true /*SITES_ONLY*/))
+  {
+    input.last_abs_pos = std::max(input.last_abs_pos, vcf.variants[0].abs_pos);
+    vcf.variants.clear();
+  }
+
+  vcf.close_vcf_file();
+}
+
+
+// Appends the records of a BGZF compressed VCF to 'out'. Only the block where the header ends is decompressed.
+void
+append_vcf_blocks(std::string const & filename, gyper::BGZF_stream & out)
+{
+  BGZF * in = bgzf_open(filename.c_str(), "r");
+
+  if (!in)
+  {
+    BOOST_LOG_TRIVIAL(error) << __HERE__ << " Could not open " << filename;
+    std::exit(1);
+  }
+
+  // The header ends with the #CHROM line
+  kstring_t line = {0, 0, nullptr};
+
+  while (true)
+  {
+    if (bgzf_getline(in, '\n', &line) < 0)
+    {
+      BOOST_LOG_TRIVIAL(error) << __HERE__ << " Could not find the #CHROM line in " << filename;
+      std::exit(1);
+    }
+
+    if (line.l >= 6 && std::strncmp(line.s, "#CHROM", 6) == 0)
+      break;
+  }
+
+  free(line.s);
+  out.append_bgzf_blocks(in);
+  bgzf_close(in);
+}
+
+
+// Merges the records of VCFs which are each sorted but overlap each other
+void
+merge_sorted_vcfs(std::vector<ConcatInput>::const_iterator begin,
+                  std::vector<ConcatInput>::const_iterator end,
+                  gyper::Vcf & vcf,
+                  gyper::TAbsPos const region_begin,
+                  gyper::TAbsPos const region_end,
+                  bool const SITES_ONLY)
+{
+  using PosAndInput = std::pair<gyper::TAbsPos, long>;
+  long const n_inputs = std::distance(begin, end);
+  std::vector<gyper::Vcf> in_vcfs(n_inputs);
+  std::priority_queue<PosAndInput, std::vector<PosAndInput>, std::greater<PosAndInput> > next_records;
+
+  // Reads the next record of an input, its calls are only decoded if it is inside the region. Inputs are done after
+  // the region since they are sorted.
+  auto read_next_record =
+    [&](long const i, gyper::TAbsPos const prev_abs_pos)
+    {
+      gyper::Vcf & in_vcf = in_vcfs[i];
+
+      if (!in_vcf.read_record(true /*SITES_ONLY*/))
+        return;
+
+      gyper::TAbsPos const abs_pos = in_vcf.variants[0].abs_pos;
+
+      if (abs_pos < prev_abs_pos)
+      {
+        BOOST_LOG_TRIVIAL(error) << __HERE__ << " The VCF file " << in_vcf.filename << " is not sorted.";
+        std::exit(1);
+      }
+
+      if (abs_pos > region_end)
+        return;
+
+      if (!SITES_ONLY && abs_pos >= region_begin)
+        in_vcf.decode_calls();
+
+      next_records.push({abs_pos, i});
+    };
+
+  for (long i = 0; i < n_inputs; ++i)
+  {
+    gyper::Vcf & in_vcf = in_vcfs[i];
+    in_vcf.open(gyper::READ_MODE, (begin + i)->filename);
+    in_vcf.open_vcf_file_for_reading();
+    in_vcf.read_samples();
+    read_next_record(i, 0);
+  }
+
+  // Variants at the same position, they are sorted and duplicates removed when they are written
+  std::vector<gyper::Variant> vars;
+
+  auto write_vars =
+    [&]()
+    {
+      for (auto & var : vars)
+      {
+        if (SITES_ONLY)
+          var.calls.clear();
+        else if (vcf.sample_names.size() > 0)
+          var.generate_infos(); // Regenerate the INFO scores
+      }
+
+      vcf.write_records(region_begin, region_end, false /*FILTER_ZERO_QUAL*/, vars);
+      vars.clear();
+    };
+
+  while (!next_records.empty())
+  {
+    gyper::TAbsPos const abs_pos = next_records.top().first;
+    long const i = next_records.top().second;
+    next_records.pop();
+
+    if (vars.size() > 0 && vars[0].abs_pos != abs_pos)
+      write_vars();
+
+    gyper::Vcf & in_vcf = in_vcfs[i];
+
+    if (abs_pos >= region_begin)
+      vars.push_back(std::move(in_vcf.variants[0]));
+
+    in_vcf.variants.clear();
+    read_next_record(i, abs_pos);
+  }
+
+  write_vars();
+
+  for (auto & in_vcf : in_vcfs)
+    in_vcf.close_vcf_file();
+}
+
+
+} // anon namespace
 
 
 namespace gyper
@@ -28,17 +368,22 @@ vcf_merge(std::vector<std::string> & vcfs, std::string const & output)
   if (vcfs.size() == 0)
     return;
 
+  // The records of the first VCF are read one at a time, together with the records of the other VCFs
+  gyper::Vcf first_vcf;
+  first_vcf.open(READ_MODE, vcfs.at(0));
+  first_vcf.open_vcf_file_for_reading();
+  first_vcf.read_samples();
+
   gyper::Vcf vcf;
-  vcf.open(READ_MODE, vcfs.at(0));
-  vcf.read(); // Read the entire file
-  vcf.open(WRITE_MODE, output); // Change to write mode
+  vcf.open(WRITE_MODE, output);
   vcf.open_for_writing();
+  vcf.sample_names = first_vcf.sample_names;
 
   std::vector<gyper::Vcf> next_vcfs(vcfs.size() - 1);
 
   // For checking if we have duplicated IDs
   long dup = -1l;
-  uint32_t old_abs_pos = static_cast<uint32_t>(-1);
+  TAbsPos old_abs_pos = static_cast<TAbsPos>(-1);
   std::string old_variant_type = "";
 
   // Open all VCFs and add sample names
@@ -53,7 +398,7 @@ vcf_merge(std::vector<std::string> & vcfs, std::string const & output)
     // Open the VCF file
     next_vcf.open_vcf_file_for_reading();
 
-    if (next_vcf.bgzf_in)
+    if (next_vcf.is_open_for_reading())
     {
       // Read the sample names and add them
       next_vcf.read_samples();
@@ -71,88 +416,16 @@ vcf_merge(std::vector<std::string> & vcfs, std::string const & output)
   vcf.write_header(); // Now that we know all the sample names we can write the header
 
   // For each variant in the first VCF, add the calls from the other VCFs
-  for (auto & var : vcf.variants)
+  while (first_vcf.read_record())
   {
-    // Only output variant if it is in the genotyping region
-    // CR
-    uint32_t number_of_clipped_reads = 0;
-
-    {
-      auto find_it = var.infos.find("CR");
-
-      if (find_it != var.infos.end())
-        number_of_clipped_reads = std::strtoull(find_it->second.c_str(), NULL, 10);
-    }
-
-    // MQ. Keep track of the total mapping quality rooted/squared
-    uint64_t mapq_squared = 0;
-
-    {
-      auto find_it = var.infos.find("MQsquared");
-
-      if (find_it != var.infos.end())
-        mapq_squared = std::strtoull(find_it->second.c_str(), NULL, 10);
-    }
-
-    // SBF and SBR
-    std::vector<uint32_t> strand_forward;
-    std::vector<uint32_t> strand_reverse;
-
-    std::vector<uint32_t> r1_strand_forward;
-    std::vector<uint32_t> r1_strand_reverse;
-    std::vector<uint32_t> r2_strand_forward;
-    std::vector<uint32_t> r2_strand_reverse;
-
-//    std::vector<uint32_t> realignment_distance;
-//    std::vector<uint32_t> realignment_count;
-
-    {
-      auto find_it = var.infos.find("SBF");
-
-      if (find_it != var.infos.end())
-        strand_forward = split_bias_to_numbers(find_it->second);
-
-      find_it = var.infos.find("SBR");
-
-      if (find_it != var.infos.end())
-        strand_reverse = split_bias_to_numbers(find_it->second);
-
-      // Read specific strand bias
-      find_it = var.infos.find("SBF1");
-
-      if (find_it != var.infos.end())
-        r1_strand_forward = split_bias_to_numbers(find_it->second);
-
-      find_it = var.infos.find("SBF2");
-
-      if (find_it != var.infos.end())
-        r2_strand_forward = split_bias_to_numbers(find_it->second);
-
-      find_it = var.infos.find("SBR1");
-
-      if (find_it != var.infos.end())
-        r1_strand_reverse = split_bias_to_numbers(find_it->second);
-
-      find_it = var.infos.find("SBR2");
-
-      if (find_it != var.infos.end())
-        r2_strand_reverse = split_bias_to_numbers(find_it->second);
-
-//      // Realignment count and distance
-//      find_it = var.infos.find("RACount");
-//
-//      if (find_it != var.infos.end())
-//        realignment_count = split_bias_to_numbers(find_it->second);
-//
-//      find_it = var.infos.find("RADist");
-//
-//      if (find_it != var.infos.end())
-//        realignment_distance = split_bias_to_numbers(find_it->second);
-    }
+    assert(first_vcf.variants.size() == 1);
+    Variant var = std::move(first_vcf.variants[0]);
+    first_vcf.variants.clear();
 
+    // Only output variant if it is in the genotyping region
     for (auto & next_vcf : next_vcfs)
     {
-      if (!next_vcf.bgzf_in)
+      if (!next_vcf.is_open_for_reading())
         continue;
 
       assert(next_vcf.variants.size() == 0);
@@ -167,53 +440,8 @@ vcf_merge(std::vector<std::string> & vcfs, std::string const & output)
 
       assert(next_vcf.variants.size() == 1);
 
-      // Get CR
-      {
-        auto find_it = next_vcf.variants[0].infos.find("CR");
-
-        if (find_it != next_vcf.variants[0].infos.end())
-          number_of_clipped_reads += std::strtoull(find_it->second.c_str(), NULL, 10);
-      }
-
-      // Get MQ
-      {
-        auto find_it = next_vcf.variants[0].infos.find("MQsquared");
-
-        if (find_it != next_vcf.variants[0].infos.end())
-          mapq_squared += std::strtoull(find_it->second.c_str(), NULL, 10);
-      }
-
-
-      // Get SBF and SBR
-      {
-        auto add_to_bias_lambda = [&](std::string id, std::vector<uint32_t> & bias)
-                                  {
-                                    auto find_it = next_vcf.variants[0].infos.find(id);
-
-                                    if (find_it != next_vcf.variants[0].infos.end())
-                                    {
-                                      std::vector<uint32_t> split_nums =
-                                        split_bias_to_numbers(find_it->second);
-
-                                      for (std::size_t i = 0; i < split_nums.size(); ++i)
-                                      {
-                                        if (i < strand_forward.size())
-                                          bias[i] += split_nums[i];
-                                        else
-                                          bias.push_back(split_nums[i]);
-                                      }
-                                    }
-                                  };
-
-        add_to_bias_lambda("SBF", strand_forward);
-        add_to_bias_lambda("SBR", strand_reverse);
-        add_to_bias_lambda("SBF1", r1_strand_forward);
-        add_to_bias_lambda("SBF2", r2_strand_forward);
-        add_to_bias_lambda("SBR1", r1_strand_reverse);
-        add_to_bias_lambda("SBR2", r2_strand_reverse);
-//        add_to_bias_lambda("RACount", realignment_count);
-//        add_to_bias_lambda("RADist", realignment_distance);
-      }
+      // Add CR, MQsquared and strand bias
+      var.stats.merge_with(next_vcf.variants[0].stats);
 
       std::move(next_vcf.variants[0].calls.begin(),
                 next_vcf.variants[0].calls.end(),
@@ -222,23 +450,8 @@ vcf_merge(std::vector<std::string> & vcfs, std::string const & output)
       next_vcf.variants.clear();
     }
 
-    // Add strand bias, this must happend before the INFO is generated
-    var.infos["SBF"] = join_strand_bias(strand_forward);
-    var.infos["SBR"] = join_strand_bias(strand_reverse);
-
-    var.infos["SBF1"] = join_strand_bias(r1_strand_forward);
-    var.infos["SBF2"] = join_strand_bias(r2_strand_forward);
-    var.infos["SBR1"] = join_strand_bias(r1_strand_reverse);
-    var.infos["SBR2"] = join_strand_bias(r2_strand_reverse);
-
-//    var.infos["RACount"] = join_strand_bias(realignment_count);
-//    var.infos["RADist"] = join_strand_bias(realignment_distance);
-
-    // Add MQsquared
-    var.infos["MQsquared"] = std::to_string(mapq_squared);
-
-    // Add CR
-    var.infos["CR"] = std::to_string(number_of_clipped_reads);
+    // A merged record always has CR, MQsquared and strand bias, this must happend before the INFO is generated
+    var.stats.set_all();
 
     // generate the rest of the INFOs
     var.generate_infos();
@@ -270,11 +483,11 @@ vcf_merge(std::vector<std::string> & vcfs, std::string const & output)
 
     old_abs_pos = var.abs_pos;
     old_variant_type = new_variant_type;
-
-    var = Variant(); // Free memory
   }
 
   // Close all the files
+  first_vcf.close_vcf_file();
+
   for (auto & next_vcf : next_vcfs)
     next_vcf.close_vcf_file();
 
@@ -297,53 +510,42 @@ vcf_merge_and_break(std::vector<std::string> const & vcfs,
   auto const & copts = *(Options::const_instance());
   long const ploidy = copts.ploidy;
   GenomicRegion genomic_region(region);
-  uint32_t const region_begin = 1 + absolute_pos.get_absolute_position(genomic_region.chr,
-                                                                       genomic_region.begin
-                                                                       );
+  TAbsPos const region_begin = 1 + absolute_pos.get_absolute_position(genomic_region.chr,
+                                                                      genomic_region.begin
+                                                                      );
 
-  uint32_t const region_end = absolute_pos.get_absolute_position(genomic_region.chr,
-                                                                 genomic_region.end);
+  TAbsPos const region_end = absolute_pos.get_absolute_position(genomic_region.chr,
+                                                                genomic_region.end);
 
-  auto const & vcf_fn = vcfs[0];
+  // The VCFs are merged one batch at a time. All VCFs have the same variants, so their batches are the same size.
   Vcf vcf;
-  load_vcf(vcf, vcf_fn, 0);
-  long n_batch{1};
-
-  // Read the entire file
-  while (append_vcf(vcf, vcf_fn, n_batch))
-    ++n_batch;
-
+  load_vcf(vcf, vcfs[0], 0);
   vcf.open(WRITE_MODE, output); // Change to write mode
-  vcf.open_for_writing(copts.threads);
-  BOOST_LOG_TRIVIAL(debug) << __HERE__ << " Read " << vcf.variants.size() << " variants.";
+  vcf.open_for_writing(copts.threads, true /*is_indexing*/);
 
   std::vector<gyper::Vcf> next_vcfs(vcfs.size() - 1);
-  n_batch = 1;
 
   // Open all VCFs and add sample names
   for (long i = 1; i < static_cast<long>(vcfs.size()); ++i)
   {
-    auto const & vcf_fn = vcfs[i];
     assert((i - 1) < static_cast<long>(next_vcfs.size()));
     gyper::Vcf & next_vcf = next_vcfs[i - 1];
-    load_vcf(next_vcf, vcf_fn, 0);
-
-    assert(next_vcf.variants.size() == next_vcfs[0].variants.size()); // all bins have the same number of variants
+    load_vcf(next_vcf, vcfs[i], 0);
 
     // Add the samples on the first batch
     vcf.sample_names.insert(vcf.sample_names.end(),
                             next_vcf.sample_names.begin(),
                             next_vcf.sample_names.end());
-
-
   }
 
   // We have all the samples, write the header now
   vcf.write_header();
 
+  bool const is_no_variant_overlapping{copts.no_variant_overlapping || force_no_variant_overlapping};
+  bool const is_all_biallelic{copts.is_all_biallelic};
   long reach{-1};
   std::vector<Variant> broken_vars; // broken down variants
-  long v_next{0}; // number of variants analyzed in previous batches
+  long n_batch{1}; // next batch to read
 
   // lambda function for updating the reach
   auto update_reach =
@@ -358,238 +560,156 @@ vcf_merge_and_break(std::vector<std::string> const & vcfs,
       }
     };
 
-  for (long v = 0; v < static_cast<long>(vcf.variants.size()); ++v)
+  while (true)
   {
-    auto & var = vcf.variants[v];
-
-    // CR
-    uint32_t number_of_clipped_reads = 0;
-
+    // All batches have the same number of variants
+    for (long i = 1; i < static_cast<long>(vcfs.size()); ++i)
     {
-      auto find_it = var.infos.find("CR");
-
-      if (find_it != var.infos.end())
-        number_of_clipped_reads = std::strtoull(find_it->second.c_str(), NULL, 10);
-    }
-
-    // MQ. Keep track of the total mapping quality rooted/squared
-    uint64_t mapq_squared = 0;
-
-    {
-      auto find_it = var.infos.find("MQsquared");
-
-      if (find_it != var.infos.end())
-        mapq_squared = std::strtoull(find_it->second.c_str(), NULL, 10);
+      if (next_vcfs[i - 1].variants.size() != vcf.variants.size())
+      {
+        BOOST_LOG_TRIVIAL(error) << __HERE__ << " Batch " << (n_batch - 1) << " of " << vcfs[i] << " has "
+                                 << next_vcfs[i - 1].variants.size() << " variants but expected "
+                                 << vcf.variants.size();
+        std::exit(1);
+      }
     }
 
-    // SBF and SBR
-    std::vector<uint32_t> strand_forward;
-    std::vector<uint32_t> strand_reverse;
+    long const num_vars = vcf.variants.size();
+    std::vector<std::vector<Variant> > new_variants(num_vars);
 
-    std::vector<uint32_t> r1_strand_forward;
-    std::vector<uint32_t> r1_strand_reverse;
-    std::vector<uint32_t> r2_strand_forward;
-    std::vector<uint32_t> r2_strand_reverse;
-
-    {
-      auto find_it = var.infos.find("SBF");
-
-      if (find_it != var.infos.end())
-        strand_forward = split_bias_to_numbers(find_it->second);
-
-      find_it = var.infos.find("SBR");
+    // Merges the calls of each variant and breaks down the ones which do not depend on the variants before them
+    auto merge_and_break_down =
+      [&](long const v_begin, long const v_end)
+      {
+        for (long v = v_begin; v < v_end; ++v)
+        {
+          auto & var = vcf.variants[v];
 
-      if (find_it != var.infos.end())
-        strand_reverse = split_bias_to_numbers(find_it->second);
+          for (auto & next_vcf : next_vcfs)
+          {
+            auto & next_vcf_var = next_vcf.variants[v];
 
-      // Read specific strand bias
-      find_it = var.infos.find("SBF1");
+            // Add CR, MQsquared and strand bias
+            var.stats.merge_with(next_vcf_var.stats);
 
-      if (find_it != var.infos.end())
-        r1_strand_forward = split_bias_to_numbers(find_it->second);
+            std::move(next_vcf_var.calls.begin(),
+                      next_vcf_var.calls.end(),
+                      std::back_inserter(var.calls));
 
-      find_it = var.infos.find("SBF2");
+            next_vcf_var = Variant(); // Free memory
+          }
 
-      if (find_it != var.infos.end())
-        r2_strand_forward = split_bias_to_numbers(find_it->second);
+          // A merged record always has CR, MQsquared and strand bias, this must happend before the INFO is generated
+          var.stats.set_all();
 
-      find_it = var.infos.find("SBR1");
+          if (var.calls.size() != vcf.sample_names.size())
+          {
+            BOOST_LOG_TRIVIAL(error) << "Number of calls a variant had did not matches the number of samples "
+                                     << var.calls.size() << " vs. " << vcf.sample_names.size();
+            std::exit(1);
+          }
 
-      if (find_it != var.infos.end())
-        r1_strand_reverse = split_bias_to_numbers(find_it->second);
+          if (force_no_break_down)
+          {
+            new_variants[v].push_back(std::move(var));
+            normalize_variants(new_variants[v]);
+            generate_infos_of_variants(new_variants[v], ploidy);
+          }
+          else if (!is_break_down_using_reach(var, is_no_variant_overlapping))
+          {
+            new_variants[v] = break_down_variant(std::move(var),
+                                                 -1, // reach is not used
+                                                 is_no_variant_overlapping,
+                                                 is_all_biallelic);
+            normalize_variants(new_variants[v]);
+            generate_infos_of_variants(new_variants[v], ploidy);
+          }
+        }
+      };
 
-      find_it = var.infos.find("SBR2");
+    parallel_for_ranges(num_vars, merge_and_break_down);
 
-      if (find_it != var.infos.end())
-        r2_strand_reverse = split_bias_to_numbers(find_it->second);
-    }
+    // Break down the remaining variants in order, since they depend on how far the variants before them reach
+    std::vector<long> serial_vars; // Indices of the variants broken down here
 
-    // Trigger read next batch
-    if (next_vcfs.size() > 0 && (v - v_next) == static_cast<long>(next_vcfs[0].variants.size()))
+    for (long v = 0; v < num_vars; ++v)
     {
-      BOOST_LOG_TRIVIAL(debug) << __HERE__ << " Updating next_vcfs";
-
-      v_next += static_cast<long>(next_vcfs[0].variants.size());
-
-      for (long i = 1; i < static_cast<long>(vcfs.size()); ++i)
+      if (new_variants[v].size() == 0)
       {
-        auto const & vcf_fn = vcfs[i];
-        Vcf & next_vcf = next_vcfs[i - 1];
-        next_vcf.variants.clear(); // clear previous batch
-        bool ret = append_vcf(next_vcf, vcf_fn, n_batch);
-
-        if (!ret)
-        {
-          BOOST_LOG_TRIVIAL(error) << __HERE__ << " Could not find file " << vcf_fn;
-          std::exit(1);
-        }
+        new_variants[v] = break_down_variant(std::move(vcf.variants[v]),
+                                             reach,
+                                             is_no_variant_overlapping,
+                                             is_all_biallelic);
+        normalize_variants(new_variants[v]);
+        serial_vars.push_back(v);
       }
 
-      ++n_batch;
+      assert(new_variants[v].size() > 0);
+      update_reach(new_variants[v]);
     }
 
-    for (auto & next_vcf : next_vcfs)
-    {
-      assert((v - v_next) >= 0);
-      assert((v - v_next) < static_cast<long>(next_vcf.variants.size()));
-      auto & next_vcf_var = next_vcf.variants[v - v_next];
-
-      // Get CR
+    auto generate_infos_of_serial_vars =
+      [&](long const i_begin, long const i_end)
       {
-        auto find_it = next_vcf_var.infos.find("CR");
-
-        if (find_it != next_vcf_var.infos.end())
-          number_of_clipped_reads += std::strtoull(find_it->second.c_str(), NULL, 10);
-      }
+        for (long i = i_begin; i < i_end; ++i)
+          generate_infos_of_variants(new_variants[serial_vars[i]], ploidy);
+      };
 
-      // Get MQ
-      {
-        auto find_it = next_vcf_var.infos.find("MQsquared");
+    parallel_for_ranges(static_cast<long>(serial_vars.size()), generate_infos_of_serial_vars);
 
-        if (find_it != next_vcf_var.infos.end())
-          mapq_squared += std::strtoull(find_it->second.c_str(), NULL, 10);
-      }
+    // Write the variants in order
+    for (long v = 0; v < num_vars; ++v)
+    {
+      std::move(new_variants[v].begin(), new_variants[v].end(), std::back_inserter(broken_vars));
+      new_variants[v] = std::vector<Variant>(); // Free memory
 
+      long constexpr W = 500; // Print variants that are more than W bp before the newest one
 
-      // Get SBF and SBR
+      if ((broken_vars[0].abs_pos + 2 * W) < broken_vars[broken_vars.size() - 1].abs_pos)
       {
-        auto add_to_bias_lambda =
-          [&](std::string id, std::vector<uint32_t> & bias)
+        // Make sure we do no print outside of the region
+        TAbsPos const reg_end =
+          std::min(region_end, static_cast<TAbsPos>(broken_vars[broken_vars.size() - 1].abs_pos - W));
+
+        vcf.write_records(region_begin,
+                          reg_end,
+                          FILTER_ZERO_QUAL,
+                          broken_vars);
+
+        // Remove variants that were written (or before the region, since they will never be printed)
+        broken_vars.erase(
+          std::remove_if(broken_vars.begin(),
+                         broken_vars.end(),
+                         [&](Variant const & v)
           {
-            auto find_it = next_vcf_var.infos.find(id);
-
-            if (find_it != next_vcf_var.infos.end())
-            {
-              std::vector<uint32_t> split_nums = split_bias_to_numbers(find_it->second);
-
-              for (long i = 0; i < static_cast<long>(split_nums.size()); ++i)
-              {
-                if (i < static_cast<long>(strand_forward.size()))
-                  bias[i] += split_nums[i];
-                else
-                  bias.push_back(split_nums[i]);
-              }
-            }
-          };
-
-        add_to_bias_lambda("SBF", strand_forward);
-        add_to_bias_lambda("SBR", strand_reverse);
-        add_to_bias_lambda("SBF1", r1_strand_forward);
-        add_to_bias_lambda("SBF2", r2_strand_forward);
-        add_to_bias_lambda("SBR1", r1_strand_reverse);
-        add_to_bias_lambda("SBR2", r2_strand_reverse);
+            return v.abs_pos <= reg_end || v.abs_pos < region_begin;
+          }),
+          broken_vars.end()
+          );
       }
-
-      std::move(next_vcf_var.calls.begin(),
-                next_vcf_var.calls.end(),
-                std::back_inserter(var.calls));
     }
 
-    // Add strand bias, this must happend before the INFO is generated
-    var.infos["SBF"] = join_strand_bias(strand_forward);
-    var.infos["SBR"] = join_strand_bias(strand_reverse);
-
-    var.infos["SBF1"] = join_strand_bias(r1_strand_forward);
-    var.infos["SBF2"] = join_strand_bias(r2_strand_forward);
-    var.infos["SBR1"] = join_strand_bias(r1_strand_reverse);
-    var.infos["SBR2"] = join_strand_bias(r2_strand_reverse);
+    // Read the next batch of every VCF, the batch before is no longer needed
+    vcf.variants.clear();
 
-    // Add MQsquared
-    var.infos["MQsquared"] = std::to_string(mapq_squared);
+    if (!append_vcf(vcf, vcfs[0], n_batch))
+      break;
 
-    // Add CR
-    var.infos["CR"] = std::to_string(number_of_clipped_reads);
+    BOOST_LOG_TRIVIAL(debug) << __HERE__ << " Merging batch " << n_batch;
 
-    if (var.calls.size() != vcf.sample_names.size())
+    for (long i = 1; i < static_cast<long>(vcfs.size()); ++i)
     {
-      BOOST_LOG_TRIVIAL(error) << "Number of calls a variant had did not matches the number of samples "
-                               << var.calls.size() << " vs. " << vcf.sample_names.size();
-      std::exit(1);
-    }
-
-    // break down the merged variants
-    bool const is_no_variant_overlapping{copts.no_variant_overlapping ||
-                                         force_no_variant_overlapping};
-
-    bool const is_all_biallelic{copts.is_all_biallelic};
-    std::vector<Variant> new_variants;
-
-    if (force_no_break_down)
-      new_variants.push_back(std::move(var));
-    else
-      new_variants = break_down_variant(std::move(var),
-                                        reach,
-                                        is_no_variant_overlapping,
-                                        is_all_biallelic);
-    assert(new_variants.size() > 0);
+      Vcf & next_vcf = next_vcfs[i - 1];
+      next_vcf.variants.clear();
 
-    for (auto & new_var : new_variants)
-    {
-      // If we have not processed this variant before, do so now
-      if (!new_var.is_info_generated)
+      if (!append_vcf(next_vcf, vcfs[i], n_batch))
       {
-        new_var.normalize();
-
-        if (ploidy > 2)
-          new_var.update_camou_phred(ploidy);
-
-        new_var.generate_infos();
-
-        // Remove MQsquared
-        new_var.infos.erase("MQsquared");
-        new_var.infos.erase("PS");
+        BOOST_LOG_TRIVIAL(error) << __HERE__ << " Could not find batch " << n_batch << " of " << vcfs[i];
+        std::exit(1);
       }
     }
 
-    update_reach(new_variants);
-    std::move(new_variants.begin(), new_variants.end(), std::back_inserter(broken_vars));
-
-    long constexpr W = 500; // Print variants that are more than W bp before the newest one
-
-    if ((broken_vars[0].abs_pos + 2 * W) < broken_vars[broken_vars.size() - 1].abs_pos)
-    {
-      // Make sure we do no print outside of the region
-      uint32_t const reg_end =
-        std::min(region_end, static_cast<uint32_t>(broken_vars[broken_vars.size() - 1].abs_pos - W));
-
-      vcf.write_records(region_begin,
-                        reg_end,
-                        FILTER_ZERO_QUAL,
-                        broken_vars);
-
-      // Remove variants that were written (or before the region, since they will never be printed)
-      broken_vars.erase(
-        std::remove_if(broken_vars.begin(),
-                       broken_vars.end(),
-                       [&](Variant const & v)
-        {
-          return v.abs_pos <= reg_end || v.abs_pos < region_begin;
-        }),
-        broken_vars.end()
-        );
-    }
-
-    var = Variant(); // Free memory
+    ++n_batch;
   }
 
   // Write the remaining broken variants
@@ -598,8 +718,7 @@ vcf_merge_and_break(std::vector<std::string> const & vcfs,
                     FILTER_ZERO_QUAL,
                     broken_vars);
 
-  vcf.close_vcf_file();
-  vcf.write_tbi_index();
+  vcf.close_vcf_file(); // Also saves the index
 }
 
 
@@ -625,6 +744,7 @@ vcf_concatenate(std::vector<std::string> const & vcfs,
   {
     vcf.open(WRITE_MODE, output);
     vcf.open_for_writing();
+    bool const is_copying_blocks = !SITES_ONLY && vcf.filemode == WRITE_BGZF_MODE;
 
     if (SITES_ONLY)
     {
@@ -670,6 +790,14 @@ vcf_concatenate(std::vector<std::string> const & vcfs,
         std::exit(1);
       }
 
+      if (is_copying_blocks && next_vcf.filemode == READ_BGZF_MODE)
+      {
+        // The records are copied as they are
+        next_vcf.close_vcf_file();
+        append_vcf_blocks(vcfs[i], vcf.bgzf_stream);
+        continue;
+      }
+
       while (next_vcf.read_record(SITES_ONLY))
       {
         // Add variants
@@ -695,63 +823,140 @@ vcf_concatenate(std::vector<std::string> const & vcfs,
   }
   else // Also sort
   {
+    auto const & copts = *(Options::const_instance());
+    std::vector<ConcatInput> inputs;
+
+    for (auto const & filename : vcfs)
+    {
+      // Skip if the filename contains '*'
+      if (std::count(filename.begin(), filename.end(), '*') > 0)
+        continue;
+
+      ConcatInput input;
+      input.filename = filename;
+      inputs.push_back(std::move(input));
+    }
+
     vcf.open(WRITE_MODE, output);
-    vcf.open_for_writing();
+    vcf.open_for_writing(copts.threads);
 
-    if (SITES_ONLY)
-      vcf.sample_names.clear();
+    if (inputs.size() > 0)
+    {
+      // The headers may set the contigs, so they are read one at a time
+      for (auto & input : inputs)
+        scan_concat_input(input);
+
+      if (!SITES_ONLY)
+      {
+        Vcf first_vcf;
+        first_vcf.open(READ_MODE, inputs[0].filename);
+        first_vcf.open_vcf_file_for_reading();
+        first_vcf.read_samples();
+        vcf.sample_names = first_vcf.sample_names;
+        first_vcf.close_vcf_file();
+
+        for (auto const & input : inputs)
+        {
+          if (input.n_samples != vcf.sample_names.size())
+          {
+            BOOST_LOG_TRIVIAL(error) << "[graphtyper::vcf_operations] The VCF file "
+                                     << input.filename
+                                     << " has different amount of samples! ("
+                                     << input.n_samples
+                                     << " but not " << vcf.sample_names.size() << ")";
+            std::exit(1);
+          }
+        }
+      }
+    }
 
     BOOST_LOG_TRIVIAL(debug) << "[graphtyper::vcf_operations] Total number of samples read is "
                              << vcf.sample_names.size();
 
-    for (std::size_t i = 0; i < vcfs.size(); ++i)
+    // Order the VCFs by their first record
+    inputs.erase(std::remove_if(inputs.begin(), inputs.end(), [](ConcatInput const & input){
+        return input.is_empty;
+      }), inputs.end());
+
+    std::stable_sort(inputs.begin(), inputs.end(), [](ConcatInput const & a, ConcatInput const & b){
+        return a.first_abs_pos < b.first_abs_pos;
+      });
+
+    // Find how far the records of each VCF reach. Indexes are only read in parallel, the VCFs without one are read
+    // afterwards since reading their header may change the contigs.
+    long const n_inputs = inputs.size();
+    std::vector<char> is_indexed(n_inputs, 0);
+
+    parallel_for_ranges(n_inputs, [&](long const i_begin, long const i_end){
+        for (long i = i_begin; i < i_end; ++i)
+          is_indexed[i] = find_last_position_using_index(inputs[i]);
+      });
+
+    for (long i = 0; i < n_inputs; ++i)
     {
-      // Skip if the filename contains '*'
-      if (std::count(vcfs[i].begin(), vcfs[i].end(), '*') > 0)
-        continue;
+      if (!is_indexed[i])
+        find_last_position_by_reading(inputs[i]);
+    }
 
-      gyper::Vcf next_vcf;
-      next_vcf.open(READ_MODE, vcfs[i]);
-      next_vcf.read(SITES_ONLY);
+    TAbsPos region_begin = 0;
+    TAbsPos region_end = std::numeric_limits<TAbsPos>::max();
 
-      if (SITES_ONLY)
-      {
-        next_vcf.sample_names.clear();
+    // Restrict to a region if it is given
+    if (region != ".")
+    {
+      GenomicRegion genomic_region(region);
 
-        for (auto & var : next_vcf.variants)
-          var.calls.clear();
+      if (absolute_pos.is_contig_available(genomic_region.chr))
+      {
+        region_begin = 1 + absolute_pos.get_absolute_position(genomic_region.chr, genomic_region.begin);
+        region_end = absolute_pos.get_absolute_position(genomic_region.chr, genomic_region.end);
       }
-      else if (i == 0)
+    }
+
+    // Records can be copied as they are unless they are filtered or changed
+    bool const is_copying_blocks = !SITES_ONLY &&
+                                   vcf.filemode == WRITE_BGZF_MODE &&
+                                   region_begin == 0 &&
+                                   region_end == std::numeric_limits<TAbsPos>::max();
+
+    vcf.write_header();
+    long n_copied{0};
+
+    // VCFs which do not overlap any other VCF are copied, the others are merged. A run of overlapping VCFs goes on
+    // while the next VCF starts before the furthest reach of the VCFs in the run, which may be a VCF before the last.
+    for (long i_begin = 0; i_begin < n_inputs;)
+    {
+      long i_end = i_begin + 1;
+      TAbsPos run_last_abs_pos = inputs[i_begin].last_abs_pos;
+
+      while (i_end < n_inputs && inputs[i_end].first_abs_pos <= run_last_abs_pos)
       {
-        // First VCF gets
-        vcf.sample_names = next_vcf.sample_names;
+        run_last_abs_pos = std::max(run_last_abs_pos, inputs[i_end].last_abs_pos);
+        ++i_end;
       }
 
-      // Merge with the other VCF
-      if (next_vcf.sample_names.size() != vcf.sample_names.size())
+      if (i_end - i_begin == 1 && is_copying_blocks && inputs[i_begin].is_bgzf)
       {
-        BOOST_LOG_TRIVIAL(error) << "[graphtyper::vcf_operations] The VCF file "
-                                 << vcfs[i]
-                                 << " has different amount of samples! ("
-                                 << next_vcf.sample_names.size()
-                                 << " but not " << vcf.sample_names.size() << ")";
-        std::exit(1);
+        append_vcf_blocks(inputs[i_begin].filename, vcf.bgzf_stream);
+        ++n_copied;
+      }
+      else
+      {
+        merge_sorted_vcfs(inputs.begin() + i_begin,
+                          inputs.begin() + i_end,
+                          vcf,
+                          region_begin,
+                          region_end,
+                          SITES_ONLY);
       }
 
-      // Add variants
-      std::move(next_vcf.variants.begin(),
-                next_vcf.variants.end(),
-                std::back_inserter(vcf.variants));
+      i_begin = i_end;
     }
 
-    // Regenerate the INFO scores
-    if (vcf.sample_names.size() > 0)
-    {
-      for (auto & var : vcf.variants)
-        var.generate_infos();
-    }
+    BOOST_LOG_TRIVIAL(debug) << "[graphtyper::vcf_operations] Copied " << n_copied << " of " << n_inputs
+                             << " VCFs without decompressing them.";
 
-    vcf.write(region);
+    vcf.close_vcf_file();
   }
 }
 
@@ -767,7 +972,7 @@ vcf_break_down(std::string const & vcf, std::string const & output, std::string
 
   // Open the VCF files
   vcf_in.open_vcf_file_for_reading();
-  vcf_out.open_for_writing();
+  vcf_out.open_for_writing(1, true /*is_indexing*/);
 
   // Read the sample names and add them
   vcf_in.read_samples();
@@ -782,12 +987,12 @@ vcf_break_down(std::string const & vcf, std::string const & output, std::string
             );
 
   GenomicRegion genomic_region(region);
-  uint32_t const region_begin = 1 + absolute_pos.get_absolute_position(genomic_region.chr,
-                                                                       genomic_region.begin
-                                                                       );
+  TAbsPos const region_begin = 1 + absolute_pos.get_absolute_position(genomic_region.chr,
+                                                                      genomic_region.begin
+                                                                      );
 
-  uint32_t const region_end = absolute_pos.get_absolute_position(genomic_region.chr,
-                                                                 genomic_region.end
+  TAbsPos const region_end = absolute_pos.get_absolute_position(genomic_region.chr,
+                                                                genomic_region.end
                                                                  );
 
   // Read first record
@@ -811,6 +1016,30 @@ vcf_break_down(std::string const & vcf, std::string const & output, std::string
       }
     };
 
+  // Normalizes and generates INFOs of the variants which are about to be written. This goes over every call, so it
+  // is done in parallel when there are many calls.
+  auto generate_infos =
+    [&vcf_out]()
+    {
+      auto generate_infos_in_range =
+        [&vcf_out](long const begin, long const end)
+        {
+          for (long i = begin; i < end; ++i)
+          {
+            vcf_out.variants[i].normalize();
+            vcf_out.variants[i].generate_infos();
+          }
+        };
+
+      long const num_vars = vcf_out.variants.size();
+      long constexpr MIN_CALLS_FOR_PARALLEL = 1000000l;
+
+      if (num_vars * static_cast<long>(vcf_out.sample_names.size()) >= MIN_CALLS_FOR_PARALLEL)
+        parallel_for_ranges(num_vars, generate_infos_in_range);
+      else
+        generate_infos_in_range(0, num_vars);
+    };
+
   // Loop over the entire VCF in file, line by line
   for (; not_at_end; not_at_end = vcf_in.read_record())
   {
@@ -844,17 +1073,12 @@ vcf_break_down(std::string const & vcf, std::string const & output, std::string
 
     if ((vcf_out.variants.front().abs_pos + 3 * W) < vcf_in.variants.back().abs_pos)
     {
-      // Generate infos
-      for (auto & var : vcf_out.variants)
-      {
-        var.normalize();
-        var.generate_infos();
-      }
+      generate_infos();
 
       // Make sure we do no print outside of the region
-      uint32_t const reg_end = std::min(region_end,
-                                        static_cast<uint32_t>(vcf_in.variants.back().abs_pos - W)
-                                        );
+      TAbsPos const reg_end = std::min(region_end,
+                                       static_cast<TAbsPos>(vcf_in.variants.back().abs_pos - W)
+                                       );
 
       vcf_out.write_records(region_begin,
                             reg_end,
@@ -882,17 +1106,11 @@ vcf_break_down(std::string const & vcf, std::string const & output, std::string
     vcf_in.variants.clear();
   }
 
-  // Generate infos
-  for (auto & var : vcf_out.variants)
-  {
-    var.normalize();
-    var.generate_infos();
-  }
+  generate_infos();
 
   vcf_out.write_records(region_begin, region_end, true /*FILTER_ZERO_QUAL*/, vcf_out.variants);
   vcf_in.close_vcf_file();
-  vcf_out.close_vcf_file();
-  vcf_out.write_tbi_index();
+  vcf_out.close_vcf_file(); // Also saves the index
 }
 
 
@@ -21,6 +21,7 @@
 #include <graphtyper/utilities/graph_help_functions.hpp>
 #include <graphtyper/utilities/io.hpp>
 #include <graphtyper/utilities/options.hpp>
+#include <graphtyper/utilities/stage_report.hpp>
 
 
 namespace
@@ -73,6 +74,7 @@ namespace gyper
 VcfWriter::VcfWriter(uint32_t variant_distance)
 {
   haplotypes = gyper::graph.get_all_haplotypes(variant_distance);
+  stage_report.haplotype_blocks = haplotypes.size(); // Every writer of the graph has the same blocks
   BOOST_LOG_TRIVIAL(debug) << "[graphtyper::vcf_writer] Number of variant nodes in graph "
                            << graph.var_nodes.size();
   BOOST_LOG_TRIVIAL(debug) << "[graphtyper::vcf_writer] Got "
@@ -93,7 +95,7 @@ VcfWriter::set_samples(std::vector<std::string> const & samples)
   {
     auto & haplotype = haplotypes[i];
     haplotype.clear_and_resize_samples(NUM_SAMPLES);
-    std::vector<uint32_t> gt_ids = haplotype.get_genotype_ids();
+    std::vector<TAbsPos> gt_ids = haplotype.get_genotype_ids();
 
     for (long j = 0; j < static_cast<long>(gt_ids.size()); ++j)
     {
@@ -144,7 +146,7 @@ VcfWriter::print_variant_group_details() const
     for (uint32_t c = 0; c < cnum; ++c)
     {
       assert(hap.gts.size() > 0);
-      uint32_t const abs_pos = hap.gts[0].id;
+      TAbsPos const abs_pos = hap.gts[0].id;
       std::vector<char> seq = graph.get_sequence_of_a_haplotype_call(hap.gts, c);
       assert(seq.size() > 1);
       auto contig_pos = absolute_pos.get_contig_position(abs_pos, gyper::graph.contigs);
@@ -272,8 +274,8 @@ VcfWriter::print_geno_statistics(std::stringstream & read_ss,
   for (std::size_t p = 0; p < geno.paths.size(); ++p)
   {
     auto const & path = geno.paths[p];
-    uint32_t const ref_reach_start = path.start_ref_reach_pos();
-    uint32_t const ref_reach_end = path.end_ref_reach_pos();
+    TAbsPos const ref_reach_start = path.start_ref_reach_pos();
+    TAbsPos const ref_reach_end = path.end_ref_reach_pos();
 
     auto const contig_pos_start = absolute_pos.get_contig_position(ref_reach_start,
                                                                    gyper::graph.contigs);
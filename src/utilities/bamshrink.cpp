@@ -1,23 +1,31 @@
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
 #include <iostream>
 #include <limits>
-#include <map>
-#include <unordered_map>
+#include <memory>
+#include <set>
+#include <sstream>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
+#include <htslib/hts.h>
 #include <htslib/sam.h>
 
-#include <seqan/file.h>
-#include <seqan/bam_io.h>
-#include <seqan/align.h>
-#include <seqan/sequence.h>
-#include <seqan/seq_io.h>
-#include <seqan/store.h>
-
 #include <paw/parser.hpp>
 
 #include <boost/log/trivial.hpp>
 
+#include <graphtyper/constants.hpp>
+#include <graphtyper/graph/genomic_region.hpp>
+#include <graphtyper/typer/caller.hpp> // gyper::CigarDiscovery
 #include <graphtyper/utilities/bamshrink.hpp>
+#include <graphtyper/utilities/hts_reader.hpp> // gyper::set_shared_cram_reference, gyper::get_hts_thread_pool
+#include <graphtyper/utilities/hts_store.hpp>
 #include <graphtyper/utilities/options.hpp>
 
 
@@ -36,241 +44,260 @@ bool constexpr CHANGE_READ_NAMES = true;
 namespace
 {
 
-void
-removeHardClipped(seqan::String<seqan::CigarElement<> > & cigar)
+struct Interval
 {
-  long n_cigar = seqan::length(cigar);
+  std::string chrom;
+  int begin{0}; // 0-based
+  int end{0}; // 0-based, inclusive
+};
 
-  if (n_cigar >= 1 && cigar[0].operation == 'H')
-  {
-    seqan::erase(cigar, 0);
-    --n_cigar;
-  }
 
-  if (n_cigar >= 2 && cigar[n_cigar - 1].operation == 'H')
-    seqan::eraseBack(cigar);
+// Complement of each 4-bit encoded base in seq_nt16_str "=ACMGRSVTWYHKDBN"
+uint8_t constexpr NT16_COMPLEMENT[16] = {0, 8, 4, 12, 2, 10, 6, 14, 1, 9, 5, 13, 3, 11, 7, 15};
+uint8_t constexpr NT16_N = 15;
+
+
+/** In-place editing of bam1_t records.
+ *  The variable length data of a record is laid out as qname|cigar|seq|qual|aux so removing parts of it is done by
+ *  moving the tail of the data block. Records never grow except when renamed.
+ */
+inline void
+erase_data(bam1_t * rec, uint8_t * pos, long const n)
+{
+  uint8_t * data_end = rec->data + rec->l_data;
+  assert(pos + n <= data_end);
+  std::memmove(pos, pos + n, data_end - (pos + n));
+  rec->l_data -= n;
 }
 
 
-void
-binarizeQual(seqan::CharString & qual)
+inline uint32_t
+cigar_op(bam1_t const * rec, long const i)
 {
-  for (auto & q : qual)
-    q = (q - 33 >= 24) ? '?' : ',';
+  return bam_cigar_op(bam_get_cigar(rec)[i]);
 }
 
 
-bool
-is_clipped_both_ends(seqan::String<seqan::CigarElement<> > const & cigar, long const min_clip = 15)
+inline uint32_t
+cigar_len(bam1_t const * rec, long const i)
 {
-  return seqan::length(cigar) >= 1 &&
-         cigar[0].operation == 'S' &&
-         cigar[seqan::length(cigar) - 1].operation == 'S' &&
-         static_cast<long>(cigar[0].count + cigar[seqan::length(cigar) - 1].count) >= min_clip;
+  return bam_cigar_oplen(bam_get_cigar(rec)[i]);
 }
 
 
-bool
-is_one_end_clipped(seqan::String<seqan::CigarElement<> > const & cigar, long const min_clip = 0)
+inline void
+set_cigar_len(bam1_t * rec, long const i, uint32_t const len)
 {
-  return seqan::length(cigar) == 0 ||
-         (cigar[0].operation == 'S' && cigar[0].count >= min_clip) ||
-         (cigar[seqan::length(cigar) - 1].operation == 'S' && cigar[seqan::length(cigar) - 1].count >= min_clip);
+  uint32_t * cigar = bam_get_cigar(rec);
+  cigar[i] = bam_cigar_gen(len, bam_cigar_op(cigar[i]));
 }
 
 
-// returns true if the alignment is good
-bool
-process_tags(seqan::BamAlignmentRecord & record, seqan::CharString & new_tags, bamshrink::Options const & opts)
+inline void
+erase_cigar(bam1_t * rec, long const i)
+{
+  assert(i < static_cast<long>(rec->core.n_cigar));
+  erase_data(rec, reinterpret_cast<uint8_t *>(bam_get_cigar(rec) + i), sizeof(uint32_t));
+  --rec->core.n_cigar;
+}
+
+
+inline void
+erase_cigar_back(bam1_t * rec)
+{
+  erase_cigar(rec, rec->core.n_cigar - 1);
+}
+
+
+inline void
+set_base(uint8_t * seq, long const i, uint8_t const base)
+{
+  long const shift = (~i & 1) << 2;
+  seq[i >> 1] = (seq[i >> 1] & ~(0xF << shift)) | (base << shift);
+}
+
+
+// Removes n_front bases from the beginning and n_back bases from the end of both the sequence and the qualities
+void
+trim_seq_and_qual(bam1_t * rec, long const n_front, long const n_back)
+{
+  long const old_len = rec->core.l_qseq;
+  long const new_len = std::max(0l, old_len - n_front - n_back);
+
+  if (new_len == old_len)
+    return;
+
+  uint8_t * seq = bam_get_seq(rec);
+  uint8_t * qual = bam_get_qual(rec);
+  uint8_t * aux = bam_get_aux(rec);
+  long const l_aux = bam_get_l_aux(rec);
+
+  // Every base is read before it is overwritten, since the read index is never smaller than the write index
+  for (long i = 0; i < new_len; ++i)
+    set_base(seq, i, bam_seqi(seq, i + n_front));
+
+  uint8_t * new_qual = seq + (new_len + 1) / 2;
+  std::memmove(new_qual, qual + n_front, new_len);
+  std::memmove(new_qual + new_len, aux, l_aux);
+  rec->l_data = static_cast<int>((new_qual + new_len + l_aux) - rec->data);
+  rec->core.l_qseq = new_len;
+}
+
+
+void
+reverse_complement(bam1_t * rec)
 {
-  unsigned i = 0;
-  int64_t as = -1;
-  int64_t xs = -1;
+  long const len = rec->core.l_qseq;
+  uint8_t * seq = bam_get_seq(rec);
+  uint8_t * qual = bam_get_qual(rec);
 
-  while (i < seqan::length(record.tags))
+  for (long i = 0, j = len - 1; i <= j; ++i, --j)
   {
-    //std::string curr_tag(2, record.tags[i]);
-    //curr_tag[1] = record.tags[i+1];
-    i += 3;
-    char type = record.tags[i - 1];
-    bool is_as = false;
-    bool is_xs = false;
+    uint8_t const base_i = NT16_COMPLEMENT[bam_seqi(seq, i)];
+    uint8_t const base_j = NT16_COMPLEMENT[bam_seqi(seq, j)];
+    set_base(seq, i, base_j);
+    set_base(seq, j, base_i);
+  }
 
-    // Check for AS and XS
-    if (record.tags[i - 2] == 'S')
-    {
-      if (record.tags[i - 3] == 'A')
-        is_as = true;
-      else if (record.tags[i - 3] == 'X')
-        is_xs = true;
-    }
+  std::reverse(qual, qual + len);
+}
 
-    switch (type)
-    {
-    case 'A':
+
+void
+set_qname(bam1_t * rec, char const * name)
+{
+  long const len = std::strlen(name) + 1;
+  long const extranul = (4 - len % 4) % 4; // Keep the cigar 4-byte aligned
+  long const new_l_qname = len + extranul;
+  long const diff = new_l_qname - rec->core.l_qname;
+
+  if (diff > 0 && static_cast<long>(rec->l_data) + diff > static_cast<long>(rec->m_data))
+  {
+    long const new_m_data = (rec->l_data + diff) * 3 / 2 + 32;
+    rec->data = static_cast<uint8_t *>(std::realloc(rec->data, new_m_data));
+
+    if (!rec->data)
     {
-      // A printable character
-      ++i;
-      break;
+      BOOST_LOG_TRIVIAL(error) << __HERE__ << " Out of memory.";
+      std::exit(1);
     }
 
-    case 'Z':
-    {
-      // A string! Let's loop it until qNULL
-      // Check for RG
-      if (record.tags[i - 3] == 'R' && record.tags[i - 2] == 'G')
-      {
-        auto begin_it = begin(record.tags) + i - 3;
+    rec->m_data = new_m_data;
+  }
 
-        while (record.tags[i] != '\0' && record.tags[i] != '\n')
-          ++i;
+  std::memmove(rec->data + new_l_qname, rec->data + rec->core.l_qname, rec->l_data - rec->core.l_qname);
+  std::memcpy(rec->data, name, len);
+  std::memset(rec->data + len, '\0', extranul);
+  rec->core.l_qname = new_l_qname;
+  rec->core.l_extranul = extranul;
+  rec->l_data += diff;
+}
 
-        ++i;
-        auto end_it = begin(record.tags) + i;
-        //unsigned const old_length = length(new_tags);
-        resize(new_tags, std::distance(begin_it, end_it), seqan::Exact());
-        seqan::arrayCopyForward(begin_it, end_it, begin(new_tags));
-      }
-      else
-      {
-        while (record.tags[i] != '\0' && record.tags[i] != '\n')
-          ++i;
 
-        ++i;
-      }
+// Removes all tags except the read group
+void
+keep_only_rg_tag(bam1_t * rec)
+{
+  uint8_t * aux = bam_get_aux(rec);
+  uint8_t * rg = bam_aux_get(rec, "RG");
 
-      break;
-    }
+  if (!rg || *rg != 'Z')
+  {
+    rec->l_data = static_cast<int>(aux - rec->data);
+    return;
+  }
 
-    case 'c':
-    {
-      if (is_as)
-      {
-        int8_t num;
-        memcpy(&num, &record.tags[i], sizeof(int8_t));
-        as = num;
-      }
-      else if (is_xs)
-      {
-        int8_t num;
-        memcpy(&num, &record.tags[i], sizeof(int8_t));
-        xs = num;
-      }
+  uint8_t * tag_begin = rg - 2;
+  uint8_t * tag_end = rg + 1 + std::strlen(reinterpret_cast<char *>(rg + 1)) + 1;
+  long const tag_size = tag_end - tag_begin;
+  std::memmove(aux, tag_begin, tag_size);
+  rec->l_data = static_cast<int>(aux - rec->data + tag_size);
+}
 
-      i += sizeof(int8_t);
-      break;
-    }
 
-    case 'C':
-    {
-      if (is_as)
-      {
-        uint8_t num;
-        memcpy(&num, &record.tags[i], sizeof(uint8_t));
-        as = num;
-      }
-      else if (is_xs)
-      {
-        uint8_t num;
-        memcpy(&num, &record.tags[i], sizeof(uint8_t));
-        xs = num;
-      }
+void
+removeHardClipped(bam1_t * rec)
+{
+  if (rec->core.n_cigar >= 1 && cigar_op(rec, 0) == BAM_CHARD_CLIP)
+    erase_cigar(rec, 0);
 
-      i += sizeof(uint8_t);
-      break;
-    }
+  if (rec->core.n_cigar >= 2 && cigar_op(rec, rec->core.n_cigar - 1) == BAM_CHARD_CLIP)
+    erase_cigar_back(rec);
+}
 
-    case 's':
-    {
-      if (is_as)
-      {
-        int16_t num;
-        memcpy(&num, &record.tags[i], sizeof(int16_t));
-        as = num;
-      }
-      else if (is_xs)
-      {
-        int16_t num;
-        memcpy(&num, &record.tags[i], sizeof(int16_t));
-        xs = num;
-      }
 
-      i += sizeof(int16_t);
-      break;
-    }
+void
+binarizeQual(bam1_t * rec)
+{
+  uint8_t * qual = bam_get_qual(rec);
 
-    case 'S':
-    {
-      if (is_as)
-      {
-        uint16_t num;
-        memcpy(&num, &record.tags[i], sizeof(uint16_t));
-        as = num;
-      }
-      else if (is_xs)
-      {
-        uint16_t num;
-        memcpy(&num, &record.tags[i], sizeof(uint16_t));
-        xs = num;
-      }
+  if (rec->core.l_qseq == 0 || qual[0] == 0xff)
+    return; // No qualities available
 
-      i += sizeof(uint16_t);
-      break;
-    }
+  for (long i = 0; i < rec->core.l_qseq; ++i)
+    qual[i] = qual[i] >= 24 ? 30 : 11;
+}
 
-    case 'i':
-    {
-      if (is_as)
-      {
-        int32_t num;
-        memcpy(&num, &record.tags[i], sizeof(int32_t));
-        as = num;
-      }
-      else if (is_xs)
-      {
-        int32_t num;
-        memcpy(&num, &record.tags[i], sizeof(int32_t));
-        xs = num;
-      }
 
-      i += sizeof(int32_t);
-      break;
-    }
+bool
+is_clipped_both_ends(bam1_t const * rec, long const min_clip = 15)
+{
+  long const n_cigar = rec->core.n_cigar;
 
-    case 'I':
-    {
-      if (is_as)
-      {
-        uint32_t num;
-        memcpy(&num, &record.tags[i], sizeof(uint32_t));
-        as = num;
-      }
-      else if (is_xs)
-      {
-        uint32_t num;
-        memcpy(&num, &record.tags[i], sizeof(uint32_t));
-        xs = num;
-      }
+  return n_cigar >= 1 &&
+         cigar_op(rec, 0) == BAM_CSOFT_CLIP &&
+         cigar_op(rec, n_cigar - 1) == BAM_CSOFT_CLIP &&
+         static_cast<long>(cigar_len(rec, 0) + cigar_len(rec, n_cigar - 1)) >= min_clip;
+}
 
-      i += sizeof(uint32_t);
-      break;
-    }
 
-    case 'f':
-    {
-      i += sizeof(float);
-      break;
-    }
+bool
+is_one_end_clipped(bam1_t const * rec, long const min_clip = 0)
+{
+  long const n_cigar = rec->core.n_cigar;
 
-    default:
-    {
-      i = length(record.tags);       // Unkown tag, stop
-      break;
-    }
-    }
+  return n_cigar == 0 ||
+         (cigar_op(rec, 0) == BAM_CSOFT_CLIP && static_cast<long>(cigar_len(rec, 0)) >= min_clip) ||
+         (cigar_op(rec, n_cigar - 1) == BAM_CSOFT_CLIP && static_cast<long>(cigar_len(rec, n_cigar - 1)) >= min_clip);
+}
+
+
+long
+countMatchingBases(bam1_t const * rec)
+{
+  long numOfMatches = 0;
+
+  for (long i = 0; i < static_cast<long>(rec->core.n_cigar); ++i)
+  {
+    if (cigar_op(rec, i) == BAM_CMATCH)
+      numOfMatches += cigar_len(rec, i);
   }
 
-  if (as != -1 && xs != -1 && (!seqan::hasFlagMultiple(record) || seqan::hasFlagNextUnmapped(record)))
+  return numOfMatches;
+}
+
+
+// returns the value of an integer AS/XS tag or -1 if it is not available
+int64_t
+get_int_tag(bam1_t const * rec, char const tag[2])
+{
+  uint8_t * aux = bam_aux_get(rec, tag);
+
+  if (!aux || std::strchr("cCsSiI", *aux) == nullptr)
+    return -1;
+
+  return bam_aux2i(aux);
+}
+
+
+// returns true if the alignment is good
+bool
+process_tags(bam1_t const * rec, bamshrink::Options const & opts)
+{
+  int64_t const as = get_int_tag(rec, "AS");
+  int64_t const xs = get_int_tag(rec, "XS");
+
+  if (as != -1 && xs != -1 && ((rec->core.flag & BAM_FPAIRED) == 0 || (rec->core.flag & BAM_FMUNMAP) != 0))
   {
     if (as <= xs)
       return false;
@@ -278,12 +305,14 @@ process_tags(seqan::BamAlignmentRecord & record, seqan::CharString & new_tags, b
     long matches = 0;
     long indels = 0;
 
-    for (auto const & c : record.cigar)
+    for (long i = 0; i < static_cast<long>(rec->core.n_cigar); ++i)
     {
-      if (c.operation == 'M')
-        matches += c.count;
-      else if (c.operation == 'D' || c.operation == 'I')
-        indels += c.count + 2; // Extra 2 for each event
+      uint32_t const op = cigar_op(rec, i);
+
+      if (op == BAM_CMATCH)
+        matches += cigar_len(rec, i);
+      else if (op == BAM_CDEL || op == BAM_CINS)
+        indels += cigar_len(rec, i) + 2; // Extra 2 for each event
     }
 
     if ((as + opts.as_filter_threshold) <= (matches - indels))
@@ -294,92 +323,94 @@ process_tags(seqan::BamAlignmentRecord & record, seqan::CharString & new_tags, b
 }
 
 
-} // anon namespace
+inline bool
+is_too_short(bam1_t const * rec, bamshrink::Options const & opts)
+{
+  return rec->core.l_qseq < opts.minReadLen || (rec->core.qual < 25 && rec->core.l_qseq < opts.minReadLenMapQ0);
+}
 
 
-namespace seqan
+struct QnameHash
 {
+  std::size_t
+  operator()(char const * s) const
+  {
+    std::size_t seed = 42;
 
-bool
-operator<(seqan::BamAlignmentRecord const & a, seqan::BamAlignmentRecord const & b)
-{
-  return a.beginPos < b.beginPos;
-}
+    for (; *s != '\0'; ++s)
+      seed ^= *s + 0x9e3779b9 + (seed << 6) + (seed >> 2);
 
+    return seed;
+  }
 
-}
 
+};
 
-namespace std
-{
 
-template <>
-struct hash<seqan::String<char> >
+struct QnameEqual
 {
-  std::size_t
-  operator()(seqan::String<char> const & s) const
+  bool
+  operator()(char const * a, char const * b) const
   {
-    std::size_t seed = 42;
+    return std::strcmp(a, b) == 0;
+  }
 
-    for (char c : s)
-      seed ^= c + 0x9e3779b9 + (c << 6) + (c >> 2);
 
-    return seed;
+};
+
+
+struct PosLess
+{
+  bool
+  operator()(bam1_t const * a, bam1_t const * b) const
+  {
+    return a->core.pos < b->core.pos;
   }
 
 
 };
 
-} // namespace std
 
-using namespace seqan;
+// Maps read names to the first read of a pair. The keys point to the read name inside the record itself.
+using TReadFirst = std::unordered_map<char const *, bam1_t *, QnameHash, QnameEqual>;
+
+// Filtered reads waiting to be written, sorted by position. Reads with equal positions keep their insertion order.
+using TReadSet = std::multiset<bam1_t *, PosLess>;
+
+
+} // anon namespace
 
 
 namespace bamshrink
 {
 
 void
-makeUnpaired(BamAlignmentRecord & record)
+makeUnpaired(bam1_t * record)
 {
-  //record.tLen = 0; // Removed for insert size distributions
-  record.pNext = record.INVALID_POS;
-  record.rNextId = record.INVALID_REFID;
+  //record->core.isize = 0; // Removed for insert size distributions
+  record->core.mpos = -1;
+  record->core.mtid = -1;
   //unset: FlagNextUnmapped, FlagAllProper,FlagMultiple, FlagNextRC:
-  record.flag &= ~BAM_FLAG_NEXT_UNMAPPED;
-  record.flag &= ~BAM_FLAG_ALL_PROPER;
-  record.flag &= ~BAM_FLAG_MULTIPLE;
-  record.flag &= ~BAM_FLAG_NEXT_RC;
-}
-
-
-long
-countMatchingBases(String<CigarElement<> > const & cigarString)
-{
-  long numOfMatches = 0;
-
-  for (auto const & cigar : cigarString)
-  {
-    if (cigar.operation == 'M')
-      numOfMatches += cigar.count;
-  }
-
-  return numOfMatches;
+  record->core.flag &= ~BAM_FMUNMAP;
+  record->core.flag &= ~BAM_FPROPER_PAIR;
+  record->core.flag &= ~BAM_FPAIRED;
+  record->core.flag &= ~BAM_FMREVERSE;
 }
 
 
 #ifndef NDEBUG
 bool
-cigarAndSeqMatch(BamAlignmentRecord & record)
+cigarAndSeqMatch(bam1_t const * record)
 {
-  unsigned counter = 0;
+  long counter = 0;
 
-  for (auto const & cigar : record.cigar)
+  for (long i = 0; i < static_cast<long>(record->core.n_cigar); ++i)
   {
-    if (cigar.operation != 'D')
-      counter += cigar.count;
+    if (cigar_op(record, i) != BAM_CDEL)
+      counter += cigar_len(record, i);
   }
 
-  return length(record.seq) == counter;
+  return record->core.l_qseq == counter;
 }
 
 
@@ -387,56 +418,57 @@ cigarAndSeqMatch(BamAlignmentRecord & record)
 
 
 void
-resetCigarStringEnd(String<CigarElement<> > & cigarString, unsigned nRemoved)
+resetCigarStringEnd(bam1_t * record, unsigned nRemoved)
 {
-  if (length(cigarString) == 0)
+  if (record->core.n_cigar == 0)
     return;
 
-  if (cigarString[length(cigarString) - 1].operation == 'D')
+  if (cigar_op(record, record->core.n_cigar - 1) == BAM_CDEL)
   {
-    eraseBack(cigarString);
+    erase_cigar_back(record);
 
-    if (length(cigarString) == 0)
+    if (record->core.n_cigar == 0)
       return;
   }
 
-  auto & cigar_end = cigarString[length(cigarString) - 1];
+  long const last = record->core.n_cigar - 1;
+  unsigned const count = cigar_len(record, last);
 
-  if (cigar_end.count > nRemoved)
+  if (count > nRemoved)
   {
-    cigar_end.count -= nRemoved;
+    set_cigar_len(record, last, count - nRemoved);
   }
-  else if (cigar_end.count == nRemoved)
+  else if (count == nRemoved)
   {
-    eraseBack(cigarString);
+    erase_cigar_back(record);
 
-    if (length(cigarString) > 0 && cigarString[length(cigarString) - 1].operation == 'D')
-      eraseBack(cigarString);
+    if (record->core.n_cigar > 0 && cigar_op(record, record->core.n_cigar - 1) == BAM_CDEL)
+      erase_cigar_back(record);
   }
   else
   {
-    unsigned nLeft = nRemoved - cigar_end.count;
-    eraseBack(cigarString);
-    resetCigarStringEnd(cigarString, nLeft);
+    unsigned nLeft = nRemoved - count;
+    erase_cigar_back(record);
+    resetCigarStringEnd(record, nLeft);
   }
 }
 
 
 // Returns the amount of reference bases (cigars D or M) removed from cigar
 unsigned
-resetCigarStringBegin(String<CigarElement<> > & cigarString, unsigned nRemoved)
+resetCigarStringBegin(bam1_t * record, unsigned nRemoved)
 {
-  if (length(cigarString) == 0)
+  if (record->core.n_cigar == 0)
     return 0;
 
   unsigned removed;
 
-  if (cigarString[0].operation == 'D')
+  if (cigar_op(record, 0) == BAM_CDEL)
   {
-    removed = cigarString[0].count;
-    erase(cigarString, 0);
+    removed = cigar_len(record, 0);
+    erase_cigar(record, 0);
 
-    if (length(cigarString) == 0)
+    if (record->core.n_cigar == 0)
       return removed;
   }
   else
@@ -444,41 +476,44 @@ resetCigarStringBegin(String<CigarElement<> > & cigarString, unsigned nRemoved)
     removed = 0;
   }
 
-  if (cigarString[0].count > nRemoved)
+  unsigned const count = cigar_len(record, 0);
+  bool const is_match = cigar_op(record, 0) == BAM_CMATCH;
+
+  if (count > nRemoved)
   {
-    cigarString[0].count -= nRemoved;
+    set_cigar_len(record, 0, count - nRemoved);
 
-    if (cigarString[0].operation == 'M')
+    if (is_match)
       removed += nRemoved;
   }
-  else if (cigarString[0].count == nRemoved)
+  else if (count == nRemoved)
   {
-    if (cigarString[0].operation == 'M')
-      removed += cigarString[0].count;
+    if (is_match)
+      removed += count;
 
-    erase(cigarString, 0);
+    erase_cigar(record, 0);
 
-    if (length(cigarString) == 0)
+    if (record->core.n_cigar == 0)
       return removed;
 
-    if (cigarString[0].operation == 'D')
+    if (cigar_op(record, 0) == BAM_CDEL)
     {
-      removed += cigarString[0].count;
-      erase(cigarString, 0);
+      removed += cigar_len(record, 0);
+      erase_cigar(record, 0);
     }
   }
   else
   {
-    if (cigarString[0].operation == 'M')
-      removed += cigarString[0].count;
+    if (is_match)
+      removed += count;
 
-    unsigned nLeft = nRemoved - cigarString[0].count;
-    erase(cigarString, 0);
+    unsigned nLeft = nRemoved - count;
+    erase_cigar(record, 0);
 
-    if (length(cigarString) == 0)
+    if (record->core.n_cigar == 0)
       return removed;
     else
-      return removed + resetCigarStringBegin(cigarString, nLeft);
+      return removed + resetCigarStringBegin(record, nLeft);
   }
 
   return removed;
@@ -486,136 +521,114 @@ resetCigarStringBegin(String<CigarElement<> > & cigarString, unsigned nRemoved)
 
 
 bool
-removeSoftClipped(BamAlignmentRecord & record, Options const & opts)
+removeSoftClipped(bam1_t * record, Options const & opts)
 {
-  long n_cigar = seqan::length(record.cigar);
-
-  if (n_cigar >= 1)
+  if (record->core.n_cigar >= 1 && cigar_op(record, 0) == BAM_CSOFT_CLIP)
   {
-    auto const & first_cigar = record.cigar[0];
-
-    if (first_cigar.operation == 'S')
-    {
-      erase(record.seq, 0, first_cigar.count);
-      erase(record.qual, 0, first_cigar.count);
-      erase(record.cigar, 0);
-      --n_cigar;
-    }
-
-    if (n_cigar >= 2)
-    {
-      auto const & last_cigar = record.cigar[n_cigar - 1];
-
-      if (last_cigar.operation == 'S')
-      {
-        long const sequence_length = length(record.seq);
-        resize(record.seq, sequence_length - last_cigar.count);
-        resize(record.qual, sequence_length - last_cigar.count);
-        eraseBack(record.cigar);
-      }
-    }
+    trim_seq_and_qual(record, cigar_len(record, 0), 0);
+    erase_cigar(record, 0);
   }
 
-  if (static_cast<long>(length(record.seq)) < opts.minReadLen ||
-      (record.mapQ < 25 && static_cast<long>(length(record.seq)) < opts.minReadLenMapQ0))
+  if (record->core.n_cigar >= 2 && cigar_op(record, record->core.n_cigar - 1) == BAM_CSOFT_CLIP)
   {
-    return false;
+    trim_seq_and_qual(record, 0, cigar_len(record, record->core.n_cigar - 1));
+    erase_cigar_back(record);
   }
 
-  return true;
+  return !is_too_short(record, opts);
 }
 
 
 bool
-removeNsAtEnds(BamAlignmentRecord & record, Options const & opts)
+removeNsAtEnds(bam1_t * record, Options const & opts)
 {
-  int nOfNs = 0;
+  if (record->core.l_qseq == 0)
+    return false;
 
-  if (record.seq[0] == 'N')
+  long nOfNs = 0;
+  uint8_t const * seq = bam_get_seq(record);
+
+  if (bam_seqi(seq, 0) == NT16_N)
   {
     ++nOfNs;
-    int idx = 1;
+    long idx = 1;
 
-    while (record.seq[idx] == 'N' && idx < static_cast<long>(length(record.seq) - 1))
+    while (idx < record->core.l_qseq - 1 && bam_seqi(seq, idx) == NT16_N)
     {
       ++nOfNs;
       ++idx;
     }
 
     // Remove ns from beginning of sequence and qual fields
-    erase(record.seq, 0, nOfNs);
-    erase(record.qual, 0, nOfNs);
+    trim_seq_and_qual(record, nOfNs, 0);
 
-    if (!hasFlagUnmapped(record)) // Only have to fix CIGAR, beginPos and fragLen if the read is mapped
+    if ((record->core.flag & BAM_FUNMAP) == 0) // Only have to fix CIGAR, beginPos and fragLen if the read is mapped
     {
-      unsigned shift = resetCigarStringBegin(record.cigar, nOfNs);
-      record.beginPos += shift;
+      unsigned shift = resetCigarStringBegin(record, nOfNs);
+      record->core.pos += shift;
     }
   }
 
-  if (static_cast<long>(length(record.seq)) < opts.minReadLen ||
-      (record.mapQ < 25 && static_cast<long>(length(record.seq)) < opts.minReadLenMapQ0))
-  {
+  if (is_too_short(record, opts))
     return false;
-  }
 
   nOfNs = 0;
+  seq = bam_get_seq(record); // The cigar may have changed size
+  long const len = record->core.l_qseq;
 
-  if (record.seq[length(record.seq) - 1] == 'N')
+  if (bam_seqi(seq, len - 1) == NT16_N)
   {
     ++nOfNs;
-    int idx = length(record.seq) - 2;
+    long idx = len - 2;
 
-    while (record.seq[idx] == 'N' && idx > 0)
+    while (idx > 0 && bam_seqi(seq, idx) == NT16_N)
     {
       ++nOfNs;
       --idx;
     }
 
     // Remove ns from end of sequence and qual fields:
-    erase(record.seq, length(record.seq) - nOfNs, length(record.seq));
-    erase(record.qual, length(record.qual) - nOfNs, length(record.qual));
-
-    if (!hasFlagUnmapped(record)) // Only have to fix CIGAR, beginPos and fragLen if the read is mapped
-      resetCigarStringEnd(record.cigar, nOfNs);
-  }
+    trim_seq_and_qual(record, 0, nOfNs);
 
-  if (static_cast<long>(length(record.seq)) < opts.minReadLen ||
-      (record.mapQ < 25 && static_cast<long>(length(record.seq)) < opts.minReadLenMapQ0))
-  {
-    return false;
+    if ((record->core.flag & BAM_FUNMAP) == 0) // Only have to fix CIGAR, beginPos and fragLen if the read is mapped
+      resetCigarStringEnd(record, nOfNs);
   }
 
-  return true;
+  return !is_too_short(record, opts);
 }
 
 
-Pair<int>
-findNum2Clip(BamAlignmentRecord & recordReverse, int forwardStartPos)
+std::pair<int, int>
+findNum2Clip(bam1_t const * recordReverse, long const forwardStartPos)
 {
   int num2clip = 0;
   int num2shift = 0;
-  unsigned cigarIndex = 0;
-  long reverseStartPos = recordReverse.beginPos;
+  long cigarIndex = 0;
+  long const n_cigar = recordReverse->core.n_cigar;
+  long reverseStartPos = recordReverse->core.pos;
   unsigned n = 0;
 
-  if (recordReverse.cigar[cigarIndex].operation == 'S')
+  if (n_cigar == 0)
+    return std::make_pair(num2clip, num2shift);
+
+  if (cigar_op(recordReverse, cigarIndex) == BAM_CSOFT_CLIP)
   {
-    num2clip = recordReverse.cigar[cigarIndex].count;
+    num2clip = cigar_len(recordReverse, cigarIndex);
     ++cigarIndex;
   }
 
-  while (cigarIndex < length(recordReverse.cigar))
+  while (cigarIndex < n_cigar)
   {
-    char cigarOperation = recordReverse.cigar[cigarIndex].operation;
+    uint32_t const cigarOperation = cigar_op(recordReverse, cigarIndex);
+    unsigned const count = cigar_len(recordReverse, cigarIndex);
     n = 0;
 
-    while (reverseStartPos < forwardStartPos && n < recordReverse.cigar[cigarIndex].count)
+    while (reverseStartPos < forwardStartPos && n < count)
     {
-      if (cigarOperation != 'D')
+      if (cigarOperation != BAM_CDEL)
         ++num2clip;
 
-      if (cigarOperation != 'I')
+      if (cigarOperation != BAM_CINS)
         ++reverseStartPos;
 
       ++n;
@@ -627,16 +640,16 @@ findNum2Clip(BamAlignmentRecord & recordReverse, int forwardStartPos)
     ++cigarIndex;
   }
 
-  if (recordReverse.cigar[cigarIndex].operation == 'D')
-    num2shift = recordReverse.cigar[cigarIndex].count - n;
+  if (cigarIndex < n_cigar && cigar_op(recordReverse, cigarIndex) == BAM_CDEL)
+    num2shift = cigar_len(recordReverse, cigarIndex) - n;
 
-  return Pair<int>(num2clip, num2shift);
+  return std::make_pair(num2clip, num2shift);
 }
 
 
 bool
-removeAdapters(BamAlignmentRecord & recordForward,
-               BamAlignmentRecord & recordReverse,
+removeAdapters(bam1_t * recordForward,
+               bam1_t * recordReverse,
                Options const & opts)
 {
   //Check for soft clipped bases at beginning of forward record.
@@ -644,35 +657,33 @@ removeAdapters(BamAlignmentRecord & recordForward,
     return false;
 
   //delStats.nAdapterReads += 2;
-  int startPosDiff = recordForward.beginPos - recordReverse.beginPos;
+  long const startPosDiff = recordForward->core.pos - recordReverse->core.pos;
 
   if (startPosDiff < 0)
     return true;
 
-  Pair<int> clipAndShift = findNum2Clip(recordReverse, recordForward.beginPos);
-  int index = clipAndShift.i1;
-  int shift = clipAndShift.i2;
+  std::pair<int, int> clipAndShift = findNum2Clip(recordReverse, recordForward->core.pos);
+  int index = clipAndShift.first;
+  int shift = clipAndShift.second;
 
   //erase from reverse read bases 0 to index
-  erase(recordReverse.seq, 0, index);
-  erase(recordReverse.qual, 0, index);
-  resetCigarStringBegin(recordReverse.cigar, index);
-  //erase from forward read bases from length(reverse.seq) to end
+  trim_seq_and_qual(recordReverse, index, 0);
+  resetCigarStringBegin(recordReverse, index);
 
-  if (length(recordForward.seq) > length(recordReverse.seq) && index > 0)
+  //erase from forward read bases from length(reverse.seq) to end
+  if (recordForward->core.l_qseq > recordReverse->core.l_qseq && index > 0)
   {
-    int forwardClip = length(recordForward.seq) - length(recordReverse.seq);
-    erase(recordForward.seq, length(recordReverse.seq), length(recordForward.seq));
-    erase(recordForward.qual, length(recordReverse.qual), length(recordForward.qual));
-    resetCigarStringEnd(recordForward.cigar, forwardClip);
+    int forwardClip = recordForward->core.l_qseq - recordReverse->core.l_qseq;
+    trim_seq_and_qual(recordForward, 0, forwardClip);
+    resetCigarStringEnd(recordForward, forwardClip);
   }
 
-  recordReverse.beginPos = recordForward.beginPos;
+  recordReverse->core.pos = recordForward->core.pos;
 
   if (shift > 0)
-    recordReverse.beginPos += shift;
+    recordReverse->core.pos += shift;
 
-  recordForward.pNext = recordReverse.beginPos;
+  recordForward->core.mpos = recordReverse->core.pos;
 
 #ifndef NDEBUG
   if (!cigarAndSeqMatch(recordForward))
@@ -688,410 +699,570 @@ removeAdapters(BamAlignmentRecord & recordForward,
   }
 #endif // ifndef NDEBUG
 
-  if (static_cast<long>(length(recordForward.seq)) < opts.minReadLen ||
-      (recordForward.mapQ < 25 && static_cast<long>(length(recordForward.seq)) < opts.minReadLenMapQ0))
-  {
-    return false;
-  }
-  else
-  {
-    return true;
-  }
+  return !is_too_short(recordForward, opts);
 }
 
 
 void
-qualityFilterSlice2(Options const & opts,
-                    Triple<CharString, int, int> chr_start_end, // cannot be const& due to some seqan issue
-                    BamFileIn & bamFileIn,
-                    BamFileOut & bamFileOut,
-                    long & read_num,
-                    bool const is_single_contig)
+writeRecord(htsFile * fp, bam_hdr_t * hdr, bam1_t * record)
 {
-  if (!loadIndex(bamFileIn, opts.bamIndex.c_str()))
+  // The alignment may have been trimmed, so the bin needs to be updated
+  record->core.bin = hts_reg2bin(record->core.pos, bam_endpos(record), 14, 5);
+
+  if (sam_write1(fp, hdr, record) < 0)
   {
-    BOOST_LOG_TRIVIAL(error) << __HERE__ << " Could not read index file " << opts.bamIndex;
+    BOOST_LOG_TRIVIAL(error) << __HERE__ << " Could not write record to " << fp->fn;
     std::exit(1);
   }
+}
 
-  // bamshrink regions are expanded by 100 which should be removed here
-  if (!setRegion(bamFileIn,
-                 toCString(chr_start_end.i1),
-                 chr_start_end.i2 - (opts.maxFragLen - 100),
-                 chr_start_end.i3 + (opts.maxFragLen - 100)))
+
+void
+renameRead(bam1_t * record, long const num)
+{
+  if (CHANGE_READ_NAMES)
   {
-    BOOST_LOG_TRIVIAL(error) << __HERE__ << " Could not set region to "
-                             << chr_start_end.i1 << ":"
-                             << (chr_start_end.i2 + 1) << "-"
-                             << (chr_start_end.i3 + 1)
-                             << " when using index " << opts.bamIndex;
-    std::exit(1);
+    char name[24];
+    std::snprintf(name, sizeof(name), "%lx", num);
+    set_qname(record, name);
   }
+}
 
-  //bool is_paired_reads_with_no_mate{false};
-  std::multiset<BamAlignmentRecord> read_set;
-  std::unordered_map<seqan::String<char>, seqan::BamAlignmentRecord> read_first;
-  std::vector<seqan::BamAlignmentRecord> unpaired_reads;
-  std::vector<std::pair<seqan::BamAlignmentRecord, seqan::BamAlignmentRecord> > paired_reads;
-  seqan::BamAlignmentRecord record;
-  long first_pos = -1;
-  std::vector<uint32_t> bin_counts;
-  long const max_bin_sum = opts.no_filter_on_coverage ?
-                           (std::numeric_limits<int>::max() / 10) :
-                           static_cast<long>(opts.avgCovByReadLen * 50.0 * 2.5);
 
-  long const max_fragment_length = opts.maxFragLen;
+// Reads overlapping [queryBegin, queryEnd) are needed to filter an interval. bamshrink regions are expanded by 100
+// which should be removed here
+long
+queryBegin(Options const & opts, Interval const & interval)
+{
+  return std::max(0, interval.begin - (opts.maxFragLen - 100));
+}
 
-  auto filter_unpaired =
-    [&chr_start_end, &opts](BamAlignmentRecord const & rec) -> bool
-    {
-      // Unpaired read that does not overlap the target region
-      if (static_cast<long>(rec.beginPos + seqan::length(rec.seq)) < static_cast<long>(chr_start_end.i2) ||
-          rec.beginPos > chr_start_end.i3)
-      {
-        return false;
-      }
 
-      if (rec.mapQ < 25 ||
-          static_cast<long>(length(rec.seq)) < opts.minUnpairedReadLen ||
-          is_one_end_clipped(rec.cigar, 12) ||
-          is_clipped_both_ends(rec.cigar, 5) ||
-          countMatchingBases(rec.cigar) < opts.minNumMatching + 5)
-      {
-        return false;
-      }
+long
+queryEnd(Options const & opts, Interval const & interval)
+{
+  return interval.end + (opts.maxFragLen - 100) + 1;
+}
 
-      return true;
-    };
 
-  auto filter_paired =
-    [&chr_start_end, &opts](BamAlignmentRecord const & rec) -> bool
-    {
-      if (opts.is_filtering_mapq0 && rec.mapQ == 0)
-      {
-        return false;
-      }
+// Filters the reads of a single interval. Reads are pushed in coordinate order and the kept ones are written to
+// the output once their mate has been seen or can no longer appear.
+class SliceFilter
+{
+public:
+  SliceFilter(Options const & _opts,
+              Interval const & _interval,
+              htsFile * _fp_out,
+              bam_hdr_t * _hdr_out,
+              gyper::HtsStore & _store,
+              long & _read_num,
+              bool const _is_single_contig,
+              gyper::CigarDiscovery * _discovery = nullptr);
+
+  SliceFilter(SliceFilter const &) = delete;
+  SliceFilter & operator=(SliceFilter const &) = delete;
+
+  void push(bam1_t * record); // Takes ownership of the record
+  void finish(); // Writes all remaining reads
+
+private:
+  Options const & opts;
+  Interval const interval;
+  htsFile * fp_out{nullptr};
+  bam_hdr_t * hdr_out{nullptr};
+  gyper::HtsStore & store;
+  long & read_num;
+  bool const is_single_contig{false};
+  gyper::CigarDiscovery * discovery{nullptr}; // If set, variants are discovered from the written reads
+  long const max_bin_sum{0};
+
+  TReadSet read_set;
+  TReadFirst read_first;
+  std::vector<bam1_t *> expired_reads;
+  long first_pos{-1};
+  std::vector<uint32_t> bin_counts;
 
-      // Paired read that does not overlap the target region
-      if (static_cast<long>(rec.beginPos + seqan::length(rec.seq)) < static_cast<long>(chr_start_end.i2) &&
-          (static_cast<long>(rec.beginPos + rec.tLen) < static_cast<long>(chr_start_end.i2)))
-      {
-        return false;
-      }
+  bool filter_unpaired(bam1_t const * rec) const;
+  bool filter_paired(bam1_t const * rec) const;
+  long get_bin_count(long const bin) const;
+  void post_process_unpaired(bam1_t * rec); // Takes ownership of rec
+  bool post_process_paired(bam1_t * rec, long const num) const;
+  void write_unless_super_hi_depth(bam1_t * rec); // Takes ownership of rec
+  void process_expired_reads();
+};
 
-      if (static_cast<long>(rec.beginPos) > static_cast<long>(chr_start_end.i3) &&
-          (static_cast<long>(rec.beginPos + rec.tLen - seqan::length(rec.seq)) > static_cast<long>(chr_start_end.i3)))
-      {
-        return false;
-      }
 
-      // Allow unmapped reads with mapped mates
-      if (hasFlagUnmapped(rec))
-      {
-        //std::cerr << rec.qName << "\n";
-        return true;
-      }
+SliceFilter::SliceFilter(Options const & _opts,
+                         Interval const & _interval,
+                         htsFile * _fp_out,
+                         bam_hdr_t * _hdr_out,
+                         gyper::HtsStore & _store,
+                         long & _read_num,
+                         bool const _is_single_contig,
+                         gyper::CigarDiscovery * _discovery)
+  : opts(_opts)
+  , interval(_interval)
+  , fp_out(_fp_out)
+  , hdr_out(_hdr_out)
+  , store(_store)
+  , read_num(_read_num)
+  , is_single_contig(_is_single_contig)
+  , discovery(_discovery)
+  , max_bin_sum(_opts.no_filter_on_coverage ?
+                (std::numeric_limits<int>::max() / 10) :
+                static_cast<long>(_opts.avgCovByReadLen * 50.0 * 2.5))
+{}
 
-      // Filter for paired reads
-      if (static_cast<long>(length(rec.seq)) < opts.minReadLen ||
-          (rec.mapQ < 30 && is_clipped_both_ends(rec.cigar, 12)) ||
-          (rec.mapQ < 5 && is_one_end_clipped(rec.cigar, length(rec.seq) / 4)) ||
-          is_clipped_both_ends(rec.cigar, length(rec.seq) / 2) ||
-          countMatchingBases(rec.cigar) < opts.minNumMatching)
-      {
-        return false;
-      }
 
-      return true;
-    };
+bool
+SliceFilter::filter_unpaired(bam1_t const * rec) const
+{
+  long const pos = rec->core.pos;
+  long const len = rec->core.l_qseq;
 
-  auto post_process_unpaired =
-    [&bin_counts, &first_pos, &max_bin_sum, &read_num, &read_set, &opts](BamAlignmentRecord && rec) -> void
-    {
-      // Filter for unpaired reads
-      seqan::CharString new_tags;
-      bool is_good_alignment = process_tags(rec, new_tags, opts);
+  // Unpaired read that does not overlap the target region
+  if (pos + len < interval.begin || pos > interval.end)
+    return false;
 
-      if (!is_good_alignment)
-        return;
+  if (rec->core.qual < 25 ||
+      len < opts.minUnpairedReadLen ||
+      is_one_end_clipped(rec, 12) ||
+      is_clipped_both_ends(rec, 5) ||
+      countMatchingBases(rec) < opts.minNumMatching + 5)
+  {
+    return false;
+  }
 
-      if (!removeNsAtEnds(rec, opts))
-        return;
+  return true;
+}
 
-      rec.tags = std::move(new_tags);
-      long const bin = (rec.beginPos - first_pos) / 50l;
 
-      if (bin >= static_cast<long>(bin_counts.size()))
-      {
-        bin_counts.resize(bin + 1, 0u);
-      }
-      else if (bin_counts[bin] >= (max_bin_sum / 3l))
-      {
-        ++bin_counts[bin];
-        return;
-      }
+bool
+SliceFilter::filter_paired(bam1_t const * rec) const
+{
+  if (opts.is_filtering_mapq0 && rec->core.qual == 0)
+    return false;
 
-      binarizeQual(rec.qual);
-      removeHardClipped(rec.cigar);
+  long const pos = rec->core.pos;
+  long const len = rec->core.l_qseq;
+  long const tlen = rec->core.isize;
 
-      if (CHANGE_READ_NAMES)
-      {
-        std::ostringstream ss;
-        ss << std::hex << read_num;
-        rec.qName = ss.str();
-        ++read_num;
-      }
+  // Paired read that does not overlap the target region
+  if (pos + len < interval.begin && pos + tlen < interval.begin)
+    return false;
 
-      ++bin_counts[bin];
-      read_set.insert(std::move(rec));
-    };
+  if (pos > interval.end && pos + tlen - len > interval.end)
+    return false;
 
-  auto post_process_paired =
-    [&opts](BamAlignmentRecord & rec, long const read_num) -> bool
-    {
-      seqan::CharString new_tags;
-      bool is_good_alignment = process_tags(rec, new_tags, opts);
+  // Allow unmapped reads with mapped mates
+  if (rec->core.flag & BAM_FUNMAP)
+    return true;
 
-      if (!is_good_alignment)
-        return false;
+  // Filter for paired reads
+  if (len < opts.minReadLen ||
+      (rec->core.qual < 30 && is_clipped_both_ends(rec, 12)) ||
+      (rec->core.qual < 5 && is_one_end_clipped(rec, len / 4)) ||
+      is_clipped_both_ends(rec, len / 2) ||
+      countMatchingBases(rec) < opts.minNumMatching)
+  {
+    return false;
+  }
 
-      if (!removeNsAtEnds(rec, opts))
-        return false;
+  return true;
+}
 
-      rec.tags = std::move(new_tags);
-      binarizeQual(rec.qual);
-      removeHardClipped(rec.cigar);
 
-      if (CHANGE_READ_NAMES)
-      {
-        std::ostringstream ss;
-        ss << std::hex << read_num;
-        rec.qName = ss.str();
-      }
+long
+SliceFilter::get_bin_count(long const bin) const
+{
+  return (bin >= 0 && bin < static_cast<long>(bin_counts.size())) ? bin_counts[bin] : 0l;
+}
 
-      return true;
-    };
 
-  while (readRegion(record, bamFileIn))
+void
+SliceFilter::post_process_unpaired(bam1_t * rec)
+{
+  // Filter for unpaired reads
+  if (!process_tags(rec, opts) || !removeNsAtEnds(rec, opts))
   {
-    if (((record.flag & gyper::Options::const_instance()->sam_flag_filter) != 0) ||
-        (record.tLen != 0 && abs(record.tLen) < opts.minReadLen))
-    {
-      continue;
-    }
+    store.push(rec);
+    return;
+  }
 
-    if (first_pos < 0)
-    {
-      if (record.beginPos < 0)
-        continue;
+  keep_only_rg_tag(rec);
+  long const bin = (rec->core.pos - first_pos) / 50l;
 
-      first_pos = record.beginPos;
-    }
+  if (bin >= static_cast<long>(bin_counts.size()))
+  {
+    bin_counts.resize(bin + 1, 0u);
+  }
+  else if (bin_counts[bin] >= (max_bin_sum / 3l))
+  {
+    ++bin_counts[bin];
+    store.push(rec);
+    return;
+  }
 
-    if (read_first.size() > 0 &&
-        static_cast<long>(record.beginPos) >
-        static_cast<long>(2 * max_fragment_length + read_first.begin()->second.beginPos))
-    {
-      auto it = read_first.begin();
+  binarizeQual(rec);
+  removeHardClipped(rec);
+  renameRead(rec, read_num);
 
-      while (it != read_first.end() &&
-             (record.beginPos > 2 * max_fragment_length + it->second.beginPos + 151) &&
-             (record.qName != it->first))
-      {
-        makeUnpaired(it->second);
-        //is_paired_reads_with_no_mate = true;
+  if (CHANGE_READ_NAMES)
+    ++read_num;
 
-        if (filter_unpaired(it->second))
-          post_process_unpaired(std::move(it->second));
+  ++bin_counts[bin];
+  read_set.insert(rec);
+}
 
-        ++it;
-      }
 
-      read_first.erase(read_first.begin(), it);
-    }
+bool
+SliceFilter::post_process_paired(bam1_t * rec, long const num) const
+{
+  if (!process_tags(rec, opts) || !removeNsAtEnds(rec, opts))
+    return false;
 
-    if (read_set.size() > 0 &&
-        static_cast<long>(record.beginPos) >
-        static_cast<long>(3 * max_fragment_length + read_set.begin()->beginPos))
-    {
-      auto it = read_set.begin();
+  keep_only_rg_tag(rec);
+  binarizeQual(rec);
+  removeHardClipped(rec);
+  renameRead(rec, num);
+  return true;
+}
 
-      while (it != read_set.end() && (record.beginPos > max_fragment_length + it->beginPos + 151))
-      {
-        long const bin1 = (it->beginPos - first_pos) / 50l;
-        long const bin2 = (it->pNext - first_pos) / 50l;
 
-        if (bin_counts[bin1] < (opts.SUPER_HI_DEPTH * max_bin_sum) ||
-            (hasFlagMultiple(*it) && bin_counts[bin2] < (opts.SUPER_HI_DEPTH * max_bin_sum)))
-        {
-          writeRecord(bamFileOut, *it);
-        }
+void
+SliceFilter::write_unless_super_hi_depth(bam1_t * rec)
+{
+  long const bin1 = (rec->core.pos - first_pos) / 50l;
+  long const bin2 = (rec->core.mpos - first_pos) / 50l;
 
-        ++it;
-      }
+  if (get_bin_count(bin1) < (opts.SUPER_HI_DEPTH * max_bin_sum) ||
+      ((rec->core.flag & BAM_FPAIRED) && get_bin_count(bin2) < (opts.SUPER_HI_DEPTH * max_bin_sum)))
+  {
+    writeRecord(fp_out, hdr_out, rec);
 
-      read_set.erase(read_set.begin(), it);
-    }
+    if (discovery)
+      discovery->add_read(rec);
+  }
+
+  store.push(rec);
+}
+
+
+void
+SliceFilter::process_expired_reads()
+{
+  for (bam1_t * rec : expired_reads)
+  {
+    makeUnpaired(rec);
+
+    if (filter_unpaired(rec))
+      post_process_unpaired(rec);
+    else
+      store.push(rec);
+  }
+
+  expired_reads.clear();
+}
 
-    // If there is only one interval the header was changed
-    if (is_single_contig)
+
+void
+SliceFilter::push(bam1_t * record)
+{
+  auto & core = record->core;
+  long const max_fragment_length = opts.maxFragLen;
+
+  if (((core.flag & gyper::Options::const_instance()->sam_flag_filter) != 0) ||
+      (core.isize != 0 && std::abs(static_cast<long>(core.isize)) < opts.minReadLen))
+  {
+    store.push(record);
+    return;
+  }
+
+  if (first_pos < 0)
+  {
+    if (core.pos < 0)
     {
-      if (record.rNextId == record.rID)
-      {
-        record.rID = 0;
-        record.rNextId = 0;
-      }
-      else
-      {
-        record.rID = 0;
-        record.rNextId = 1; // Such that they are not the same
-      }
+      store.push(record);
+      return;
     }
 
-    if ((hasFlagUnmapped(record) || hasFlagNextUnmapped(record)) && hasFlagRC(record) == hasFlagNextRC(record))
+    first_pos = core.pos;
+  }
+
+  if (read_first.size() > 0 &&
+      static_cast<long>(core.pos) > 2 * max_fragment_length + read_first.begin()->second->core.pos)
+  {
+    char const * qname = bam_get_qname(record);
+    auto it = read_first.begin();
+
+    while (it != read_first.end() &&
+           (core.pos > 2 * max_fragment_length + it->second->core.pos + 151) &&
+           std::strcmp(qname, it->first) != 0)
     {
-      seqan::reverseComplement(record.seq);
-      seqan::reverse(record.qual);
-      record.flag ^= 16;
+      expired_reads.push_back(it->second);
+      ++it;
     }
 
-    // determine which reads are unpaired
-    if (record.rID != record.rNextId ||
-        hasFlagRC(record) == hasFlagNextRC(record) ||
-        abs(record.tLen) > max_fragment_length ||
-        (record.tLen > 0 && hasFlagRC(record)) ||
-        (record.tLen < 0 && !hasFlagRC(record)))
+    // Erase before the reads are modified since the keys point into them
+    read_first.erase(read_first.begin(), it);
+    process_expired_reads();
+  }
+
+  if (read_set.size() > 0 &&
+      static_cast<long>(core.pos) > 3 * max_fragment_length + (*read_set.begin())->core.pos)
+  {
+    auto it = read_set.begin();
+
+    while (it != read_set.end() && (core.pos > max_fragment_length + (*it)->core.pos + 151))
     {
-      makeUnpaired(record);
+      write_unless_super_hi_depth(*it);
+      ++it;
     }
 
-    if (!hasFlagMultiple(record))
-    {
-      // Unpaired read
-      if (filter_unpaired(record))
-        post_process_unpaired(std::move(record));
+    read_set.erase(read_set.begin(), it);
+  }
 
-      continue;
+  // If there is only one interval the header was changed
+  if (is_single_contig)
+  {
+    if (core.mtid == core.tid)
+    {
+      core.tid = 0;
+      core.mtid = 0;
     }
+    else
+    {
+      core.tid = 0;
+      core.mtid = 1; // Such that they are not the same
+    }
+  }
 
-    // Paired reads
-    if (!filter_paired(record))
-      continue;
+  if ((core.flag & (BAM_FUNMAP | BAM_FMUNMAP)) &&
+      ((core.flag & BAM_FREVERSE) != 0) == ((core.flag & BAM_FMREVERSE) != 0))
+  {
+    reverse_complement(record);
+    core.flag ^= BAM_FREVERSE;
+  }
 
-    auto find_it = read_first.find(record.qName);
+  bool const is_rc = (core.flag & BAM_FREVERSE) != 0;
+  bool const is_next_rc = (core.flag & BAM_FMREVERSE) != 0;
 
-    if (find_it == read_first.end())
-    {
-      // No point in waiting if this read comes record
-      assert(record.pNext != 0);
+  // determine which reads are unpaired
+  if (core.tid != core.mtid ||
+      is_rc == is_next_rc ||
+      std::abs(static_cast<long>(core.isize)) > max_fragment_length ||
+      (core.isize > 0 && is_rc) ||
+      (core.isize < 0 && !is_rc))
+  {
+    makeUnpaired(record);
+  }
 
-      if (record.pNext >= record.beginPos)
-        read_first[record.qName] = std::move(record);
+  if ((core.flag & BAM_FPAIRED) == 0)
+  {
+    // Unpaired read
+    if (filter_unpaired(record))
+      post_process_unpaired(record);
+    else
+      store.push(record);
 
-      continue;
-    }
+    return;
+  }
 
-    long const bin1 = (record.beginPos - first_pos) / 50l;
-    long const bin2 = (find_it->second.beginPos - first_pos) / 50l;
+  // Paired reads
+  if (!filter_paired(record))
+  {
+    store.push(record);
+    return;
+  }
 
-    {
-      long const max_bin = std::max(bin1, bin2);
+  auto find_it = read_first.find(bam_get_qname(record));
 
-      if (max_bin >= static_cast<long>(bin_counts.size()))
-        bin_counts.resize(max_bin + 1, 0u);
-    }
+  if (find_it == read_first.end())
+  {
+    // No point in waiting if this read comes record
+    assert(core.mpos != 0);
+
+    if (core.mpos >= core.pos)
+      read_first[bam_get_qname(record)] = record;
+    else
+      store.push(record);
+
+    return;
+  }
+
+  bam1_t * mate = find_it->second;
+  read_first.erase(find_it);
+  bool is_record_kept{false};
+  bool is_mate_kept{false};
 
-    ++bin_counts[bin1];
-    ++bin_counts[bin2];
+  long const bin1 = (core.pos - first_pos) / 50l;
+  long const bin2 = (mate->core.pos - first_pos) / 50l;
 
-    if (bin_counts[bin1] < max_bin_sum)
+  {
+    long const max_bin = std::max(bin1, bin2);
+
+    if (max_bin >= static_cast<long>(bin_counts.size()))
+      bin_counts.resize(max_bin + 1, 0u);
+  }
+
+  ++bin_counts[bin1];
+  ++bin_counts[bin2];
+
+  if (bin_counts[bin1] < max_bin_sum)
+  {
+    if (bin_counts[bin2] < max_bin_sum)
     {
-      if (bin_counts[bin2] < max_bin_sum)
+      bool is_ok;
+
+      if (core.isize == 0 ||
+          std::abs(static_cast<long>(core.isize)) > std::max(core.l_qseq, mate->core.l_qseq))
+      {
+        is_ok = true;
+      }
+      else if (is_rc)
+      {
+        is_ok = removeAdapters(mate, record, opts);
+      }
+      else
       {
-        bool is_ok;
+        is_ok = removeAdapters(record, mate, opts);
+      }
 
-        if (record.tLen == 0 ||
-            abs(record.tLen) > static_cast<long>(std::max(length(record.seq), length(find_it->second.seq))))
-          is_ok = true;
-        else if (hasFlagRC(record))
-          is_ok = removeAdapters(find_it->second, record, opts);
-        else
-          is_ok = removeAdapters(record, find_it->second, opts);
+      if (is_ok && post_process_paired(record, read_num) && post_process_paired(mate, read_num))
+      {
+        bool const is_unmapped = (core.flag & BAM_FUNMAP) != 0;
+        bool const is_mate_unmapped = (mate->core.flag & BAM_FUNMAP) != 0;
 
-        if (is_ok && post_process_paired(record, read_num) && post_process_paired(find_it->second, read_num))
+        if ((!is_unmapped && !is_mate_unmapped) ||
+            (is_unmapped && filter_unpaired(mate)) ||
+            (is_mate_unmapped && filter_unpaired(record)))
         {
-          if ((!hasFlagUnmapped(record) && !hasFlagUnmapped(find_it->second)) ||
-              (hasFlagUnmapped(record) && filter_unpaired(find_it->second)) ||
-              (hasFlagUnmapped(find_it->second) && filter_unpaired(record)))
-          {
-            ++read_num; // Only increase read_num if we actually add the reads
-            read_set.insert(std::move(record));
-            read_set.insert(std::move(find_it->second));
-          }
+          ++read_num; // Only increase read_num if we actually add the reads
+          read_set.insert(record);
+          read_set.insert(mate);
+          is_record_kept = true;
+          is_mate_kept = true;
         }
       }
-      else if (bin_counts[bin1] < (max_bin_sum / 3))
-      {
-        makeUnpaired(record);
+    }
+    else if (bin_counts[bin1] < (max_bin_sum / 3))
+    {
+      makeUnpaired(record);
 
-        if (filter_unpaired(record))
-          post_process_unpaired(std::move(record));
+      if (filter_unpaired(record))
+      {
+        post_process_unpaired(record);
+        is_record_kept = true;
       }
     }
-    else if (bin_counts[bin2] < (max_bin_sum / 3))
-    {
-      makeUnpaired(find_it->second);
+  }
+  else if (bin_counts[bin2] < (max_bin_sum / 3))
+  {
+    makeUnpaired(mate);
 
-      if (filter_unpaired(find_it->second))
-        post_process_unpaired(std::move(find_it->second));
+    if (filter_unpaired(mate))
+    {
+      post_process_unpaired(mate);
+      is_mate_kept = true;
     }
+  }
 
-    read_first.erase(find_it);
-  } //... while readRegion
+  if (!is_record_kept)
+    store.push(record);
+
+  if (!is_mate_kept)
+    store.push(mate);
+}
 
 
+void
+SliceFilter::finish()
+{
   if (read_first.size() > 0)
   {
-    for (auto && rec : read_first)
-    {
-      makeUnpaired(rec.second);
-
-      if (filter_unpaired(rec.second))
-        post_process_unpaired(std::move(rec.second));
-    }
+    for (auto const & qname_rec : read_first)
+      expired_reads.push_back(qname_rec.second);
 
     read_first.clear();
+    process_expired_reads();
   }
 
   // Write remaining reads
-  for (auto & rec : read_set)
+  for (bam1_t * rec : read_set)
+    write_unless_super_hi_depth(rec);
+
+  read_set.clear();
+}
+
+
+hts_itr_t *
+queryInterval(hts_idx_t * idx, bam_hdr_t * hdr, Interval const & interval, long const begin, long const end)
+{
+  int const tid = bam_name2id(hdr, interval.chrom.c_str());
+  hts_itr_t * iter = tid >= 0 ? sam_itr_queryi(idx, tid, begin, end) : nullptr;
+
+  if (!iter)
+  {
+    BOOST_LOG_TRIVIAL(error) << __HERE__ << " Could not set region to "
+                             << interval.chrom << ":" << (begin + 1) << "-" << end;
+    std::exit(1);
+  }
+
+  return iter;
+}
+
+
+void
+qualityFilterSlice2(Options const & opts,
+                    Interval const & chr_start_end,
+                    htsFile * fp_in,
+                    bam_hdr_t * hdr_in,
+                    hts_idx_t * idx,
+                    htsFile * fp_out,
+                    bam_hdr_t * hdr_out,
+                    gyper::HtsStore & store,
+                    long & read_num,
+                    bool const is_single_contig,
+                    gyper::CigarDiscovery * discovery)
+{
+  SliceFilter slice(opts, chr_start_end, fp_out, hdr_out, store, read_num, is_single_contig, discovery);
+  hts_itr_t * iter = queryInterval(idx,
+                                   hdr_in,
+                                   chr_start_end,
+                                   queryBegin(opts, chr_start_end),
+                                   queryEnd(opts, chr_start_end));
+
+  while (true)
   {
-    long const bin1 = (rec.beginPos - first_pos) / 50l;
-    long const bin2 = (rec.pNext - first_pos) / 50l;
+    bam1_t * record = store.get();
 
-    if (bin_counts[bin1] < (opts.SUPER_HI_DEPTH * max_bin_sum) ||
-        (hasFlagMultiple(rec) && bin_counts[bin2] < (opts.SUPER_HI_DEPTH * max_bin_sum)))
+    int const ret = sam_itr_next(fp_in, iter, record);
+
+    if (ret < -1)
+    {
+      BOOST_LOG_TRIVIAL(error) << __HERE__ << " Could not read record from " << fp_in->fn << " (error " << ret << ")";
+      std::exit(1);
+    }
+    else if (ret == -1)
     {
-      writeRecord(bamFileOut, rec);
+      store.push(record);
+      break;
     }
+
+    slice.push(record);
   }
 
-  // Check if there are any paired reads which their mate was never found
-  //if (is_paired_reads_with_no_mate)
-  //{
-  //  BOOST_LOG_TRIVIAL(info) << __HERE__ << " Some reads had flags indicating that they "
-  //                          << "are paired with a mate read in the region but the mate was never found.";
-  //}
+  hts_itr_destroy(iter);
+  slice.finish();
 }
 
 
-String<Triple<CharString, int, int> >
+std::vector<Interval>
 readIntervals(Options const & opts)
 {
-  // String of intervals to return
-  String<Triple<CharString, int, int> > intervalString;
-  std::string chrStr;
-  Triple<CharString, int, int> chr_start_end;
+  // Intervals to return
+  std::vector<Interval> intervals;
+  Interval chr_start_end;
   std::ifstream intFile(opts.intervalFile.c_str());
 
   if (intFile.fail())
@@ -1101,35 +1272,31 @@ readIntervals(Options const & opts)
   }
 
   //Read first interval and add to string
-  intFile >> chrStr;
-  chr_start_end.i1 = chrStr;
-  intFile >> chr_start_end.i2;
-  --chr_start_end.i2;
-  intFile >> chr_start_end.i3;
-  --chr_start_end.i3;
-  append(intervalString, chr_start_end);
+  intFile >> chr_start_end.chrom;
+  intFile >> chr_start_end.begin;
+  --chr_start_end.begin;
+  intFile >> chr_start_end.end;
+  --chr_start_end.end;
+  intervals.push_back(chr_start_end);
 
   // If file only contains one interval, return.
   if (intFile.eof())
-  {
-    intFile.close();
-    return intervalString;
-  }
+    return intervals;
 
   while (!intFile.eof())
   {
-    intFile >> chrStr;
-    chr_start_end.i1 = chrStr;
-    intFile >> chr_start_end.i2;
-    --chr_start_end.i2;
-    intFile >> chr_start_end.i3;
-    --chr_start_end.i3;
+    intFile >> chr_start_end.chrom;
+    intFile >> chr_start_end.begin;
+    --chr_start_end.begin;
+    intFile >> chr_start_end.end;
+    --chr_start_end.end;
 
     if (intFile.eof())
       break;
 
-    if (chr_start_end.i1 == intervalString[length(intervalString) - 1].i1 &&
-        chr_start_end.i2 < intervalString[length(intervalString) - 1].i2)
+    Interval & prev = intervals.back();
+
+    if (chr_start_end.chrom == prev.chrom && chr_start_end.begin < prev.begin)
     {
       BOOST_LOG_TRIVIAL(error) << "The input intervals are not sorted.";
       std::exit(1);
@@ -1137,19 +1304,339 @@ readIntervals(Options const & opts)
 
     // If beginning of interval is closer than 2*maxFragLen bases to the previous interval we merge them.
     // Otherwise we cannot ensure sorting of reads.
-    if (chr_start_end.i2 - intervalString[length(intervalString) - 1].i3 <= 2 * opts.maxFragLen &&
-        chr_start_end.i1 == intervalString[length(intervalString) - 1].i1)
+    if (chr_start_end.begin - prev.end <= 2 * opts.maxFragLen && chr_start_end.chrom == prev.chrom)
+      prev.end = chr_start_end.end;
+    else
+      intervals.push_back(chr_start_end);
+  }
+
+  return intervals;
+}
+
+
+// Creates a header with only the @HD, @RG and the @SQ line of the given contig
+bam_hdr_t *
+make_single_contig_header(bam_hdr_t const * hdr_in, std::string const & chrom)
+{
+  std::string const sq = "@SQ\tSN:" + chrom + "\t";
+  long const sq_len = sq.size();
+  std::string const hd = "@HD\t";
+  std::string const rg = "@RG\t";
+  const char * t = hdr_in->text;
+  const char * t_end = hdr_in->text + hdr_in->l_text;
+  std::ostringstream new_ss;
+
+  while (t < t_end)
+  {
+    long const line_size = std::distance(t, std::find(t, t_end, '\n'));
+
+    if (line_size > 4 &&
+        (std::equal(hd.begin(), hd.begin() + 4, t) ||
+         std::equal(rg.begin(), rg.begin() + 4, t) ||
+         (line_size > sq_len && std::equal(sq.begin(), sq.begin() + sq_len, t))))
     {
-      intervalString[length(intervalString) - 1].i3 = chr_start_end.i3;
+      new_ss << std::string(t, line_size) << '\n';
     }
-    else
+
+    t += line_size + 1;
+  }
+
+  std::string new_header = new_ss.str();
+  bam_hdr_t * hdr_out = sam_hdr_parse(new_header.size(), new_header.c_str());
+  hdr_out->l_text = new_header.size();
+  hdr_out->text = static_cast<char *>(realloc(hdr_out->text, sizeof(char) * new_header.size()));
+  strncpy(hdr_out->text, new_header.c_str(), new_header.size());
+  return hdr_out;
+}
+
+
+// An input SAM/BAM/CRAM file opened for region queries
+struct ShrinkInput
+{
+  htsFile * fp{nullptr};
+  bam_hdr_t * hdr{nullptr};
+  hts_idx_t * idx{nullptr};
+};
+
+
+ShrinkInput
+openInput(std::string const & path, std::string const & index_path, std::string const & reference)
+{
+  ShrinkInput in;
+  in.fp = hts_open(path.c_str(), "r");
+
+  if (!in.fp)
+  {
+    BOOST_LOG_TRIVIAL(error) << __HERE__ << " Could not open " << path;
+    std::exit(1);
+  }
+
+  htsThreadPool * thread_pool = gyper::get_hts_thread_pool();
+
+  if (thread_pool)
+    hts_set_thread_pool(in.fp, thread_pool);
+
+  if (reference.size() > 0 && hts_set_fai_filename(in.fp, reference.c_str()) < 0)
+  {
+    BOOST_LOG_TRIVIAL(error) << __HERE__ << " Could not open reference FASTA file with filename " << reference;
+    std::exit(1);
+  }
+
+  in.hdr = sam_hdr_read(in.fp);
+
+  if (!in.hdr)
+  {
+    BOOST_LOG_TRIVIAL(error) << __HERE__ << " Could not read header of " << path;
+    std::exit(1);
+  }
+
+  // Use the reference sequences already loaded by other CRAM decoders in this process
+  if (gyper::set_shared_cram_reference(in.fp, in.hdr, reference) < 0)
+    BOOST_LOG_TRIVIAL(warning) << __HERE__ << " Could not share CRAM reference for " << path;
+
+  in.idx = sam_index_load2(in.fp, path.c_str(), index_path.c_str());
+
+  if (!in.idx)
+  {
+    BOOST_LOG_TRIVIAL(error) << __HERE__ << " Could not read index file " << index_path;
+    std::exit(1);
+  }
+
+  return in;
+}
+
+
+void
+closeInput(ShrinkInput & in)
+{
+  hts_idx_destroy(in.idx);
+  bam_hdr_destroy(in.hdr);
+  hts_close(in.fp);
+  in = ShrinkInput();
+}
+
+
+htsFile *
+openOutput(std::string const & path, bam_hdr_t * hdr)
+{
+  htsFile * fp = hts_open(path.c_str(), "wb");
+
+  if (!fp)
+  {
+    BOOST_LOG_TRIVIAL(error) << __HERE__ << " Could not open " << path << " for writing.";
+    std::exit(1);
+  }
+
+  htsThreadPool * thread_pool = gyper::get_hts_thread_pool();
+
+  if (thread_pool)
+    hts_set_thread_pool(fp, thread_pool);
+
+  if (sam_hdr_write(fp, hdr) < 0)
+  {
+    BOOST_LOG_TRIVIAL(error) << __HERE__ << " Could not write header to " << path;
+    std::exit(1);
+  }
+
+  return fp;
+}
+
+
+void
+shrink(Options const & opts,
+       std::vector<Interval> const & intervals,
+       std::string const & reference,
+       gyper::CigarDiscovery * discovery = nullptr)
+{
+  ShrinkInput in = openInput(opts.bamPathIn, opts.bamIndex, reference);
+
+  // When there is only one contig, remove all other contigs from header to save space
+  bool const is_single_contig = intervals.size() == 1;
+  bam_hdr_t * hdr_out = is_single_contig ? make_single_contig_header(in.hdr, intervals[0].chrom) : bam_hdr_dup(in.hdr);
+  htsFile * fp_out = openOutput(opts.bamPathOut, hdr_out);
+
+  {
+    gyper::HtsStore store; // Pool of records which are reused
+    long read_num{0};
+
+    for (auto const & interval : intervals)
+    {
+      qualityFilterSlice2(opts,
+                          interval,
+                          in.fp,
+                          in.hdr,
+                          in.idx,
+                          fp_out,
+                          hdr_out,
+                          store,
+                          read_num,
+                          is_single_contig,
+                          discovery);
+    }
+  }
+
+  hts_close(fp_out);
+  bam_hdr_destroy(hdr_out);
+  closeInput(in);
+}
+
+
+/**
+ * Shrinks each interval to its own output file while reading the input only once. Intervals whose query windows
+ * overlap or touch are read with a single iterator and every read is handed to each interval it overlaps, so the
+ * outputs are identical to shrinking the intervals one at a time.
+ */
+void
+shrinkRegions(Options const & opts,
+              std::vector<Interval> const & intervals,
+              std::vector<std::string> const & paths_out,
+              std::string const & reference)
+{
+  assert(intervals.size() == paths_out.size());
+
+  struct SliceOutput
+  {
+    htsFile * fp{nullptr};
+    bam_hdr_t * hdr{nullptr};
+    long read_num{0};
+    std::unique_ptr<SliceFilter> slice;
+  };
+
+  ShrinkInput in = openInput(opts.bamPathIn, opts.bamIndex, reference);
+  gyper::HtsStore store; // Pool of records which are reused
+  long const NUM_INTERVALS = intervals.size();
+  std::vector<SliceOutput> outputs(NUM_INTERVALS);
+  std::vector<long> order(NUM_INTERVALS);
+  std::vector<int> tids(NUM_INTERVALS);
+
+  for (long i = 0; i < NUM_INTERVALS; ++i)
+  {
+    order[i] = i;
+    tids[i] = bam_name2id(in.hdr, intervals[i].chrom.c_str());
+  }
+
+  // Process the intervals in the order they appear in the input file
+  std::sort(order.begin(), order.end(), [&](long const a, long const b)
+    {
+      return tids[a] < tids[b] || (tids[a] == tids[b] && intervals[a].begin < intervals[b].begin);
+    });
+
+  auto open_slice =
+    [&](long const i)
+    {
+      SliceOutput & out = outputs[i];
+      out.hdr = make_single_contig_header(in.hdr, intervals[i].chrom);
+      out.fp = openOutput(paths_out[i], out.hdr);
+      out.slice.reset(new SliceFilter(opts, intervals[i], out.fp, out.hdr, store, out.read_num, true));
+    };
+
+  auto close_slice =
+    [&](long const i)
+    {
+      SliceOutput & out = outputs[i];
+
+      if (!out.slice)
+        open_slice(i); // No reads overlapped the interval, but the output file is still expected
+
+      out.slice->finish();
+      out.slice.reset();
+      hts_close(out.fp);
+      bam_hdr_destroy(out.hdr);
+      out.fp = nullptr;
+      out.hdr = nullptr;
+    };
+
+  long o = 0;
+
+  while (o < NUM_INTERVALS)
+  {
+    // Find the consecutive intervals which can be read using a single iterator
+    Interval const & first = intervals[order[o]];
+    long const window_begin = queryBegin(opts, first);
+    long window_end = queryEnd(opts, first);
+    long o_end = o + 1;
+
+    while (o_end < NUM_INTERVALS &&
+           tids[order[o_end]] == tids[order[o]] &&
+           queryBegin(opts, intervals[order[o_end]]) <= window_end)
+    {
+      window_end = std::max(window_end, queryEnd(opts, intervals[order[o_end]]));
+      ++o_end;
+    }
+
+    hts_itr_t * iter = queryInterval(in.idx, in.hdr, first, window_begin, window_end);
+    long o_first_open = o; // Slices in [o_first_open, o_next) have been opened
+    long o_next = o;
+
+    while (true)
     {
-      append(intervalString, chr_start_end);
+      bam1_t * record = store.get();
+
+      int const ret = sam_itr_next(in.fp, iter, record);
+
+      if (ret < -1)
+      {
+        BOOST_LOG_TRIVIAL(error) << __HERE__ << " Could not read record from " << in.fp->fn << " (error " << ret
+                                 << ")";
+        std::exit(1);
+      }
+      else if (ret == -1)
+      {
+        store.push(record);
+        break;
+      }
+
+      long const pos = record->core.pos;
+      long const end_pos = bam_endpos(record);
+
+      while (o_next < o_end && queryBegin(opts, intervals[order[o_next]]) < end_pos)
+      {
+        open_slice(order[o_next]);
+        ++o_next;
+      }
+
+      while (o_first_open < o_next && queryEnd(opts, intervals[order[o_first_open]]) <= pos)
+      {
+        close_slice(order[o_first_open]);
+        ++o_first_open;
+      }
+
+      // Every slice gets its own copy of the record since the filters modify it, the last one takes the original
+      SliceFilter * prev_slice = nullptr;
+
+      for (long k = o_first_open; k < o_next; ++k)
+      {
+        Interval const & interval = intervals[order[k]];
+        SliceFilter * slice = outputs[order[k]].slice.get();
+
+        if (!slice || queryBegin(opts, interval) >= end_pos || queryEnd(opts, interval) <= pos)
+          continue;
+
+        if (prev_slice)
+        {
+          bam1_t * copy = store.get();
+          bam_copy1(copy, record);
+          prev_slice->push(copy);
+        }
+
+        prev_slice = slice;
+      }
+
+      if (prev_slice)
+        prev_slice->push(record);
+      else
+        store.push(record);
     }
+
+    hts_itr_destroy(iter);
+
+    for (long k = o_first_open; k < o_end; ++k)
+      close_slice(order[k]);
+
+    o = o_end;
   }
 
-  intFile.close();
-  return intervalString;
+  closeInput(in);
 }
 
 
@@ -1164,13 +1651,13 @@ main(bamshrink::Options & opts)
       opts.bamIndex = opts.bamPathIn + std::string(".bai");
   }
 
-  String<Triple<CharString, int, int> > intervalString;
+  std::vector<Interval> intervals;
 
   if (opts.intervalFile.size() > 0)
   {
-    intervalString = readIntervals(opts);
+    intervals = readIntervals(opts);
 
-    if (length(intervalString) == 0)
+    if (intervals.size() == 0)
     {
       BOOST_LOG_TRIVIAL(error) << "The interval file \"" << opts.intervalFile << "\" contained no intervals!";
       return 1;
@@ -1179,7 +1666,6 @@ main(bamshrink::Options & opts)
 
   if (opts.interval.size() > 0)
   {
-    assert(opts.interval.size() > 0);
     auto begin_it = opts.interval.begin();
     auto end_it = opts.interval.end();
     auto find_colon_it = std::find(begin_it, end_it, ':');
@@ -1191,79 +1677,20 @@ main(bamshrink::Options & opts)
       return 1;
     }
 
-    Triple<CharString, int, int> interval;
-    interval.i1 = std::string(begin_it, find_colon_it).c_str();
-    interval.i2 = std::stoi(std::string(find_colon_it + 1, find_dash_it)) - 1;
-    interval.i3 = std::stoi(std::string(find_dash_it + 1, end_it)) - 1;
-    appendValue(intervalString, interval);
+    Interval interval;
+    interval.chrom = std::string(begin_it, find_colon_it);
+    interval.begin = std::stoi(std::string(find_colon_it + 1, find_dash_it)) - 1;
+    interval.end = std::stoi(std::string(find_dash_it + 1, end_it)) - 1;
+    intervals.push_back(std::move(interval));
   }
 
-  BamFileIn bamFileIn;
-  //
-  open(bamFileIn, opts.bamPathIn.c_str());
-
-  BamFileOut bamFileOut(opts.bamPathOut.c_str(), "wb");
-  BamAlignmentRecord record;
-
-  if (length(intervalString) == 0)
+  if (intervals.size() == 0)
   {
     BOOST_LOG_TRIVIAL(error) << "[graphtyper::bamshrink] Some intervals are required to extract reads from.";
     std::exit(1);
   }
 
-  // When there is only one contig, remove all other contigs from header to save space
-  if (length(intervalString) == 1)
-  {
-    std::ostringstream ss;
-    ss << "@SQ\tSN:" << intervalString[0].i1 << "\t";
-    std::string const sq = ss.str();
-    long const sq_len = sq.size();
-    std::string const hd = "@HD\t";
-    std::string const rg = "@RG\t";
-    const char * t = bamFileIn.hdr->text;
-    const char * t_end = bamFileIn.hdr->text + (bamFileIn.hdr->l_text - 4);
-    std::ostringstream new_ss;
-
-    while (t < t_end)
-    {
-      long line_size = std::distance(t, std::find(t, t + bamFileIn.hdr->l_text, '\n'));
-
-      if (std::equal(hd.begin(), hd.begin() + 4, t) ||
-          std::equal(rg.begin(), rg.begin() + 4, t) ||
-          (line_size > sq_len && std::equal(sq.begin(), sq.begin() + sq_len, t))
-          )
-      {
-        new_ss << std::string(t, line_size) << '\n';
-      }
-
-      t += line_size + 1;
-    }
-
-    std::string new_header = new_ss.str();
-    bamFileOut.hdr = sam_hdr_parse(new_header.size(), new_header.c_str());
-    bamFileOut.hdr->l_text = new_header.size();
-    bamFileOut.hdr->text = static_cast<char *>(realloc(bamFileOut.hdr->text, sizeof(char) * new_header.size()));
-    strncpy(bamFileOut.hdr->text, new_header.c_str(), new_header.size());
-    writeHeader(bamFileOut);
-    long read_num {
-      0
-    };
-    qualityFilterSlice2(opts, intervalString[0], bamFileIn, bamFileOut, read_num, true); // is_single_contig
-  }
-  else
-  {
-    copyHeader(bamFileOut, bamFileIn);
-    writeHeader(bamFileOut);
-    long read_num {
-      0
-    };
-
-    for (unsigned i = 0; i < length(intervalString); ++i)
-    {
-      qualityFilterSlice2(opts, intervalString[i], bamFileIn, bamFileOut, read_num, false); // is_single_contig
-    }
-  }
-
+  shrink(opts, intervals, "");
   return 0;
 }
 
@@ -1274,25 +1701,13 @@ main(bamshrink::Options & opts)
 namespace gyper
 {
 
-void
-bamshrink(seqan::String<seqan::Triple<seqan::CharString, int, int> > const & intervals,
-          std::string const & path_in,
-          std::string const & sam_index_in,
-          std::string const & path_out,
-          double const avg_cov_by_readlen,
-          const char * reference_genome)
+bamshrink::Options
+get_bamshrink_options(std::string const & path_in,
+                      std::string const & sam_index_in,
+                      double const avg_cov_by_readlen)
 {
-  if (seqan::length(intervals) == 0)
-  {
-    BOOST_LOG_TRIVIAL(warning) << "No intervals to read regions from. Aborting bamshrink.";
-    return;
-  }
-
   bamshrink::Options opts;
-  BamFileIn bamFileIn;
-  open(bamFileIn, path_in.c_str(), reference_genome);
-
-  BamFileOut bamFileOut(path_out.c_str(), "wb");
+  opts.bamPathIn = path_in;
   opts.bamIndex = sam_index_in;
 
   if (avg_cov_by_readlen > 0.0)
@@ -1309,60 +1724,28 @@ bamshrink(seqan::String<seqan::Triple<seqan::CharString, int, int> > const & int
   opts.minUnpairedReadLen = copts.bamshrink_min_unpair_readlen;
   opts.as_filter_threshold = copts.bamshrink_as_filter_threshold;
   opts.no_filter_on_coverage = copts.no_filter_on_coverage;
+  return opts;
+}
 
-  // When there is only one contig, remove all other contigs from header to save space
-  if (seqan::length(intervals) == 1)
-  {
-    auto const & interval = intervals[0];
-    std::ostringstream ss;
-    ss << "@SQ\tSN:" << interval.i1 << "\t";
-    std::string const sq = ss.str();
-    long const sq_len = sq.size();
-    std::string const hd = "@HD\t";
-    std::string const rg = "@RG\t";
-    const char * t = bamFileIn.hdr->text;
-    const char * t_end = bamFileIn.hdr->text + bamFileIn.hdr->l_text;
-    std::ostringstream new_ss;
-
-    while (t <= t_end)
-    {
-      long const line_size = std::distance(t, std::find(t, t_end, '\n'));
-
-      if (line_size > 4 &&
-          (std::equal(hd.begin(), hd.begin() + 4, t) ||
-           std::equal(rg.begin(), rg.begin() + 4, t) ||
-           (line_size > sq_len && std::equal(sq.begin(), sq.begin() + sq_len, t))))
-      {
-        new_ss << std::string(t, line_size) << '\n';
-      }
-
-      t += line_size + 1;
-    }
 
-    std::string new_header = new_ss.str();
-    bamFileOut.hdr = sam_hdr_parse(new_header.size(), new_header.c_str());
-    bamFileOut.hdr->l_text = new_header.size();
-    bamFileOut.hdr->text = static_cast<char *>(realloc(bamFileOut.hdr->text, sizeof(char) * new_header.size()));
-    strncpy(bamFileOut.hdr->text, new_header.c_str(), new_header.size());
-    writeHeader(bamFileOut);
-    long read_num {
-      0
-    };
-    bamshrink::qualityFilterSlice2(opts, interval, bamFileIn, bamFileOut, read_num, true); // is_single_contig
-  }
-  else
+void
+bamshrink(std::vector<Interval> const & intervals,
+          std::string const & path_in,
+          std::string const & sam_index_in,
+          std::string const & path_out,
+          double const avg_cov_by_readlen,
+          std::string const & reference_genome,
+          CigarDiscovery * discovery = nullptr)
+{
+  if (intervals.size() == 0)
   {
-    copyHeader(bamFileOut, bamFileIn);
-    writeHeader(bamFileOut);
-    long read_num {
-      0
-    };
-
-    for (auto const & interval : intervals)
-    {
-      bamshrink::qualityFilterSlice2(opts, interval, bamFileIn, bamFileOut, read_num, false); // is_single_contig
-    }
+    BOOST_LOG_TRIVIAL(warning) << "No intervals to read regions from. Aborting bamshrink.";
+    return;
   }
+
+  bamshrink::Options opts = get_bamshrink_options(path_in, sam_index_in, avg_cov_by_readlen);
+  opts.bamPathOut = path_out;
+  bamshrink::shrink(opts, intervals, reference_genome, discovery);
 }
 
 
@@ -1376,14 +1759,47 @@ bamshrink(std::string const chrom,
           double const avg_cov_by_readlen,
           std::string const ref_fn)
 {
-  seqan::String<seqan::Triple<seqan::CharString, int, int> > intervals;
-  seqan::Triple<seqan::CharString, int, int> interval;
-  interval.i1 = chrom.c_str();
-  interval.i2 = begin;
-  interval.i3 = end;
-  seqan::appendValue(intervals, interval);
+  Interval interval;
+  interval.chrom = chrom;
+  interval.begin = begin;
+  interval.end = end;
   BOOST_LOG_TRIVIAL(debug) << "Bamshrink is copying file " << path_in;
-  bamshrink(intervals, path_in, sam_index_in, path_out, avg_cov_by_readlen, ref_fn.c_str());
+  bamshrink(std::vector<Interval>(1, interval), path_in, sam_index_in, path_out, avg_cov_by_readlen, ref_fn);
+}
+
+
+void
+bamshrink_and_discover(std::string const chrom,
+                       int begin,
+                       int end,
+                       std::string const path_in,
+                       std::string const sam_index_in,
+                       std::string const path_out,
+                       double const avg_cov_by_readlen,
+                       std::string const ref_fn,
+                       GenomicRegion const * discovery_region,
+                       std::string const variant_map_path)
+{
+  assert(discovery_region);
+  Interval interval;
+  interval.chrom = chrom;
+  interval.begin = begin;
+  interval.end = end;
+
+  auto const & copts = *(Options::const_instance());
+  CigarDiscovery discovery(*discovery_region, copts.genotype_aln_min_support, copts.genotype_aln_min_support_ratio);
+  discovery.add_file(path_in);
+
+  BOOST_LOG_TRIVIAL(debug) << "Bamshrink is copying file " << path_in << " and discovering variants";
+  bamshrink(std::vector<Interval>(1, interval),
+            path_in,
+            sam_index_in,
+            path_out,
+            avg_cov_by_readlen,
+            ref_fn,
+            &discovery);
+
+  discovery.save(variant_map_path);
 }
 
 
@@ -1396,7 +1812,7 @@ bamshrink_multi(std::string const interval_fn,
 {
   bamshrink::Options opts;
   opts.intervalFile = interval_fn;
-  seqan::String<seqan::Triple<seqan::CharString, int, int> > intervals = readIntervals(opts);
+  std::vector<Interval> intervals = bamshrink::readIntervals(opts);
   std::string sam_index;
 
   if (path_in.size() > 5 && std::string(path_in.rbegin(), path_in.rbegin() + 5) == "marc.")
@@ -1404,7 +1820,34 @@ bamshrink_multi(std::string const interval_fn,
   else
     sam_index = path_in + ".bai";
 
-  bamshrink(intervals, path_in, sam_index, path_out, avg_cov_by_readlen, ref_fn.c_str());
+  bamshrink(intervals, path_in, sam_index, path_out, avg_cov_by_readlen, ref_fn);
+}
+
+
+void
+bamshrink_regions(std::vector<GenomicRegion> const & regions,
+                  std::string const & path_in,
+                  std::string const & sam_index_in,
+                  std::vector<std::string> const & paths_out,
+                  double const avg_cov_by_readlen,
+                  std::string const & ref_fn)
+{
+  assert(regions.size() == paths_out.size());
+  std::vector<Interval> intervals;
+  intervals.reserve(regions.size());
+
+  for (auto const & region : regions)
+  {
+    Interval interval;
+    interval.chrom = region.chr;
+    interval.begin = region.begin;
+    interval.end = region.end;
+    intervals.push_back(std::move(interval));
+  }
+
+  BOOST_LOG_TRIVIAL(debug) << "Bamshrink is copying " << regions.size() << " regions from file " << path_in;
+  bamshrink::Options opts = get_bamshrink_options(path_in, sam_index_in, avg_cov_by_readlen);
+  bamshrink::shrinkRegions(opts, intervals, paths_out, ref_fn);
 }
 
 
@@ -14,6 +14,7 @@
 #include <graphtyper/utilities/genotype.hpp>
 #include <graphtyper/utilities/hts_parallel_reader.hpp>
 #include <graphtyper/utilities/options.hpp>
+#include <graphtyper/utilities/stage_report.hpp>
 #include <graphtyper/utilities/system.hpp>
 
 #include <paw/station.hpp>
@@ -57,7 +58,9 @@ run_bamshrink(std::vector<std::string> const & sams,
               std::string const & ref_fn,
               GenomicRegion const & region,
               std::vector<double> const & avg_cov_by_readlen,
-              std::string const & tmp)
+              std::string const & tmp,
+              GenomicRegion const * discovery_region,
+              std::vector<std::string> * variant_map_paths)
 {
   // Get SAM/BAM/CRAM files
   create_dir(tmp + "/bams");
@@ -66,6 +69,14 @@ run_bamshrink(std::vector<std::string> const & sams,
   GenomicRegion bs_region(region); // bs = bamshrink
   bs_region.pad(100);
 
+  if (discovery_region)
+  {
+    assert(variant_map_paths);
+    create_dir(tmp + "/it1");
+    variant_map_paths->clear();
+    variant_map_paths->reserve(sams.size());
+  }
+
   paw::Station bamshrink_station(Options::const_instance()->threads);
   std::vector<std::string> output_paths;
   output_paths.reserve(sams.size());
@@ -81,15 +92,34 @@ run_bamshrink(std::vector<std::string> const & sams,
     ss << tmp << "/bams/" << basename << ".bam";
     std::string path_out = ss.str();
     output_paths.push_back(path_out);
-    bamshrink_station.add_work(bamshrink,
-                               bs_region.chr,
-                               bs_region.begin,
-                               bs_region.end,
-                               sam,
-                               sam_index,
-                               path_out,
-                               avg_cov,
-                               ref_fn);
+
+    if (discovery_region)
+    {
+      variant_map_paths->push_back(tmp + "/it1/" + basename + "_variant_map");
+      bamshrink_station.add_work(bamshrink_and_discover,
+                                 bs_region.chr,
+                                 bs_region.begin,
+                                 bs_region.end,
+                                 sam,
+                                 sam_index,
+                                 path_out,
+                                 avg_cov,
+                                 ref_fn,
+                                 discovery_region,
+                                 variant_map_paths->back());
+    }
+    else
+    {
+      bamshrink_station.add_work(bamshrink,
+                                 bs_region.chr,
+                                 bs_region.begin,
+                                 bs_region.end,
+                                 sam,
+                                 sam_index,
+                                 path_out,
+                                 avg_cov,
+                                 ref_fn);
+    }
   }
 
   // Process the last sam on the main thread
@@ -105,16 +135,112 @@ run_bamshrink(std::vector<std::string> const & sams,
     std::string path_out = ss.str();
     output_paths.push_back(path_out);
 
-    bamshrink_station.add_to_thread(Options::const_instance()->threads - 1,
-                                    bamshrink,
-                                    bs_region.chr,
-                                    bs_region.begin,
-                                    bs_region.end,
-                                    sam,
-                                    sam_index,
-                                    path_out,
-                                    avg_cov,
-                                    ref_fn);
+    if (discovery_region)
+    {
+      variant_map_paths->push_back(tmp + "/it1/" + basename + "_variant_map");
+      bamshrink_station.add_to_thread(Options::const_instance()->threads - 1,
+                                      bamshrink_and_discover,
+                                      bs_region.chr,
+                                      bs_region.begin,
+                                      bs_region.end,
+                                      sam,
+                                      sam_index,
+                                      path_out,
+                                      avg_cov,
+                                      ref_fn,
+                                      discovery_region,
+                                      variant_map_paths->back());
+    }
+    else
+    {
+      bamshrink_station.add_to_thread(Options::const_instance()->threads - 1,
+                                      bamshrink,
+                                      bs_region.chr,
+                                      bs_region.begin,
+                                      bs_region.end,
+                                      sam,
+                                      sam_index,
+                                      path_out,
+                                      avg_cov,
+                                      ref_fn);
+    }
+  }
+
+  std::string const thread_info = bamshrink_station.join();
+
+  // DO NOT CHANGE THIS LOG LINE (we parse it externally)
+  BOOST_LOG_TRIVIAL(info) << "Finished copying data. Thread work: " << thread_info;
+  // PLEEEASE
+
+  return output_paths;
+}
+
+
+std::vector<std::vector<std::string> >
+run_bamshrink_regions(std::vector<std::string> const & sams,
+                      std::vector<std::string> const & sams_index,
+                      std::string const & ref_fn,
+                      std::vector<GenomicRegion> const & regions,
+                      std::vector<double> const & avg_cov_by_readlen,
+                      std::string const & tmp)
+{
+  assert(sams.size() == avg_cov_by_readlen.size());
+  assert(sams.size() == sams_index.size());
+  create_dir(tmp + "/bams");
+
+  std::vector<GenomicRegion> bs_regions(regions); // bs = bamshrink
+
+  for (auto & bs_region : bs_regions)
+    bs_region.pad(100);
+
+  // output_paths[r][s] is the shrinked file of sample s in region r
+  std::vector<std::vector<std::string> > output_paths(regions.size());
+
+  for (long r = 0; r < static_cast<long>(regions.size()); ++r)
+  {
+    std::ostringstream ss_dir;
+    ss_dir << tmp << "/bams/" << std::setw(5) << std::setfill('0') << r;
+    std::string const dir = ss_dir.str();
+    create_dir(dir);
+    output_paths[r].reserve(sams.size());
+
+    for (auto const & sam : sams)
+      output_paths[r].push_back(dir + "/" + get_basename_wo_ext(sam) + ".bam");
+  }
+
+  // Each input file is read once, so the work is split by input file
+  paw::Station bamshrink_station(Options::const_instance()->threads);
+
+  for (long s = 0; s < static_cast<long>(sams.size()); ++s)
+  {
+    std::vector<std::string> paths_out;
+    paths_out.reserve(regions.size());
+
+    for (auto const & region_paths : output_paths)
+      paths_out.push_back(region_paths[s]);
+
+    if (s + 1 < static_cast<long>(sams.size()))
+    {
+      bamshrink_station.add_work(bamshrink_regions,
+                                 bs_regions,
+                                 sams[s],
+                                 sams_index[s],
+                                 std::move(paths_out),
+                                 avg_cov_by_readlen[s],
+                                 ref_fn);
+    }
+    else
+    {
+      // Process the last sam on the main thread
+      bamshrink_station.add_to_thread(Options::const_instance()->threads - 1,
+                                      bamshrink_regions,
+                                      bs_regions,
+                                      sams[s],
+                                      sams_index[s],
+                                      std::move(paths_out),
+                                      avg_cov_by_readlen[s],
+                                      ref_fn);
+    }
   }
 
   std::string const thread_info = bamshrink_station.join();
@@ -270,7 +396,8 @@ genotype_only_with_a_vcf(std::string const & ref_path,
                          GenomicRegion const & region,
                          GenomicRegion const & padded_region,
                          Primers const * primers,
-                         std::string const & tmp)
+                         std::string const & tmp,
+                         std::string const & output_ext)
 {
   // Iteration 1
   BOOST_LOG_TRIVIAL(info) << "Genotyping using an input VCF.";
@@ -284,6 +411,7 @@ genotype_only_with_a_vcf(std::string const & ref_path,
   bool const is_discovery{false};
   bool const is_writing_hap{false};
 
+  StageTimer construct_timer("it1/construct_graph");
   gyper::construct_graph(ref_path,
                          Options::const_instance()->vcf,
                          padded_region.to_string(),
@@ -292,6 +420,7 @@ genotype_only_with_a_vcf(std::string const & ref_path,
                          check_index);
 
   absolute_pos.calculate_offsets(gyper::graph.contigs);
+  construct_timer.stop();
 
 #ifndef NDEBUG
   // Save graph in debug mode
@@ -301,8 +430,11 @@ genotype_only_with_a_vcf(std::string const & ref_path,
   std::vector<std::string> paths;
 
   {
+    StageTimer index_timer("it1/index");
     PHIndex ph_index = index_graph(gyper::graph);
+    index_timer.stop();
 
+    StageTimer call_timer("it1/call");
     paths = gyper::call(shrinked_sams,
                         "",                          // graph_path
                         ph_index,
@@ -325,7 +457,9 @@ genotype_only_with_a_vcf(std::string const & ref_path,
   //  path += "_calls.vcf.gz";
 
   //> FILTER_ZERO_QUAL, force_no_variant_overlapping, force_no_break_down
-  vcf_merge_and_break(paths, tmp + "/graphtyper.vcf.gz", region.to_string(), true, false, false);
+  StageTimer merge_timer("merge_and_break");
+  vcf_merge_and_break(paths, tmp + "/graphtyper" + output_ext, region.to_string(), true, false, false);
+  merge_timer.stop();
 
   // free memory
   graph = Graph();
@@ -339,7 +473,8 @@ genotype(std::string ref_path,
          GenomicRegion const & region,
          std::string const & output_path,
          std::vector<double> const & avg_cov_by_readlen,
-         bool const is_copy_reference)
+         bool const is_copy_reference,
+         std::vector<std::string> const & shrinked_sams_in)
 {
   // TODO: If the reference is only Ns then output an empty vcf with the sample names
   // TODO: Extract the reference sequence and use that to discover directly from BAM
@@ -350,8 +485,10 @@ genotype(std::string ref_path,
   long minimum_variant_support = 5;
   double minimum_variant_support_ratio = 0.25;
   gyper::Options const & copts = *(Options::const_instance());
+  std::string const output_ext = copts.output_bcf ? ".bcf" : ".vcf.gz"; // Extension of the final output
 
   long const NUM_SAMPLES = sams.size();
+  stage_report.clear(region.to_string());
   BOOST_LOG_TRIVIAL(info) << "Genotyping region " << region.to_string();
   BOOST_LOG_TRIVIAL(info) << "Path to genome is '" << ref_path << "'";
   BOOST_LOG_TRIVIAL(info) << "Running with up to " << copts.threads << " threads.";
@@ -402,12 +539,27 @@ genotype(std::string ref_path,
     ref_path = tmp + "/genome.fa";
   }
 
+  GenomicRegion padded_region(region);
+  padded_region.pad(1000l);
+
   std::vector<std::string> shrinked_sams;
 
+  // Variant maps of cigar discovery done by bamshrink, if they are set the first iteration does not read the input again
+  std::vector<std::string> bamshrink_variant_maps;
+
   if (copts.no_bamshrink)
   {
     shrinked_sams = std::move(sams);
   }
+  else if (shrinked_sams_in.size() > 0)
+  {
+    // The input files have already been shrinked for this region
+    create_dir(tmp + "/bams");
+    shrinked_sams = shrinked_sams_in;
+    std::sort(shrinked_sams.begin(), shrinked_sams.end()); // Sort by input filename
+    StageTimer merge_timer("merge");
+    run_samtools_merge(shrinked_sams, tmp);
+  }
   else
   {
     std::string bamshrink_ref_path;
@@ -415,14 +567,35 @@ genotype(std::string ref_path,
     if (copts.force_use_input_ref_for_cram_reading)
       bamshrink_ref_path = ref_path;
 
-    shrinked_sams = run_bamshrink(sams, sams_index, bamshrink_ref_path, region, avg_cov_by_readlen, tmp);
+    if (copts.is_cigar_discovery_in_bamshrink && copts.vcf.size() == 0)
+    {
+      // Cigar discovery needs the reference graph of the first iteration
+      StageTimer construct_timer("it1/construct_graph");
+      gyper::construct_graph(ref_path, "", padded_region.to_string(), false, true, false);
+      absolute_pos.calculate_offsets(gyper::graph.contigs);
+      construct_timer.stop();
+
+      StageTimer bamshrink_timer("bamshrink");
+      shrinked_sams = run_bamshrink(sams,
+                                    sams_index,
+                                    bamshrink_ref_path,
+                                    region,
+                                    avg_cov_by_readlen,
+                                    tmp,
+                                    &padded_region,
+                                    &bamshrink_variant_maps);
+    }
+    else
+    {
+      StageTimer bamshrink_timer("bamshrink");
+      shrinked_sams = run_bamshrink(sams, sams_index, bamshrink_ref_path, region, avg_cov_by_readlen, tmp);
+    }
+
     std::sort(shrinked_sams.begin(), shrinked_sams.end()); // Sort by input filename
+    StageTimer merge_timer("merge");
     run_samtools_merge(shrinked_sams, tmp);
   }
 
-  GenomicRegion padded_region(region);
-  padded_region.pad(1000l);
-
   // Read primers from amplicon sequencing if they were specified
   std::unique_ptr<Primers> primers;
 
@@ -435,7 +608,7 @@ genotype(std::string ref_path,
   if (copts.vcf.size() > 0)
   {
     BOOST_LOG_TRIVIAL(info) << "Genotyping a input VCF";
-    genotype_only_with_a_vcf(ref_path, shrinked_sams, region, padded_region, primers.get(), tmp);
+    genotype_only_with_a_vcf(ref_path, shrinked_sams, region, padded_region, primers.get(), tmp, output_ext);
   }
   else
   {
@@ -443,29 +616,53 @@ genotype(std::string ref_path,
     minimum_variant_support_ratio = copts.genotype_aln_min_support_ratio;
     is_writing_calls_vcf = false; // Skip writing calls vcf in release mode in all iterations except the last one
 
+    // Variant sites found in the previous iteration, the next graph is constructed with them. Their VCF is only
+    // written if the temporary files are kept, except the sites of the last graph which are copied to the output.
+    std::vector<Variant> prev_sites;
+
     // Iteration 1
     {
       BOOST_LOG_TRIVIAL(info) << "Initial variant discovery step starting.";
       std::string const output_vcf = tmp + "/it1/final.vcf.gz";
       std::string const out_dir = tmp + "/it1";
       mkdir(out_dir.c_str(), 0755);
-      gyper::construct_graph(ref_path, "", padded_region.to_string(), false, true, false);
+      std::vector<std::string> output_paths;
+
+      // The graph is already constructed if bamshrink discovered the variants
+      if (bamshrink_variant_maps.size() == 0)
+      {
+        StageTimer construct_timer("it1/construct_graph");
+        gyper::construct_graph(ref_path, "", padded_region.to_string(), false, true, false);
+        absolute_pos.calculate_offsets(gyper::graph.contigs);
+      }
+
 #ifndef NDEBUG
       // Save graph in debug mode
       save_graph(out_dir + "/graph");
 #endif // NDEBUG
-      absolute_pos.calculate_offsets(gyper::graph.contigs);
-      auto output_paths = gyper::discover_directly_from_bam("",
-                                                            shrinked_sams,
-                                                            padded_region.to_string(),
-                                                            out_dir,
-                                                            minimum_variant_support,
-                                                            minimum_variant_support_ratio);
+
+      StageTimer discovery_timer("it1/discovery");
+
+      if (bamshrink_variant_maps.size() == 0)
+      {
+        output_paths = gyper::discover_directly_from_bam("",
+                                                         shrinked_sams,
+                                                         padded_region.to_string(),
+                                                         out_dir,
+                                                         minimum_variant_support,
+                                                         minimum_variant_support_ratio);
+      }
+      else
+      {
+        output_paths = std::move(bamshrink_variant_maps);
+      }
+
       gyper::VariantMap varmap;
       varmap.load_many_variant_maps(output_paths);
       varmap.filter_varmap_for_all();
       Vcf final_vcf;
       varmap.get_vcf(final_vcf, output_vcf);
+      discovery_timer.stop();
 
       if (copts.prior_vcf.size() > 0)
       {
@@ -476,10 +673,15 @@ genotype(std::string ref_path,
         std::move(prior_variants.begin(), prior_variants.end(), std::back_inserter(final_vcf.variants));
       }
 
-      final_vcf.write(".", copts.threads);
+      prev_sites = final_vcf.get_sites();
+
+      if (copts.no_cleanup)
+      {
+        final_vcf.write(".", copts.threads);
 #ifndef NDEBUG
-      final_vcf.write_tbi_index(); // Write index in debug mode
+        final_vcf.write_tbi_index(); // Write index in debug mode
 #endif // NDEBUG
+      }
 
       // free memory
       graph = Graph();
@@ -512,7 +714,9 @@ genotype(std::string ref_path,
       std::string const haps_output_vcf = out_dir + "/haps.vcf.gz";
       std::string const discovery_output_vcf = out_dir + "/discovery.vcf.gz";
       mkdir(out_dir.c_str(), 0755);
-      construct_graph(ref_path, tmp + "/it1/final.vcf.gz", padded_region.to_string(), false, true, false);
+      StageTimer construct_timer("it2/construct_graph");
+      construct_graph(ref_path, prev_sites, padded_region.to_string(), true);
+      construct_timer.stop();
 
 #ifndef NDEBUG
       // Save graph in debug mode
@@ -522,11 +726,14 @@ genotype(std::string ref_path,
       std::vector<std::string> paths;
 
       {
+        StageTimer index_timer("it2/index");
         PHIndex ph_index = index_graph(gyper::graph);
+        index_timer.stop();
 
         minimum_variant_support = copts.genotype_dis_min_support;
         minimum_variant_support_ratio = copts.genotype_dis_min_support_ratio;
 
+        StageTimer call_timer("it2/call");
         paths = gyper::call(shrinked_sams,
                             "", // graph_path
                             ph_index,
@@ -541,6 +748,7 @@ genotype(std::string ref_path,
                             is_writing_hap);
       }
 
+      StageTimer extract_timer("it2/extract");
       Vcf haps_vcf;
       extract_to_vcf(haps_vcf,
                      paths,
@@ -558,11 +766,16 @@ genotype(std::string ref_path,
       Vcf discovery_vcf;
       varmap.get_vcf(discovery_vcf, out_dir + "/final.vcf.gz");
       std::move(haps_vcf.variants.begin(), haps_vcf.variants.end(), std::back_inserter(discovery_vcf.variants));
-      discovery_vcf.write(".", copts.threads);
+      prev_sites = discovery_vcf.get_sites();
+      extract_timer.stop();
 
+      if (copts.no_cleanup)
+      {
+        discovery_vcf.write(".", copts.threads);
 #ifndef NDEBUG
-      discovery_vcf.write_tbi_index(); // Write index in debug mode
+        discovery_vcf.write_tbi_index(); // Write index in debug mode
 #endif // NDEBUG
+      }
 
       // free memory
       graph = Graph();
@@ -582,14 +795,9 @@ genotype(std::string ref_path,
         is_writing_hap = false; // No need for writing .hap
       }
 
-      std::string prev_out_vcf;
       std::string out_dir;
 
       {
-        std::ostringstream ss_prev;
-        ss_prev << tmp << "/it" << (i - 1) << "/final.vcf.gz";
-        prev_out_vcf = ss_prev.str();
-
         std::ostringstream ss;
         ss << tmp << "/it" << i;
         out_dir = ss.str();
@@ -597,7 +805,11 @@ genotype(std::string ref_path,
 
       mkdir(out_dir.c_str(), 0755);
       std::string const haps_output_vcf = out_dir + "/final.vcf.gz";
-      construct_graph(ref_path, prev_out_vcf, padded_region.to_string(), false, true, false);
+      std::string const stage_prefix = "it" + std::to_string(i);
+      StageTimer construct_timer(stage_prefix + "/construct_graph");
+      construct_graph(ref_path, prev_sites, padded_region.to_string(), true);
+      prev_sites.clear();
+      construct_timer.stop();
 
 #ifndef NDEBUG
       // Save graph in debug mode
@@ -605,8 +817,11 @@ genotype(std::string ref_path,
 #endif // NDEBUG
 
       {
+        StageTimer index_timer(stage_prefix + "/index");
         PHIndex ph_index = index_graph(gyper::graph);
+        index_timer.stop();
 
+        StageTimer call_timer(stage_prefix + "/call");
         paths = gyper::call(shrinked_sams,
                             "", // graph_path
                             ph_index,
@@ -626,17 +841,25 @@ genotype(std::string ref_path,
         // Split variants unless its the next-to-last iteration
         bool const is_splitting_vars = (i + 1) < LAST_ITERATION;
 
+        StageTimer extract_timer(stage_prefix + "/extract");
         Vcf haps_vcf;
         extract_to_vcf(haps_vcf,
                        paths,
                        haps_output_vcf,
                        is_splitting_vars);
 
-        haps_vcf.write(".", copts.threads);
+        prev_sites = haps_vcf.get_sites();
+        extract_timer.stop();
+
+        // The sites of the last graph are copied to the output
+        if (copts.no_cleanup || i + 1 == LAST_ITERATION)
+        {
+          haps_vcf.write(".", copts.threads);
 #ifndef NDEBUG
-        // Write index in debug mode
-        haps_vcf.write_tbi_index();
+          // Write index in debug mode
+          haps_vcf.write_tbi_index();
 #endif // NDEBUG
+        }
 
         // free memory
         graph = Graph();
@@ -647,18 +870,20 @@ genotype(std::string ref_path,
 
     // VCF merge and break_down
     {
+      StageTimer merge_timer("merge_and_break");
+
       // Append _calls.vcf.gz
       //for (auto & path : paths)
       //  path += "_calls.vcf.gz";
 
       //> FILTER_ZERO_QUAL, force_no_variant_overlapping
-      vcf_merge_and_break(paths, tmp + "/graphtyper.vcf.gz", region.to_string(), true, false, false);
+      vcf_merge_and_break(paths, tmp + "/graphtyper" + output_ext, region.to_string(), true, false, false);
 
       if (copts.normal_and_no_variant_overlapping)
       {
         //> FILTER_ZERO_QUAL, force_no_variant_overlapping
         vcf_merge_and_break(paths,
-                            tmp + "/graphtyper.no_variant_overlapping.vcf.gz",
+                            tmp + "/graphtyper.no_variant_overlapping" + output_ext,
                             region.to_string(),
                             true,
                             true,
@@ -667,63 +892,51 @@ genotype(std::string ref_path,
     }
 
 
-    BOOST_LOG_TRIVIAL(info) << "Copying results to output directory.";
+    BOOST_LOG_TRIVIAL(info) << "Moving results to output directory.";
 
     // Copy sites to system
     {
-      std::ostringstream ss_cmd;
-      ss_cmd << "cp -p " << tmp << "/it" << (LAST_ITERATION - 1) << "/final.vcf.gz" << " " // Change to (LAST_ITERATION - 1)
-             << output_path << "/input_sites/" << region.chr << "/"
-             << std::setw(9) << std::setfill('0') << (region.begin + 1)
-             << '-'
-             << std::setw(9) << std::setfill('0') << region.end
-             << ".vcf.gz";
-
-      int ret = system(ss_cmd.str().c_str());
-
-      if (ret != 0)
-      {
-        BOOST_LOG_TRIVIAL(error) << "This command failed '" << ss_cmd.str() << "'";
-        std::exit(ret);
-      }
+      std::ostringstream ss_to;
+      ss_to << output_path << "/input_sites/" << region.chr << "/"
+            << std::setw(9) << std::setfill('0') << (region.begin + 1)
+            << '-'
+            << std::setw(9) << std::setfill('0') << region.end
+            << ".vcf.gz";
+
+      copy_file(tmp + "/it" + std::to_string(LAST_ITERATION - 1) + "/final.vcf.gz", ss_to.str());
     }
   }
 
-  // Copy final VCFs
-  auto copy_to_results =
-    [&](std::string const & basename_no_ext, std::string const & extension, std::string const & id)
+  // Move final VCFs and their indexes (which were built while the VCFs were written) to the output directory. Each
+  // file is renamed into place, so a partially written output never appears there.
+  auto move_to_results =
+    [&](std::string const & basename_no_ext, std::string const & id)
     {
-      std::ostringstream ss_cmd;
-      ss_cmd << "cp -p " << tmp << "/" << basename_no_ext << extension << " "
-             << output_path << "/" << region.chr << "/"
-             << std::setw(9) << std::setfill('0') << (region.begin + 1)
-             << '-'
-             << std::setw(9) << std::setfill('0') << region.end
-             << id
-             << extension;
-
-      int ret = system(ss_cmd.str().c_str());
-
-      if (extension != ".vcf.gz.tbi" && ret != 0)
+      std::ostringstream ss_to;
+      ss_to << output_path << "/" << region.chr << "/"
+            << std::setw(9) << std::setfill('0') << (region.begin + 1)
+            << '-'
+            << std::setw(9) << std::setfill('0') << region.end
+            << id
+            << output_ext;
+
+      std::string const from = tmp + "/" + basename_no_ext + output_ext;
+      std::string const to = ss_to.str();
+
+      // Move the index first so it is in place when the VCF appears
+      for (std::string const idx_ext : {".tbi", ".csi"})
       {
-        BOOST_LOG_TRIVIAL(error) << __HERE__ << " This command failed '" << ss_cmd.str() << "'";
-        std::exit(ret);
-      }
-      else if (ret != 0)
-      {
-        // Just a warning if tabix fails and there is no index
-        BOOST_LOG_TRIVIAL(warning) << __HERE__ << " This command failed '" << ss_cmd.str() << "'";
+        if (is_file(from + idx_ext))
+          move_file(from + idx_ext, to + idx_ext);
       }
+
+      move_file(from, to);
     };
 
-  copy_to_results("graphtyper", ".vcf.gz", ""); // Copy final VCF
-  copy_to_results("graphtyper", ".vcf.gz.tbi", ""); // Copy tabix index for final VCF
+  move_to_results("graphtyper", ""); // Move final VCF
 
   if (copts.normal_and_no_variant_overlapping)
-  {
-    copy_to_results("graphtyper.no_variant_overlapping", ".vcf.gz", ".no_variant_overlapping");
-    copy_to_results("graphtyper.no_variant_overlapping", ".vcf.gz.tbi", ".no_variant_overlapping");
-  }
+    move_to_results("graphtyper.no_variant_overlapping", ".no_variant_overlapping");
 
   if (!copts.no_cleanup)
   {
@@ -741,10 +954,22 @@ genotype(std::string ref_path,
        << std::setw(9) << std::setfill('0') << (region.begin + 1)
        << '-'
        << std::setw(9) << std::setfill('0') << region.end
-       << ".vcf.gz";
+       << output_ext;
 
     BOOST_LOG_TRIVIAL(info) << "Finished! Output written at: " << ss.str();
   }
+
+  // Write the timings, memory usage and counters of each stage next to the output VCF
+  {
+    std::ostringstream ss;
+    ss << output_path << "/" << region.chr << "/"
+       << std::setw(9) << std::setfill('0') << (region.begin + 1)
+       << '-'
+       << std::setw(9) << std::setfill('0') << region.end
+       << ".stages.json";
+
+    stage_report.write_json(ss.str());
+  }
 }
 
 
@@ -800,17 +1025,72 @@ genotype_regions(std::string const & ref_path,
     }
   }
 
-  // Genotype regions serially
-  for (auto const & region : regions)
+  long const REGIONS_PER_PASS = opts.bamshrink_regions_per_pass;
+
+  if (REGIONS_PER_PASS > 1 && opts.is_cigar_discovery_in_bamshrink && !opts.no_bamshrink)
   {
-    genotype(ref_path,
-             sams,
-             sams_index,
-             region,
-             output_path,
-             avg_cov_by_readlen,
-             is_copy_reference);
+    BOOST_LOG_TRIVIAL(warning) << __HERE__ << " --bamshrink_regions_per_pass is ignored with "
+                               << "--is_cigar_discovery_in_bamshrink, each region is shrinked separately.";
   }
+
+  // Discovery during bamshrink needs the graph of the region, so then each region is shrinked on its own
+  if (opts.no_bamshrink || opts.is_cigar_discovery_in_bamshrink || REGIONS_PER_PASS <= 1 || regions.size() <= 1)
+  {
+    // Genotype regions serially
+    for (auto const & region : regions)
+    {
+      genotype(ref_path,
+               sams,
+               sams_index,
+               region,
+               output_path,
+               avg_cov_by_readlen,
+               is_copy_reference,
+               {});
+    }
+
+    return;
+  }
+
+  std::string bamshrink_ref_path;
+
+  if (opts.force_use_input_ref_for_cram_reading)
+    bamshrink_ref_path = ref_path;
+
+  // Shrink the input files for a batch of regions in a single pass over each file, then genotype them serially
+  for (long r = 0; r < static_cast<long>(regions.size()); r += REGIONS_PER_PASS)
+  {
+    auto batch_end = regions.begin() + std::min(static_cast<long>(regions.size()), r + REGIONS_PER_PASS);
+    std::vector<GenomicRegion> const batch(regions.begin() + r, batch_end);
+    std::string const tmp = create_temp_dir(batch[0]);
+
+    BOOST_LOG_TRIVIAL(info) << "Copying data of " << batch.size() << " regions from " << NUM_SAMPLES
+                            << " input SAM/BAM/CRAMs to " << tmp;
+
+    // The pass is reported in the stages of each region of the batch, split evenly between them
+    StageTimer bamshrink_timer("bamshrink", batch.size());
+    std::vector<std::vector<std::string> > shrinked_sams =
+      run_bamshrink_regions(sams, sams_index, bamshrink_ref_path, batch, avg_cov_by_readlen, tmp);
+    bamshrink_timer.stop();
+    stage_report.set_shared_stages({bamshrink_timer.get_usage()});
+
+    for (long b = 0; b < static_cast<long>(batch.size()); ++b)
+    {
+      genotype(ref_path,
+               sams,
+               sams_index,
+               batch[b],
+               output_path,
+               avg_cov_by_readlen,
+               is_copy_reference,
+               shrinked_sams[b]);
+    }
+
+    if (!opts.no_cleanup)
+      remove_file_tree(tmp.c_str());
+  }
+
+  stage_report.set_shared_stages({});
 }
 
 
@@ -160,38 +160,26 @@ genotype_sv(std::string ref_path,
     }
   }
 
-  // Copy final VCFs
-  auto copy_vcf_to_system =
-    [&](std::string const & extension) -> void
-    {
-      std::ostringstream ss_cmd;
-      ss_cmd << "cp -p " << tmp << "/graphtyper.vcf.gz" << extension << " "
-             << output_path << "/" << genomic_region.chr << "/"
-             << std::setw(9) << std::setfill('0') << (genomic_region.begin + 1)
-             << '-'
-             << std::setw(9) << std::setfill('0') << genomic_region.end
-             << ".vcf.gz" << extension;
+  // Move final VCF and its index to the output directory
+  {
+    std::ostringstream ss_to;
+    ss_to << output_path << "/" << genomic_region.chr << "/"
+          << std::setw(9) << std::setfill('0') << (genomic_region.begin + 1)
+          << '-'
+          << std::setw(9) << std::setfill('0') << genomic_region.end
+          << ".vcf.gz";
 
-      int ret = system(ss_cmd.str().c_str());
+    std::string const from = tmp + "/graphtyper.vcf.gz";
+    std::string const to = ss_to.str();
 
-      if (ret != 0)
-      {
-        if (extension.size() == 0)
-        {
-          // Error if copying final VCF
-          BOOST_LOG_TRIVIAL(error) << "This command failed '" << ss_cmd.str() << "'";
-          std::exit(ret);
-        }
-        else
-        {
-          // Otherwise a warning
-          BOOST_LOG_TRIVIAL(warning) << "This command failed '" << ss_cmd.str() << "'";
-        }
-      }
-    };
+    for (std::string const idx_ext : {".tbi", ".csi"})
+    {
+      if (is_file(from + idx_ext))
+        move_file(from + idx_ext, to + idx_ext);
+    }
 
-  copy_vcf_to_system(""); // Copy final VCF
-  copy_vcf_to_system(".tbi"); // Copy tabix index for final VCF
+    move_file(from, to);
+  }
 
   if (!Options::instance()->no_cleanup)
   {
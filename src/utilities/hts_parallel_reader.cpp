@@ -76,11 +76,7 @@ HtsParallelReader::open(std::vector<std::string> const & hts_file_paths,
   for (auto const & bam : hts_file_paths)
   {
     HtsReader f(store);
-    f.open(bam, region);
-
-    if (!reference.empty())
-      f.set_reference(reference);
-
+    f.open(bam, region, reference);
     f.set_sample_index_offset(samples.size());
     std::copy(f.samples.begin(), f.samples.end(), std::back_inserter(samples));
     f.set_rg_index_offset(num_rg);
@@ -654,6 +650,7 @@ parallel_reader_genotype_only(std::string * out_path,
 
     if (graph.is_sv_graph)
     {
+      reference_depth.finalize();
       reformat_sv_vcf_records(vcf.variants, reference_depth);
 
       if (vcf.sample_names.size() > 0)
@@ -792,6 +789,7 @@ parallel_reader_with_discovery(std::string * out_path,
 #endif // NDEBUG
 
   // Output variants
+  reference_depth.finalize();
   varmap.create_varmap_for_all(reference_depth);
 
 #ifndef NDEBUG
@@ -842,6 +840,7 @@ parallel_reader_with_discovery(std::string * out_path,
 
     if (graph.is_sv_graph)
     {
+      reference_depth.finalize();
       reformat_sv_vcf_records(vcf.variants, reference_depth);
 
       if (vcf.sample_names.size() > 0)
@@ -875,7 +874,10 @@ sam_merge(std::string const & output_sam, std::vector<std::string> const & input
 
     HtsRecord hts_rec;
     HtsWriter hts_writer;
-    hts_writer.open(output_sam);
+
+    // The merged file is a temporary file which is read in every iteration. Writing it without BGZF compression
+    // avoids deflating every record here and inflating it again on each read
+    hts_writer.open(output_sam, "wbu");
     hts_writer.copy_header(hts_preader);
 
     while (hts_preader.read_record(hts_rec))
@@ -1,25 +1,173 @@
 #include <algorithm> // std::sort
 #include <iostream> // std::cout, std::cerr, std::endl
+#include <map> // std::map
+#include <mutex> // std::mutex, std::once_flag, std::call_once
 
 #include <graphtyper/utilities/hts_reader.hpp>
 
 #include <boost/algorithm/string.hpp>
 #include <boost/log/trivial.hpp>
 
+#include <htslib/cram.h>
 #include <htslib/hfile.h>
 #include <htslib/hts.h>
 
 
+namespace
+{
+
+class SharedHtsThreadPool
+{
+public:
+  htsThreadPool p{nullptr, 0};
+
+  SharedHtsThreadPool() = default;
+  SharedHtsThreadPool(SharedHtsThreadPool const &) = delete;
+  SharedHtsThreadPool & operator=(SharedHtsThreadPool const &) = delete;
+
+  ~SharedHtsThreadPool()
+  {
+    if (p.pool)
+      hts_tpool_destroy(p.pool);
+  }
+
+
+  void
+  init(int const n_threads)
+  {
+    if (n_threads <= 1)
+      return;
+
+    p.pool = hts_tpool_init(n_threads);
+
+    if (!p.pool)
+    {
+      BOOST_LOG_TRIVIAL(warning) << "[graphtyper::utilities::hts_reader] Could not create a htslib thread pool with "
+                                 << n_threads << " threads. Decompressing on the calling threads instead.";
+      return;
+    }
+
+    BOOST_LOG_TRIVIAL(debug) << "[graphtyper::utilities::hts_reader] Created a shared htslib thread pool with "
+                             << n_threads << " threads.";
+  }
+
+
+};
+
+
+/** Process-wide cache of CRAM reference sequences. The first CRAM opened for a given reference FASTA and set of
+ *  contigs becomes the owner of the reference store (refs_t), and later CRAMs with identical @SQ lines share it via
+ *  CRAM_OPT_SHARED_REF. The owner file handle is kept open so the loaded sequences outlive the individual readers.
+ */
+class CramReferenceCache
+{
+public:
+  CramReferenceCache() = default;
+  CramReferenceCache(CramReferenceCache const &) = delete;
+  CramReferenceCache & operator=(CramReferenceCache const &) = delete;
+
+  ~CramReferenceCache()
+  {
+    for (auto & key_fp : owners)
+      hts_close(key_fp.second);
+  }
+
+
+  int
+  attach(htsFile * fp, bam_hdr_t const * hdr, std::string const & reference_path)
+  {
+    std::string const key = get_key(hdr, reference_path);
+    std::lock_guard<std::mutex> lock(mutex);
+    auto find_it = owners.find(key);
+
+    if (find_it == owners.end())
+    {
+      // First CRAM with this reference and contigs, it becomes the owner of the reference store
+      htsFile * owner = hts_open(fp->fn, "r");
+
+      if (!owner)
+        return -1;
+
+      if (reference_path.size() > 0 && hts_set_fai_filename(owner, reference_path.c_str()) < 0)
+      {
+        hts_close(owner);
+        return -1;
+      }
+
+      find_it = owners.insert(find_it, {key, owner});
+    }
+
+    refs_t * refs = cram_get_refs(find_it->second);
+
+    if (!refs)
+      return -1;
+
+    return hts_set_opt(fp, CRAM_OPT_SHARED_REF, refs);
+  }
+
+
+private:
+  std::mutex mutex;
+  std::map<std::string, htsFile *> owners;
+
+  static std::string
+  get_key(bam_hdr_t const * hdr, std::string const & reference_path)
+  {
+    // Reference IDs in CRAM slices index the @SQ lines, so sharing is only safe between identical contig lists
+    std::string key(reference_path);
+
+    for (int32_t i = 0; i < hdr->n_targets; ++i)
+    {
+      key.push_back('\n');
+      key.append(hdr->target_name[i]);
+    }
+
+    return key;
+  }
+
+
+};
+
+
+} // anon namespace
+
+
 namespace gyper
 {
 
+int
+set_shared_cram_reference(htsFile * fp, bam_hdr_t const * hdr, std::string const & reference_path)
+{
+  static CramReferenceCache cache;
+
+  if (!fp || !hdr || fp->format.format != cram)
+    return 0;
+
+  return cache.attach(fp, hdr, reference_path);
+}
+
+
+htsThreadPool *
+get_hts_thread_pool()
+{
+  static SharedHtsThreadPool shared_pool;
+  static std::once_flag is_initialized;
+
+  std::call_once(is_initialized, [](){
+      shared_pool.init(Options::const_instance()->threads);
+    });
+
+  return shared_pool.p.pool ? &shared_pool.p : nullptr;
+}
+
+
 HtsReader::HtsReader(HtsStore & _store)
   : store(_store)
 {}
 
 
 void
-HtsReader::open(std::string const & path, std::string const & region)
+HtsReader::open(std::string const & path, std::string const & region, std::string const & reference)
 {
   fp = hts_open(path.c_str(), "r");
 
@@ -29,8 +177,25 @@ HtsReader::open(std::string const & path, std::string const & region)
     std::exit(1);
   }
 
+  // Decompress BGZF blocks/CRAM containers on the shared thread pool
+  htsThreadPool * thread_pool = get_hts_thread_pool();
+
+  if (thread_pool && hts_set_thread_pool(fp, thread_pool) < 0)
+  {
+    BOOST_LOG_TRIVIAL(warning) << "[graphtyper::utilities::hts_reader] Could not attach thread pool to " << path;
+  }
+
+  if (!reference.empty())
+    set_reference(reference);
+
   fp->bam_header = sam_hdr_read(fp);
 
+  // Use the reference sequences already loaded by other CRAM decoders in this process
+  if (set_shared_cram_reference(fp, fp->bam_header, reference) < 0)
+  {
+    BOOST_LOG_TRIVIAL(warning) << "[graphtyper::utilities::hts_reader] Could not share CRAM reference for " << path;
+  }
+
   // Read sample from header
   if (!Options::instance()->get_sample_names_from_filename)
   {
@@ -4,6 +4,7 @@
 #include <htslib/sam.h>
 
 #include <graphtyper/utilities/hts_parallel_reader.hpp>
+#include <graphtyper/utilities/hts_reader.hpp> // gyper::get_hts_thread_pool
 #include <graphtyper/utilities/hts_writer.hpp>
 
 
@@ -11,15 +12,21 @@ namespace gyper
 {
 
 void
-HtsWriter::open(std::string const & path)
+HtsWriter::open(std::string const & path, std::string const & mode)
 {
-  fp = hts_open(path.c_str(), "wb");
+  fp = hts_open(path.c_str(), mode.c_str());
 
   if (!fp)
   {
     std::cerr << "[graphtyper::hts_writer] ERROR: Could not open HTS file  " << path << std::endl;
     std::exit(1);
   }
+
+  // Uncompressed files have no BGZF blocks for the pool to deflate
+  htsThreadPool * thread_pool = mode.find('u') == std::string::npos ? get_hts_thread_pool() : nullptr;
+
+  if (thread_pool)
+    hts_set_thread_pool(fp, thread_pool);
 }
 
 
@@ -0,0 +1,67 @@
+#include <algorithm> // std::min
+#include <functional> // std::function
+
+#include <paw/station.hpp>
+
+#include <graphtyper/utilities/options.hpp>
+#include <graphtyper/utilities/parallel.hpp>
+
+
+namespace gyper
+{
+
+long
+get_num_parallel_ranges(long const size)
+{
+  long const n_threads = Options::const_instance()->threads;
+
+  if (n_threads <= 1 || size <= 1)
+    return 1;
+
+  return std::min(size, 4 * n_threads);
+}
+
+
+long
+get_parallel_range_begin(long const size, long const n_ranges, long const r)
+{
+  return size * r / n_ranges;
+}
+
+
+void
+parallel_for_each_index(long const size, std::function<void(long)> const & func)
+{
+  long const n_threads = Options::const_instance()->threads;
+
+  if (n_threads <= 1 || size <= 1)
+  {
+    for (long i{0}; i < size; ++i)
+      func(i);
+
+    return;
+  }
+
+  paw::Station station(n_threads);
+
+  for (long i{0}; i < size - 1; ++i)
+    station.add_work(func, i);
+
+  station.add_to_thread(n_threads - 1, func, size - 1); // Last one on the current thread
+  station.join();
+}
+
+
+void
+parallel_for_ranges(long const size, std::function<void(long, long)> const & func)
+{
+  long const n_ranges = get_num_parallel_ranges(size);
+
+  parallel_for_each_index(n_ranges, [&](long const r)
+    {
+      func(get_parallel_range_begin(size, n_ranges, r), get_parallel_range_begin(size, n_ranges, r + 1));
+    });
+}
+
+
+} // namespace gyper
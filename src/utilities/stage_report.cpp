@@ -0,0 +1,293 @@
+#include <algorithm> // std::max
+#include <chrono> // std::chrono
+#include <fstream> // std::ifstream, std::ofstream
+#include <iomanip> // std::setprecision
+#include <sstream> // std::ostringstream
+#include <string> // std::string
+#include <vector> // std::vector
+
+#include <sys/resource.h> // getrusage
+
+#include <boost/log/trivial.hpp>
+
+#include <graphtyper/constants.hpp>
+#include <graphtyper/utilities/stage_report.hpp>
+
+
+namespace
+{
+
+double
+get_cpu_seconds()
+{
+  struct rusage usage;
+
+  if (getrusage(RUSAGE_SELF, &usage) != 0)
+    return 0.0;
+
+  return static_cast<double>(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) +
+         static_cast<double>(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+
+// Resets the peak resident set size of the process, which Linux supports since 4.0. Returns false if it failed.
+bool
+reset_peak_rss()
+{
+  std::ofstream f("/proc/self/clear_refs");
+
+  if (!f.is_open())
+    return false;
+
+  f << "5";
+  f.flush();
+  return f.good();
+}
+
+
+long
+get_peak_rss_kb()
+{
+  // VmHWM is the peak since it was last reset
+  std::ifstream f("/proc/self/status");
+
+  for (std::string line; std::getline(f, line);)
+  {
+    if (line.compare(0, 6, "VmHWM:") == 0)
+      return std::stol(line.substr(6)); // The value is in kB
+  }
+
+  // Fall back to the peak of the whole process
+  struct rusage usage;
+
+  if (getrusage(RUSAGE_SELF, &usage) != 0)
+    return 0;
+
+  return usage.ru_maxrss; // kB on Linux
+}
+
+
+std::string
+json_string(std::string const & str)
+{
+  std::ostringstream ss;
+  ss << '"';
+
+  for (char const c : str)
+  {
+    if (c == '"' || c == '\\')
+      ss << '\\' << c;
+    else if (static_cast<unsigned char>(c) < 0x20)
+      ss << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c) << std::dec;
+    else
+      ss << c;
+  }
+
+  ss << '"';
+  return ss.str();
+}
+
+
+void
+write_counters(std::ostream & os, gyper::StageCounters const & counters, std::string const & indent)
+{
+  os << indent << "\"reads_aligned\": " << counters.reads_aligned << ",\n"
+     << indent << "\"seeds\": " << counters.seeds << ",\n"
+     << indent << "\"dfs_expansions\": " << counters.dfs_expansions;
+}
+
+
+} // anon namespace
+
+
+namespace gyper
+{
+
+thread_local uint64_t thread_dfs_expansions{0};
+
+
+void
+StageReport::clear(std::string const & new_region)
+{
+  region = new_region;
+  stages = shared_stages;
+
+  // The region started when its share of the shared stages started
+  double shared_wall_seconds{0.0};
+  double shared_cpu_seconds{0.0};
+
+  for (auto const & stage : shared_stages)
+  {
+    shared_wall_seconds += stage.wall_seconds;
+    shared_cpu_seconds += stage.cpu_seconds;
+  }
+
+  using TDuration = std::chrono::steady_clock::duration;
+  wall_start = std::chrono::steady_clock::now() -
+               std::chrono::duration_cast<TDuration>(std::chrono::duration<double>(shared_wall_seconds));
+  cpu_start = get_cpu_seconds() - shared_cpu_seconds;
+  reads_aligned = 0;
+  seeds = 0;
+  dfs_expansions = 0;
+  haplotype_blocks = 0;
+}
+
+
+StageCounters
+StageReport::get_counters() const
+{
+  StageCounters counters;
+  counters.reads_aligned = reads_aligned.load();
+  counters.seeds = seeds.load();
+  counters.dfs_expansions = dfs_expansions.load();
+  counters.haplotype_blocks = haplotype_blocks.load();
+  return counters;
+}
+
+
+void
+StageReport::add_thread_counters()
+{
+  dfs_expansions.fetch_add(thread_dfs_expansions, std::memory_order_relaxed);
+  thread_dfs_expansions = 0;
+}
+
+
+void
+StageReport::add_stage(StageUsage && usage)
+{
+  BOOST_LOG_TRIVIAL(debug) << __HERE__ << " Stage " << usage.name << " took " << usage.wall_seconds << " s (CPU "
+                           << usage.cpu_seconds << " s), peak RSS " << usage.peak_rss_kb << " kB";
+
+  stages.push_back(std::move(usage));
+}
+
+
+void
+StageReport::set_shared_stages(std::vector<StageUsage> && usages)
+{
+  shared_stages = std::move(usages);
+}
+
+
+void
+StageReport::write_json(std::string const & path) const
+{
+  std::ofstream f(path);
+
+  if (!f.is_open())
+  {
+    BOOST_LOG_TRIVIAL(warning) << __HERE__ << " Could not write stage report to " << path;
+    return;
+  }
+
+  // The total includes the time between the stages. Haplotype blocks are counted per graph, so they are not summed.
+  StageUsage total;
+  total.wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+  total.cpu_seconds = get_cpu_seconds() - cpu_start;
+
+  for (auto const & stage : stages)
+  {
+    total.peak_rss_kb = std::max(total.peak_rss_kb, stage.peak_rss_kb);
+    total.counters.reads_aligned += stage.counters.reads_aligned;
+    total.counters.seeds += stage.counters.seeds;
+    total.counters.dfs_expansions += stage.counters.dfs_expansions;
+  }
+
+  f << std::fixed << std::setprecision(3);
+  f << "{\n"
+    << "  \"region\": " << json_string(region) << ",\n"
+    << "  \"total\": {\n"
+    << "    \"wall_seconds\": " << total.wall_seconds << ",\n"
+    << "    \"cpu_seconds\": " << total.cpu_seconds << ",\n"
+    << "    \"peak_rss_kb\": " << total.peak_rss_kb << ",\n";
+
+  write_counters(f, total.counters, "    ");
+  f << "\n"
+    << "  },\n"
+    << "  \"stages\": [";
+
+  for (long i = 0; i < static_cast<long>(stages.size()); ++i)
+  {
+    auto const & stage = stages[i];
+    f << (i == 0 ? "\n" : ",\n")
+      << "    {\n"
+      << "      \"name\": " << json_string(stage.name) << ",\n"
+      << "      \"wall_seconds\": " << stage.wall_seconds << ",\n"
+      << "      \"cpu_seconds\": " << stage.cpu_seconds << ",\n"
+      << "      \"peak_rss_kb\": " << stage.peak_rss_kb << ",\n"
+      << "      \"num_regions\": " << stage.num_regions << ",\n";
+
+    write_counters(f, stage.counters, "      ");
+    f << ",\n"
+      << "      \"haplotype_blocks\": " << stage.counters.haplotype_blocks << "\n"
+      << "    }";
+  }
+
+  f << "\n  ]\n"
+    << "}\n";
+}
+
+
+StageReport stage_report;
+
+
+StageTimer::StageTimer(std::string const & _name, long const _num_shared_regions)
+  : name(_name)
+  , num_shared_regions(_num_shared_regions)
+  , wall_start(std::chrono::steady_clock::now())
+  , cpu_start(get_cpu_seconds())
+  , counters_start(stage_report.get_counters())
+{
+  reset_peak_rss();
+}
+
+
+StageTimer::~StageTimer()
+{
+  stop();
+}
+
+
+void
+StageTimer::stop()
+{
+  if (is_stopped)
+    return;
+
+  is_stopped = true;
+  usage.name = name;
+  usage.wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+  usage.cpu_seconds = get_cpu_seconds() - cpu_start;
+  usage.peak_rss_kb = get_peak_rss_kb();
+
+  StageCounters const counters_end = stage_report.get_counters();
+  usage.counters.reads_aligned = counters_end.reads_aligned - counters_start.reads_aligned;
+  usage.counters.seeds = counters_end.seeds - counters_start.seeds;
+  usage.counters.dfs_expansions = counters_end.dfs_expansions - counters_start.dfs_expansions;
+  usage.counters.haplotype_blocks = stage_report.haplotype_blocks.exchange(0); // Blocks of the graph of this stage
+
+  if (num_shared_regions == 0)
+  {
+    stage_report.add_stage(StageUsage(usage));
+    return;
+  }
+
+  // Split the stage evenly between its regions, the peak memory is the same for all of them
+  usage.num_regions = num_shared_regions;
+  usage.wall_seconds /= num_shared_regions;
+  usage.cpu_seconds /= num_shared_regions;
+  usage.counters.reads_aligned /= num_shared_regions;
+  usage.counters.seeds /= num_shared_regions;
+  usage.counters.dfs_expansions /= num_shared_regions;
+}
+
+
+StageUsage const &
+StageTimer::get_usage() const
+{
+  return usage;
+}
+
+
+} // namespace gyper
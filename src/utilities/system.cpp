@@ -1,6 +1,9 @@
 #include <algorithm> // std::generate_n
 #include <cassert> // assert
+#include <cerrno> // errno, EXDEV
+#include <cstdio> // std::rename, std::remove
 #include <cstring>
+#include <fstream> // std::ifstream, std::ofstream
 #include <iomanip>
 #include <iostream>
 #include <random>
@@ -10,6 +13,7 @@
 #include <vector>
 
 #include <dirent.h>
+#include <fcntl.h> // AT_FDCWD
 #include <sys/stat.h>
 #include <unistd.h>
 
@@ -169,6 +173,59 @@ remove_file_tree(std::string const & path)
 }
 
 
+void
+copy_file(std::string const & from, std::string const & to)
+{
+  std::string const tmp_to = to + ".tmp";
+
+  {
+    std::ifstream ifs(from.c_str(), std::ios::binary);
+    std::ofstream ofs(tmp_to.c_str(), std::ios::binary);
+
+    if (!ifs.is_open() || !ofs.is_open() || !(ofs << ifs.rdbuf()))
+    {
+      BOOST_LOG_TRIVIAL(error) << __HERE__ << " Could not copy '" << from << "' to '" << tmp_to << "'";
+      std::exit(1);
+    }
+  }
+
+  // Keep the permissions and modification time of the original, like "cp -p"
+  struct stat sb;
+
+  if (stat(from.c_str(), &sb) == 0)
+  {
+    struct timespec const times[2] = {sb.st_atim, sb.st_mtim};
+
+    if (chmod(tmp_to.c_str(), sb.st_mode & 07777) != 0 || utimensat(AT_FDCWD, tmp_to.c_str(), times, 0) != 0)
+      BOOST_LOG_TRIVIAL(warning) << __HERE__ << " Could not keep the permissions and times of '" << from << "'";
+  }
+
+  if (std::rename(tmp_to.c_str(), to.c_str()) != 0)
+  {
+    BOOST_LOG_TRIVIAL(error) << __HERE__ << " Could not move '" << tmp_to << "' to '" << to << "'";
+    std::exit(1);
+  }
+}
+
+
+void
+move_file(std::string const & from, std::string const & to)
+{
+  if (std::rename(from.c_str(), to.c_str()) == 0)
+    return;
+
+  if (errno != EXDEV)
+  {
+    BOOST_LOG_TRIVIAL(error) << __HERE__ << " Could not move '" << from << "' to '" << to << "'";
+    std::exit(1);
+  }
+
+  // The files are on different file systems
+  copy_file(from, to);
+  std::remove(from.c_str());
+}
+
+
 bool
 is_file(std::string const & filename)
 {
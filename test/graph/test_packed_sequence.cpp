@@ -0,0 +1,134 @@
+#include <sstream> // std::stringstream
+#include <string> // std::string
+#include <vector> // std::vector
+
+#include <boost/archive/binary_iarchive.hpp>
+#include <boost/archive/binary_oarchive.hpp>
+
+#include <graphtyper/graph/packed_sequence.hpp>
+
+#include <catch.hpp>
+
+
+namespace
+{
+
+std::vector<char>
+to_seq(std::string const & str)
+{
+  return std::vector<char>(str.begin(), str.end());
+}
+
+
+// Checks every way of reading the sequence back against the original string
+void
+require_same_sequence(gyper::PackedSequence const & packed, std::string const & str)
+{
+  REQUIRE(packed.size() == str.size());
+  REQUIRE(packed.empty() == str.empty());
+  REQUIRE(packed.to_string() == str);
+  REQUIRE(std::string(packed.begin(), packed.end()) == str);
+
+  for (std::size_t i = 0; i < str.size(); ++i)
+    REQUIRE(packed[i] == str[i]);
+
+  // All ranges, including partial runs of other characters
+  for (std::size_t b = 0; b <= str.size(); ++b)
+  {
+    for (std::size_t e = b; e <= str.size(); ++e)
+    {
+      std::string const expected = str.substr(b, e - b);
+      std::vector<char> const seq = packed.get_sequence(b, e);
+      REQUIRE(std::string(seq.begin(), seq.end()) == expected);
+      REQUIRE(packed.has_other_bases(b, e) == (expected.find_first_not_of("ACGT") != std::string::npos));
+
+      gyper::PackedSequenceView const view = packed.get_view(b, e);
+      REQUIRE(view.size() == expected.size());
+
+      for (std::size_t i = 0; i < expected.size(); ++i)
+        REQUIRE(view[i] == expected[i]);
+    }
+  }
+}
+
+
+} // anon namespace
+
+
+TEST_CASE("Pack sequences with and without other characters")
+{
+  std::vector<std::string> const strs = {
+    "",
+    "A",
+    "ACGT",
+    "ACGTACGTACGTACGTACGTACGTACGTACGT", // A full word, stored in the object
+    "ACGTACGTACGTACGTACGTACGTACGTACGTT", // One base into the second word
+    "N",
+    "NNNNACGTNNNN", // Runs at both ends
+    "ANNA", // A run in the middle
+    "NNnnNN", // Runs of different characters next to each other
+    "ACGTNACGTACGTACGTACGTACGTACGTACGTACNNNGT", // Runs in both words
+    "<DEL>", // A symbolic allele is only other characters
+    std::string(100, 'N')
+  };
+
+  for (auto const & str : strs)
+  {
+    gyper::PackedSequence const packed(to_seq(str));
+    require_same_sequence(packed, str);
+  }
+}
+
+
+TEST_CASE("Copy, move and reassign packed sequences")
+{
+  std::string const long_str = "ACGTNNNACGTACGTACGTACGTACGTACGTACGTACGTACGTTTTG";
+  std::string const short_str = "GATTACA";
+  gyper::PackedSequence packed(to_seq(long_str));
+
+  gyper::PackedSequence copy(packed);
+  require_same_sequence(copy, long_str);
+
+  gyper::PackedSequence moved(std::move(copy));
+  require_same_sequence(moved, long_str);
+  REQUIRE(copy.empty());
+
+  copy = moved;
+  require_same_sequence(copy, long_str);
+  require_same_sequence(moved, long_str);
+
+  copy.assign(to_seq(short_str));
+  require_same_sequence(copy, short_str);
+
+  packed = std::move(copy);
+  require_same_sequence(packed, short_str);
+
+  packed.clear();
+  require_same_sequence(packed, "");
+}
+
+
+TEST_CASE("Serialize packed sequences")
+{
+  std::vector<std::string> const strs = {"", "GATTACA", "NNACGTACGTACGTACGTACGTACGTACGTACGTACGTACGTN"};
+
+  for (auto const & str : strs)
+  {
+    gyper::PackedSequence const packed(to_seq(str));
+    std::stringstream ss;
+
+    {
+      boost::archive::binary_oarchive oa(ss);
+      oa << packed;
+    }
+
+    gyper::PackedSequence loaded(to_seq("CCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCC"));
+
+    {
+      boost::archive::binary_iarchive ia(ss);
+      ia >> loaded;
+    }
+
+    require_same_sequence(loaded, str);
+  }
+}
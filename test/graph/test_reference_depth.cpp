@@ -0,0 +1,259 @@
+#include <algorithm> // std::max, std::min
+#include <cstdint> // uint16_t
+#include <random> // std::mt19937
+#include <vector> // std::vector
+
+#include <graphtyper/graph/reference_depth.hpp>
+#include <graphtyper/typer/genotype_paths.hpp>
+#include <graphtyper/typer/path.hpp>
+
+#include <catch.hpp>
+
+
+namespace
+{
+
+// Plain depth of every position, used as the expected depth of a DepthTrack
+class NaiveDepth
+{
+public:
+  std::vector<long> depths;
+
+  explicit NaiveDepth(long const size)
+    : depths(size, 0)
+  {}
+
+
+  void
+  add(long const begin_index, long const end_index)
+  {
+    for (long i = begin_index; i < end_index; ++i)
+      ++depths[i];
+  }
+
+
+  uint16_t
+  get_max_depth(long const begin_index, long const end_index) const
+  {
+    long max_depth{0};
+
+    for (long i = begin_index; i < end_index; ++i)
+      max_depth = std::max(max_depth, depths[i]);
+
+    return static_cast<uint16_t>(std::min(0xFFFFl, max_depth));
+  }
+
+
+};
+
+
+// Adds a read to both depths and checks that the events are compacted exactly when they reach the threshold
+void
+add_and_check_compaction(gyper::DepthTrack & track, NaiveDepth & naive, long const begin, long const end)
+{
+  std::size_t const old_num_events = track.events.size();
+  std::size_t const threshold = std::max(static_cast<std::size_t>(4096), 2 * track.run_ends.size());
+  track.add(begin, end);
+  naive.add(begin, end);
+
+  if (begin >= end)
+    REQUIRE(track.events.size() == old_num_events);
+  else if (old_num_events + 2 >= threshold)
+    REQUIRE(track.events.size() == 0);
+  else
+    REQUIRE(track.events.size() == old_num_events + 2);
+}
+
+
+// Compares the maximum depth of every range, the track must be compacted first
+void
+require_same_depths(gyper::DepthTrack const & track, NaiveDepth const & naive)
+{
+  REQUIRE(track.events.size() == 0);
+  long const size = naive.depths.size();
+
+  // The runs are sorted and there is never a trailing run of zero depth
+  REQUIRE(track.run_ends.size() == track.run_depths.size());
+  REQUIRE(std::is_sorted(track.run_ends.begin(), track.run_ends.end()));
+  REQUIRE((track.run_depths.size() == 0 || track.run_depths.back() > 0));
+
+  for (long b = 0; b <= size; ++b)
+  {
+    for (long e = b; e <= size; ++e)
+      REQUIRE(track.get_max_depth(b, e) == naive.get_max_depth(b, e));
+  }
+}
+
+
+gyper::Path
+make_path(gyper::TAbsPos const start, gyper::TAbsPos const end)
+{
+  gyper::Path path;
+  path.start = start;
+  path.end = end;
+  path.read_start_index = 0;
+  path.read_end_index = static_cast<uint16_t>(end - start);
+  return path;
+}
+
+
+} // anon namespace
+
+
+TEST_CASE("Depth of overlapping and adjacent reads")
+{
+  gyper::DepthTrack track;
+  NaiveDepth naive(30);
+
+  add_and_check_compaction(track, naive, 0, 5);
+  add_and_check_compaction(track, naive, 5, 10); // Adjacent
+  add_and_check_compaction(track, naive, 12, 20);
+  add_and_check_compaction(track, naive, 15, 25); // Overlapping
+  add_and_check_compaction(track, naive, 15, 25); // Same interval again
+  add_and_check_compaction(track, naive, 8, 8); // Empty
+  add_and_check_compaction(track, naive, 9, 7); // Empty
+  track.compact();
+  require_same_depths(track, naive);
+
+  // Adjacent reads of the same depth are a single run
+  REQUIRE(track.run_ends == std::vector<uint32_t>({10, 12, 15, 20, 25}));
+  REQUIRE(track.run_depths == std::vector<uint16_t>({1, 0, 1, 3, 2}));
+
+  // Compacting again changes nothing
+  track.compact();
+  require_same_depths(track, naive);
+}
+
+
+TEST_CASE("Depth of many random reads over several compactions")
+{
+  std::mt19937 random_engine(42);
+  std::uniform_int_distribution<long> begin_dist(0, 299);
+  std::uniform_int_distribution<long> length_dist(0, 40);
+  gyper::DepthTrack track;
+  NaiveDepth naive(340);
+  long num_compactions{0};
+
+  for (long r = 0; r < 20000; ++r)
+  {
+    long const begin = begin_dist(random_engine);
+    add_and_check_compaction(track, naive, begin, begin + length_dist(random_engine));
+
+    if (track.events.size() == 0)
+      ++num_compactions;
+
+    // Compacting in the middle of adding must not change the depth
+    if (r == 10000)
+    {
+      track.compact();
+      require_same_depths(track, naive);
+    }
+  }
+
+  REQUIRE(num_compactions > 2);
+  track.compact();
+  require_same_depths(track, naive);
+}
+
+
+TEST_CASE("Events are compacted when there are twice as many as runs")
+{
+  // Disjoint reads make two runs each, so the number of runs soon decides when the events are compacted
+  gyper::DepthTrack track;
+  NaiveDepth naive(3 * 8000);
+  long num_compactions_with_many_runs{0};
+
+  for (long r = 0; r < 8000; ++r)
+  {
+    bool const has_many_runs = 2 * track.run_ends.size() > 4096;
+    add_and_check_compaction(track, naive, 3 * r + 1, 3 * r + 3);
+
+    if (has_many_runs && track.events.size() == 0)
+      ++num_compactions_with_many_runs;
+  }
+
+  REQUIRE(num_compactions_with_many_runs > 0);
+  track.compact();
+  REQUIRE(track.run_ends.size() == 2 * 8000);
+
+  // Only check the depth of ranges close to each other, all ranges would take too long
+  for (long b = 0; b < static_cast<long>(naive.depths.size()); ++b)
+  {
+    for (long e = b; e <= std::min(b + 10, static_cast<long>(naive.depths.size())); ++e)
+      REQUIRE(track.get_max_depth(b, e) == naive.get_max_depth(b, e));
+  }
+}
+
+
+TEST_CASE("Depth saturates at 65535")
+{
+  gyper::DepthTrack track;
+  NaiveDepth naive(30);
+
+  // Compacted many times while saturated
+  for (long r = 0; r < 70000; ++r)
+    add_and_check_compaction(track, naive, 10, 20);
+
+  for (long r = 0; r < 5; ++r)
+    add_and_check_compaction(track, naive, 15, 25);
+
+  track.compact();
+  require_same_depths(track, naive);
+  REQUIRE(track.get_max_depth(0, 30) == 0xFFFF);
+  REQUIRE(track.get_max_depth(19, 20) == 0xFFFF);
+  REQUIRE(track.get_max_depth(20, 25) == 5);
+  REQUIRE(track.get_max_depth(0, 10) == 0);
+}
+
+
+TEST_CASE("A read with many paths adds depth to the union of its paths")
+{
+  gyper::ReferenceDepth reference_depth;
+  reference_depth.reference_offset = 50;
+  reference_depth.set_depth_sizes(2 /*sample_count*/, 1000 /*reference_size*/);
+
+  // Overlapping paths, which are trimmed by 4 bases on each side since they are long
+  gyper::GenotypePaths overlapping(0 /*flags*/, 100 /*read_length*/);
+  overlapping.paths.push_back(make_path(100, 199));
+  overlapping.paths.push_back(make_path(150, 249));
+  reference_depth.add_genotype_paths(overlapping, 0);
+
+  // Adjacent paths after trimming
+  gyper::GenotypePaths adjacent(0 /*flags*/, 100 /*read_length*/);
+  adjacent.paths.push_back(make_path(400, 499));
+  adjacent.paths.push_back(make_path(492, 591));
+  reference_depth.add_genotype_paths(adjacent, 0);
+
+  // A read with a single path is not trimmed
+  gyper::GenotypePaths single(0 /*flags*/, 100 /*read_length*/);
+  single.paths.push_back(make_path(200, 299));
+  reference_depth.add_genotype_paths(single, 1);
+
+  // Reads with short paths add no depth
+  gyper::GenotypePaths short_paths(0 /*flags*/, 50 /*read_length*/);
+  short_paths.paths.push_back(make_path(100, 149));
+  reference_depth.add_genotype_paths(short_paths, 1);
+
+  reference_depth.finalize();
+  NaiveDepth naive0(1000);
+  naive0.add(104 - 50, 246 - 50);
+  naive0.add(404 - 50, 588 - 50);
+  NaiveDepth naive1(1000);
+  naive1.add(200 - 50, 300 - 50);
+  require_same_depths(reference_depth.depths[0], naive0);
+  require_same_depths(reference_depth.depths[1], naive1);
+
+  REQUIRE(reference_depth.get_read_depth(103, 0) == 0);
+  REQUIRE(reference_depth.get_read_depth(104, 0) == 1);
+  REQUIRE(reference_depth.get_read_depth(200, 0) == 1); // Only once where the paths overlap
+  REQUIRE(reference_depth.get_read_depth(245, 0) == 1);
+  REQUIRE(reference_depth.get_read_depth(246, 0) == 0);
+  REQUIRE(reference_depth.get_read_depth(495, 0) == 1);
+  REQUIRE(reference_depth.get_read_depth(496, 0) == 1);
+  REQUIRE(reference_depth.depths[0].run_ends.size() == 4);
+  REQUIRE(reference_depth.get_read_depth(199, 1) == 0);
+  REQUIRE(reference_depth.get_read_depth(200, 1) == 1);
+  REQUIRE(reference_depth.get_read_depth(299, 1) == 1);
+  REQUIRE(reference_depth.get_read_depth(300, 1) == 0);
+  REQUIRE(reference_depth.get_read_depth(120, 1) == 0);
+}
@@ -0,0 +1,436 @@
+#include <catch.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/log/trivial.hpp>
+
+#include <graphtyper/constants.hpp>
+#include <graphtyper/graph/constructor.hpp>
+#include <graphtyper/typer/variant_candidate.hpp>
+#include <graphtyper/typer/variant_map.hpp>
+#include <graphtyper/typer/variant_support.hpp>
+#include <graphtyper/utilities/options.hpp>
+#include <graphtyper/utilities/system.hpp>
+#include <graphtyper/utilities/type_conversions.hpp>
+
+#include "../help_functions.hpp" // create_test_graph
+
+
+namespace
+{
+
+gyper::VariantCandidate
+make_candidate(gyper::TAbsPos const abs_pos,
+               std::string const & ref,
+               std::string const & alt,
+               uint32_t const original_pos,
+               uint16_t const flags)
+{
+  gyper::VariantCandidate var;
+  var.abs_pos = abs_pos;
+  var.seqs = {gyper::to_vec(std::string(ref)), gyper::to_vec(std::string(alt))};
+  var.original_pos = original_pos;
+  var.flags = flags;
+  return var;
+}
+
+
+// Support of a SNP which passes every filter on its own, except maybe the ones on unique positions
+gyper::VariantSupport
+make_support(long const num_unique_positions, bool const is_biased)
+{
+  gyper::VariantSupport support;
+  support.hq_support = 10;
+  support.proper_pairs = 10;
+  support.depth = 10;
+  support.is_any_mapq_good = true;
+
+  // Biased reads only pass the read and strand bias filters when the variant is promising
+  support.first_in_pairs = is_biased ? 0 : 5;
+  support.sequence_reversed = is_biased ? 1 : 5;
+
+  for (long p = 0; p < num_unique_positions; ++p)
+    support.add_unique_position(static_cast<uint32_t>(1000 + p));
+
+  return support;
+}
+
+
+std::string
+get_varmap_test_path(std::string const & name)
+{
+  std::string const dir = std::string(gyper_SOURCE_DIRECTORY) + "/test/data/varmaps";
+
+  if (!gyper::is_directory(dir))
+    gyper::create_dir(dir, 0755);
+
+  return dir + "/" + name;
+}
+
+
+// Support of a variant in the pool of one sample. The depth tells which pool the support came from.
+gyper::VariantSupport
+make_pool_support(long const pool,
+                  uint16_t const hq_support,
+                  uint16_t const sequence_reversed,
+                  uint16_t const first_in_pairs)
+{
+  gyper::VariantSupport support;
+  support.hq_support = hq_support;
+  support.proper_pairs = hq_support;
+  support.depth = static_cast<uint16_t>(100 + pool);
+  support.sequence_reversed = sequence_reversed;
+  support.first_in_pairs = first_in_pairs;
+  return support;
+}
+
+
+} // anon namespace
+
+
+TEST_CASE("Allele sequences are stored once in an arena")
+{
+  using namespace gyper;
+
+  AlleleArena arena;
+  std::vector<std::vector<char> > const seqs = {to_vec("A"), to_vec("ACGT"), to_vec("AC"), to_vec(""), to_vec("C")};
+  std::vector<uint32_t> ids;
+
+  for (auto const & seq : seqs)
+    ids.push_back(arena.insert(seq));
+
+  REQUIRE(ids == std::vector<uint32_t>({0, 1, 2, 3, 4}));
+
+  // The same sequences get the same IDs
+  for (long i = static_cast<long>(seqs.size()) - 1; i >= 0; --i)
+    REQUIRE(arena.insert(seqs[i]) == ids[i]);
+
+  for (long i = 0; i < static_cast<long>(seqs.size()); ++i)
+    REQUIRE(arena.get(ids[i]) == seqs[i]);
+
+  SECTION("Cleared arenas start over")
+  {
+    arena.clear();
+    REQUIRE(arena.insert(to_vec("C")) == 0);
+    REQUIRE(arena.get(0) == to_vec("C"));
+  }
+}
+
+
+TEST_CASE("Allele sequences with the same hash are told apart")
+{
+  using namespace gyper;
+
+  AlleleArena arena;
+  std::size_t const HASH = 42;
+
+  // A prefix of another sequence and a sequence of the same length
+  uint32_t const id_ac = arena.insert(to_vec("AC"), HASH);
+  uint32_t const id_acg = arena.insert(to_vec("ACG"), HASH);
+  uint32_t const id_agg = arena.insert(to_vec("AGG"), HASH);
+  uint32_t const id_a = arena.insert(to_vec("A"), HASH);
+  REQUIRE(id_ac != id_acg);
+  REQUIRE(id_acg != id_agg);
+  REQUIRE(id_agg != id_a);
+  REQUIRE(id_a != id_ac);
+
+  REQUIRE(arena.insert(to_vec("AGG"), HASH) == id_agg);
+  REQUIRE(arena.insert(to_vec("A"), HASH) == id_a);
+  REQUIRE(arena.insert(to_vec("AC"), HASH) == id_ac);
+  REQUIRE(arena.insert(to_vec("ACG"), HASH) == id_acg);
+
+  REQUIRE(arena.get(id_ac) == to_vec("AC"));
+  REQUIRE(arena.get(id_acg) == to_vec("ACG"));
+  REQUIRE(arena.get(id_agg) == to_vec("AGG"));
+  REQUIRE(arena.get(id_a) == to_vec("A"));
+
+  // A sequence under another hash is a new entry even if it is stored already
+  REQUIRE(arena.insert(to_vec("AC"), HASH + 1) != id_ac);
+}
+
+
+TEST_CASE("Variant map keys are equal only if all their fields are")
+{
+  using namespace gyper;
+
+  VarMapKey key;
+  key.abs_pos = 100;
+  key.ref_id = 1;
+  key.alt_id = 2;
+
+  VarMapKey other_pos(key);
+  other_pos.abs_pos = 101;
+  VarMapKey other_ref(key);
+  other_ref.ref_id = 3;
+  VarMapKey other_alt(key);
+  other_alt.alt_id = 3;
+  VarMapKey swapped(key);
+  swapped.ref_id = 2;
+  swapped.alt_id = 1;
+
+  REQUIRE(key == VarMapKey(key));
+  REQUIRE(VarMapKeyHash()(key) == VarMapKeyHash()(VarMapKey(key)));
+  REQUIRE(!(key == other_pos));
+  REQUIRE(!(key == other_ref));
+  REQUIRE(!(key == other_alt));
+  REQUIRE(!(key == swapped));
+
+  VarMap varmap;
+  varmap[key].depth = 1;
+  varmap[other_pos].depth = 2;
+  varmap[other_ref].depth = 3;
+  varmap[other_alt].depth = 4;
+  varmap[swapped].depth = 5;
+  varmap[key].depth += 10;
+
+  REQUIRE(varmap.size() == 5);
+  REQUIRE(varmap.at(key).depth == 11);
+  REQUIRE(varmap.at(swapped).depth == 5);
+}
+
+
+TEST_CASE("Variant candidates are recovered from the keys of a varmap")
+{
+  using namespace gyper;
+
+  VariantMap varmap;
+  varmap.set_samples({"sample1", "sample2"});
+
+  {
+    std::vector<VariantCandidate> vars;
+    vars.push_back(make_candidate(10, "A", "G", 100, IS_PROPER_PAIR | IS_FIRST_IN_PAIR));
+    vars.push_back(make_candidate(10, "A", "G", 100, IS_PROPER_PAIR)); // Same read position
+    vars.push_back(make_candidate(10, "A", "G", 101, IS_SEQ_REVERSED | IS_LOW_BASE_QUAL));
+    vars.push_back(make_candidate(10, "A", "C", 102, IS_PROPER_PAIR));
+    vars.push_back(make_candidate(11, "G", "A", 103, IS_PROPER_PAIR));
+    varmap.add_variants(std::move(vars), 0);
+  }
+
+  {
+    std::vector<VariantCandidate> vars;
+    vars.push_back(make_candidate(10, "A", "G", 200, IS_MAPQ_BAD));
+    varmap.add_variants(std::move(vars), 1);
+  }
+
+  std::vector<VariantCandidate> const expected = {make_candidate(10, "A", "C", 0, 0),
+                                                  make_candidate(10, "A", "G", 0, 0),
+                                                  make_candidate(11, "G", "A", 0, 0)};
+
+  REQUIRE(varmap.varmaps.size() == 2);
+  REQUIRE(varmap.varmaps[0].size() == 3);
+  REQUIRE(varmap.varmaps[1].size() == 1);
+  std::vector<std::pair<VariantCandidate, VariantSupport> > found;
+
+  for (auto const & key_support : varmap.varmaps[0])
+    found.push_back(std::make_pair(varmap.get_variant_candidate(key_support.first), key_support.second));
+
+  std::sort(found.begin(),
+            found.end(),
+            [](std::pair<VariantCandidate, VariantSupport> const & a,
+               std::pair<VariantCandidate, VariantSupport> const & b) -> bool
+    {
+      return a.first < b.first;
+    });
+
+  REQUIRE(found.size() == expected.size());
+
+  for (long i = 0; i < static_cast<long>(expected.size()); ++i)
+  {
+    REQUIRE(found[i].first == expected[i]);
+    REQUIRE(found[i].first.seqs.size() == 2);
+  }
+
+  VariantSupport const & a_to_g = found[1].second;
+  REQUIRE(a_to_g.depth == 3);
+  REQUIRE(a_to_g.hq_support == 2);
+  REQUIRE(a_to_g.lq_support == 1);
+  REQUIRE(a_to_g.proper_pairs == 2);
+  REQUIRE(a_to_g.first_in_pairs == 1);
+  REQUIRE(a_to_g.sequence_reversed == 1);
+  REQUIRE(a_to_g.num_unique_positions == 2);
+  REQUIRE(a_to_g.is_any_mapq_good);
+  REQUIRE(!a_to_g.is_indel);
+  REQUIRE(a_to_g.var_size == 0);
+
+  // Both samples refer to the same alleles
+  auto const & key_support = *varmap.varmaps[1].begin();
+  REQUIRE(varmap.get_variant_candidate(key_support.first) == expected[1]);
+  REQUIRE(key_support.second.depth == 1);
+  REQUIRE(!key_support.second.is_any_mapq_good);
+  REQUIRE(varmap.varmaps[0].count(key_support.first) == 1);
+}
+
+
+TEST_CASE("Only up to three unique positions are kept for each variant")
+{
+  using namespace gyper;
+
+  VariantSupport support;
+  support.add_unique_position(5);
+  support.add_unique_position(5);
+  REQUIRE(support.num_unique_positions == 1);
+
+  support.add_unique_position(7);
+  support.add_unique_position(5);
+  support.add_unique_position(7);
+  REQUIRE(support.num_unique_positions == 2);
+
+  support.add_unique_position(9);
+  support.add_unique_position(11);
+  support.add_unique_position(0);
+  REQUIRE(support.num_unique_positions == 3);
+  REQUIRE(support.unique_positions[0] == 5);
+  REQUIRE(support.unique_positions[1] == 7);
+  REQUIRE(support.unique_positions[2] == 9);
+}
+
+
+TEST_CASE("Variants need reads from more than one position to pass")
+{
+  using namespace gyper;
+
+  long const MIN_SUPPORT = 5;
+
+  SECTION("Unbiased reads need two unique positions")
+  {
+    REQUIRE(!make_support(0, false /*is_biased*/).is_support_above_cutoff(MIN_SUPPORT));
+    REQUIRE(!make_support(1, false).is_support_above_cutoff(MIN_SUPPORT));
+    REQUIRE(make_support(2, false).is_support_above_cutoff(MIN_SUPPORT));
+    REQUIRE(make_support(3, false).is_support_above_cutoff(MIN_SUPPORT));
+    REQUIRE(make_support(4, false).is_support_above_cutoff(MIN_SUPPORT));
+  }
+
+  SECTION("Biased reads need three unique positions")
+  {
+    REQUIRE(!make_support(1, true /*is_biased*/).is_support_above_cutoff(MIN_SUPPORT));
+    REQUIRE(!make_support(2, true).is_support_above_cutoff(MIN_SUPPORT));
+    REQUIRE(make_support(3, true).is_support_above_cutoff(MIN_SUPPORT));
+    REQUIRE(make_support(4, true).is_support_above_cutoff(MIN_SUPPORT));
+  }
+
+  SECTION("The filter on unique positions can be turned off")
+  {
+    Options::instance()->no_filter_on_begin_pos = true;
+    bool const is_passing = make_support(1, false).is_support_above_cutoff(MIN_SUPPORT);
+    bool const is_biased_passing = make_support(2, true).is_support_above_cutoff(MIN_SUPPORT);
+    Options::instance()->no_filter_on_begin_pos = false;
+    REQUIRE(is_passing);
+    REQUIRE(!is_biased_passing); // The bias filters still need three positions
+  }
+}
+
+
+TEST_CASE("Merge an odd number of variant maps and filter the variants")
+{
+  using namespace gyper;
+
+  create_test_graph("/test/data/reference/index_test.fa", "/test/data/reference/index_test.vcf.gz", "chr1", true);
+  // AGGTTTCCCCAGGTTTCCCCAGGTTTCCCCAGGTTTCCCCAGGTTTCCCCAGGTTTCCCCTTTGGA
+
+  long const NUM_POOLS = 5;
+  VariantCandidate const good_snp = make_candidate(10, "C", "T", 0, 0); // In pools 0, 2 and 4
+  VariantCandidate const strand_biased = make_candidate(11, "A", "G", 0, 0); // In pools 1 and 3, all forward
+  VariantCandidate const shared_snp = make_candidate(12, "G", "A", 0, 0); // In pools 3 and 4
+  VariantCandidate const read_biased = make_candidate(20, "C", "A", 0, 0); // In all pools, all second in pair
+  VariantCandidate const last_snp = make_candidate(21, "A", "C", 0, 0); // Only in the last pool
+
+  // Each pool is one sample
+  std::vector<std::string> paths;
+
+  for (long p = 0; p < NUM_POOLS; ++p)
+  {
+    VariantMap map;
+    map.samples = {"sample" + std::to_string(p)};
+    map.minimum_variant_support = 7;
+    map.minimum_variant_support_ratio = 0.3;
+
+    if (p % 2 == 0)
+      map.pool_varmap.emplace_back(good_snp, std::vector<VariantSupport>(1, make_pool_support(p, 10, 5, 5)));
+    else
+      map.pool_varmap.emplace_back(strand_biased, std::vector<VariantSupport>(1, make_pool_support(p, 3, 0, 1)));
+
+    if (p >= 3)
+      map.pool_varmap.emplace_back(shared_snp, std::vector<VariantSupport>(1, make_pool_support(p, 10, 5, 5)));
+
+    map.pool_varmap.emplace_back(read_biased, std::vector<VariantSupport>(1, make_pool_support(p, 4, 2, 0)));
+
+    if (p == NUM_POOLS - 1)
+      map.pool_varmap.emplace_back(last_snp, std::vector<VariantSupport>(1, make_pool_support(p, 10, 5, 5)));
+
+    paths.push_back(get_varmap_test_path("pool_" + std::to_string(p)));
+    save_variant_map(paths.back(), map);
+  }
+
+  std::string const paths_list = get_varmap_test_path("pools.txt");
+
+  {
+    std::ofstream ofs(paths_list.c_str());
+    REQUIRE(ofs.is_open());
+
+    for (auto const & path : paths)
+      ofs << path << '\n';
+  }
+
+  VariantMap merged;
+  merged.load_many_variant_maps(paths_list);
+
+  REQUIRE(merged.samples == std::vector<std::string>({"sample0", "sample1", "sample2", "sample3", "sample4"}));
+  REQUIRE(merged.minimum_variant_support == 7);
+  REQUIRE(merged.minimum_variant_support_ratio == 0.3);
+
+  // The variants are sorted and the supports of each variant are in the order of the pools
+  std::vector<VariantCandidate> const expected_vars = {good_snp, strand_biased, shared_snp, read_biased, last_snp};
+  std::vector<std::vector<uint16_t> > const expected_pools = {{100, 102, 104},
+                                                              {101, 103},
+                                                              {103, 104},
+                                                              {100, 101, 102, 103, 104},
+                                                              {104}};
+
+  REQUIRE(merged.pool_varmap.size() == expected_vars.size());
+
+  for (long v = 0; v < static_cast<long>(expected_vars.size()); ++v)
+  {
+    REQUIRE(merged.pool_varmap[v].first == expected_vars[v]);
+    std::vector<uint16_t> pools;
+
+    for (auto const & support : merged.pool_varmap[v].second)
+      pools.push_back(support.depth);
+
+    REQUIRE(pools == expected_pools[v]);
+  }
+
+  SECTION("Biased variants are filtered from the merged supports")
+  {
+    merged.filter_varmap_for_all();
+    REQUIRE(merged.pool_varmap.size() == 3);
+    REQUIRE(merged.pool_varmap[0].first == good_snp);
+    REQUIRE(merged.pool_varmap[0].second.size() == 3);
+    REQUIRE(merged.pool_varmap[1].first == shared_snp);
+    REQUIRE(merged.pool_varmap[1].second.size() == 2);
+    REQUIRE(merged.pool_varmap[2].first == last_snp);
+    REQUIRE(merged.pool_varmap[2].second.size() == 1);
+  }
+
+  SECTION("The read bias of a single pool is too shallow to be filtered")
+  {
+    VariantMap single;
+    single.load_many_variant_maps(std::vector<std::string>(1, paths[0]));
+    REQUIRE(single.samples == std::vector<std::string>({"sample0"}));
+    REQUIRE(single.pool_varmap.size() == 2);
+
+    single.filter_varmap_for_all();
+    REQUIRE(single.pool_varmap.size() == 2);
+    REQUIRE(single.pool_varmap[1].first == read_biased);
+  }
+
+  for (auto const & path : paths)
+    std::remove(path.c_str());
+
+  std::remove(paths_list.c_str());
+}
@@ -0,0 +1,240 @@
+#include <catch.hpp>
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <graphtyper/constants.hpp>
+#include <graphtyper/graph/absolute_position.hpp>
+#include <graphtyper/graph/graph.hpp>
+#include <graphtyper/typer/sample_call.hpp>
+#include <graphtyper/typer/variant.hpp>
+#include <graphtyper/typer/vcf.hpp>
+#include <graphtyper/typer/vcf_batch.hpp>
+#include <graphtyper/utilities/options.hpp>
+#include <graphtyper/utilities/system.hpp>
+#include <graphtyper/utilities/type_conversions.hpp>
+
+
+namespace
+{
+
+std::string
+get_batch_test_path(std::string const & name)
+{
+  std::string const dir = std::string(gyper_SOURCE_DIRECTORY) + "/test/data/batch";
+
+  if (!gyper::is_directory(dir))
+    gyper::create_dir(dir, 0755);
+
+  return dir + "/" + name;
+}
+
+
+gyper::SampleCall
+make_call(std::vector<uint8_t> && phred, std::vector<uint16_t> && coverage)
+{
+  gyper::SampleCall call(std::move(phred), std::move(coverage), 3 /*ambiguous_depth*/, 0, 7 /*alt_proper_pair_depth*/);
+  call.ref_total_depth = 300;
+  call.alt_total_depth = 17;
+  return call;
+}
+
+
+// A VCF with two samples, a biallelic variant with uniform calls and a multiallelic variant with one call of an
+// unexpected size
+void
+make_batch_test_vcf(gyper::Vcf & vcf)
+{
+  vcf.sample_names = {"sample1", "sample2"};
+
+  {
+    gyper::Variant var;
+    var.abs_pos = 1000;
+    var.seqs = {gyper::to_vec("A"), gyper::to_vec("C")};
+    var.suffix_id = "1";
+    var.infos["SVTYPE"] = "DEL";
+    var.infos["HOMSEQ"] = "";
+    var.stats.has_mapq_squared = true;
+    var.stats.mapq_squared = 5000000000ull; // Does not fit in 32 bits
+    var.calls.push_back(make_call({0, 10, 255}, {200, 1}));
+    var.calls.push_back(make_call({40, 0, 90}, {15, 16}));
+    vcf.variants.push_back(std::move(var));
+  }
+
+  {
+    gyper::Variant var;
+    var.abs_pos = static_cast<gyper::TAbsPos>(gyper::SPECIAL_START - 1);
+    var.seqs = {gyper::to_vec("AT"), gyper::to_vec("A"), gyper::to_vec("ATT")};
+    var.stats.has_clipped_reads = true;
+    var.stats.clipped_reads = 12;
+    var.stats.has_strand_bias = true;
+    var.stats.sbf = {1, 2, 3};
+    var.stats.sbr = {4, 5, 6};
+    var.stats.sbf1 = {1, 1, 1};
+    var.stats.sbf2 = {0, 1, 2};
+    var.stats.sbr1 = {2, 2, 2};
+    var.stats.sbr2 = {2, 3, 4};
+    var.calls.push_back(make_call({0, 1, 2, 3, 4, 5}, {0, 1, 2}));
+    var.calls.push_back(make_call({0, 20}, {9, 1})); // Not uniform
+    vcf.variants.push_back(std::move(var));
+  }
+}
+
+
+void
+require_equal_variants(gyper::Variant const & a, gyper::Variant const & b)
+{
+  REQUIRE(a.abs_pos == b.abs_pos);
+  REQUIRE(a.seqs == b.seqs);
+  REQUIRE(a.suffix_id == b.suffix_id);
+  REQUIRE(a.infos == b.infos);
+  REQUIRE(a.stats.has_clipped_reads == b.stats.has_clipped_reads);
+  REQUIRE(a.stats.has_mapq_squared == b.stats.has_mapq_squared);
+  REQUIRE(a.stats.has_strand_bias == b.stats.has_strand_bias);
+  REQUIRE(a.stats.clipped_reads == b.stats.clipped_reads);
+  REQUIRE(a.stats.mapq_squared == b.stats.mapq_squared);
+  REQUIRE(a.stats.sbf == b.stats.sbf);
+  REQUIRE(a.stats.sbr == b.stats.sbr);
+  REQUIRE(a.stats.sbf1 == b.stats.sbf1);
+  REQUIRE(a.stats.sbf2 == b.stats.sbf2);
+  REQUIRE(a.stats.sbr1 == b.stats.sbr1);
+  REQUIRE(a.stats.sbr2 == b.stats.sbr2);
+  REQUIRE(a.calls.size() == b.calls.size());
+
+  for (long c = 0; c < static_cast<long>(a.calls.size()); ++c)
+  {
+    REQUIRE(a.calls[c].phred == b.calls[c].phred);
+    REQUIRE(a.calls[c].coverage == b.calls[c].coverage);
+    REQUIRE(a.calls[c].ref_total_depth == b.calls[c].ref_total_depth);
+    REQUIRE(a.calls[c].alt_total_depth == b.calls[c].alt_total_depth);
+    REQUIRE(a.calls[c].ambiguous_depth == b.calls[c].ambiguous_depth);
+    REQUIRE(a.calls[c].alt_proper_pair_depth == b.calls[c].alt_proper_pair_depth);
+  }
+}
+
+
+} // anon namespace
+
+
+TEST_CASE("Write and read back a VCF batch")
+{
+  using namespace gyper;
+
+  Vcf vcf;
+  make_batch_test_vcf(vcf);
+  std::string const path = get_batch_test_path("round_trip");
+  write_vcf_batch(path, vcf.sample_names, vcf.variants.begin(), vcf.variants.end());
+
+  Vcf new_vcf;
+  REQUIRE(read_vcf_batch(path, new_vcf, true /*is_reading_sample_names*/));
+  REQUIRE(new_vcf.sample_names == vcf.sample_names);
+  REQUIRE(new_vcf.variants.size() == vcf.variants.size());
+
+  for (long v = 0; v < static_cast<long>(vcf.variants.size()); ++v)
+    require_equal_variants(new_vcf.variants[v], vcf.variants[v]);
+
+  SECTION("Sample names are only read when asked for")
+  {
+    Vcf sites_vcf;
+    REQUIRE(read_vcf_batch(path, sites_vcf, false /*is_reading_sample_names*/));
+    REQUIRE(sites_vcf.sample_names.size() == 0);
+    REQUIRE(sites_vcf.variants.size() == vcf.variants.size());
+  }
+
+  SECTION("A batch which does not exist is not read")
+  {
+    Vcf missing_vcf;
+    REQUIRE(!read_vcf_batch(get_batch_test_path("does_not_exist"), missing_vcf, true));
+  }
+}
+
+
+TEST_CASE("Write and read back an empty VCF batch")
+{
+  using namespace gyper;
+
+  std::vector<Variant> const no_variants;
+  std::vector<std::string> const sample_names = {"sample1"};
+  std::string const path = get_batch_test_path("empty");
+  write_vcf_batch(path, sample_names, no_variants.begin(), no_variants.end());
+
+  Vcf vcf;
+  REQUIRE(read_vcf_batch(path, vcf, true /*is_reading_sample_names*/));
+  REQUIRE(vcf.sample_names == sample_names);
+  REQUIRE(vcf.variants.size() == 0);
+}
+
+
+TEST_CASE("Stream a VCF saved in many batches")
+{
+  using namespace gyper;
+
+  Vcf vcf;
+  make_batch_test_vcf(vcf);
+  std::string const path = get_batch_test_path("streamed");
+
+  // Every variant goes in its own batch
+  long const old_num_alleles_in_batch = Options::instance()->num_alleles_in_batch;
+  Options::instance()->num_alleles_in_batch = 1;
+  save_vcf(vcf, path);
+  Options::instance()->num_alleles_in_batch = old_num_alleles_in_batch;
+
+  Vcf new_vcf;
+  load_vcf(new_vcf, path, 0);
+  REQUIRE(new_vcf.sample_names == vcf.sample_names);
+  REQUIRE(new_vcf.variants.size() == 1);
+
+  long n_batch{1};
+
+  while (append_vcf(new_vcf, path, n_batch))
+    ++n_batch;
+
+  // The last batch is empty, since every variant fills a batch
+  REQUIRE(n_batch == static_cast<long>(vcf.variants.size()) + 1);
+  REQUIRE(new_vcf.sample_names == vcf.sample_names);
+  REQUIRE(new_vcf.variants.size() == vcf.variants.size());
+
+  for (long v = 0; v < static_cast<long>(vcf.variants.size()); ++v)
+    require_equal_variants(new_vcf.variants[v], vcf.variants[v]);
+
+  for (long b = 0; b < n_batch; ++b)
+    std::remove((path + "_" + std::to_string(b)).c_str());
+}
+
+
+#ifdef GT_USE_64BIT_POSITIONS
+TEST_CASE("Write and read back a VCF batch with a position past 2^32")
+{
+  using namespace gyper;
+
+  // Two contigs which are together longer than what 32-bit positions can hold
+  std::vector<Contig> contigs(2);
+  contigs[0].name = "chrA";
+  contigs[0].length = 3000000000u;
+  contigs[1].name = "chrB";
+  contigs[1].length = 3000000000u;
+  AbsolutePosition const abs_positions(contigs);
+
+  TAbsPos const abs_pos = abs_positions.get_absolute_position("chrB", 2000000000u);
+  REQUIRE(abs_pos == 5000000000ull);
+  REQUIRE(abs_pos < SPECIAL_START);
+  REQUIRE(abs_positions.get_contig_position(abs_pos, contigs) == std::make_pair(std::string("chrB"), 2000000000u));
+
+  Vcf vcf;
+  make_batch_test_vcf(vcf);
+  vcf.variants[0].abs_pos = abs_pos; // Still before the second variant
+  std::string const path = get_batch_test_path("round_trip_64bit");
+  write_vcf_batch(path, vcf.sample_names, vcf.variants.begin(), vcf.variants.end());
+
+  Vcf new_vcf;
+  REQUIRE(read_vcf_batch(path, new_vcf, true /*is_reading_sample_names*/));
+  REQUIRE(new_vcf.variants.size() == vcf.variants.size());
+  REQUIRE(new_vcf.variants[0].abs_pos == 5000000000ull);
+
+  for (long v = 0; v < static_cast<long>(vcf.variants.size()); ++v)
+    require_equal_variants(new_vcf.variants[v], vcf.variants[v]);
+
+  std::remove(path.c_str());
+}
+#endif // GT_USE_64BIT_POSITIONS
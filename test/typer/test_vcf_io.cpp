@@ -3,12 +3,66 @@
 #include <stdio.h>
 #include <climits>
 #include <cstdio>
+#include <cstdlib>
+#include <sstream>
 #include <string>
+#include <vector>
 #include <iostream>
 #include <fstream>
 
+#include <htslib/bgzf.h>
+#include <htslib/tbx.h>
+#include <htslib/vcf.h>
+
 #include <graphtyper/constants.hpp>
+#include <graphtyper/graph/absolute_position.hpp>
+#include <graphtyper/graph/graph.hpp>
+#include <graphtyper/typer/sample_call.hpp>
+#include <graphtyper/typer/variant.hpp>
 #include <graphtyper/typer/vcf.hpp>
+#include <graphtyper/typer/vcf_operations.hpp>
+#include <graphtyper/utilities/system.hpp>
+#include <graphtyper/utilities/type_conversions.hpp>
+
+
+namespace
+{
+
+// Writes a BGZF compressed VCF with SNPs at the given positions of chr1
+std::string
+write_concat_test_vcf(std::string const & name, std::vector<uint32_t> const & positions, bool const is_indexed)
+{
+  std::string const dir = std::string(gyper_SOURCE_DIRECTORY) + "/test/data/concat";
+
+  if (!gyper::is_directory(dir))
+    gyper::create_dir(dir, 0755);
+
+  std::ostringstream ss;
+  ss << "##fileformat=VCFv4.2\n"
+     << "##contig=<ID=chr1,length=10000>\n"
+     << "#CHROM\tPOS\tID\tREF\tALT\tQUAL\tFILTER\tINFO\n";
+
+  for (auto const pos : positions)
+    ss << "chr1\t" << pos << "\t.\tA\tC\t0\t.\t.\n";
+
+  std::string const filename = dir + "/" + name + ".vcf.gz";
+  std::string const str = ss.str();
+  BGZF * fp = bgzf_open(filename.c_str(), "w");
+  REQUIRE(fp);
+  REQUIRE(bgzf_write(fp, str.data(), str.size()) == static_cast<ssize_t>(str.size()));
+  REQUIRE(bgzf_close(fp) == 0);
+
+  std::string const index = filename + ".tbi";
+  std::remove(index.c_str());
+
+  if (is_indexed)
+    REQUIRE(tbx_index_build(filename.c_str(), 0, &tbx_conf_vcf) == 0);
+
+  return filename;
+}
+
+
+} // anon namespace
 
 
 TEST_CASE("Read the index test VCF file")
@@ -43,3 +97,154 @@ TEST_CASE("Read the index test VCF file")
     REQUIRE(vcf.sample_names.size() == 0);
   }
 }
+
+
+TEST_CASE("Concatenate nested, adjacent and disjoint VCF files")
+{
+  using namespace gyper;
+
+  graph = Graph();
+  graph.contigs.resize(1);
+  graph.contigs[0].name = "chr1";
+  graph.contigs[0].length = 10000;
+  absolute_pos = AbsolutePosition(graph.contigs);
+
+  // B and C are inside A, and B has no index. D and E are adjacent and F is disjoint from the others.
+  std::vector<std::string> const vcfs = {
+    write_concat_test_vcf("F", {5000, 5001}, true),
+    write_concat_test_vcf("C", {30, 40}, true),
+    write_concat_test_vcf("A", {1, 35, 1000}, true),
+    write_concat_test_vcf("E", {2101, 2200}, true),
+    write_concat_test_vcf("B", {10, 20}, false),
+    write_concat_test_vcf("D", {2000, 2100}, true)
+  };
+
+  std::string const output = std::string(gyper_SOURCE_DIRECTORY) + "/test/data/concat/out.vcf.gz";
+  vcf_concatenate(vcfs, output, false /*SKIP_SORT*/, false /*SITES_ONLY*/, ".");
+
+  Vcf vcf(READ_BGZF_MODE, output);
+  vcf.read();
+
+  std::vector<uint32_t> const expected_positions = {1, 10, 20, 30, 35, 40, 1000, 2000, 2100, 2101, 2200, 5000, 5001};
+  std::vector<uint32_t> positions;
+
+  for (auto const & var : vcf.variants)
+    positions.push_back(absolute_pos.get_contig_position(var.abs_pos, graph.contigs).second);
+
+  REQUIRE(positions == expected_positions);
+}
+
+
+TEST_CASE("Read a subset of the samples of a VCF and a BCF file")
+{
+  using namespace gyper;
+
+  graph = Graph();
+  graph.contigs.resize(1);
+  graph.contigs[0].name = "chr1";
+  graph.contigs[0].length = 10000;
+  absolute_pos = AbsolutePosition(graph.contigs);
+
+  std::string const dir = std::string(gyper_SOURCE_DIRECTORY) + "/test/data/subset";
+
+  if (!is_directory(dir))
+    create_dir(dir, 0755);
+
+  std::vector<std::string> const all_samples = {"sample1", "sample2", "sample3"};
+
+  for (std::string const ext : {".vcf.gz", ".bcf"})
+  {
+    std::string const filename = dir + "/samples" + ext;
+
+    {
+      Vcf vcf(WRITE_MODE, filename);
+      vcf.sample_names = all_samples;
+
+      Variant var;
+      var.abs_pos = absolute_pos.get_absolute_position("chr1", 100);
+      var.seqs = {to_vec("A"), to_vec("C")};
+
+      // The samples have different coverage so they can be told apart
+      for (uint16_t s = 1; s <= 3; ++s)
+        var.calls.push_back(SampleCall({0, 10, 20}, {s, 0}, 0, 0, 0));
+
+      vcf.variants.push_back(std::move(var));
+      vcf.write();
+    }
+
+    SECTION("Read two samples of " + ext)
+    {
+      Vcf vcf(READ_MODE, filename);
+      vcf.open_vcf_file_for_reading();
+      vcf.read_samples();
+      vcf.set_sample_subset({"sample3", "sample1"});
+      REQUIRE(vcf.sample_names == std::vector<std::string>({"sample1", "sample3"}));
+      REQUIRE(vcf.read_record());
+      REQUIRE(vcf.variants.size() == 1);
+      REQUIRE(vcf.variants[0].calls.size() == 2);
+      REQUIRE(vcf.variants[0].calls[0].coverage[0] == 1);
+      REQUIRE(vcf.variants[0].calls[1].coverage[0] == 3);
+    }
+
+    SECTION("An empty subset reads all samples of " + ext)
+    {
+      Vcf vcf(READ_MODE, filename);
+      vcf.open_vcf_file_for_reading();
+      vcf.read_samples();
+      vcf.set_sample_subset({});
+      REQUIRE(vcf.sample_names == all_samples);
+      REQUIRE(vcf.read_record());
+      REQUIRE(vcf.variants.size() == 1);
+      REQUIRE(vcf.variants[0].calls.size() == 3);
+      REQUIRE(vcf.variants[0].calls[1].coverage[0] == 2);
+    }
+  }
+}
+
+
+TEST_CASE("INFO fields which GraphTyper does not declare are kept in BCF output")
+{
+  using namespace gyper;
+
+  graph = Graph();
+  graph.contigs.resize(1);
+  graph.contigs[0].name = "chr1";
+  graph.contigs[0].length = 10000;
+  absolute_pos = AbsolutePosition(graph.contigs);
+
+  std::string const dir = std::string(gyper_SOURCE_DIRECTORY) + "/test/data/subset";
+
+  if (!is_directory(dir))
+    create_dir(dir, 0755);
+
+  std::string const filename = dir + "/custom_infos.bcf";
+
+  {
+    Vcf vcf(WRITE_MODE, filename);
+    Variant var;
+    var.abs_pos = absolute_pos.get_absolute_position("chr1", 100);
+    var.seqs = {to_vec("A"), to_vec("C")};
+    var.infos["CUSTOM"] = "a,b";
+    var.infos["CUSTOMFLAG"] = "";
+    vcf.variants.push_back(std::move(var));
+    vcf.write();
+  }
+
+  htsFile * fp = hts_open(filename.c_str(), "r");
+  REQUIRE(fp);
+  bcf_hdr_t * hdr = bcf_hdr_read(fp);
+  REQUIRE(hdr);
+  bcf1_t * rec = bcf_init();
+  REQUIRE(bcf_read(fp, hdr, rec) == 0);
+
+  char * value{nullptr};
+  int n_value{0};
+  REQUIRE(bcf_get_info_string(hdr, rec, "CUSTOM", &value, &n_value) > 0);
+  REQUIRE(std::string(value) == "a,b");
+  REQUIRE(bcf_get_info_flag(hdr, rec, "CUSTOMFLAG", nullptr, nullptr) == 1);
+
+  free(value);
+  bcf_destroy(rec);
+  bcf_hdr_destroy(hdr);
+  hts_close(fp);
+}
@@ -0,0 +1,168 @@
+#include <catch.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <htslib/hts.h>
+#include <htslib/kstring.h>
+#include <htslib/sam.h>
+
+#include <graphtyper/graph/genomic_region.hpp>
+#include <graphtyper/utilities/bamshrink.hpp>
+#include <graphtyper/utilities/options.hpp>
+#include <graphtyper/utilities/system.hpp>
+
+
+namespace
+{
+
+std::string
+get_bamshrink_test_path(std::string const & name)
+{
+  std::string const dir = std::string(gyper_SOURCE_DIRECTORY) + "/test/data/bamshrink";
+
+  if (!gyper::is_directory(dir))
+    gyper::create_dir(dir, 0755);
+
+  return dir + "/" + name;
+}
+
+
+// Copies the test SAM to an indexed BAM, which bamshrink needs to query regions
+std::string
+make_test_bam()
+{
+  std::string const sam_path = std::string(gyper_SOURCE_DIRECTORY) + "/test/data/reference/test.sam";
+  std::string const bam_path = get_bamshrink_test_path("test.bam");
+  htsFile * in = hts_open(sam_path.c_str(), "r");
+  REQUIRE(in);
+  bam_hdr_t * hdr = sam_hdr_read(in);
+  REQUIRE(hdr);
+  htsFile * out = hts_open(bam_path.c_str(), "wb");
+  REQUIRE(out);
+  REQUIRE(sam_hdr_write(out, hdr) >= 0);
+  bam1_t * rec = bam_init1();
+
+  while (sam_read1(in, hdr, rec) >= 0)
+    REQUIRE(sam_write1(out, hdr, rec) >= 0);
+
+  bam_destroy1(rec);
+  bam_hdr_destroy(hdr);
+  hts_close(in);
+  REQUIRE(hts_close(out) == 0);
+  REQUIRE(sam_index_build(bam_path.c_str(), 0) == 0);
+  return bam_path;
+}
+
+
+// Returns the header text and each record as a SAM line
+std::pair<std::string, std::vector<std::string> >
+read_records(std::string const & path)
+{
+  std::pair<std::string, std::vector<std::string> > header_and_records;
+  htsFile * fp = hts_open(path.c_str(), "r");
+  REQUIRE(fp);
+  bam_hdr_t * hdr = sam_hdr_read(fp);
+  REQUIRE(hdr);
+  header_and_records.first = std::string(hdr->text, hdr->l_text);
+  bam1_t * rec = bam_init1();
+  kstring_t line = {0, 0, nullptr};
+
+  while (sam_read1(fp, hdr, rec) >= 0)
+  {
+    REQUIRE(sam_format1(hdr, rec, &line) >= 0);
+    header_and_records.second.emplace_back(line.s, line.l);
+  }
+
+  free(line.s);
+  bam_destroy1(rec);
+  bam_hdr_destroy(hdr);
+  hts_close(fp);
+  return header_and_records;
+}
+
+
+} // anon namespace
+
+
+TEST_CASE("Shrinking many regions in one pass gives the same reads as shrinking each region")
+{
+  using namespace gyper;
+
+  // The reads in the test file are short, so the length filters are lowered. A short fragment length keeps the
+  // query windows of the regions small, so some regions share a window and others do not.
+  Options & opts = *Options::instance();
+  std::vector<int> const old_opts = {opts.bamshrink_max_fraglen,
+                                     opts.bamshrink_min_matching,
+                                     opts.bamshrink_min_readlen,
+                                     opts.bamshrink_min_readlen_low_mapq,
+                                     opts.bamshrink_min_unpair_readlen};
+  opts.bamshrink_max_fraglen = 300;
+  opts.bamshrink_min_matching = 30;
+  opts.bamshrink_min_readlen = 30;
+  opts.bamshrink_min_readlen_low_mapq = 30;
+  opts.bamshrink_min_unpair_readlen = 30;
+
+  std::string const bam_path = make_test_bam();
+
+  // Not sorted, with overlapping and equal regions, regions in the same query window, a region in a window of its own
+  // and a region without reads
+  std::vector<GenomicRegion> const regions = {GenomicRegion("chr2", 101, 400),
+                                              GenomicRegion("chr1", 601, 900),
+                                              GenomicRegion("chr1", 101, 400),
+                                              GenomicRegion("chr1", 301, 700),
+                                              GenomicRegion("chr1", 1401, 1500),
+                                              GenomicRegion("chr2", 4001, 4500),
+                                              GenomicRegion("chr1", 301, 700)};
+
+  std::vector<std::string> batch_paths;
+
+  for (long r = 0; r < static_cast<long>(regions.size()); ++r)
+    batch_paths.push_back(get_bamshrink_test_path("batch_" + std::to_string(r) + ".bam"));
+
+  bamshrink_regions(regions, bam_path, bam_path + ".bai", batch_paths, 0.0 /*avg_cov_by_readlen*/, "");
+  long num_records{0};
+
+  for (long r = 0; r < static_cast<long>(regions.size()); ++r)
+  {
+    std::string const single_path = get_bamshrink_test_path("single_" + std::to_string(r) + ".bam");
+    gyper::bamshrink(regions[r].chr,
+                     regions[r].begin,
+                     regions[r].end,
+                     bam_path,
+                     bam_path + ".bai",
+                     single_path,
+                     0.0 /*avg_cov_by_readlen*/,
+                     "");
+
+    auto const batch = read_records(batch_paths[r]);
+    auto const single = read_records(single_path);
+    REQUIRE(batch.first == single.first);
+    REQUIRE(batch.second.size() == single.second.size());
+
+    for (long i = 0; i < static_cast<long>(batch.second.size()); ++i)
+      REQUIRE(batch.second[i] == single.second[i]);
+
+    num_records += batch.second.size();
+
+    if (regions[r].begin >= 4000)
+      REQUIRE(batch.second.size() == 0);
+    else
+      REQUIRE(batch.second.size() > 0);
+
+    std::remove(batch_paths[r].c_str());
+    std::remove(single_path.c_str());
+  }
+
+  REQUIRE(num_records > 100);
+  std::remove((bam_path + ".bai").c_str());
+  std::remove(bam_path.c_str());
+  opts.bamshrink_max_fraglen = old_opts[0];
+  opts.bamshrink_min_matching = old_opts[1];
+  opts.bamshrink_min_readlen = old_opts[2];
+  opts.bamshrink_min_readlen_low_mapq = old_opts[3];
+  opts.bamshrink_min_unpair_readlen = old_opts[4];
+}
@@ -0,0 +1,152 @@
+#include <catch.hpp>
+
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <graphtyper/utilities/bgzf_stream.hpp>
+
+
+namespace
+{
+
+// Redirects std::cout, where a BGZF_stream which is not opened writes its text
+class CoutCapture
+{
+public:
+  std::ostringstream ss;
+  std::streambuf * old_buf{nullptr};
+
+  CoutCapture()
+    : old_buf(std::cout.rdbuf(ss.rdbuf()))
+  {}
+
+
+  ~CoutCapture()
+  {
+    std::cout.rdbuf(old_buf);
+  }
+
+
+};
+
+
+template <typename T>
+std::string
+to_bgzf_string(T const val)
+{
+  CoutCapture capture;
+
+  {
+    gyper::BGZF_stream stream;
+    stream << val;
+    stream.close();
+  }
+
+  return capture.ss.str();
+}
+
+
+std::string
+phred_to_bgzf_string(std::vector<uint8_t> const & phred)
+{
+  CoutCapture capture;
+
+  {
+    gyper::BGZF_stream stream;
+    stream << "PL=";
+    stream.write_phred(phred);
+    stream << ';';
+    stream.close();
+  }
+
+  return capture.ss.str();
+}
+
+
+} // anon namespace
+
+
+TEST_CASE("Unsigned integers are formatted like std::to_string")
+{
+  std::vector<uint64_t> const vals = {0ull, 1ull, 9ull, 10ull, 99ull, 100ull, 101ull, 999ull, 1000ull, 65535ull,
+                                      4294967295ull, 4294967296ull, 9999999999999999999ull,
+                                      10000000000000000000ull, std::numeric_limits<uint64_t>::max() - 1,
+                                      std::numeric_limits<uint64_t>::max()};
+
+  for (uint64_t const val : vals)
+  {
+    REQUIRE(to_bgzf_string(static_cast<unsigned long long>(val)) == std::to_string(val));
+    REQUIRE(to_bgzf_string(static_cast<unsigned long>(val)) == std::to_string(static_cast<unsigned long>(val)));
+    REQUIRE(to_bgzf_string(static_cast<unsigned int>(val)) == std::to_string(static_cast<unsigned int>(val)));
+    REQUIRE(to_bgzf_string(static_cast<unsigned short>(val)) ==
+            std::to_string(static_cast<unsigned short>(val)));
+  }
+}
+
+
+TEST_CASE("Signed integers are formatted like std::to_string")
+{
+  std::vector<int64_t> const vals = {0ll, 1ll, -1ll, 9ll, -9ll, 10ll, -10ll, 99ll, -99ll, 100ll, -100ll,
+                                     32767ll, -32768ll, 2147483647ll, -2147483648ll, 2147483648ll, -2147483649ll,
+                                     std::numeric_limits<int64_t>::max(), std::numeric_limits<int64_t>::min() + 1,
+                                     std::numeric_limits<int64_t>::min()};
+
+  for (int64_t const val : vals)
+  {
+    REQUIRE(to_bgzf_string(static_cast<long long>(val)) == std::to_string(val));
+    REQUIRE(to_bgzf_string(static_cast<long>(val)) == std::to_string(static_cast<long>(val)));
+    REQUIRE(to_bgzf_string(static_cast<int>(val)) == std::to_string(static_cast<int>(val)));
+    REQUIRE(to_bgzf_string(static_cast<short>(val)) == std::to_string(static_cast<short>(val)));
+  }
+}
+
+
+TEST_CASE("Mixed text is written like an ostream writes it")
+{
+  std::ostringstream expected;
+  CoutCapture capture;
+
+  {
+    gyper::BGZF_stream stream;
+    stream << "chr1" << '\t' << 123456789u << '\t' << -42 << '\t' << std::string("AC") << '\t'
+           << std::numeric_limits<int64_t>::min() << '\t' << std::numeric_limits<uint64_t>::max() << '\t' << 0.5;
+    stream.close();
+  }
+
+  expected << "chr1" << '\t' << 123456789u << '\t' << -42 << '\t' << std::string("AC") << '\t'
+           << std::numeric_limits<int64_t>::min() << '\t' << std::numeric_limits<uint64_t>::max() << '\t' << 0.5;
+
+  REQUIRE(capture.ss.str() == expected.str());
+}
+
+
+TEST_CASE("PL lists are written with one to three digits per value")
+{
+  REQUIRE(phred_to_bgzf_string({}) == "PL=;");
+  REQUIRE(phred_to_bgzf_string({0}) == "PL=0;");
+  REQUIRE(phred_to_bgzf_string({255}) == "PL=255;");
+  REQUIRE(phred_to_bgzf_string({0, 9, 10, 99, 100, 101, 109, 110, 199, 200, 255}) ==
+          "PL=0,9,10,99,100,101,109,110,199,200,255;");
+
+  // Every value, and a list which is longer than any buffer growth step
+  std::vector<uint8_t> all_vals;
+  std::string expected = "PL=";
+
+  for (long r = 0; r < 10; ++r)
+  {
+    for (long val = 0; val <= 255; ++val)
+    {
+      if (all_vals.size() > 0)
+        expected += ',';
+
+      all_vals.push_back(static_cast<uint8_t>(val));
+      expected += std::to_string(val);
+    }
+  }
+
+  REQUIRE(phred_to_bgzf_string(all_vals) == expected + ";");
+}